@@ -24,6 +24,29 @@
 #define __BLOCKALLOCATOR_H__
 
 #include <iostream>
+#include <atomic>
+#include <new>
+#include <stddef.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+//reserves page aligned memory for large arenas. If hugePages is set 
+//and bytes is at least HUGE_PAGE_SIZE, the memory is aligned to huge 
+//pages and marked for transparent huge pages (Linux only). bytes is 
+//rounded up to the reserved size that has to be passed to freePages().
+inline void *allocPages(size_t &bytes, bool hugePages);
+inline void  freePages(void *p, size_t bytes);
+
 
 //NOTE: size of class C must be bigger than the size of a pointer
 template<class C, unsigned int BLOCKSIZE=1024>
@@ -56,29 +79,90 @@ class BlockAllocator
 
 
 
+//Process wide pool of blocks of BLOCKSIZE elements of class C shared
+//by all BlockAllocatorLocal and BlockAllocatorStatic instances. Blocks 
+//are kept in a lock-free list: they are returned as whole chains and 
+//taken by detaching the entire list, so that no thread ever follows a 
+//link another thread may change (no ABA problem).
+template<class C, unsigned int BLOCKSIZE=1024>
+class BlockPool
+{
+ public:
+  struct Block {
+    C data[BLOCKSIZE];
+    Block *nextBlock;
+  };
+
+ private:
+  std::atomic<Block*> freeBlocks;
+
+  BlockPool() : freeBlocks(0) {};
+
+ public:
+  ~BlockPool();
+
+  static BlockPool &global() { static BlockPool pool; return pool; };
+
+  Block *acquire();                          //takes a block (or creates one)
+  void   release(Block *first, Block *last); //returns the chain first..last
+};
+
+
+
+
+//Allocator with the interface of BlockAllocator that takes its blocks
+//from the global BlockPool. Each thread (or solver) owns its instance,
+//so alloc() and dealloc() need no synchronization. reset() returns 
+//all blocks to the pool at once.
+//NOTE: size of class C must be bigger than the size of a pointer
+template<class C, unsigned int BLOCKSIZE=1024>
+class BlockAllocatorLocal
+{
+  typedef typename BlockPool<C,BLOCKSIZE>::Block Block;
+
+  Block *firstBlock;
+  Block *lastBlock;
+
+  C *firstFree; //points to the first free slot
+
+  C** castCtoCPtr(C *c) { return reinterpret_cast<C**>(c); }; //inline cast
+
+ public:
+  BlockAllocatorLocal() : firstBlock(0), lastBlock(0), firstFree(0) {};
+  ~BlockAllocatorLocal() { reset(); };
+
+  inline C *alloc();         //returns a pointer to a free slot
+  inline void dealloc(C *);  //frees a slot
+  void reset(); //frees all elements and returns the blocks to the pool
+};
+
+
+
+
+//Allocator that hands out the slots of its blocks in order and can 
+//enumerate them. The blocks come from the global BlockPool, and reset() 
+//returns them all at once.
 //NOTE: size of class C must be bigger than the size of a pointer
 template<class C, unsigned int BLOCKSIZE=1024>
 class BlockAllocatorStatic
 {  
-  struct AllocBlock {
-    C *data;
-    AllocBlock *nextBlock;
-  };
-  
-  AllocBlock *firstBlock;
-  AllocBlock *currentBlock; //for fast access
+  typedef typename BlockPool<C,BLOCKSIZE>::Block Block;
+
+  Block *firstBlock;
+  Block *currentBlock; //for fast access
     
   C *firstFree; //points to the first free slot
 
   //auxiliary variables for blockwise enumeration
-  AllocBlock *enumBlock;
+  Block *enumBlock;
   C *enumItem;
   
 public:
    BlockAllocatorStatic() : firstBlock(0), currentBlock(0), firstFree(0) {};
-  ~BlockAllocatorStatic();
+  ~BlockAllocatorStatic() { reset(); };
   
   inline C *alloc();         //returns a pointer to a free slot
+  void reset(); //frees all elements and returns the blocks to the pool
   
   //methods for blockwise entity enumeration 
   inline C *getFirst();
@@ -176,37 +260,194 @@ template<class C, unsigned int BLOCKSIZE>
 
 
 //********************************************************************
-//       BlockAllocatorStatic
+//       Page memory
 //********************************************************************
 
-template<class C, unsigned int BLOCKSIZE>
-BlockAllocatorStatic<C,BLOCKSIZE>::~BlockAllocatorStatic() {
-  AllocBlock *block = firstBlock, *prevBlock;
+inline void *allocPages(size_t &bytes, bool hugePages) {
+
+  size_t pageSize = 4096;
+
+  if (hugePages && bytes >= HUGE_PAGE_SIZE)
+    pageSize = HUGE_PAGE_SIZE;
+  else
+    hugePages = false;
+
+  bytes = (bytes + pageSize - 1) & ~(pageSize - 1);
+
+#ifdef _WIN32
+  //large pages require a user privilege on Windows
+  void *p = VirtualAlloc(0, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+#else
+  if (!hugePages) {
+    void *p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      throw std::bad_alloc();
+    return p;
+  }
 
-  //free all the allocated blocks
+  //map one huge page more and trim the mapping to an aligned region
+  size_t mapBytes = bytes + HUGE_PAGE_SIZE;
+  char *map = static_cast<char*>(mmap(0, mapBytes, PROT_READ | PROT_WRITE, 
+				      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (map == MAP_FAILED)
+    throw std::bad_alloc();
+
+  char *p = reinterpret_cast<char*>((reinterpret_cast<size_t>(map) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+  if (p > map)
+    munmap(map, p - map);
+  if (map + mapBytes > p + bytes)
+    munmap(p + bytes, map + mapBytes - (p + bytes));
+
+#ifdef MADV_HUGEPAGE
+  madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+
+  return p;
+#endif
+}
+
+
+inline void freePages(void *p, size_t bytes) {
+  if (!p)
+    return;
+#ifdef _WIN32
+  VirtualFree(p, 0, MEM_RELEASE);
+#else
+  munmap(p, bytes);
+#endif
+}
+
+
+
+//********************************************************************
+//       BlockPool
+//********************************************************************
+
+template<class C, unsigned int BLOCKSIZE>
+BlockPool<C,BLOCKSIZE>::~BlockPool() {
+  Block *block = freeBlocks.exchange(0), *nextBlock;
   while (block) {
-    delete [] block->data;
-    prevBlock = block;
-    if (block->nextBlock == block) 
-      block = 0; //last block in the list
+    nextBlock = block->nextBlock;
+    delete block;
+    block = nextBlock;
+  }
+}
+
+
+template<class C, unsigned int BLOCKSIZE>
+typename BlockPool<C,BLOCKSIZE>::Block *BlockPool<C,BLOCKSIZE>::acquire() {
+
+  //detach the whole list - a thread running into the empty list
+  //meanwhile simply creates a new block
+  Block *block = freeBlocks.exchange(0, std::memory_order_acquire);
+  if (!block)
+    return new Block;
+
+  //put back the rest of the chain
+  if (block->nextBlock) {
+    Block *last = block->nextBlock;
+    while (last->nextBlock)
+      last = last->nextBlock;
+    release(block->nextBlock, last);
+  }
+
+  block->nextBlock = 0;
+  return block;
+}
+
+
+template<class C, unsigned int BLOCKSIZE>
+void BlockPool<C,BLOCKSIZE>::release(Block *first, Block *last) {
+  Block *head = freeBlocks.load(std::memory_order_relaxed);
+  do {
+    last->nextBlock = head;
+  } while (!freeBlocks.compare_exchange_weak(head, first,
+					     std::memory_order_release,
+					     std::memory_order_relaxed));
+}
+
+
+
+//********************************************************************
+//       BlockAllocatorLocal
+//********************************************************************
+
+template<class C,unsigned int BLOCKSIZE>
+C *BlockAllocatorLocal<C,BLOCKSIZE>::alloc() {
+  C *c;
+
+  if (!firstFree) {
+    Block *block = BlockPool<C,BLOCKSIZE>::global().acquire();
+    if (lastBlock) 
+      lastBlock->nextBlock = block;
     else
-      block = block->nextBlock;
-    delete prevBlock;
+      firstBlock = block;
+    lastBlock = block;
+
+    //each slot in the new block points to the next one
+    for (unsigned int i=0; i<BLOCKSIZE-1; i++) 
+      *castCtoCPtr(block->data + i) = block->data + i + 1;
+
+    //except the last one
+    *castCtoCPtr(block->data + BLOCKSIZE - 1) = 0;
+
+    firstFree = block->data;
+  } 
+
+  c         = firstFree;
+  firstFree = *castCtoCPtr(firstFree);
+
+  return c;
+}
+
+
+template<class C, unsigned int BLOCKSIZE>
+void BlockAllocatorLocal<C,BLOCKSIZE>::dealloc(C *c) {
+  if (c) {
+    *castCtoCPtr(c) = firstFree;
+    firstFree = c;
   }
 }
 
 
+template<class C, unsigned int BLOCKSIZE>
+void BlockAllocatorLocal<C,BLOCKSIZE>::reset() {
+  if (firstBlock)
+    BlockPool<C,BLOCKSIZE>::global().release(firstBlock, lastBlock);
+  firstBlock = 0;
+  lastBlock  = 0;
+  firstFree  = 0;
+}
+
+
+
+//********************************************************************
+//       BlockAllocatorStatic
+//********************************************************************
+
+template<class C, unsigned int BLOCKSIZE>
+void BlockAllocatorStatic<C,BLOCKSIZE>::reset() {
+  if (firstBlock)
+    BlockPool<C,BLOCKSIZE>::global().release(firstBlock, currentBlock);
+  firstBlock   = 0;
+  currentBlock = 0;
+  firstFree    = 0;
+}
+
+
 template<class C,unsigned int BLOCKSIZE>
 C *BlockAllocatorStatic<C,BLOCKSIZE>::alloc() {
   C *c;
 
   if (!firstFree) {
-    AllocBlock *block = new AllocBlock();
-    block->nextBlock  = block;
-    if (!currentBlock) //have any blocks been allocated so far?
-      firstBlock = currentBlock = block;
-    block->data = new C[BLOCKSIZE];
-    currentBlock->nextBlock = block;
+    Block *block = BlockPool<C,BLOCKSIZE>::global().acquire();
+    if (currentBlock) //have any blocks been allocated so far?
+      currentBlock->nextBlock = block;
+    else
+      firstBlock = block;
     currentBlock = block;
     firstFree = block->data;
   } 
@@ -233,7 +474,7 @@ template<class C,unsigned int BLOCKSIZE>
 inline C *BlockAllocatorStatic<C, BLOCKSIZE>::getNext() {
   C *nextEnumItem = enumItem + 1;
   if (!((unsigned int)(nextEnumItem - enumBlock->data) < BLOCKSIZE)) {
-    if (enumBlock->nextBlock == enumBlock)
+    if (enumBlock == currentBlock)
       return 0;
     enumBlock = enumBlock->nextBlock;
     nextEnumItem  = enumBlock->data;
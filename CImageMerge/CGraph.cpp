@@ -21,6 +21,9 @@
 *****************************************************************************/
 
 #include "CGraph.h"
+#include "IndexHeap.h"
+#include "ThreadPool.h"
+#include <string.h>
 
 using namespace std;
 
@@ -36,19 +39,40 @@ CGraph::CGraph(uint numMaxNodes)
   edgeBlock = new BlockAllocatorStatic<CGEdge, NODE_BLOCK_SIZE>;
 
   this->numMaxNodes = numMaxNodes;
+  this->curEpoch = 0;
+
+  csrNumNodes = 0;
+  csrFirst  = NULL;
+  csrHead   = NULL;
+  csrWeight = NULL;
 }
 
 CGraph::~CGraph()
 {
   delete nodeBlock;
   delete edgeBlock;
+  freeCSR();
 }
 
 void CGraph::clear() {
-  delete nodeBlock;
-  delete edgeBlock;
-  nodeBlock = new BlockAllocatorStatic<CGNode, NODE_BLOCK_SIZE>;
-  edgeBlock = new BlockAllocatorStatic<CGEdge, NODE_BLOCK_SIZE>;
+  //the blocks go back to the global pool for the next graph
+  nodeBlock->reset();
+  edgeBlock->reset();
+  freeCSR();
+}
+
+void CGraph::freeCSR() {
+  if (csrFirst)
+    delete [] csrFirst;
+  if (csrHead)
+    delete [] csrHead;
+  if (csrWeight)
+    delete [] csrWeight;
+
+  csrNumNodes = 0;
+  csrFirst  = NULL;
+  csrHead   = NULL;
+  csrWeight = NULL;
 }
 
 CGNode * CGraph::addNode()
@@ -59,8 +83,10 @@ CGNode * CGraph::addNode()
   n->dijkWeight= 0;
   n->dijkPrev = NULL;
   n->type = 0;
+  n->epoch = 0;
 
   n->first = NULL;
+  n->firstIn = NULL;
 
   return n;
 }
@@ -74,8 +100,10 @@ CGNode * CGraph::addNode(int tag)
   n->dijkWeight= 0;
   n->dijkPrev = NULL;
   n->type = 0;
+  n->epoch = 0;
 
   n->first = NULL;
+  n->firstIn = NULL;
 
   return n;
 }
@@ -88,7 +116,10 @@ void CGraph::addEdge(CGNode * from, CGNode * to, CapType weight) {
   e->sister = NULL;
   e->next = ((CGNode *)from)->first;
   ((CGNode *)from)->first = e;
+  e->nextIn = ((CGNode *)to)->firstIn;
+  ((CGNode *)to)->firstIn = e;
   e->head = (CGNode *)to;
+  e->tail = (CGNode *)from;
   e->weight = weight;
 }
 
@@ -157,12 +188,25 @@ void CGraph::runDijkstra(CGNode * start) {
   dijk.node = start;
   start->heapId = dh.insert(dijk);
 
+  //nodes reached via zero weight edges are settled immediately 
+  //without passing through the heap (see below)
+  CGNode **zeroNodes = new CGNode*[numMaxNodes];
+  int numZeroNodes = 0;
+
   //compute shortest path
   CDijkNode min;
 
-  while(dh.deleteMin(min)) {
+  while (true) {
+
+    CGNode *n, *d;
+
+    if (numZeroNodes)
+      n = zeroNodes[--numZeroNodes];
+    else if (dh.deleteMin(min))
+      n = min.node;
+    else
+      break;
 
-    CGNode *n = min.node, *d;
     CGEdge *e = n->first;
 
     n->heapId = 0;	//n has already been removed from the heap
@@ -191,12 +235,18 @@ void CGraph::runDijkstra(CGNode * start) {
 
 	d->dijkWeight = n->dijkWeight + e->weight;
 	d->dijkPrev = n;
-	  
-	CDijkNode dijk;
-	dijk.dijkWeight = d->dijkWeight;
-	dijk.node = d;
-	//	fh.insert(dijk, d->fid);
-	d->heapId = dh.insert(dijk);
+
+	if (e->weight == 0) {
+	  //no node in the heap can be closer than n, so the shortest 
+	  //path to the target node is known already
+	  zeroNodes[numZeroNodes++] = d;
+	} else {
+	  CDijkNode dijk;
+	  dijk.dijkWeight = d->dijkWeight;
+	  dijk.node = d;
+	  //	fh.insert(dijk, d->fid);
+	  d->heapId = dh.insert(dijk);
+	}
 	
       }
 
@@ -204,6 +254,350 @@ void CGraph::runDijkstra(CGNode * start) {
     } //while(e)
   }
 
+  delete [] zeroNodes;
+
+}
+
+
+
+CGNode *CGraph::runDijkstraMulti(CGNode **start, int numStart, CGNode **end, int numEnd) {
+
+  //invalidate the search fields of all nodes at once
+  if (++curEpoch == 0) {
+    CGNode *n = nodeBlock->getFirst();
+    while (n) {
+      n->epoch = 0;
+      n = nodeBlock->getNext();
+    }
+    curEpoch = 1;
+  }
+
+  DijkHeap fwd(numMaxNodes); //forward search from the start nodes
+  DijkHeap bwd(numMaxNodes); //backward search from the end nodes
+  CDijkNode dijk, min;
+  int i;
+
+  //length of the shortest path found so far - it consists of the forward
+  //path to meetFrom, the edge (meetFrom, meetTo) and the backward path 
+  //from meetTo (meetFrom is NULL if the path consists of meetTo only)
+  CapType best = CAP_INF;
+  CGNode *meetFrom = NULL, *meetTo = NULL;
+
+  for (i=0; i<numStart; i++) {
+    CGNode *n = start[i];
+    touchNode(n);
+    if (n->dijkWeight == 0)
+      continue;
+    n->dijkWeight = 0;
+    dijk.dijkWeight = 0;
+    dijk.node = n;
+    n->heapId = fwd.insert(dijk);
+  }
+
+  for (i=0; i<numEnd; i++) {
+    CGNode *n = end[i];
+    touchNode(n);
+    if (n->dijkWeightRev == 0)
+      continue;
+    n->dijkWeightRev = 0;
+    dijk.dijkWeight = 0;
+    dijk.node = n;
+    n->heapIdRev = bwd.insert(dijk);
+
+    //start and end node at the same time
+    if (n->dijkWeight == 0) {
+      best = 0;
+      meetTo = n;
+    }
+  }
+
+  while (!fwd.isempty() && !bwd.isempty() && fwd.getMin() + bwd.getMin() < best) {
+
+    if (fwd.getMin() <= bwd.getMin()) {
+
+      //forward step
+      fwd.deleteMin(min);
+      CGNode *n = min.node;
+      n->heapId = NULL; //n has already been removed from the heap
+
+      for (CGEdge *e = n->first; e; e = e->next) {
+	CGNode *d = e->head;
+	CapType w = n->dijkWeight + e->weight;
+
+	touchNode(d);
+
+	if (d->heapId) {
+	  if (d->dijkWeight > w) {
+	    d->dijkWeight = w;
+	    d->dijkPrev = n;
+	    fwd.decrease(d->heapId, w);
+	  }
+	} else if (d->dijkWeight == CAP_INF) {
+	  d->dijkWeight = w;
+	  d->dijkPrev = n;
+	  dijk.dijkWeight = w;
+	  dijk.node = d;
+	  d->heapId = fwd.insert(dijk);
+	}
+
+	//does the edge connect to the backward search?
+	if (d->dijkWeightRev != CAP_INF && w + d->dijkWeightRev < best) {
+	  best = w + d->dijkWeightRev;
+	  meetFrom = n;
+	  meetTo = d;
+	}
+      }
+
+    } else {
+
+      //backward step
+      bwd.deleteMin(min);
+      CGNode *n = min.node;
+      n->heapIdRev = NULL;
+
+      for (CGEdge *e = n->firstIn; e; e = e->nextIn) {
+	CGNode *d = e->tail;
+	CapType w = n->dijkWeightRev + e->weight;
+
+	touchNode(d);
+
+	if (d->heapIdRev) {
+	  if (d->dijkWeightRev > w) {
+	    d->dijkWeightRev = w;
+	    d->dijkNext = n;
+	    bwd.decrease(d->heapIdRev, w);
+	  }
+	} else if (d->dijkWeightRev == CAP_INF) {
+	  d->dijkWeightRev = w;
+	  d->dijkNext = n;
+	  dijk.dijkWeight = w;
+	  dijk.node = d;
+	  d->heapIdRev = bwd.insert(dijk);
+	}
+
+	if (d->dijkWeight != CAP_INF && d->dijkWeight + w < best) {
+	  best = d->dijkWeight + w;
+	  meetFrom = d;
+	  meetTo = n;
+	}
+      }
+
+    }
+
+  }
+
+  if (!meetTo)
+    return NULL;
+
+  //link the backward path via dijkPrev as well, so that the whole 
+  //path can be retrieved by getShortestPath()
+  if (meetFrom)
+    meetTo->dijkPrev = meetFrom;
+
+  CGNode *n = meetTo;
+  while (n->dijkNext) {
+    n->dijkNext->dijkPrev = n;
+    n = n->dijkNext;
+  }
+
+  return n;
+
+}
+
+
+
+//state of the counting sort in buildCSR() - thread t handles the arcs
+//and the nodes in its share of the index ranges
+struct CSRBuild {
+  int numNodes;
+  int numArcs;
+  int numThreads;
+  const int     *from;
+  const int     *to;
+  const CapType *weight;
+
+  int **count;     //arcs per node and thread, later the insert positions
+  int  *rangeSum;  //arcs leaving the nodes of a thread
+  int  *first;
+  int  *head;
+  CapType *headWeight;
+
+  int phase;
+};
+
+static inline int rangeBegin(int n, int t, int numThreads) {
+  return (int)(((long long)n * t) / numThreads);
+}
+
+static void buildCSRPhase(void *arg, int t) {
+
+  CSRBuild *cb = static_cast<CSRBuild*>(arg);
+  int aBegin = rangeBegin(cb->numArcs, t, cb->numThreads);
+  int aEnd   = rangeBegin(cb->numArcs, t+1, cb->numThreads);
+  int vBegin = rangeBegin(cb->numNodes, t, cb->numThreads);
+  int vEnd   = rangeBegin(cb->numNodes, t+1, cb->numThreads);
+  int *count = cb->count[t];
+  int i, u, v;
+
+  switch (cb->phase) {
+
+  case 0: //count the arcs of the thread per node
+    memset(count, 0, sizeof(int)*cb->numNodes);
+    for (i=aBegin; i<aEnd; i++)
+      count[cb->from[i]]++;
+    break;
+
+  case 1: //sum up the counts of the nodes of the thread
+    cb->rangeSum[t] = 0;
+    for (v=vBegin; v<vEnd; v++) {
+      int sum = 0;
+      for (u=0; u<cb->numThreads; u++)
+	sum += cb->count[u][v];
+      cb->first[v] = sum;
+      cb->rangeSum[t] += sum;
+    }
+    break;
+
+  case 2: { //turn the counts into insert positions (rangeSum holds the offsets now)
+    int pos = cb->rangeSum[t];
+    for (v=vBegin; v<vEnd; v++) {
+      cb->first[v] = pos;
+      for (u=0; u<cb->numThreads; u++) {
+	int c = cb->count[u][v];
+	cb->count[u][v] = pos;
+	pos += c;
+      }
+    }
+    break;
+  }
+
+  case 3: //scatter the arcs - each thread fills its own slots per node
+    for (i=aBegin; i<aEnd; i++) {
+      int p = count[cb->from[i]]++;
+      cb->head[p]       = cb->to[i];
+      cb->headWeight[p] = cb->weight[i];
+    }
+    break;
+
+  }
+
+}
+
+
+void CGraph::buildCSR(int numNodes, int numArcs, 
+		      const int *from, const int *to, const CapType *weight,
+		      ThreadPool *pool) {
+
+  freeCSR();
+
+  csrNumNodes = numNodes;
+  csrFirst  = new int[numNodes+1];
+  csrHead   = new int[numArcs];
+  csrWeight = new CapType[numArcs];
+
+  CSRBuild cb;
+  cb.numNodes   = numNodes;
+  cb.numArcs    = numArcs;
+  cb.numThreads = pool ? pool->getNumThreads() : 1;
+  cb.from   = from;
+  cb.to     = to;
+  cb.weight = weight;
+  cb.first      = csrFirst;
+  cb.head       = csrHead;
+  cb.headWeight = csrWeight;
+
+  cb.rangeSum = new int[cb.numThreads];
+  cb.count    = new int*[cb.numThreads];
+  for (int t=0; t<cb.numThreads; t++)
+    cb.count[t] = new int[numNodes];
+
+  for (cb.phase=0; cb.phase<4; cb.phase++) {
+
+    if (pool)
+      pool->run(&buildCSRPhase, &cb);
+    else
+      buildCSRPhase(&cb, 0);
+
+    //exclusive prefix sum over the threads
+    if (cb.phase == 1) {
+      int sum = 0;
+      for (int t=0; t<cb.numThreads; t++) {
+	int s = cb.rangeSum[t];
+	cb.rangeSum[t] = sum;
+	sum += s;
+      }
+    }
+
+  }
+
+  csrFirst[numNodes] = numArcs;
+
+  for (int t=0; t<cb.numThreads; t++)
+    delete [] cb.count[t];
+  delete [] cb.count;
+  delete [] cb.rangeSum;
+
+}
+
+
+void CGraph::runDijkstraCSR(int start, CapType *dist, int *prev) {
+
+  DAryHeap<4> heap(csrNumNodes);
+  int *zeroNodes, numZeroNodes = 0;
+  int n, d, a;
+  CapType w;
+
+  for (n=0; n<csrNumNodes; n++) {
+    dist[n] = CAP_INF;
+    prev[n] = -1;
+  }
+
+  //nodes reached via zero weight arcs are settled immediately 
+  //without passing through the heap (cf. runDijkstra())
+  zeroNodes = new int[csrNumNodes];
+
+  dist[start] = 0;
+  heap.insert(start, 0);
+
+  while (true) {
+
+    if (numZeroNodes)
+      n = zeroNodes[--numZeroNodes];
+    else if (!heap.deleteMin(n))
+      break;
+
+    //update all neighboring nodes
+    for (a=csrFirst[n]; a<csrFirst[n+1]; a++) {
+
+      d = csrHead[a];
+      w = dist[n] + csrWeight[a];
+
+      if (heap.contains(d)) {
+
+	if (dist[d] > w) {
+	  dist[d] = w;
+	  prev[d] = n;
+	  heap.decrease(d, w);
+	}
+
+      } else if (dist[d] == CAP_INF) {
+
+	dist[d] = w;
+	prev[d] = n;
+
+	if (csrWeight[a] == 0)
+	  zeroNodes[numZeroNodes++] = d;
+	else
+	  heap.insert(d, w);
+
+      }
+
+    }
+
+  }
+
+  delete [] zeroNodes;
+
 }
 
 
@@ -36,6 +36,7 @@
 
 
 struct CGNode;
+class ThreadPool;
 
 class CDijkNode {
 
@@ -56,12 +57,20 @@ struct CGNode
 {
 
   CGEdge    *first;     //first outcoming edge
+  CGEdge    *firstIn;   //first incoming edge
   int	   tag;	      //just a tag
   uchar    type;	      //type of node (start- or end-node)
   HeapId   heapId;     //corresponding entity in heap
   CapType  dijkWeight; //used by runDijkstra() to compute shortest path
   CGNode    *dijkPrev;  //points to previous node on the shortest path
 
+  //backward search of runDijkstraMulti() - these fields and the ones 
+  //above are only valid for runDijkstraMulti() if epoch is the current one
+  uint     epoch;         //query the node has been reached by last
+  HeapId   heapIdRev;     //corresponding entity in the backward heap
+  CapType  dijkWeightRev; //distance to the nearest end node
+  CGNode    *dijkNext;    //points to next node on the path to an end node
+
 };
 
 
@@ -71,7 +80,9 @@ struct CGEdge
 {
 
   CGNode    *head;   //node the arc points to 
+  CGNode    *tail;   //node the arc originates from
   CGEdge    *next;   //next arc with the same originating node
+  CGEdge    *nextIn; //next arc with the same head node
   CGEdge    *sister; //reverse arc
   CapType  weight; //capacity
 
@@ -86,7 +97,7 @@ struct CGEdge
 class DijkHeap {
 
   CDijkNode **heap;
-  BlockAllocator<CDijkNode> dijkNodes;
+  BlockAllocatorLocal<CDijkNode> dijkNodes; //blocks are shared via BlockPool
 
   int maxIdx;
   int maxHeapSize;
@@ -122,11 +133,38 @@ class DijkHeap {
 ********************************************************************/
 class CGraph {
 
+  //the node and arc blocks come from the lock-free global BlockPool, so 
+  //graphs built and cleared on several threads recycle each other's blocks
   BlockAllocatorStatic<CGNode, NODE_BLOCK_SIZE> *nodeBlock;
   BlockAllocatorStatic<CGEdge, NODE_BLOCK_SIZE> *edgeBlock;
 
   uint numMaxNodes;
 
+  uint curEpoch; //number of the current runDijkstraMulti() query
+
+  //compressed row form built by buildCSR(): the arcs leaving node v 
+  //are csrHead/csrWeight[csrFirst[v]..csrFirst[v+1]-1]
+  int      csrNumNodes;
+  int     *csrFirst;
+  int     *csrHead;
+  CapType *csrWeight;
+
+  void freeCSR();
+
+  //initializes the search fields of a node when it is reached 
+  //for the first time in the current query
+  void touchNode(CGNode *n) {
+    if (n->epoch == curEpoch)
+      return;
+    n->epoch         = curEpoch;
+    n->heapId        = NULL;
+    n->heapIdRev     = NULL;
+    n->dijkWeight    = CAP_INF;
+    n->dijkWeightRev = CAP_INF;
+    n->dijkPrev      = NULL;
+    n->dijkNext      = NULL;
+  }
+
  public:
   CGraph(uint numMaxNodes);
   ~CGraph();
@@ -145,11 +183,29 @@ class CGraph {
   bool setEdgeWeight(CGNode *from, CGNode *to, CapType cap);
 
   void runDijkstra(CGNode *start);
+  //bidirectional search for the shortest path from any of the start 
+  //nodes to any of the end nodes. Returns the end node of the path, 
+  //which can be retrieved by getShortestPath(), or NULL if there is 
+  //none. The cost is independent of the size of the graph: the nodes
+  //are reset lazily by means of an epoch counter.
   CGNode *runDijkstraMulti(CGNode **start, int numStart, CGNode **end, int numEnd);
   //returns null-terminated list of shortest path nodes
   CGNode **getShortestPath(CGNode *dest, int *length = NULL); 
   void printShortestPath(CGNode *dest);
 
+  //builds the compressed row form of the graph given by the arcs 
+  //from[i] -> to[i] with the nodes numbered 0..numNodes-1. It is kept
+  //apart from the nodes added by addNode(). Arcs leaving the same node 
+  //keep their order. The counting sort is distributed among the threads
+  //of pool if given.
+  void buildCSR(int numNodes, int numArcs, 
+		const int *from, const int *to, const CapType *weight,
+		ThreadPool *pool = NULL);
+
+  //Dijkstra's algorithm on the compressed row form - dist and prev 
+  //(previous node on the shortest path or -1) hold numNodes entries
+  void runDijkstraCSR(int start, CapType *dist, int *prev);
+
 };
 
 
@@ -23,13 +23,15 @@
 #include "CutGrid.h"
 
 
-CapType CutGrid::edgeCostNull(int row, int col, EDir dir) {
+template<class DynTree>
+CapType CutGridT<DynTree>::edgeCostNull(int row, int col, EDir dir) {
   
   return 0.0;
 
 }
 
-CutGrid::CutGrid(int nRows, int nCols) : idxSource(0), idxSink(0) {
+template<class DynTree>
+CutGridT<DynTree>::CutGridT(int nRows, int nCols) : idxSource(0), idxSink(0) {
 
   //set standard edge cost function so edgeCostFunc is always non-null
   edgeCostFunc = &edgeCostNull;
@@ -68,7 +70,8 @@ CutGrid::CutGrid(int nRows, int nCols) : idxSource(0), idxSink(0) {
   PlanarEdge *edgesCCW[4];
 
   int i, j; //column and row counter
-  int v, e; //vertex and edge counter
+  PlanarIdx v; //vertex counter
+  int e; //edge counter
 
   for (j=0, v=0; j<nRows; j++) {
     for (i=0; i<nCols; i++, v++) {
@@ -95,7 +98,8 @@ CutGrid::CutGrid(int nRows, int nCols) : idxSource(0), idxSink(0) {
 
 }
 
-CutGrid::~CutGrid() {
+template<class DynTree>
+CutGridT<DynTree>::~CutGridT() {
 
   if (verts)
     delete [] verts;
@@ -109,7 +113,8 @@ CutGrid::~CutGrid() {
 }
 
 
-void CutGrid::setSource(int row, int col) {
+template<class DynTree>
+void CutGridT<DynTree>::setSource(int row, int col) {
 
   if (row >= 0 && row < nRows &&
       col >= 0 && col < nCols)
@@ -117,7 +122,8 @@ void CutGrid::setSource(int row, int col) {
   
 }
 
-void CutGrid::setSink(int row, int col) {
+template<class DynTree>
+void CutGridT<DynTree>::setSink(int row, int col) {
 
   if (row >= 0 && row < nRows &&
       col >= 0 && col < nCols)
@@ -126,14 +132,16 @@ void CutGrid::setSink(int row, int col) {
 }
 
 
-void CutGrid::getSource(int &row, int &col) {
+template<class DynTree>
+void CutGridT<DynTree>::getSource(int &row, int &col) {
 
   row = idxSource / nCols;
   col = idxSource % nCols;
 
 }
 
-void CutGrid::getSink(int &row, int &col) {
+template<class DynTree>
+void CutGridT<DynTree>::getSink(int &row, int &col) {
 
   row = idxSink / nCols;
   col = idxSink % nCols;
@@ -141,7 +149,8 @@ void CutGrid::getSink(int &row, int &col) {
 }
 
 
-void CutGrid::setEdgeCostFunction(EdgeCostFunc edgeCostFunc) {
+template<class DynTree>
+void CutGridT<DynTree>::setEdgeCostFunction(EdgeCostFunc edgeCostFunc) {
 
   if (edgeCostFunc)
     this->edgeCostFunc = edgeCostFunc;
@@ -151,17 +160,19 @@ void CutGrid::setEdgeCostFunction(EdgeCostFunc edgeCostFunc) {
 }
 
 
-double CutGrid::edgeCost(int row, int col, EDir dir) {
+template<class DynTree>
+double CutGridT<DynTree>::edgeCost(int row, int col, EDir dir) {
 
   //this call is safe, since we made sure that edgeCostFunc is always non-null
   return edgeCostFunc(row, col, dir);
 
 }
 
-double CutGrid::getMaxFlow() {
+template<class DynTree>
+double CutGridT<DynTree>::getMaxFlow() {
 
   int i, j; //column and row counter
-  int e; //vertex and edge counter
+  PlanarIdx e; //vertex and edge counter
 
   //add horizontal edges
   for (j=0, e=0; j<nRows; j++)
@@ -187,26 +198,80 @@ double CutGrid::getMaxFlow() {
 
 
   pc.initialize(nVerts, verts, nEdges, edges, nFaces, faces, 
-		idxSource, idxSink, CutPlanar::CHECK_NONE);
+		idxSource, idxSink, CutPlanarBase::CHECK_NONE);
 
 
   return pc.getMaxFlow();
   
 }
 
-CutPlanar::ELabel CutGrid::getLabel(int row, int col) {
+template<class DynTree>
+double CutGridT<DynTree>::updateMaxFlow(int rowMin, int colMin, int rowMax, int colMax) {
+
+  int i, j; //column and row counter
+  PlanarIdx e; //edge counter
+
+  //clip the region to the grid
+  if (rowMin < 0) rowMin = 0;
+  if (colMin < 0) colMin = 0;
+  if (rowMax > nRows-1) rowMax = nRows-1;
+  if (colMax > nCols-1) colMax = nCols-1;
+
+  if (rowMin > rowMax || colMin > colMax)
+    return pc.getMaxFlow();
+
+  //the edges are collected here before being passed to the planar cut
+  PlanarIdx maxRegionEdges = 2 * (PlanarIdx)(rowMax-rowMin+3) * (colMax-colMin+3);
+  PlanarIdx maxUpdates = (maxRegionEdges < nEdges) ? maxRegionEdges : nEdges;
+  PlanarIdx *edgeIDs   = new PlanarIdx[maxUpdates];
+  CapType   *caps      = new CapType[maxUpdates];
+  CapType   *rcaps     = new CapType[maxUpdates];
+  PlanarIdx nUpdates   = 0;
+
+  //horizontal edges having an end inside the region
+  for (j=rowMin; j<=rowMax; j++)
+    for (i=(colMin>0 ? colMin-1 : 0); i<=colMax && i<nHorzEdgesPerRow; i++) {
+      e = j*nHorzEdgesPerRow + i;
+      edgeIDs[nUpdates] = e;
+      caps[nUpdates]    = edgeCost(j, i, DIR_EAST);
+      rcaps[nUpdates]   = edgeCost(j, i+1, DIR_WEST);
+      nUpdates++;
+    }
+
+  //vertical edges having an end inside the region
+  for (j=(rowMin>0 ? rowMin-1 : 0); j<=rowMax && j<nRows-1; j++)
+    for (i=colMin; i<=colMax; i++) {
+      e = nHorzEdges + j*nVertEdgesPerRow + i;
+      edgeIDs[nUpdates] = e;
+      caps[nUpdates]    = edgeCost(j, i, DIR_SOUTH);
+      rcaps[nUpdates]   = edgeCost(j+1, i, DIR_NORTH);
+      nUpdates++;
+    }
+
+  pc.updateCapacities(nUpdates, edgeIDs, caps, rcaps);
+
+  delete [] edgeIDs;
+  delete [] caps;
+  delete [] rcaps;
+
+  return pc.getMaxFlow();
+
+}
+
+template<class DynTree>
+CutPlanarBase::ELabel CutGridT<DynTree>::getLabel(int row, int col) {
   if ((row >= 0) && (row < nRows) &&
       (col >= 0) && (col < nCols))
     return pc.getLabel(row*nCols + col);
   throw ExceptionUnexpectedError();
 }
 
-void CutGrid::getLabels(CutPlanar::ELabel *lmask) {
-  for (int row=0; row<nRows; row++) {
-    for (int col=0; col<nCols; col++) {
-      lmask[row*nCols + col] = pc.getLabel(row*nCols + col);
-    }
-  }
+template<class DynTree>
+void CutGridT<DynTree>::getLabels(CutPlanarBase::ELabel *lmask) {
+  //the nodes are numbered row by row
+  pc.getLabels(lmask);
 }
 
 
+template class CutGridT<DynPathTree>;
+template class CutGridT<SplayPathTree>;
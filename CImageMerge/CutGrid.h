@@ -28,7 +28,8 @@
 
 	
 
-class CutGrid
+//declarations shared by all instantiations of CutGridT
+class CutGridBase
 {
  public:
 
@@ -38,12 +39,19 @@ class CutGrid
     DIR_WEST,
     DIR_SOUTH,
   };
+};
+
 
+//DynTree is the dynamic tree backend of the planar cut (cf. CutPlanarT)
+template<class DynTree>
+class CutGridT : public CutGridBase
+{
  private:
 
-  //dimensions of the grid
-  int nCols;
-  int nRows;
+  //dimensions of the grid - kept as PlanarIdx, so that the 
+  //index arithmetic below does not overflow
+  PlanarIdx nCols;
+  PlanarIdx nRows;
 
   //planar graph entities
   PlanarVertex *verts;
@@ -51,23 +59,23 @@ class CutGrid
   PlanarFace   *faces; 
 
   //metrics of the planar graph
-  int nFaces;
-  int nFacesPerRow;
-  int nFacesPerCol;
+  PlanarIdx nFaces;
+  PlanarIdx nFacesPerRow;
+  PlanarIdx nFacesPerCol;
 
-  int nEdges;
-  int nHorzEdgesPerRow;
-  int nVertEdgesPerRow;
-  int nHorzEdges;
-  int nVertEdges;
+  PlanarIdx nEdges;
+  PlanarIdx nHorzEdgesPerRow;
+  PlanarIdx nVertEdgesPerRow;
+  PlanarIdx nHorzEdges;
+  PlanarIdx nVertEdges;
 
-  int nVerts;
+  PlanarIdx nVerts;
 
   //planar cut related
-  CutPlanar pc;
+  CutPlanarT<DynTree> pc;
 
-  int idxSource;
-  int idxSink;
+  PlanarIdx idxSource;
+  PlanarIdx idxSink;
 
   typedef CapType (*EdgeCostFunc)(int row, int col, EDir dir);
   EdgeCostFunc edgeCostFunc;
@@ -75,8 +83,8 @@ class CutGrid
   static CapType edgeCostNull(int row, int col, EDir dir);
 
  public:
-  CutGrid(int nRows, int nCols);
-  virtual ~CutGrid();
+  CutGridT(int nRows, int nCols);
+  virtual ~CutGridT();
 
   void setSource(int row, int col);
   void setSink(int row, int col);
@@ -84,17 +92,27 @@ class CutGrid
   void getSource(int &row, int &col);
   void getSink(int &row, int &col);
 
+  //number of threads used by the planar cut (cf. CutPlanar)
+  void setNumThreads(int numThreads) { pc.setNumThreads(numThreads); }
+
   void setEdgeCostFunction(CapType (*edgeCostFunc)(int row, int col, EDir dir));
 
   virtual CapType edgeCost(int row, int col, EDir dir);
   
   double getMaxFlow();
 
+  //re-evaluates the costs of all edges adjacent to the pixels within
+  //the given region and updates the previously computed flow
+  double updateMaxFlow(int rowMin, int colMin, int rowMax, int colMax);
+
   //returns the label of a the pixel at (x,y)
-  CutPlanar::ELabel getLabel(int row, int col);
+  CutPlanarBase::ELabel getLabel(int row, int col);
 
-  void getLabels(CutPlanar::ELabel *lmask);
+  void getLabels(CutPlanarBase::ELabel *lmask);
 };
 
 
+typedef CutGridT<DYN_TREE> CutGrid;
+
+
 #endif
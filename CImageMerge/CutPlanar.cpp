@@ -22,32 +22,40 @@
 
 #include "CutPlanar.h"
 #include <assert.h>
+#include <atomic>
+#include <algorithm>
 
 /***************************************************
  * Public Methods                                  *
  ***************************************************/
-CutPlanar::CutPlanar() : nVerts(0), nEdges(0), nFaces(0),
+template<class DynTree>
+CutPlanarT<DynTree>::CutPlanarT() : nVerts(0), nEdges(0), nFaces(0),
 			 verts(0), faces(0), edges(0),
 			 sourceID(0), sinkID(0),
 			 computedFlow(false),
-			 maxFlow(0), capEps(0),
+			 maxFlow(0), augFlow(0), capEps(0),
+			 capInf(0), capMin(0), capSum(0), nEpsDarts(0), nInfDarts(0),
+			 inputCaps(0), inputRevCaps(0),
+			 capsDirty(false), warmStart(false),
+			 dualAdjFirst(0), dualAdjFace(0), dualAdjDart(0),
+			 threadPool(0),
 			 primalTreeNodes(0), plSource(0), plSink(0),
-			 dualTreeParent(0), dualTreeEdge(0),
+			 dualTreeParent(0), dualTreeEdge(0), treesSpanning(false),
+			 cutTail(-1), cutFaceEdge(-1),
+			 faceStamp(0), curStamp(0), faceDist(0), facePred(0), repairHeap(0),
 			 completelyLabeled(false),
 			 isLabeled(0), labels(0),
 			 isSourceBlocked(false)
 {
-
-  DynRoot::resetBlockAllocator();
-
 }
 
 
-CutPlanar::~CutPlanar() {
+template<class DynTree>
+CutPlanarT<DynTree>::~CutPlanarT() {
 
   //free primal spanning tree T
   if (primalTreeNodes) 
-    delete [] primalTreeNodes;
+    DynTree::releaseArena(arena);
 
   //free dual spanning tree T*
   if (dualTreeParent)
@@ -56,21 +64,47 @@ CutPlanar::~CutPlanar() {
   if (dualTreeEdge)
     delete [] dualTreeEdge;
 
+  //free the scratch space of the repair of the trees
+  if (faceStamp)
+    delete [] faceStamp;
+  if (faceDist)
+    delete [] faceDist;
+  if (facePred)
+    delete [] facePred;
+  if (repairHeap)
+    delete repairHeap;
+
   //free label infrastructure
   if (isLabeled)
     delete [] isLabeled;
   if (labels)
     delete [] labels;
 
-  DynRoot::resetBlockAllocator();
+  //free input capacities
+  if (inputCaps)
+    delete [] inputCaps;
+  if (inputRevCaps)
+    delete [] inputRevCaps;
+
+  //free dual adjacency
+  if (dualAdjFirst)
+    delete [] dualAdjFirst;
+  if (dualAdjFace)
+    delete [] dualAdjFace;
+  if (dualAdjDart)
+    delete [] dualAdjDart;
+
+  if (threadPool)
+    delete threadPool;
 
 }
 
 
-void CutPlanar::initialize(int numVerts, PlanarVertex *vertexList,
-		           int numEdges, PlanarEdge   *edgeList,
-		           int numFaces, PlanarFace   *faceList,
-                           int idxSource, int idxSink, ECheckFlags checkInput) {
+template<class DynTree>
+void CutPlanarT<DynTree>::initialize(PlanarIdx numVerts, PlanarVertex *vertexList,
+		           PlanarIdx numEdges, PlanarEdge   *edgeList,
+		           PlanarIdx numFaces, PlanarFace   *faceList,
+                           PlanarIdx idxSource, PlanarIdx idxSink, ECheckFlags checkInput) {
   
   nVerts = numVerts; verts = vertexList;
   nEdges = numEdges; edges = edgeList;
@@ -78,102 +112,129 @@ void CutPlanar::initialize(int numVerts, PlanarVertex *vertexList,
   sourceID = idxSource<0?numVerts-1:idxSource;
   sinkID   = idxSink  <0?numVerts-1:idxSink;
   computedFlow = false;
+
   performChecks(checkInput);
 
-  CapType capInf = 0, capMin = CAP_INF, cap, rcap;
-  PlanarEdge *e;
-  int i;
+  //all passes of the computation work on the compact form
+  graph.build(nVerts, verts, nEdges, edges, nFaces, faces);
+
+  //remember the input capacities
+  if (inputCaps)
+    delete [] inputCaps;
+  if (inputRevCaps)
+    delete [] inputRevCaps;
+  inputCaps    = new CapType[nEdges];
+  inputRevCaps = new CapType[nEdges];
+
+  memcpy(inputCaps,    graph.cap,  sizeof(CapType)*nEdges);
+  memcpy(inputRevCaps, graph.rcap, sizeof(CapType)*nEdges);
+
+  resetCapacities();
+
+  buildDualAdjacency();
+
+  //the scratch space depends on the number of faces
+  if (faceStamp)
+    delete [] faceStamp;
+  if (faceDist)
+    delete [] faceDist;
+  if (facePred)
+    delete [] facePred;
+  if (repairHeap)
+    delete repairHeap;
+  faceStamp = 0;
+  faceDist  = 0;
+  facePred  = 0;
+  repairHeap = 0;
 
-  //reset edge flags
-  for (int i=0; i<nEdges; i++)
-    edges[i].setFlags(0);
+}
 
-  //determine minimum weight that is considered = infinity...
-  for (i=0, e=edges; i<numEdges; i++, e++) {
-    cap = e->getCapacity();
-    if (cap != CAP_INF)
-      capInf += cap;
 
-    cap = e->getRevCapacity();
-    if (cap != CAP_INF)
-      capInf += cap;
-  }
-
-  capInf += 1.;
+template<class DynTree>
+void CutPlanarT<DynTree>::setSource(PlanarIdx idxSource) {
+  computedFlow &= (idxSource == sourceID);
+  capsDirty    |= (idxSource != sourceID); //the flow cannot be reused
+  sourceID = idxSource;
+}
 
-  //...and set all infinity edges to this weight
-  for (i=0, e=edges; i<numEdges; i++, e++) {
-    if (e->getCapacity() == CAP_INF)
-      e->setCapacity(capInf);
 
-    if (e->getRevCapacity() == CAP_INF)
-      e->setRevCapacity(capInf);
-  }
+template<class DynTree>
+void CutPlanarT<DynTree>::setSink(PlanarIdx idxSink) {
+  computedFlow &= (idxSink == sinkID);
+  capsDirty    |= (idxSink != sinkID); //the flow cannot be reused
+  sinkID = idxSink;
+}
 
-  //virtually remove all edges with capacity zero
-  capEps = 0;
 
-  for (i=0, e=edges; i<numEdges; i++, e++) {
-    
-    cap  = e->getCapacity();
-    rcap = e->getRevCapacity();
+template<class DynTree>
+void CutPlanarT<DynTree>::setNumThreads(int numThreads) {
 
-    if (!cap)
-      capEps++;
-    else if (cap < capMin) 
-      capMin = cap;
-      
-    if (!rcap)
-      capEps++;
-    else if (rcap < capMin)
-      capMin = rcap;
+  if (threadPool)
+    delete threadPool;
+  threadPool = 0;
 
-  }
+  if (numThreads > 1)
+    threadPool = new ThreadPool(numThreads);
 
-  capEps = capMin / (capEps * 2);
+}
 
-  if (capEps == 0)   //the graph completely consists of zero edges
-    capEps = 0.1;    
 
-  for (i=0, e=edges; i<numEdges; i++, e++) {
+template<class DynTree>
+void CutPlanarT<DynTree>::updateCapacities(PlanarIdx numUpdates, const PlanarIdx *edgeIDs,
+				 const CapType *caps, const CapType *rcaps) {
 
-    if (!e->getCapacity()) {
-      e->setCapacity(capEps);
-      e->setFlags(e->getFlags() | 2);
-    }
-    
-    if (!e->getRevCapacity()) {
-      e->setRevCapacity(capEps);
-      e->setFlags(e->getFlags() | 4);
-    }
+  if (!inputCaps) //not initialized yet
+    return;
 
+  //the residual capacities of a computed flow serve as starting point,
+  //which requires its spanning trees to span the whole graph
+  if (computedFlow && !warmStart) {
+    capsDirty = !treesSpanning || cutTail < 0;
+    warmStart = !capsDirty;
   }
 
-}
+  bool cutChanged = false;
 
+  for (PlanarIdx i=0; i<numUpdates; i++) {
+    PlanarIdx id = edgeIDs[i];
 
-void CutPlanar::setSource(int idxSource) {
-  computedFlow &= (idxSource == sourceID);
-  sourceID = idxSource;
-}
+    //check whether the edge is part of the cut
+    if (computedFlow && 
+	getLabel(graph.head[id]) != getLabel(graph.tail[id]))
+      cutChanged = true;
+
+    if (warmStart && !capsDirty) {
+      //fall back to a complete re-solve if the flow cannot be reused
+      if (!updateResidualCapacity(id, caps[i], rcaps[i]))
+	capsDirty = true;
+    } else {
+      inputCaps[id]    = caps[i];
+      inputRevCaps[id] = rcaps[i];
+      capsDirty = true;
+    }
+  }
 
+  //the flow remains maximal as long as the capacity of the cut is unchanged
+  if (capsDirty || cutChanged)
+    computedFlow = false;
 
-void CutPlanar::setSink(int idxSink) {
-  computedFlow &= (idxSink == sinkID);
-  sinkID = idxSink;
 }
 
 
 
-double CutPlanar::getMaxFlow() {
+template<class DynTree>
+double CutPlanarT<DynTree>::getMaxFlow() {
+
+  Root *pr, *prLeft, *prRight;
+  Leaf *plTailD, *plHeadD, *plTailE, *plHeadE;
 
-  DynRoot *pr, *prLeft, *prRight;
-  DynLeaf *plTailD, *plHeadD, *plTailE, *plHeadE;
+  PlanarIdx tailEIdx, headEIdx;
 
-  int tailEIdx, headEIdx;
+  PlanarIdx eD, eE;          //edges
+  PlanarIdx fLeft, fRight;   //faces
 
-  PlanarEdge *peD, *peE;
-  PlanarFace *pfLeft, *pfRight;
+  fRight = -1;
+  eE     = -1;
 
   CapType eArcCap, eAntiArcCap;
 
@@ -189,104 +250,117 @@ double CutPlanar::getMaxFlow() {
       !verts  || !edges  || !faces)
     return 0;
 
+  //the capacities may have been altered by a previous computation
+  if (capsDirty)
+    resetCapacities();
 
-  //allocate memory for primal and dual spanning tree T and T*
-  if (primalTreeNodes)
-    delete [] primalTreeNodes;
-  primalTreeNodes = new DynLeaf[nVerts];
 
-  if (dualTreeParent)
-    delete [] dualTreeParent;
-  dualTreeParent = new PlanarFace*[nVerts];
-  memset(dualTreeParent, 0, sizeof(PlanarFace*)*nVerts);
+  if (warmStart) {
 
-  if (dualTreeEdge)
-    delete [] dualTreeEdge;
-  dualTreeEdge   = new PlanarEdge*[nVerts];
-  memset(dualTreeEdge, 0, sizeof(PlanarEdge*)*nVerts);
+    //the spanning trees of the previous flow are repaired locally
+    repairSpanningTrees();
 
+  } else {
 
-  //perform all precomputations
-  preFlow();
-  constructSpanningTrees();
+    //allocate memory for primal and dual spanning tree T and T*
+    //(this frees the nodes of the previous trees)
+    primalTreeNodes = DynTree::allocLeaves(arena, nVerts);
+
+    if (dualTreeParent)
+      delete [] dualTreeParent;
+    dualTreeParent = new PlanarIdx[nFaces];
+    memset(dualTreeParent, -1, sizeof(PlanarIdx)*nFaces);
+
+    if (dualTreeEdge)
+      delete [] dualTreeEdge;
+    dualTreeEdge   = new PlanarIdx[nFaces];
+    memset(dualTreeEdge, -1, sizeof(PlanarIdx)*nFaces);
+
+
+    //perform all precomputations
+    preFlow();
+    constructSpanningTrees();
+
+    cutTail = -1;
+
+  }
 
-  //initialize
-  maxFlow = 0;
+  //initialize - on a warm start the previous flow is augmented
+  maxFlow = warmStart ? augFlow : 0;
 
-  //  if (!isSourceBlocked) { //TODO (F) please check if ok
+  //no path leads from the source to the sink - nothing to augment
 
   //enter augmentation loop
-  while (true) {
+  while (!isSourceBlocked) {
 
-    pr = plSource->expose();
-    plTailD = pr->getMinCostLeaf();
+    pr = plSource->expose(arena);
+    plTailD = pr->getMinCostLeaf(arena);
 
     //augmentation step
-    CapType augCap = plTailD->getEdgeCost();
+    CapType augCap = plTailD->getEdgeCost(arena);
     pr->addCost(-augCap);
     maxFlow += augCap; 
 
     //the nodes between plHeadD and plSink lie on the 
-    //same DynPath due to the call of expose()
-    plHeadD = plTailD->getNextDyn(); 
+    //same path due to the call of expose()
+    plHeadD = plTailD->getNextDyn(arena); 
 
     //find the edge that has is to be saturated
-    ResultSplit sres;
+    Split sres;
 
-    plHeadD->divide(&sres);
-    plTailD->setWeakLink(0, 0, 0, false, 0); 
+    plHeadD->divide(arena, &sres);
+    plTailD->setWeakLink(arena, 0, 0, 0, false, 0); 
 
-    peD = static_cast<PlanarEdge*>(sres.dataBefore);
+    eD = sres.dataBefore;
 
-    //update the capacity of peD in the graph as well
+    //update the capacity of eD in the graph as well
     if (!sres.mappingBefore) { 
-      //the mapping-bit indicates, whether the forward capacity of the DynPath edge 
+      //the mapping-bit indicates, whether the forward capacity of the path edge 
       //maps to the arc or the antiarc of the corresponding edge in the graph
-      peD->setCapacity(sres.costBefore);
-      peD->setRevCapacity(sres.costBeforeR);
+      graph.cap[eD]  = sres.costBefore;
+      graph.rcap[eD] = sres.costBeforeR;
       
-      pfLeft  = peD->getTailDual();
-      pfRight = peD->getHeadDual();
+      fLeft  = graph.tailDual[eD];
+      fRight = graph.headDual[eD];
     } else {
-      peD->setRevCapacity(sres.costBefore);
-      peD->setCapacity(sres.costBeforeR);
+      graph.rcap[eD] = sres.costBefore;
+      graph.cap[eD]  = sres.costBeforeR;
       
-      pfRight = peD->getTailDual();
-      pfLeft  = peD->getHeadDual();
+      fRight = graph.tailDual[eD];
+      fLeft  = graph.headDual[eD];
     }
 
-    //get the edge that leads to the parent of peD's right face in T*
-    peE = dualTreeEdge[getFaceIndex(pfRight)];
+    //get the edge that leads to the parent of eD's right face in T*
+    eE = dualTreeEdge[fRight];
 
 
     //update dual spanning tree T*:
-    //insert peD into T* ...
-    int fIdx = getFaceIndex(pfRight);
-    dualTreeParent[fIdx] = pfLeft;
-    dualTreeEdge[fIdx]   = peD;
+    //insert eD into T* ...
+    dualTreeParent[fRight] = fLeft;
+    dualTreeEdge[fRight]   = eD;
 
     // //... and obviate numerical issues
-    // if (peD->getCapacity() < EPSILON)
-    //   peD->setCapacity(0.0);
-    // if (peD->getRevCapacity() < EPSILON)
-    //   peD->setRevCapacity(0.0);
+    // if (graph.cap[eD] < EPSILON)
+    //   graph.cap[eD] = 0.0;
+    // if (graph.rcap[eD] < EPSILON)
+    //   graph.rcap[eD] = 0.0;
 
-    //check if peE is properly defined or if pfRight is root of T*
-    if (peE) {
+    //check if eE is properly defined or if fRight is root of T*
+    if (eE >= 0) {
       
-      eArcCap     = peE->getCapacity();
-      eAntiArcCap = peE->getRevCapacity();
+      eArcCap     = graph.cap[eE];
+      eAntiArcCap = graph.rcap[eE];
 
       //identify arc with positive costs - 
       //the costs of the antiarc should be zero
       if (eArcCap) {
-	tailEIdx = getVertIndex(peE->getTail());
-	headEIdx = getVertIndex(peE->getHead());
+	tailEIdx = graph.tail[eE];
+	headEIdx = graph.head[eE];
 
 	bMapping = false;
       } else {
-	tailEIdx = getVertIndex(peE->getHead());
-	headEIdx = getVertIndex(peE->getTail());
+	tailEIdx = graph.head[eE];
+	headEIdx = graph.tail[eE];
 
 	bMapping = true;
       }
@@ -294,18 +368,18 @@ double CutPlanar::getMaxFlow() {
       plTailE = primalTreeNodes + tailEIdx;
       plHeadE = primalTreeNodes + headEIdx;
 
-      pr = plTailE->expose();
+      pr = plTailE->expose(arena);
 
     } else {
 
-      //special case: pfRight is root => termination condition fulfilled
+      //special case: fRight is root => termination condition fulfilled
       break;
 
-    } //consistency check peE
+    } //consistency check eE
 
     
       //check the invariant that plTailE is successor of plTailD
-    if (!pr || pr->getTail() != plTailD) {
+    if (!pr || pr->getTail(arena) != plTailD) {
 
       //invariant inactive: termination condition fulfilled
       break;
@@ -316,34 +390,51 @@ double CutPlanar::getMaxFlow() {
     if (plTailD != plTailE) {
 
       pr->reverse();
-      plTailE->setWeakLink(0, 0, 0, false, 0);
+      plTailE->setWeakLink(arena, 0, 0, 0, false, 0);
 
     }
 
-    //insert peD into the primal spanning tree T
+    //insert eE into the primal spanning tree T
     prLeft  = pr;                 //path between plTailD and plTailE
-    prRight = plHeadE->expose();  //path between plHeadE and plSink
+    prRight = plHeadE->expose(arena);  //path between plHeadE and plSink
 
     if (!bMapping)
-      prLeft->concatenate(prRight, 
+      prLeft->concatenate(arena, prRight, 
 			  eArcCap, eAntiArcCap, 
 			  bMapping, 
-			  peE);
+			  eE);
     else
-      prLeft->concatenate(prRight, 
+      prLeft->concatenate(arena, prRight, 
 			  eAntiArcCap, eArcCap, 
 			  bMapping, 
-			  peE);
+			  eE);
 
 
-  } //while(true)
+  } //while(!isSourceBlocked)
 
-    //  } //if (!isSourceBlocked)
+  //a warm start relies on the residual capacities of the previous 
+  //flow - if they do not close the loop of the cut in T*, start over
+  if (warmStart && fRight >= 0 && !isCutLoop(fRight)) {
+    resetCapacities();
+    return getMaxFlow();
+  }
 
   computedFlow = true;
 
+  //remember the last augmentation for a warm start
+  if (fRight >= 0) {
+    cutTail     = plTailD - primalTreeNodes;
+    cutFaceEdge = eE;
+  }
+
+  //the edge capacities are partially held by the primal spanning tree
+  augFlow   = maxFlow;
+  capsDirty = true;
+  warmStart = false;
+
   //remember a starting point in the loop in T* representing the cut
-  pfStartOfCut = pfRight;
+  //(-1 if there is no such loop since the source is blocked)
+  faceStartOfCut = fRight;
 
   // reset the whole label infrastructure
   if (isLabeled)
@@ -362,26 +453,26 @@ double CutPlanar::getMaxFlow() {
   // end label infrastructure
 
   //correct the value of maximum flow by the epsilon edges 
-  PlanarFace *curFace = pfStartOfCut;
-  int curFaceIdx;
-  PlanarEdge *curEdge;
+  PlanarIdx curFace = faceStartOfCut;
+  PlanarIdx curEdge;
 
-  do {
+  if (faceStartOfCut >= 0) do {
 
-    curFaceIdx = curFace - faces;
-    curEdge = dualTreeEdge[curFaceIdx];
+    curEdge = dualTreeEdge[curFace];
 
     //if the edge has epsilon weight in the direction 
-    //from source to sink reduce the actual flow
-    if (!(curEdge->getCapacity()) && (curEdge->getFlags() & 2))
-      maxFlow -= capEps;
-    else if (!(curEdge->getRevCapacity()) && (curEdge->getFlags() & 4))
+    //from source to sink reduce the actual flow - this is the 
+    //saturated dart, whose residual capacity need not be exactly zero
+    if (graph.cap[curEdge] <= graph.rcap[curEdge]) {
+      if (graph.flags[curEdge] & 2)
+	maxFlow -= capEps;
+    } else if (graph.flags[curEdge] & 4)
       maxFlow -= capEps;
 
     //proceed to next edge in cut
-    curFace = dualTreeParent[curFaceIdx];
+    curFace = dualTreeParent[curFace];
 
-  } while(curFace != pfStartOfCut);
+  } while(curFace != faceStartOfCut);
 
   //compensate for numerical issues
   if (maxFlow < EPSILON)
@@ -391,21 +482,42 @@ double CutPlanar::getMaxFlow() {
 }
 
 
-  CutPlanar::ELabel CutPlanar::getLabel(int node) {
+template<class DynTree>
+bool CutPlanarT<DynTree>::isCutLoop(PlanarIdx face) {
+
+  //the loop has to return to face without leaving T*
+  PlanarIdx curFace = face;
+
+  for (PlanarIdx i=0; i<nFaces; i++) {
+    if (dualTreeEdge[curFace] < 0)
+      return false;
+
+    curFace = dualTreeParent[curFace];
+    if (curFace == face)
+      return true;
+  }
+
+  return false;
+
+}
+
+
+  template<class DynTree>
+  CutPlanarBase::ELabel CutPlanarT<DynTree>::getLabel(PlanarIdx node) {
     if (!computedFlow) getMaxFlow();
     if ((completelyLabeled) || (isLabeled[node])) return labels[node];
 
-    DynLeaf *currLeaf;
-    DynRoot *currRoot;
-    std::vector<int> visitedID;
+    Leaf *currLeaf;
+    Root *currRoot;
+    std::vector<PlanarIdx> visitedID;
 
     currLeaf = primalTreeNodes + node;
     while (!isLabeled[node]) {
-      currRoot = currLeaf->getPath();
-      currLeaf = currRoot->getTail();
+      currRoot = currLeaf->getPath(arena);
+      currLeaf = currRoot->getTail(arena);
       node = currLeaf - primalTreeNodes;
       visitedID.push_back(node);
-      currLeaf = currLeaf->getWeakParent();
+      currLeaf = currLeaf->getWeakParent(arena);
       if ((isLabeled[node]) || (currLeaf == 0)) break;
       node = currLeaf - primalTreeNodes;
       visitedID.push_back(node);
@@ -422,48 +534,15 @@ double CutPlanar::getMaxFlow() {
   }
 
 
-  std::vector<int> CutPlanar::getLabels(ELabel label) {
-    DynRoot   *path;
-    DynLeaf   *leaf;
-    int      leafID;
-    ELabel curLabel;
-    std::vector<int> vertices;
+  template<class DynTree>
+  std::vector<PlanarIdx> CutPlanarT<DynTree>::getLabels(ELabel label) {
+    std::vector<PlanarIdx> vertices;
 
     if (!computedFlow) getMaxFlow();
-
-    if (!completelyLabeled) {
-      // compute all labels in O(N)
-      for (int i=0; i<nVerts; i++) {
-	if (isLabeled[i]) continue;
-	path     = primalTreeNodes[i].getPath();
-	leaf     = path->getTail();
-	leafID   = leaf - primalTreeNodes;
-	if (isLabeled[leafID])
-	  curLabel = labels[leafID];
-	else {
-	  leaf     = leaf->getWeakParent();
-	  if (leaf==0)
-	    curLabel = LABEL_SOURCE;
-	  else {
-	    leafID   = leaf - primalTreeNodes;
-	    curLabel = isLabeled[leafID]?labels[leafID]:getLabel(leafID);
-	  }
-	}
-	leaf     = path->getHead();
-	while (leaf) {
-	  leafID = leaf - primalTreeNodes;
-	  isLabeled[leafID] = true;
-	  labels[leafID] = curLabel;
-	  leaf = leaf->getNextDyn();
-	}
-      }
-      completelyLabeled = true;
-      delete [] isLabeled;
-      isLabeled = 0;
-    }
+    if (!completelyLabeled) completeLabels();
 
     // extract all relevant labels in O(N)
-    for (int i=0; i<nVerts; i++) {
+    for (PlanarIdx i=0; i<nVerts; i++) {
       if (labels[i]==label) {
 	vertices.push_back(i);
       }
@@ -472,22 +551,35 @@ double CutPlanar::getMaxFlow() {
   }
 
 
-  std::vector<int> CutPlanar::getCutBoundary(ELabel label) {
+  template<class DynTree>
+  void CutPlanarT<DynTree>::getLabels(ELabel *lmask) {
     if (!computedFlow) getMaxFlow();
+    if (!completelyLabeled) completeLabels();
+
+    memcpy(lmask, labels, sizeof(ELabel)*nVerts);
+  }
 
-    int         cutFace  = getFaceIndex(pfStartOfCut);  
-    int         currFace = cutFace;
-    PlanarEdge *currEdge;
-    int         currHead, currTail;
-    DynRoot *currRoot;
-    DynLeaf *currLeaf;
-    int      currLeafID;
-    std::vector<int> boundary;
+
+  template<class DynTree>
+  std::vector<PlanarIdx> CutPlanarT<DynTree>::getCutBoundary(ELabel label) {
+    if (!computedFlow) getMaxFlow();
+
+    PlanarIdx   cutFace  = faceStartOfCut;  
+    PlanarIdx   currFace = cutFace;
+    PlanarIdx   currEdge;
+    PlanarIdx   currHead, currTail;
+    Root *currRoot;
+    Leaf *currLeaf;
+    PlanarIdx currLeafID;
+    std::vector<PlanarIdx> boundary;
+
+    if (cutFace < 0) //the source is blocked
+      return boundary;
 
     while (true) {
       currEdge  = dualTreeEdge[currFace];
-      currHead  = currEdge->getHead() - verts;
-      currTail  = currEdge->getTail() - verts;
+      currHead  = graph.head[currEdge];
+      currTail  = graph.tail[currEdge];
       if (!completelyLabeled) {
 	// retrieve labels of 'currHead' and 'currTail'
 	if (isLabeled[currHead]) {
@@ -495,8 +587,8 @@ double CutPlanar::getMaxFlow() {
 	    isLabeled[currTail] = true;
 	    labels[currTail]    = labels[currHead]==LABEL_SOURCE?LABEL_SINK:LABEL_SOURCE;
 	    currLeaf   = primalTreeNodes + currTail;
-	    currRoot   = currLeaf->getPath();
-	    currLeaf   = currRoot->getTail();
+	    currRoot   = currLeaf->getPath(arena);
+	    currLeaf   = currRoot->getTail(arena);
 	    currLeafID = currLeaf - primalTreeNodes;
 	    isLabeled[currLeafID] = true;
 	    labels[currLeafID]    = labels[currTail];
@@ -506,8 +598,8 @@ double CutPlanar::getMaxFlow() {
 	    isLabeled[currHead] = true;
 	    labels[currHead]    = labels[currTail]==LABEL_SOURCE?LABEL_SINK:LABEL_SOURCE;
 	    currLeaf   = primalTreeNodes + currHead;
-	    currRoot   = currLeaf->getPath();
-	    currLeaf   = currRoot->getTail();
+	    currRoot   = currLeaf->getPath(arena);
+	    currLeaf   = currRoot->getTail(arena);
 	    currLeafID = currLeaf - primalTreeNodes;
 	    isLabeled[currLeafID] = true;
 	    labels[currLeafID]    = labels[currHead];
@@ -516,8 +608,8 @@ double CutPlanar::getMaxFlow() {
 	    isLabeled[currHead] = isLabeled[currTail] = true;
 	    labels[currTail]    = labels[currHead]==LABEL_SOURCE?LABEL_SINK:LABEL_SOURCE;
 	    currLeaf   = primalTreeNodes + currTail;
-	    currRoot   = currLeaf->getPath();
-	    currLeaf   = currRoot->getTail();
+	    currRoot   = currLeaf->getPath(arena);
+	    currLeaf   = currRoot->getTail(arena);
 	    currLeafID = currLeaf - primalTreeNodes;
 	    isLabeled[currLeafID] = true;
 	    labels[currLeafID]    = labels[currTail];
@@ -526,22 +618,25 @@ double CutPlanar::getMaxFlow() {
 	// end of head/tail labeling
       }
       boundary.push_back(labels[currHead]==label?currHead:currTail);
-      currFace = dualTreeParent[currFace] - faces;
+      currFace = dualTreeParent[currFace];
       if (currFace == cutFace) break; 
     }  
     return boundary;
   }
 
 
-  std::vector<int> CutPlanar::getCircularPath() {
+  template<class DynTree>
+  std::vector<PlanarIdx> CutPlanarT<DynTree>::getCircularPath() {
     if (!computedFlow) getMaxFlow();
 
-    int         cutFace  = getFaceIndex(pfStartOfCut);  
-    int         currFace = cutFace;
-    std::vector<int> circel;
+    PlanarIdx   cutFace  = faceStartOfCut;  
+    PlanarIdx   currFace = cutFace;
+    std::vector<PlanarIdx> circel;
+    if (cutFace < 0) //the source is blocked
+      return circel;
     while (true) {
       circel.push_back(currFace);
-      currFace = dualTreeParent[currFace] - faces;
+      currFace = dualTreeParent[currFace];
       if (currFace == cutFace) break; 
     }  
     return circel;
@@ -551,53 +646,31 @@ double CutPlanar::getMaxFlow() {
   /***************************************************
    * Protected Methods                               *
    ***************************************************/
-  void CutPlanar::preFlow() {
-
-    CGNode **cgNodes;
-    CGraph graph(nFaces + 1);
-
-    int srcFaceIdx, dstFaceIdx;
-    PlanarEdge *infEdge = verts[sinkID].getEdge(0);
-    int infFaceIdx = (infEdge->getTail()-verts==sinkID)?(infEdge->getHeadDual()-faces):(infEdge->getTailDual()-faces);
-    int i;
-
-    cgNodes = new CGNode*[nFaces];
+  template<class DynTree>
+  void CutPlanarT<DynTree>::preFlow() {
 
-    for (i=0; i<nFaces; i++)
-      cgNodes[i] = graph.addNode(i);
+    CapType *dist;
+    PlanarIdx infEdge = graph.getEdge(sinkID, 0);
+    PlanarIdx infFaceIdx = (graph.tail[infEdge]==sinkID)?graph.headDual[infEdge]:graph.tailDual[infEdge];
+    PlanarIdx i;
 
+    dist = new CapType[nFaces];
 
-    //insert dual darts of input graph with costs lower than infinity
-    for (i=0; i<nEdges; i++) {
-
-      srcFaceIdx = getFaceIndex(edges[i].getTailDual());
-      dstFaceIdx = getFaceIndex(edges[i].getHeadDual());
-
-      graph.addEdge(cgNodes[srcFaceIdx], 
-		    cgNodes[dstFaceIdx], 
-		    edges[i].getCapacity());
-
-      graph.addEdge(cgNodes[dstFaceIdx], 
-		    cgNodes[srcFaceIdx], 
-		    edges[i].getRevCapacity());
-    
-    }
+    runDualDijkstra(infFaceIdx, dist);
 
-    graph.runDijkstra(cgNodes[infFaceIdx]);
-
-    int faceTIdx, faceHIdx;
+    PlanarIdx faceTIdx, faceHIdx;
     double w, rw;
     CapType eta;
 
     for (i=0; i<nEdges; i++) {
     
-      faceTIdx = getFaceIndex(edges[i].getTailDual());
-      faceHIdx = getFaceIndex(edges[i].getHeadDual());
+      faceTIdx = graph.tailDual[i];
+      faceHIdx = graph.headDual[i];
 
-      w  = edges[i].getCapacity();
-      rw = edges[i].getRevCapacity();
+      w  = graph.cap[i];
+      rw = graph.rcap[i];
 
-      eta = cgNodes[faceHIdx]->dijkWeight - cgNodes[faceTIdx]->dijkWeight;
+      eta = dist[faceHIdx] - dist[faceTIdx];
 
       w  = w  - eta;
       rw = rw + eta;
@@ -619,23 +692,173 @@ double CutPlanar::getMaxFlow() {
       if (rw < EPSILON)
       	rw = 0;
 
-      edges[i].setCapacity(w);
-      edges[i].setRevCapacity(rw);
+      graph.cap[i]  = w;
+      graph.rcap[i] = rw;
    
     }
 
-    delete [] cgNodes;
+    delete [] dist;
+
+  }
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::buildDualAdjacency() {
+
+    PlanarIdx i, f, srcFaceIdx, dstFaceIdx;
+    PlanarIdx *fill;
+
+    if (dualAdjFirst)
+      delete [] dualAdjFirst;
+    if (dualAdjFace)
+      delete [] dualAdjFace;
+    if (dualAdjDart)
+      delete [] dualAdjDart;
+
+    dualAdjFirst = new PlanarIdx[nFaces+1];
+    dualAdjFace  = new PlanarIdx[2*nEdges];
+    dualAdjDart  = new PlanarIdx[2*nEdges];
+
+    //count the darts leaving each face
+    for (f=0; f<=nFaces; f++)
+      dualAdjFirst[f] = 0;
+
+    for (i=0; i<nEdges; i++) {
+      dualAdjFirst[graph.tailDual[i]+1]++;
+      dualAdjFirst[graph.headDual[i]+1]++;
+    }
+
+    for (f=0; f<nFaces; f++)
+      dualAdjFirst[f+1] += dualAdjFirst[f];
+
+    //the darts are filled in from the back, so that they are visited
+    //in the same order as in the former linked list representation
+    fill = new PlanarIdx[nFaces];
+    for (f=0; f<nFaces; f++)
+      fill[f] = dualAdjFirst[f+1];
+
+    for (i=0; i<nEdges; i++) {
+
+      srcFaceIdx = graph.tailDual[i];
+      dstFaceIdx = graph.headDual[i];
+
+      f = --fill[srcFaceIdx];
+      dualAdjFace[f] = dstFaceIdx;
+      dualAdjDart[f] = 2*i;
+
+      f = --fill[dstFaceIdx];
+      dualAdjFace[f] = srcFaceIdx;
+      dualAdjDart[f] = 2*i + 1;
+
+    }
+
+    delete [] fill;
+
+  }
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::runDualDijkstra(PlanarIdx startFace, CapType *dist) {
+
+    CapType *weight;
+    CapType sum = 0;
+    bool integral = true;
+    PlanarIdx i, a;
+
+    //gather the dart capacities in adjacency order
+    weight = new CapType[2*nEdges];
+
+    for (a=0; a<2*nEdges; a++) {
+      i = dualAdjDart[a];
+      weight[a] = (i & 1) ? graph.rcap[i >> 1] : graph.cap[i >> 1];
+
+      sum += weight[a];
+      integral = integral && RadixHeap::isValidKey(weight[a]);
+    }
+
+    //integral capacities allow for a radix heap, as no path is 
+    //longer than the sum of all capacities
+    if (threadPool)
+      runDualDeltaStepping(startFace, dist, weight);
+    else if (integral && RadixHeap::isValidKey(sum))
+      runDualDijkstra< RadixHeapT<PlanarIdx> >(startFace, dist, weight);
+    else
+      runDualDijkstra< DAryHeap<DUAL_HEAP_ARITY, PlanarIdx> >(startFace, dist, weight);
+
+    delete [] weight;
+
+  }
+
+
+  template<class DynTree>
+  template<class Heap>
+  void CutPlanarT<DynTree>::runDualDijkstra(PlanarIdx startFace, CapType *dist, const CapType *weight) {
+
+    Heap heap(nFaces);
+    PlanarIdx *zeroFaces, numZeroFaces = 0;
+    PlanarIdx f, d, a;
+    CapType w;
+
+    for (f=0; f<nFaces; f++)
+      dist[f] = CAP_INF;
+
+    //faces reached via zero weight darts are settled immediately 
+    //without passing through the heap
+    zeroFaces = new PlanarIdx[nFaces];
+
+    dist[startFace] = 0;
+    heap.insert(startFace, 0);
+
+    while (true) {
+
+      if (numZeroFaces)
+	f = zeroFaces[--numZeroFaces];
+      else if (!heap.deleteMin(f))
+	break;
+
+      //update all neighboring faces
+      for (a=dualAdjFirst[f]; a<dualAdjFirst[f+1]; a++) {
+
+	d = dualAdjFace[a];
+	w = dist[f] + weight[a];
+
+	if (heap.contains(d)) {
+
+	  //can we improve on the shortest path to the target face?
+	  if (dist[d] > w) {
+	    dist[d] = w;
+	    heap.decrease(d, w);
+	  }
+
+	} else if (dist[d] == CAP_INF) {
+
+	  dist[d] = w;
+
+	  if (weight[a] == 0)
+	    zeroFaces[numZeroFaces++] = d;
+	  else
+	    heap.insert(d, w);
+
+	}
+
+      }
+
+    }
+
+    delete [] zeroFaces;
 
   }
 
 
-  void CutPlanar::performChecks(ECheckFlags checks) {
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::performChecks(ECheckFlags checks) {
     // check whether the graph is connected 
     if (checks & CHECK_CONNECTIVITY) {
-      int v, vNumE, e;
+      PlanarIdx v, vNumE, e;
       bool *unconnected = new bool[nVerts];
       for (v=0; v<nVerts; v++) unconnected[v]=true;
-      std::vector<int> boundary(1,0);
+      std::vector<PlanarIdx> boundary(1,0);
       while (boundary.size()>0) {
 	v = boundary.back();
 	unconnected[v] = false;
@@ -643,7 +866,7 @@ double CutPlanar::getMaxFlow() {
 	vNumE = verts[v].getNumEdges();
 	for (e=0; e<vNumE; e++) {
 	  PlanarEdge *pe = verts[v].getEdge(e);
-	  int u1, u2;
+	  PlanarIdx u1, u2;
 	  u1 = pe->getHead()-verts;
 	  u2 = pe->getTail()-verts;
 	  if (unconnected[u1]) boundary.push_back(u1);
@@ -663,7 +886,7 @@ double CutPlanar::getMaxFlow() {
 
     // check whether all edges have non-negative capacities
     if (checks & CHECK_NON_NEGATIVE_COST) {
-      for (int edge=0; edge<nEdges; edge++) {
+      for (PlanarIdx edge=0; edge<nEdges; edge++) {
 	if ((edges[edge].getCapacity()<0) || (edges[edge].getRevCapacity()<0))
 	  throw ExceptionCheckNonNegativeCost();
       }
@@ -674,9 +897,9 @@ double CutPlanar::getMaxFlow() {
       // Euler characteristic
       if (nVerts-nEdges+nFaces!=2) throw ExceptionCheckPlanarity();
       // check ccw integrity
-      for(int vID=0; vID<nVerts; vID++) {
+      for(PlanarIdx vID=0; vID<nVerts; vID++) {
 	PlanarVertex *v = verts+vID;
-	for(int eID=0; eID<v->getNumEdges(); eID++) {
+	for(PlanarIdx eID=0; eID<v->getNumEdges(); eID++) {
 	  PlanarEdge *pe1 = v->getEdge(eID);
 	  PlanarEdge *pe2 = v->getEdge(eID+1);
 	  PlanarFace *faceLeftOf_e1  = (pe1->getTail()==v)?pe1->getTailDual():pe1->getHeadDual();
@@ -687,8 +910,8 @@ double CutPlanar::getMaxFlow() {
 	}
       }
       // save to every face one edge
-      int e0,u,v,f0,f1;
-      int *firstEdge = new int[nFaces];
+      PlanarIdx e0,u,v,f0,f1;
+      PlanarIdx *firstEdge = new PlanarIdx[nFaces];
       for (f0=0; f0<nFaces; f0++) firstEdge[f0] = -1; 
       for (e0=0; e0<nEdges; e0++) {
 	f0 = edges[e0].getTailDual() - faces;
@@ -701,7 +924,7 @@ double CutPlanar::getMaxFlow() {
       bool sanity = true;
       bool *isSelected = new bool[nVerts];
       for (u=0; u<nVerts; u++) isSelected[u]=false;      
-      std::vector<int> vertCycle;
+      std::vector<PlanarIdx> vertCycle;
       bool orient;          
       for (f0=0; f0<nFaces; f0++) {
 	if (firstEdge[f0] < 0) {
@@ -741,41 +964,44 @@ double CutPlanar::getMaxFlow() {
   /***************************************************
    * Private Methods                                 *
    ***************************************************/
-  void CutPlanar::constructSpanningTrees() {
+  template<class DynTree>
+  void CutPlanarT<DynTree>::constructSpanningTrees() {
 
-    //pointers to entities in the graph
-    PlanarVertex *pvCurVert, *pvSource, *pvSink;
-    PlanarEdge   *peCurEdge;
-    PlanarFace   *pfLeft, *pfRight;
+    //current edge and faces left and right of it
+    PlanarIdx curEdge;
+    PlanarIdx fLeft, fRight;
 
     //pointer to current node in primal spanning tree T
-    DynLeaf *plCurNode;
+    Leaf *plCurNode;
 
     //indices of current edge and vertex
-    short *maxEdgeIdx, *curEdgeIdx;
-    int curVertIdx;
+    PlanarIdx *maxEdgeIdx, *curEdgeIdx;
+    PlanarIdx curVertIdx;
+    PlanarIdx tailIdx, dartTailIdx;
 
     //capacities of current edge in graph
     CapType arcCap, antiArcCap;
     CapType *pInDartCap, *pOutDartCap;
 
     //new branch for insertion in primal spanning tree T
-    DynRoot *curBranch;
-    int curBranchLength;
-    DynLeaf **curBranchLeaves;
+    Root *curBranch;
+    PlanarIdx curBranchLength;
+    Leaf **curBranchLeaves;
 
     //data for weak link in primal spanning tree T
-    DynLeaf *linkNode;
+    Leaf *linkNode;
     CapType  linkCost, linkCostR;
     bool     linkMapping;
-    void    *linkData;
+    DynData  linkData;
 
     //state variables
     bool bAddedNewPrimEdge; //true if new edges are being added, false in case of a backtrack
+    PlanarIdx numDualEdges = 0; //number of edges added to T*
 
     //initialize first bit of edge flag to zero - this indicates whether an edge has been added to T*
-    for (int i=0; i<nEdges; i++)
-      edges[i].setFlags(edges[i].getFlags() & 0xfe);
+    uchar *flags = graph.flags;
+    for (PlanarIdx i=0; i<nEdges; i++)
+      flags[i] &= 0xfe;
 
     //set the source and sink pointers of the primal spanning tree
     //the primal spanning nodes and the vertices of the planar graph 
@@ -785,23 +1011,19 @@ double CutPlanar::getMaxFlow() {
 
     //  plSink->id = nVerts - 1;
 
-    pvSource = verts + sourceID;
-    pvSink   = verts + sinkID;
-
     //initialize depth search
-    pvCurVert = pvSink;   //begin search at the sink
-    plCurNode = plSink;
+    curVertIdx = sinkID;   //begin search at the sink
+    plCurNode  = plSink;
 
-    curEdgeIdx = new short[nVerts];
-    maxEdgeIdx = new short[nVerts];
+    curEdgeIdx = new PlanarIdx[nVerts];
+    maxEdgeIdx = new PlanarIdx[nVerts];
   
-    for (int i=0; i<nVerts; i++) {
+    for (PlanarIdx i=0; i<nVerts; i++) {
       curEdgeIdx[i] = -1;
       maxEdgeIdx[i] = 0;
     }
   
-    curVertIdx = getVertIndex(pvCurVert); 
-    maxEdgeIdx[curVertIdx] = pvSink->getNumEdges();
+    maxEdgeIdx[curVertIdx] = graph.getNumEdges(sinkID);
 
     isSourceBlocked = true;
     bAddedNewPrimEdge = false;
@@ -813,29 +1035,28 @@ double CutPlanar::getMaxFlow() {
 
     curBranch = 0;
     curBranchLength = 0;
-    curBranchLeaves = new DynLeaf*[nVerts];
+    curBranchLeaves = new Leaf*[nVerts];
 
   
-    while (!(pvCurVert == pvSink && curEdgeIdx[curVertIdx] >= maxEdgeIdx[curVertIdx])) {
+    while (!(curVertIdx == sinkID && curEdgeIdx[curVertIdx] >= maxEdgeIdx[curVertIdx])) {
 
       curEdgeIdx[curVertIdx]++;
-      peCurEdge = pvCurVert->getEdge(curEdgeIdx[curVertIdx]);
+      curEdge = graph.getEdge(curVertIdx, curEdgeIdx[curVertIdx]);
 
-      PlanarVertex *pvTail = peCurEdge->getTail();
-      PlanarVertex *pvDartTail;
+      tailIdx = graph.tail[curEdge];
 
-      arcCap     = peCurEdge->getCapacity(); 
-      antiArcCap = peCurEdge->getRevCapacity();
+      arcCap     = graph.cap[curEdge]; 
+      antiArcCap = graph.rcap[curEdge];
 
       //get capacities of the two darts
-      if (pvCurVert == pvTail) { //edge points away from current vertex
+      if (curVertIdx == tailIdx) { //edge points away from current vertex
 	pInDartCap  = &antiArcCap;
 	pOutDartCap = &arcCap;
-	pvDartTail  = peCurEdge->getHead();
+	dartTailIdx = graph.head[curEdge];
       } else { //edge points to current vertex
 	pInDartCap  = &arcCap;
 	pOutDartCap = &antiArcCap;
-	pvDartTail  = peCurEdge->getTail();
+	dartTailIdx = tailIdx;
       }
     
 
@@ -844,50 +1065,50 @@ double CutPlanar::getMaxFlow() {
 	      //...not all edges of the vertex have been visited yet AND...
 	      ((!*pInDartCap) ||                                     
 	       //...either the dart pointing to the current vertex has capcity 0...
-	       (curEdgeIdx[getVertIndex(pvDartTail)] != -1)) ) {     
+	       (curEdgeIdx[dartTailIdx] != -1)) ) {     
 	//...or the vertex at the end of the edge has been visited already (or both).
 
 	//check if the edge has not yet been added to T*
-	if (!(peCurEdge->getFlags() & 1)) {
+	if (!(flags[curEdge] & 1)) {
 
 	  if (arcCap && antiArcCap) 
 	    throw ExceptionUnexpectedError(); //throw ExceptionCyclesDetected(); 
 	
 	  //identify the faces left and right of the dart with positive capacity 
 	  if (arcCap) {
-	    pfRight = peCurEdge->getHeadDual();
-	    pfLeft = peCurEdge->getTailDual();
+	    fRight = graph.headDual[curEdge];
+	    fLeft  = graph.tailDual[curEdge];
 	  } else {
-	    pfRight = peCurEdge->getTailDual();
-	    pfLeft = peCurEdge->getHeadDual();
+	    fRight = graph.tailDual[curEdge];
+	    fLeft  = graph.headDual[curEdge];
 	  }
       
-	  int fIdx = getFaceIndex(pfLeft);
-	  dualTreeParent[fIdx] = pfRight;
-	  dualTreeEdge[fIdx]   = peCurEdge;
+	  dualTreeParent[fLeft] = fRight;
+	  dualTreeEdge[fLeft]   = curEdge;
 
-	  peCurEdge->setFlags((peCurEdge->getFlags() & 0xfe) + 1);
+	  flags[curEdge] = (flags[curEdge] & 0xfe) + 1;
+	  numDualEdges++;
 
 	}
 
 	curEdgeIdx[curVertIdx]++;
       
-	peCurEdge = pvCurVert->getEdge(curEdgeIdx[curVertIdx]);
+	curEdge = graph.getEdge(curVertIdx, curEdgeIdx[curVertIdx]);
 
-	pvTail = peCurEdge->getTail();
+	tailIdx = graph.tail[curEdge];
 
-	arcCap     = peCurEdge->getCapacity();
-	antiArcCap = peCurEdge->getRevCapacity();
+	arcCap     = graph.cap[curEdge];
+	antiArcCap = graph.rcap[curEdge];
 
 	//get capacities of the two darts
-	if (pvCurVert == pvTail) { //edge points away from current vertex
+	if (curVertIdx == tailIdx) { //edge points away from current vertex
 	  pInDartCap  = &antiArcCap;
 	  pOutDartCap = &arcCap;
-	  pvDartTail  = peCurEdge->getHead();
+	  dartTailIdx = graph.head[curEdge];
 	} else { //edge points to current vertex
 	  pInDartCap  = &arcCap;
 	  pOutDartCap = &antiArcCap;
-	  pvDartTail  = peCurEdge->getTail();
+	  dartTailIdx = tailIdx;
 	}
       
 
@@ -897,22 +1118,20 @@ double CutPlanar::getMaxFlow() {
       //check if a backtrack has to be performed
       if (curEdgeIdx[curVertIdx] == maxEdgeIdx[curVertIdx]) {
 
-	if (pvCurVert != pvSink) {  //no backtrack at the sink
+	if (curVertIdx != sinkID) {  //no backtrack at the sink
 
 	  //go back via the edge that lead to the currrent vertex (current edge)
-	  if (pvCurVert == peCurEdge->getHead())
-	    pvCurVert = peCurEdge->getTail();
+	  if (curVertIdx == graph.head[curEdge])
+	    curVertIdx = graph.tail[curEdge];
 	  else
-	    pvCurVert = peCurEdge->getHead();
-
-	  curVertIdx = getVertIndex(pvCurVert);
+	    curVertIdx = graph.head[curEdge];
 
 	  //check if there has been found a new primary spanning tree edge in the last step
 	  if (bAddedNewPrimEdge && curBranchLength) {  
 	  
-	    curBranch = DynRoot::DynRootFromLeafChain(curBranchLeaves, curBranchLength);
+	    curBranch = DynTree::rootFromLeafChain(arena, curBranchLeaves, curBranchLength);
 
-	    curBranch->getTail()->setWeakLink(linkNode,
+	    curBranch->getTail(arena)->setWeakLink(arena, linkNode,
 					      linkCost, linkCostR,
 					      linkMapping,
 					      linkData);
@@ -925,7 +1144,7 @@ double CutPlanar::getMaxFlow() {
 
 	  //perform backtrack in the primal spanning tree as well
   
-	  plCurNode = plCurNode->getNext();
+	  plCurNode = plCurNode->getNext(arena);
 
 	}
 
@@ -938,7 +1157,7 @@ double CutPlanar::getMaxFlow() {
 	  linkCost    = *pInDartCap;
 	  linkCostR   = *pOutDartCap;
 	  linkMapping = (pInDartCap == &antiArcCap);
-	  linkData    = (void *)peCurEdge;
+	  linkData    = curEdge;
 
 	  curBranchLength = 0;
 	}
@@ -946,17 +1165,15 @@ double CutPlanar::getMaxFlow() {
 	bAddedNewPrimEdge = true;
 
 	if (pInDartCap == &arcCap)
-	  pvCurVert = peCurEdge->getTail();
+	  curVertIdx = graph.tail[curEdge];
 	else
-	  pvCurVert = peCurEdge->getHead();
+	  curVertIdx = graph.head[curEdge];
 
-	if (pvCurVert == pvSource)
+	if (curVertIdx == sourceID)
 	  isSourceBlocked = false;
-
-	curVertIdx = getVertIndex(pvCurVert);
       
-	curEdgeIdx[curVertIdx] = pvCurVert->getEdgeID(peCurEdge);
-	maxEdgeIdx[curVertIdx] = curEdgeIdx[curVertIdx] + pvCurVert->getNumEdges();
+	curEdgeIdx[curVertIdx] = graph.getEdgeID(curVertIdx, curEdge);
+	maxEdgeIdx[curVertIdx] = curEdgeIdx[curVertIdx] + graph.getNumEdges(curVertIdx);
 
 	plCurNode = primalTreeNodes + curVertIdx;
 
@@ -965,10 +1182,10 @@ double CutPlanar::getMaxFlow() {
 	//add the current node to the new branch
 	curBranchLeaves[curBranchLength++] = plCurNode;
 
-	plCurNode->setWeakLink(0,
+	plCurNode->setWeakLink(arena, 0,
 			       *pInDartCap, *pOutDartCap,
 			       pInDartCap == &antiArcCap,
-			       peCurEdge);
+			       curEdge);
 
       } //backtrack oder new edge in primal spanning tree T
 
@@ -980,5 +1197,907 @@ double CutPlanar::getMaxFlow() {
     delete [] maxEdgeIdx;
     delete [] curBranchLeaves;
 
+    //T* is a spanning tree if the search has reached all vertices
+    treesSpanning = (numDualEdges == nFaces-1);
+
+  }
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::resetCapacities() {
+
+    CapType *caps  = graph.cap;
+    CapType *rcaps = graph.rcap;
+    uchar   *flags = graph.flags;
+    PlanarIdx i;
+
+    //restore input capacities and reset edge flags
+    memcpy(caps,  inputCaps,    sizeof(CapType)*nEdges);
+    memcpy(rcaps, inputRevCaps, sizeof(CapType)*nEdges);
+    memset(flags, 0, nEdges);
+
+    //determine minimum weight that is considered = infinity...
+    capSum = 0;
+    nInfDarts = 0;
+
+    for (i=0; i<nEdges; i++) {
+      if (caps[i] != CAP_INF)
+	capSum += caps[i];
+      else
+	nInfDarts++;
+
+      if (rcaps[i] != CAP_INF)
+	capSum += rcaps[i];
+      else
+	nInfDarts++;
+    }
+
+    capInf = capSum + 1.;
+
+    //...and set all infinity edges to this weight
+    infDarts.clear();
+
+    for (i=0; i<nEdges; i++) {
+      if (caps[i] == CAP_INF) {
+	caps[i] = capInf;
+	infDarts.push_back(2*i);
+      }
+
+      if (rcaps[i] == CAP_INF) {
+	rcaps[i] = capInf;
+	infDarts.push_back(2*i + 1);
+      }
+    }
+
+    //virtually remove all edges with capacity zero
+    capMin = CAP_INF;
+    nEpsDarts = 0;
+
+    for (i=0; i<nEdges; i++) {
+
+      if (!caps[i])
+	nEpsDarts++;
+      else if (caps[i] < capMin) 
+	capMin = caps[i];
+      
+      if (!rcaps[i])
+	nEpsDarts++;
+      else if (rcaps[i] < capMin)
+	capMin = rcaps[i];
+
+    }
+
+    capEps = capMin / (nEpsDarts * 2);
+
+    if (capEps == 0)   //the graph completely consists of zero edges
+      capEps = 0.1;    
+
+    for (i=0; i<nEdges; i++) {
+
+      if (!caps[i]) {
+	caps[i] = capEps;
+	flags[i] |= 2;
+      }
+    
+      if (!rcaps[i]) {
+	rcaps[i] = capEps;
+	flags[i] |= 4;
+      }
+
+    }
+
+    capsDirty = false;
+    warmStart = false;
+    changedEdges.clear();
+
+  }
+
+
+  //writes the costs of a path edge to the edge e of graph
+  static void storeEdgeCost(DynData e, 
+			    CapType cost, CapType costR, 
+			    bool mapping, 
+			    PlanarGraph *graph) {
+
+    //the mapping-bit indicates, whether the forward capacity of the path edge 
+    //maps to the arc or the antiarc of the corresponding edge in the graph
+    if (!mapping) {
+      graph->cap[e]  = cost;
+      graph->rcap[e] = costR;
+    } else {
+      graph->rcap[e] = cost;
+      graph->cap[e]  = costR;
+    }
+
+  }
+
+
+  template<class DynTree>
+  bool CutPlanarT<DynTree>::updateResidualCapacity(PlanarIdx edgeID, CapType cap, CapType rcap) {
+
+    CapType oldCap  = inputCaps[edgeID];
+    CapType oldRCap = inputRevCaps[edgeID];
+    uchar flags;
+
+    //keep the replacement values for infinite and zero capacities valid
+    if (oldCap  != CAP_INF) capSum -= oldCap;
+    if (oldRCap != CAP_INF) capSum -= oldRCap;
+    if (cap     != CAP_INF) capSum += cap;
+    if (rcap    != CAP_INF) capSum += rcap;
+
+    nInfDarts += (cap  == CAP_INF) + (rcap    == CAP_INF);
+    nInfDarts -= (oldCap == CAP_INF) + (oldRCap == CAP_INF);
+    nEpsDarts += (!cap) + (!rcap) - (!oldCap) - (!oldRCap);
+
+    if (cap && transformCapacity(cap) < capMin)
+      capMin = transformCapacity(cap);
+    if (rcap && transformCapacity(rcap) < capMin)
+      capMin = transformCapacity(rcap);
+
+    bool valid = !nEpsDarts || capEps * 2 * nEpsDarts <= capMin;
+
+    //the infinite darts of edgeID are raised as well, as long as 
+    //its input capacities are not replaced yet
+    if (valid && nInfDarts && capSum >= capInf)
+      valid = raiseInfCapacity();
+
+    inputCaps[edgeID]    = cap;
+    inputRevCaps[edgeID] = rcap;
+
+    if (!valid)
+      return false;
+
+    if (cap  == CAP_INF && oldCap  != CAP_INF) infDarts.push_back(2*edgeID);
+    if (rcap == CAP_INF && oldRCap != CAP_INF) infDarts.push_back(2*edgeID + 1);
+
+    //the residual capacities change by the same amount as the capacities
+    if (!addResidualCapacity(edgeID, 
+			     transformCapacity(cap)  - transformCapacity(oldCap),
+			     transformCapacity(rcap) - transformCapacity(oldRCap)))
+      return false;
+
+    flags = graph.flags[edgeID] & ~6;
+    if (!cap)  flags |= 2;
+    if (!rcap) flags |= 4;
+    graph.flags[edgeID] = flags;
+
+    return true;
+
+  }
+
+
+  template<class DynTree>
+  bool CutPlanarT<DynTree>::addResidualCapacity(PlanarIdx edgeID, CapType dCap, CapType dRCap) {
+
+    PlanarIdx child = -1;
+    CapType resCap, resRCap;
+
+    //the residual capacities of the edges of T are held by T
+    if (isPrimalTreeEdge(edgeID))
+      child = cutTreeEdge(edgeID);
+
+    resCap  = graph.cap[edgeID]  + dCap;
+    resRCap = graph.rcap[edgeID] + dRCap;
+
+    //the previous flow exceeds the new capacity
+    bool valid = (resCap >= -EPSILON && resRCap >= -EPSILON);
+
+    //obviate numerical issues the same way preFlow() does
+    if (valid) {
+      graph.cap[edgeID]  = (resCap  < EPSILON) ? 0 : resCap;
+      graph.rcap[edgeID] = (resRCap < EPSILON) ? 0 : resRCap;
+      changedEdges.push_back(edgeID);
+    }
+
+    if (child >= 0)
+      linkTreeEdge(child, edgeID);
+
+    return valid;
+
+  }
+
+
+  template<class DynTree>
+  bool CutPlanarT<DynTree>::raiseInfCapacity() {
+
+    //leave room for further updates, so that this happens rarely
+    CapType delta = 2*capSum + 1. - capInf;
+    PlanarIdx d;
+    size_t i, n = 0;
+
+    //drop the darts that have become finite and those listed twice
+    for (i=0; i<infDarts.size(); i++) {
+      d = infDarts[i];
+      if (((d & 1) ? inputRevCaps[d >> 1] : inputCaps[d >> 1]) == CAP_INF)
+	infDarts[n++] = d;
+    }
+
+    infDarts.resize(n);
+    std::sort(infDarts.begin(), infDarts.end());
+    infDarts.erase(std::unique(infDarts.begin(), infDarts.end()), infDarts.end());
+
+    capInf += delta;
+
+    for (i=0; i<infDarts.size(); i++) {
+      d = infDarts[i];
+      if (!addResidualCapacity(d >> 1, (d & 1) ? 0 : delta, (d & 1) ? delta : 0))
+	return false;
+    }
+
+    return true;
+
+  }
+
+
+  template<class DynTree>
+  bool CutPlanarT<DynTree>::isPrimalTreeEdge(PlanarIdx edgeID) {
+
+    //the edges not in T* are in T - except for the edge the last 
+    //augmentation has removed from T* (cf. cutFaceEdge)
+    return dualTreeEdge[graph.tailDual[edgeID]] != edgeID &&
+           dualTreeEdge[graph.headDual[edgeID]] != edgeID &&
+           (cutTail < 0 || edgeID != cutFaceEdge);
+
+  }
+
+
+  template<class DynTree>
+  PlanarIdx CutPlanarT<DynTree>::cutTreeEdge(PlanarIdx edgeID) {
+
+    PlanarIdx child  = graph.tail[edgeID];
+    PlanarIdx parent = graph.head[edgeID];
+    Split sres;
+
+    if ((primalTreeNodes + child)->getNext(arena) != primalTreeNodes + parent) {
+      child  = graph.head[edgeID];
+      parent = graph.tail[edgeID];
+    }
+
+    //the edge follows the child on the exposed path
+    (primalTreeNodes + child)->expose(arena);
+    (primalTreeNodes + parent)->divide(arena, &sres);
+    (primalTreeNodes + child)->setWeakLink(arena, 0, 0, 0, false, 0);
+
+    assert(sres.dataBefore == edgeID);
+    storeEdgeCost(sres.dataBefore, 
+		  sres.costBefore, sres.costBeforeR, 
+		  sres.mappingBefore, 
+		  &graph);
+
+    return child;
+
+  }
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::linkTreeEdge(PlanarIdx child, PlanarIdx edgeID) {
+
+    //the mapping-bit is set if the dart towards the parent is the antiarc
+    bool bMapping   = (graph.tail[edgeID] != child);
+    PlanarIdx parent = bMapping ? graph.tail[edgeID] : graph.head[edgeID];
+    Root *prChild, *prParent;
+
+    prChild  = (primalTreeNodes + child)->expose(arena);
+    prParent = (primalTreeNodes + parent)->expose(arena);
+
+    if (!bMapping)
+      prChild->concatenate(arena, prParent, 
+			   graph.cap[edgeID], graph.rcap[edgeID], 
+			   bMapping, 
+			   edgeID);
+    else
+      prChild->concatenate(arena, prParent, 
+			   graph.rcap[edgeID], graph.cap[edgeID], 
+			   bMapping, 
+			   edgeID);
+
+  }
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::evertTree(PlanarIdx node) {
+
+    Leaf *pl = primalTreeNodes + node;
+    Root *pr = pl->expose(arena);
+
+    //replace the darts on the path to the root by their antidarts
+    if (pr->getTail(arena) != pl) {
+      pr->reverse();
+      pl->setWeakLink(arena, 0, 0, 0, false, 0);
+    }
+
+  }
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::reopenCut() {
+
+    PlanarIdx f = faceStartOfCut;
+    PlanarIdx e = dualTreeEdge[f];
+
+    //put the edge replaced by the saturated edge back into T* ...
+    dualTreeEdge[f] = cutFaceEdge;
+    if (cutFaceEdge < 0)
+      dualTreeParent[f] = -1;
+    else if (graph.tailDual[cutFaceEdge] == f)
+      dualTreeParent[f] = graph.headDual[cutFaceEdge];
+    else
+      dualTreeParent[f] = graph.tailDual[cutFaceEdge];
+
+    //... and the saturated edge into T, whose tail has become the 
+    //root of the tree holding the source
+    linkTreeEdge(cutTail, e);
+
+    cutTail = -1;
+
+  }
+
+
+  //a tree of T cut off by repairSpanningTrees(), given by its root, 
+  //and an edge of the repaired T having an endpoint in it
+  struct TreeLink {
+    PlanarIdx root, edge;
+    PlanarIdx other, otherRoot;  //other endpoint and the root of its tree
+
+    bool operator<(const TreeLink &l) const { return root < l.root; }
+  };
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::repairSpanningTrees() {
+
+    std::vector<PlanarIdx> repair, repairEdges, queue, queueEdge;
+    std::vector<TreeLink> links;
+    std::vector<TreeLink>::iterator it, itEnd;
+    TreeLink link;
+    PlanarIdx f, g, a, d, e, u, v;
+    PlanarIdx inEdge, numCut = 0;
+    CapType w, rw, eta;
+    size_t k;
+
+    reopenCut();
+
+    if (!faceStamp) {
+      faceStamp  = new unsigned[nFaces];
+      faceDist   = new CapType[nFaces];
+      facePred   = new PlanarIdx[nFaces];
+      repairHeap = new DAryHeap<DUAL_HEAP_ARITY, PlanarIdx>(nFaces);
+      memset(faceStamp, 0, sizeof(unsigned)*nFaces);
+      curStamp = 0;
+    }
+
+    //faces of the current repair are marked by curStamp and by 
+    //curStamp+1 once their distance is final
+    curStamp += 2;
+    if (curStamp < 2) {
+      memset(faceStamp, 0, sizeof(unsigned)*nFaces);
+      curStamp = 2;
+    }
+
+    isSourceBlocked = false;
+
+    //all faces have distance zero from the root of T*, as the darts 
+    //of T* leading away from the root have zero capacity. A capacity
+    //change can only increase the distances of the faces below an 
+    //edge of T* whose dart of zero capacity has become positive
+    for (k=0; k<changedEdges.size(); k++) {
+      e = changedEdges[k];
+
+      //the dart from the parent face is the arc if the child is 
+      //the head face and the antiarc otherwise
+      f = graph.headDual[e];
+      if (dualTreeEdge[f] == e && graph.cap[e] > 0 && faceStamp[f] != curStamp) {
+	faceStamp[f] = curStamp;
+	repair.push_back(f);
+      }
+
+      f = graph.tailDual[e];
+      if (dualTreeEdge[f] == e && graph.rcap[e] > 0 && faceStamp[f] != curStamp) {
+	faceStamp[f] = curStamp;
+	repair.push_back(f);
+      }
+    }
+
+    changedEdges.clear();
+
+    if (repair.empty())
+      return;
+
+    //add the subtrees of T* below these faces
+    for (k=0; k<repair.size(); k++) {
+      f = repair[k];
+      for (a=dualAdjFirst[f]; a<dualAdjFirst[f+1]; a++) {
+	g = dualAdjFace[a];
+	if (dualTreeParent[g] == f && faceStamp[g] != curStamp) {
+	  faceStamp[g] = curStamp;
+	  repair.push_back(g);
+	}
+      }
+    }
+
+    //cut the edges around these faces out of T, so that all of their 
+    //residual capacities are found in graph
+    for (k=0; k<repair.size(); k++) {
+      f = repair[k];
+      for (a=dualAdjFirst[f]; a<dualAdjFirst[f+1]; a++) {
+	d = dualAdjDart[a];
+	e = d >> 1;
+
+	//visit an edge between two such faces from its tail face only
+	if ((d & 1) && faceStamp[graph.tailDual[e]] == curStamp)
+	  continue;
+
+	repairEdges.push_back(e);
+
+	if (isPrimalTreeEdge(e)) {
+	  cutTreeEdge(e);
+	  numCut++;
+	}
+      }
+    }
+
+    //Dijkstra's algorithm on the marked faces, starting from the 
+    //unmarked faces next to them
+    for (k=0; k<repair.size(); k++) {
+      f = repair[k];
+      faceDist[f] = CAP_INF;
+
+      for (a=dualAdjFirst[f]; a<dualAdjFirst[f+1]; a++) {
+	if (faceStamp[dualAdjFace[a]] == curStamp)
+	  continue;
+
+	//capacity of the dart pointing to f
+	d = dualAdjDart[a];
+	w = (d & 1) ? graph.cap[d >> 1] : graph.rcap[d >> 1];
+
+	if (w < faceDist[f]) {
+	  faceDist[f] = w;
+	  facePred[f] = d >> 1;
+	}
+      }
+
+      if (faceDist[f] < CAP_INF)
+	repairHeap->insert(f, faceDist[f]);
+    }
+
+    while (repairHeap->deleteMin(f)) {
+
+      faceStamp[f] = curStamp + 1;
+
+      for (a=dualAdjFirst[f]; a<dualAdjFirst[f+1]; a++) {
+	g = dualAdjFace[a];
+	if (faceStamp[g] != curStamp)
+	  continue;
+
+	d = dualAdjDart[a];
+	w = faceDist[f] + ((d & 1) ? graph.rcap[d >> 1] : graph.cap[d >> 1]);
+
+	if (repairHeap->contains(g)) {
+	  if (w < faceDist[g]) {
+	    faceDist[g] = w;
+	    facePred[g] = d >> 1;
+	    repairHeap->decrease(g, w);
+	  }
+	} else if (faceDist[g] == CAP_INF) {
+	  faceDist[g] = w;
+	  facePred[g] = d >> 1;
+	  repairHeap->insert(g, w);
+	}
+      }
+    }
+
+    //shift the capacities by the new distances as preFlow() does, 
+    //the unmarked faces keep distance zero
+    for (k=0; k<repairEdges.size(); k++) {
+      e = repairEdges[k];
+
+      eta = 0;
+      if (faceStamp[graph.headDual[e]] > curStamp)
+	eta += faceDist[graph.headDual[e]];
+      if (faceStamp[graph.tailDual[e]] > curStamp)
+	eta -= faceDist[graph.tailDual[e]];
+
+      w  = graph.cap[e]  - eta;
+      rw = graph.rcap[e] + eta;
+
+      graph.cap[e]  = (w  < EPSILON) ? 0 : w;
+      graph.rcap[e] = (rw < EPSILON) ? 0 : rw;
+    }
+
+    //the shortest path tree replaces T* on the marked faces
+    for (k=0; k<repair.size(); k++) {
+      f = repair[k];
+      e = facePred[f];
+      dualTreeEdge[f]   = e;
+      dualTreeParent[f] = (graph.tailDual[e] == f) ? graph.headDual[e] : graph.tailDual[e];
+    }
+
+    //the edges around the marked faces that are not in T* any more 
+    //connect the trees cut off from T
+    for (k=0; k<repairEdges.size(); k++) {
+      e = repairEdges[k];
+      if (!isPrimalTreeEdge(e))
+	continue;
+
+      u = (primalTreeNodes + graph.tail[e])->expose(arena)->getTail(arena) - primalTreeNodes;
+      v = (primalTreeNodes + graph.head[e])->expose(arena)->getTail(arena) - primalTreeNodes;
+
+      link.edge = e;
+      link.root = u; link.other = graph.head[e]; link.otherRoot = v;
+      links.push_back(link);
+      link.root = v; link.other = graph.tail[e]; link.otherRoot = u;
+      links.push_back(link);
+    }
+
+    assert(links.size() == 2*(size_t)numCut);
+
+    std::sort(links.begin(), links.end());
+
+    //link the trees to the tree of the sink in breadth first order - 
+    //the trees and these edges form a tree themselves
+    queue.push_back(sinkID);
+    queueEdge.push_back(-1);
+
+    for (k=0; k<queue.size(); k++) {
+      link.root = queue[k];
+      inEdge    = queueEdge[k];
+
+      itEnd = std::upper_bound(links.begin(), links.end(), link);
+      for (it=std::lower_bound(links.begin(), links.end(), link); it!=itEnd; it++) {
+	if (it->edge == inEdge)
+	  continue;
+
+	//the endpoint in the other tree becomes its root
+	evertTree(it->other);
+	linkTreeEdge(it->other, it->edge);
+
+	queue.push_back(it->otherRoot);
+	queueEdge.push_back(it->edge);
+      }
+    }
+
+  }
+
+
+  //state shared by the threads during runDualDeltaStepping()
+  struct DeltaStepping {
+    const PlanarIdx *adjFirst;
+    const PlanarIdx *adjFace;
+    const CapType   *weight;
+
+    std::atomic<CapType> *dist;
+    std::atomic<int>     *stamp;  //last phase, in which a face changed
+
+    const PlanarIdx *frontier;    //faces to be relaxed in this phase
+    PlanarIdx  frontierSize;
+    std::atomic<PlanarIdx> next;  //next unprocessed frontier position
+    int        phase;
+
+    std::vector<PlanarIdx> *changed; //improved faces found by each thread
+  };
+
+
+  //relaxes the darts leaving the faces of the frontier
+  static void relaxFrontier(void *arg, int threadIdx) {
+
+    const int CHUNK_SIZE = 64;
+
+    DeltaStepping *ds = static_cast<DeltaStepping*>(arg);
+    std::vector<PlanarIdx> &changed = ds->changed[threadIdx];
+    PlanarIdx i, iEnd, a, f, d;
+    CapType df, w, cur;
+
+    while ((i = ds->next.fetch_add(CHUNK_SIZE)) < ds->frontierSize) {
+
+      iEnd = i + CHUNK_SIZE;
+      if (iEnd > ds->frontierSize)
+	iEnd = ds->frontierSize;
+
+      for (; i<iEnd; i++) {
+
+	f  = ds->frontier[i];
+	df = ds->dist[f].load(std::memory_order_relaxed);
+
+	for (a=ds->adjFirst[f]; a<ds->adjFirst[f+1]; a++) {
+
+	  d   = ds->adjFace[a];
+	  w   = df + ds->weight[a];
+	  cur = ds->dist[d].load(std::memory_order_relaxed);
+
+	  //atomic minimum - cur is reloaded by a failing exchange
+	  while (w < cur) {
+	    if (ds->dist[d].compare_exchange_weak(cur, w, std::memory_order_relaxed)) {
+	      if (ds->stamp[d].exchange(ds->phase, std::memory_order_relaxed) != ds->phase)
+		changed.push_back(d);
+	      break;
+	    }
+	  }
+
+	}
+      }
+    }
+
+  }
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::runDualDeltaStepping(PlanarIdx startFace, CapType *dist, const CapType *weight) {
+
+    DeltaStepping ds;
+    std::vector<PlanarIdx> frontier, far;
+    int numThreads = threadPool->getNumThreads();
+    int t, phase = 0;
+    PlanarIdx f, k;
+    size_t j;
+    CapType delta = 0, bucketEnd, minDist, df;
+
+    //the bucket width is the average finite dart capacity
+    for (j=0, k=0; j<(size_t)2*nEdges; j++)
+      if (weight[j] < capInf) {
+	delta += weight[j];
+	k++;
+      }
+
+    delta = k ? delta / k : 0;
+    if (delta <= 0)
+      delta = 1;
+
+    ds.adjFirst = dualAdjFirst;
+    ds.adjFace  = dualAdjFace;
+    ds.weight   = weight;
+    ds.dist     = new std::atomic<CapType>[nFaces];
+    ds.stamp    = new std::atomic<int>[nFaces];
+    ds.changed  = new std::vector<PlanarIdx>[numThreads];
+
+    for (f=0; f<nFaces; f++) {
+      ds.dist[f].store(CAP_INF, std::memory_order_relaxed);
+      ds.stamp[f].store(-1, std::memory_order_relaxed);
+    }
+
+    ds.dist[startFace].store(0, std::memory_order_relaxed);
+    frontier.push_back(startFace);
+    bucketEnd = delta;
+
+    //The faces with a distance below bucketEnd are relaxed in phases
+    //until none of them improves any more. Every distance is the minimum 
+    //over its (rounded) predecessor distances plus the dart capacity, 
+    //just as with Dijkstra's algorithm, so the results are identical.
+    while (true) {
+
+      while (!frontier.empty()) {
+
+	ds.frontier     = &frontier[0];
+	ds.frontierSize = (PlanarIdx)frontier.size();
+	ds.next.store(0);
+	ds.phase        = ++phase;
+
+	if (ds.frontierSize >= PARALLEL_MIN_FRONTIER)
+	  threadPool->run(&relaxFrontier, &ds);
+	else
+	  relaxFrontier(&ds, 0);
+
+	//sort the improved faces into the current bucket or the far set
+	frontier.clear();
+
+	for (t=0; t<numThreads; t++) {
+	  for (j=0; j<ds.changed[t].size(); j++) {
+	    f = ds.changed[t][j];
+	    if (ds.dist[f].load(std::memory_order_relaxed) < bucketEnd)
+	      frontier.push_back(f);
+	    else
+	      far.push_back(f);
+	  }
+	  ds.changed[t].clear();
+	}
+
+      }
+
+      //drop outdated entries of the far set and find the next bucket
+      minDist = CAP_INF;
+
+      for (j=0, k=0; j<far.size(); j++) {
+	df = ds.dist[far[j]].load(std::memory_order_relaxed);
+	if (df >= bucketEnd) {
+	  far[k++] = far[j];
+	  if (df < minDist)
+	    minDist = df;
+	}
+      }
+      far.resize(k);
+
+      if (far.empty())
+	break;
+
+      bucketEnd = minDist + delta;
+      if (!(bucketEnd > minDist))
+	bucketEnd = CAP_INF;
+
+      //move the faces of the next bucket to the frontier (only once)
+      phase++;
+
+      for (j=0, k=0; j<far.size(); j++) {
+	f = far[j];
+	if (ds.dist[f].load(std::memory_order_relaxed) < bucketEnd) {
+	  if (ds.stamp[f].exchange(phase, std::memory_order_relaxed) != phase)
+	    frontier.push_back(f);
+	} else
+	  far[k++] = f;
+      }
+      far.resize(k);
+
+    }
+
+    for (f=0; f<nFaces; f++)
+      dist[f] = ds.dist[f].load(std::memory_order_relaxed);
+
+    delete [] ds.dist;
+    delete [] ds.stamp;
+    delete [] ds.changed;
+
+  }
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::completeLabels() {
+    Root   *path;
+    Leaf   *leaf;
+    PlanarIdx leafID;
+    ELabel curLabel;
+
+    if (threadPool && faceStartOfCut >= 0)
+      floodFillLabels();
+    else {
+      // compute all labels in O(N)
+      for (PlanarIdx i=0; i<nVerts; i++) {
+	if (isLabeled[i]) continue;
+	path     = primalTreeNodes[i].getPath(arena);
+	leaf     = path->getTail(arena);
+	leafID   = leaf - primalTreeNodes;
+	if (isLabeled[leafID])
+	  curLabel = labels[leafID];
+	else {
+	  leaf     = leaf->getWeakParent(arena);
+	  if (leaf==0)
+	    curLabel = LABEL_SOURCE;
+	  else {
+	    leafID   = leaf - primalTreeNodes;
+	    curLabel = isLabeled[leafID]?labels[leafID]:getLabel(leafID);
+	  }
+	}
+	leaf     = path->getHead(arena);
+	while (leaf) {
+	  leafID = leaf - primalTreeNodes;
+	  isLabeled[leafID] = true;
+	  labels[leafID] = curLabel;
+	  leaf = leaf->getNextDyn(arena);
+	}
+      }
+    }
+
+    completelyLabeled = true;
+    delete [] isLabeled;
+    isLabeled = 0;
+  }
+
+
+  //state shared by the threads during floodFillLabels()
+  struct FloodFill {
+    PlanarGraph  *graph;
+    const uchar  *isCut;           //edges of the cut are not crossed
+
+    std::atomic<uchar> *reached;
+
+    const PlanarIdx *frontier;
+    PlanarIdx  frontierSize;
+    std::atomic<PlanarIdx> next;   //next unprocessed frontier position
+
+    std::vector<PlanarIdx> *found; //newly reached nodes of each thread
+  };
+
+
+  //visits the unreached neighbors of the frontier
+  static void floodFrontier(void *arg, int threadIdx) {
+
+    const int CHUNK_SIZE = 64;
+
+    FloodFill *ff = static_cast<FloodFill*>(arg);
+    std::vector<PlanarIdx> &found = ff->found[threadIdx];
+    const PlanarIdx *head = ff->graph->head;
+    const PlanarIdx *tail = ff->graph->tail;
+    const PlanarIdx *edgesCCW  = ff->graph->edgesCCW;
+    const PlanarIdx *firstEdge = ff->graph->firstEdge;
+    PlanarIdx i, iEnd, j, u, v, e;
+
+    while ((i = ff->next.fetch_add(CHUNK_SIZE)) < ff->frontierSize) {
+
+      iEnd = i + CHUNK_SIZE;
+      if (iEnd > ff->frontierSize)
+	iEnd = ff->frontierSize;
+
+      for (; i<iEnd; i++) {
+
+	u = ff->frontier[i];
+
+	for (j=firstEdge[u]; j<firstEdge[u+1]; j++) {
+
+	  e = edgesCCW[j];
+	  if (ff->isCut[e])
+	    continue;
+
+	  v = (head[e] == u) ? tail[e] : head[e];
+
+	  if (!ff->reached[v].load(std::memory_order_relaxed) &&
+	      !ff->reached[v].exchange(1, std::memory_order_relaxed))
+	    found.push_back(v);
+
+	}
+      }
+    }
+
+  }
+
+
+  template<class DynTree>
+  void CutPlanarT<DynTree>::floodFillLabels() {
+
+    FloodFill ff;
+    std::vector<PlanarIdx> frontier;
+    uchar *isCut;
+    PlanarIdx curFace, i;
+    int numThreads = threadPool->getNumThreads();
+    int t;
+
+    //mark the edges of the cut cycle in T*
+    isCut = new uchar[nEdges];
+    memset(isCut, 0, nEdges);
+
+    curFace = faceStartOfCut;
+    do {
+      isCut[dualTreeEdge[curFace]] = 1;
+      curFace = dualTreeParent[curFace];
+    } while (curFace != faceStartOfCut);
+
+    ff.graph   = &graph;
+    ff.isCut   = isCut;
+    ff.reached = new std::atomic<uchar>[nVerts];
+    ff.found   = new std::vector<PlanarIdx>[numThreads];
+
+    for (i=0; i<nVerts; i++)
+      ff.reached[i].store(0, std::memory_order_relaxed);
+
+    //all nodes enclosed by the cut together with the sink are sink nodes
+    ff.reached[sinkID].store(1, std::memory_order_relaxed);
+    frontier.push_back(sinkID);
+
+    while (!frontier.empty()) {
+
+      ff.frontier     = &frontier[0];
+      ff.frontierSize = (PlanarIdx)frontier.size();
+      ff.next.store(0);
+
+      if (ff.frontierSize >= PARALLEL_MIN_FRONTIER)
+	threadPool->run(&floodFrontier, &ff);
+      else
+	floodFrontier(&ff, 0);
+
+      frontier.clear();
+      for (t=0; t<numThreads; t++) {
+	frontier.insert(frontier.end(), ff.found[t].begin(), ff.found[t].end());
+	ff.found[t].clear();
+      }
+
+    }
+
+    for (i=0; i<nVerts; i++)
+      labels[i] = ff.reached[i].load(std::memory_order_relaxed) ? LABEL_SINK : LABEL_SOURCE;
+
+    delete [] isCut;
+    delete [] ff.reached;
+    delete [] ff.found;
+
   }
 
+
+//the dynamic tree backends CutPlanar can be built with (cf. CutPlanarDefs.h)
+template class CutPlanarT<DynPathTree>;
+template class CutPlanarT<SplayPathTree>;
@@ -26,11 +26,15 @@
 #include "CutPlanarDefs.h"
 #include "Planar.h"
 #include "DynPath.h"
+#include "SplayPath.h"
 #include "CGraph.h"
+#include "IndexHeap.h"
+#include "ThreadPool.h"
 #include <vector>
 
 
-class CutPlanar 
+//declarations shared by all instantiations of CutPlanarT
+class CutPlanarBase
 {
 public:
   static const int FIRST_VERT =  0;
@@ -50,64 +54,156 @@ public:
     LABEL_SINK   = 0,
     LABEL_SOURCE = 1,
   };
+};
+
 
+//The primal spanning tree is held by the dynamic tree backend DynTree
+//(DynPathTree or SplayPathTree). A backend provides the types
+//  Leaf  - a node of the tree: expose(), divide(Split*), getPath(), 
+//          getNext(), getNextDyn(), getEdgeCost() and the weak link 
+//          accessors setWeakLink(), getWeakParent(), getWeakCost(), ...
+//  Root  - a path: getHead(), getTail(), getMinCostLeaf(), addCost(),
+//          reverse() and concatenate()
+//  Split - the result of Leaf::divide()
+//and the static functions allocLeaves(), releaseArena(), 
+//resetBlockAllocator() and rootFromLeafChain(). Leaves are returned 
+//by allocLeaves() as one array. The nodes live in an Arena which is
+//passed to the static functions and to all operations that reach 
+//other nodes (all but addCost() and reverse()). Each instance of 
+//CutPlanarT has an arena of its own.
+//The edge data of a tree (Leaf::setWeakLink(), Root::concatenate()) 
+//is the index of the edge.
+//Both backends yield the same maximum flow up to the rounding of the 
+//augmentations, also on graphs with zero capacity (eps) edges (the 
+//tests allow a relative difference of 1e-6). If there are several 
+//minimum cuts, they may return different ones.
+template<class DynTree>
+class CutPlanarT : public CutPlanarBase
+{
+  typedef typename DynTree::Leaf  Leaf;
+  typedef typename DynTree::Root  Root;
+  typedef typename DynTree::Split Split;
+  typedef typename DynTree::Arena Arena;
+
+public:
   //allocates memory for nodes, edges and faces
-  CutPlanar();
-  virtual ~CutPlanar();
+  CutPlanarT();
+  virtual ~CutPlanarT();
 
   //define graph
   //class works in state, i.e., the arrays may be altered.
-  void initialize(int numVerts, PlanarVertex *vertexList,
-		  int numEdges, PlanarEdge   *edgeList,
-		  int numFaces, PlanarFace   *faceList,
-		  int idxSource          = FIRST_VERT,  //sets which node should be source
-		  int idxSink            = LAST_VERT,   //sets which node should be sink
+  void initialize(PlanarIdx numVerts, PlanarVertex *vertexList,
+		  PlanarIdx numEdges, PlanarEdge   *edgeList,
+		  PlanarIdx numFaces, PlanarFace   *faceList,
+		  PlanarIdx idxSource    = FIRST_VERT,  //sets which node should be source
+		  PlanarIdx idxSink      = LAST_VERT,   //sets which node should be sink
 		  ECheckFlags checkInput = CHECK_ALL);  //enables advanced input validation
 
-  void setSource(int idxSource);
-  void setSink  (int idxSink);
+  void setSource(PlanarIdx idxSource);
+  void setSink  (PlanarIdx idxSink);
+
+  //number of threads used by the parallel parts of the computation
+  //(currently the shortest paths in preFlow() and the flood fill
+  //labeling of the nodes after the cut), default is 1
+  void setNumThreads(int numThreads);
+
+  //changes the capacities of a subset of edges. If the flow has been
+  //computed already, the next call of getMaxFlow() re-solves starting
+  //from the previous flow instead of starting from scratch.
+  void updateCapacities(PlanarIdx numUpdates, const PlanarIdx *edgeIDs,
+			const CapType *caps, const CapType *rcaps);
 
 
   double getMaxFlow();
-  ELabel      getLabel(int node);                // returns the label of a node
-  std::vector<int> getLabels(ELabel label);      // returns all nodes of a specific label
-  std::vector<int> getCutBoundary(ELabel label); // returns all cut-nodes in the source or the sink set
-  std::vector<int> getCircularPath();
+  ELabel      getLabel(PlanarIdx node);                // returns the label of a node
+  std::vector<PlanarIdx> getLabels(ELabel label);      // returns all nodes of a specific label
+  void        getLabels(ELabel *lmask);                // writes the labels of all nodes to lmask
+  std::vector<PlanarIdx> getCutBoundary(ELabel label); // returns all cut-nodes in the source or the sink set
+  std::vector<PlanarIdx> getCircularPath();
 
 protected:
   virtual void preFlow();
 
+  //computes the shortest path distances from face startFace to all
+  //other faces w.r.t. the current capacities of the dual darts, the 
+  //potentials of preFlow()
+  void runDualDijkstra(PlanarIdx startFace, CapType *dist);
+
   virtual void performChecks(ECheckFlags checks);
 
 
   
 private:
   // planar encoding
-  int nVerts;
-  int nEdges;
-  int nFaces;
+  PlanarIdx nVerts;
+  PlanarIdx nEdges;
+  PlanarIdx nFaces;
   PlanarVertex *verts;
   PlanarFace   *faces;
   PlanarEdge   *edges;
+  // compact form of the graph the computation works on
+  PlanarGraph graph;
   // source and sink
-  int sourceID; // previously PlanarVertex *pvSource
-  int sinkID;   // previously PlanarVertex *pvSink
+  PlanarIdx sourceID; // previously PlanarVertex *pvSource
+  PlanarIdx sinkID;   // previously PlanarVertex *pvSink
   
   bool computedFlow; // stores whether the flow is already computed
                      // has to be maintained by 'maxflow' and 'initialize'
   double maxFlow;
+  double augFlow;    // flow augmented so far (w/o epsilon correction)
   double capEps;     // zero capacity darts are replaced by this value
+  double capInf;     // infinite capacity darts are replaced by this value
+  double capMin;     // minimal non-zero capacity
+  double capSum;     // sum of all finite capacities
+  PlanarIdx nEpsDarts;  // number of darts with capacity capEps
+  PlanarIdx nInfDarts;  // number of darts with capacity capInf
+
+  //capacities as passed by the user - the edge capacities
+  //themselves are altered during the computation
+  CapType *inputCaps;
+  CapType *inputRevCaps;
 
-  PlanarFace *pfStartOfCut; //if computedFlow, retains the first 
+  bool capsDirty; // edge capacities have to be restored from the input
+  bool warmStart; // edges hold the residual capacities of the last flow
+
+  //darts of capacity capInf: 2*edge for the arc, 2*edge+1 for the
+  //antiarc (may hold darts that are finite by now)
+  std::vector<PlanarIdx> infDarts;
+  //edges whose residual capacities changed since the last flow
+  std::vector<PlanarIdx> changedEdges;
+
+  //dual darts in compressed row format: the darts leaving face f are
+  //dualAdjFace/dualAdjDart[dualAdjFirst[f]..dualAdjFirst[f+1]-1]
+  PlanarIdx *dualAdjFirst;
+  PlanarIdx *dualAdjFace;  // face the dart points to
+  PlanarIdx *dualAdjDart;  // 2*edge for the arc, 2*edge+1 for the antiarc
+
+  ThreadPool *threadPool; // only present if more than one thread is used
+
+  PlanarIdx faceStartOfCut;       //if computedFlow, retains the first 
                             //face of the cut loop in T*
 
   //primal spanning tree
-  DynLeaf *primalTreeNodes; //nodes of the primal spanning tree
-  DynLeaf *plSource;  //pointer on source in primal spanning tree
-  DynLeaf *plSink;    //pointer to sink in primal spanning tree
+  Arena arena; //holds the nodes of the primal spanning tree
+  Leaf *primalTreeNodes; //nodes of the primal spanning tree
+  Leaf *plSource;  //pointer on source in primal spanning tree
+  Leaf *plSink;    //pointer to sink in primal spanning tree
   //dual spanning tree
-  PlanarFace **dualTreeParent; // dual tree parent relationship
-  PlanarEdge **dualTreeEdge;  // dual tree fast edge-access
+  PlanarIdx *dualTreeParent; // dual tree parent face (-1 for none)
+  PlanarIdx *dualTreeEdge;   // dual tree fast edge-access (-1 for none)
+  bool treesSpanning;        // T and T* span all vertices and faces
+
+  //the last augmentation closes the cut loop in T* by the saturated 
+  //edge and detaches the source from T - a warm start undoes this
+  PlanarIdx cutTail;      // tail of the saturated dart (-1 if none)
+  PlanarIdx cutFaceEdge;  // former edge of faceStartOfCut in T*
+
+  //scratch space of repairSpanningTrees()
+  unsigned  *faceStamp;   // faces marked by the current repair 
+  unsigned   curStamp;
+  CapType   *faceDist;
+  PlanarIdx *facePred;    // edge to the predecessor face
+  DAryHeap<DUAL_HEAP_ARITY, PlanarIdx> *repairHeap;
 
   //labeling
   bool completelyLabeled;
@@ -120,13 +216,76 @@ private:
   //definition of planar input graph
 
   //auxiliary inline functions
-  int getVertIndex(PlanarVertex *pv) {return pv - verts;}
-  int getFaceIndex(PlanarFace *pf)   {return pf - faces;}
-  int getDynNodeIndex(DynLeaf *pl)   {return pl - primalTreeNodes;}
+  PlanarIdx getDynNodeIndex(Leaf *pl)      {return pl - primalTreeNodes;}
 
   //constructs the primal and dual spanning trees used by maxflow()
   void constructSpanningTrees();
+
+  //labels all nodes at once (cf. getLabels())
+  void completeLabels();
+
+  //labels the nodes by a parallel flood fill from the sink 
+  //that does not cross the edges of the cut
+  void floodFillLabels();
+
+  //builds the dual adjacency arrays used by preFlow()
+  void buildDualAdjacency();
+
+  //Dijkstra's algorithm using the priority queue Heap (cf. IndexHeap.h)
+  //weight holds the dart capacities in the order of dualAdjFace
+  template<class Heap>
+  void runDualDijkstra(PlanarIdx startFace, CapType *dist, const CapType *weight);
+
+  //parallel delta-stepping yielding the same distances as runDualDijkstra()
+  void runDualDeltaStepping(PlanarIdx startFace, CapType *dist, const CapType *weight);
+
+  //restores the edge capacities from the input and replaces 
+  //infinite and zero capacities
+  void resetCapacities();
+
+  //maps an input capacity to the capacity used during computation
+  CapType transformCapacity(CapType cap) 
+  { return (cap == CAP_INF) ? capInf : (cap ? cap : capEps); }
+
+  //applies a capacity change to the residual capacities, 
+  //returns false if the previous flow cannot be reused
+  bool updateResidualCapacity(PlanarIdx edgeID, CapType cap, CapType rcap);
+
+  //adds to the residual capacities of an edge wherever they are held,
+  //returns false if one of them becomes negative
+  bool addResidualCapacity(PlanarIdx edgeID, CapType dCap, CapType dRCap);
+
+  //raises capInf above capSum by adding to all infinite darts
+  bool raiseInfCapacity();
+
+  //whether the residual capacities of an edge are held by T
+  bool isPrimalTreeEdge(PlanarIdx edgeID);
+
+  //removes an edge from T, which leaves its residual capacities in 
+  //graph - returns the endpoint that was the child
+  PlanarIdx cutTreeEdge(PlanarIdx edgeID);
+
+  //makes the root child of a tree in T the child of the other 
+  //endpoint of the edge
+  void linkTreeEdge(PlanarIdx child, PlanarIdx edgeID);
+
+  //makes a node the root of its tree in T
+  void evertTree(PlanarIdx node);
+
+  //puts the edges of the last augmentation back (cf. cutTail)
+  void reopenCut();
+
+  //restores T, T* and zero distances in the dual from the spanning 
+  //trees of the last flow after a capacity change - only the faces 
+  //below an edge of T* that lost its dart of zero capacity are visited
+  void repairSpanningTrees();
+
+  //checks whether following T* from face leads back to it
+  bool isCutLoop(PlanarIdx face);
 };
 
 
+typedef CutPlanarT<DYN_TREE> CutPlanar;
+
+
 #endif
@@ -24,12 +24,49 @@
 #define __PLANARCUTDEFS_H
 
 #include <limits>
+#include <stdint.h>
 
 
 #define CAP_INF std::numeric_limits<double>::max()
 
 #define EPSILON 1e-6       //used for numerical issues
 
+//arity of the heap used for the shortest paths in the dual graph 
+//(only used if the capacities are not integral, cf. IndexHeap.h)
+#ifndef DUAL_HEAP_ARITY
+#define DUAL_HEAP_ARITY 4
+#endif
+
+//frontiers of the parallel shortest path computation smaller than 
+//this are processed by a single thread
+#ifndef PARALLEL_MIN_FRONTIER
+#define PARALLEL_MIN_FRONTIER 1024
+#endif
+
+//dynamic tree backend holding the primal spanning tree of CutPlanar:
+//DynPathTree (balanced path trees, cf. DynPath.h) or SplayPathTree 
+//(splay trees, cf. SplayPath.h)
+#ifndef DYN_TREE
+#define DYN_TREE DynPathTree
+#endif
+
+//node arenas of the dynamic trees of at least 2 MB are backed by 
+//transparent huge pages (cf. allocPages() in BlockAllocator.h)
+#ifndef DYN_TREE_HUGE_PAGES
+#define DYN_TREE_HUGE_PAGES true
+#endif
+
+//integer type of the vertex, edge and face indices of the planar graph, 
+//which also indexes the darts (two per edge) and the nodes of the dynamic
+//trees. The default can index every graph that fits into memory, while
+//-DPLANAR_INDEX=int saves memory and time on graphs with less than 2^30 
+//edges.
+#ifndef PLANAR_INDEX
+#define PLANAR_INDEX int64_t
+#endif
+
+typedef PLANAR_INDEX PlanarIdx;
+
 typedef double CapType;      /* data type for flow capacity */
 typedef unsigned char uchar; /* for convenience             */
 typedef unsigned int uint;
@@ -28,71 +28,42 @@
 
 using namespace std;
 
-//static member definitions
-//stack pointer
-int DynLeaf::idxRightSide;
-int DynLeaf::idxLeftSide;
-int DynLeaf::idxCostR;
-int DynLeaf::idxCostL;
-int DynLeaf::idxMappingR;
-int DynLeaf::idxMappingL;
-int DynLeaf::idxDataL;
-int DynLeaf::idxDataR;
-int DynLeaf::idxRPath;
-  
-//stacks
-DynRoot* DynLeaf::stackRightSide[STACKSIZE]; 
-DynRoot* DynLeaf::stackLeftSide[STACKSIZE];  
-CapType  DynLeaf::stackCostR[STACKSIZE];     
-CapType  DynLeaf::stackCostL[STACKSIZE];     
-bool     DynLeaf::stackMappingR[STACKSIZE];  
-bool     DynLeaf::stackMappingL[STACKSIZE];  
-void*    DynLeaf::stackDataR[STACKSIZE];     
-void*    DynLeaf::stackDataL[STACKSIZE];     
-DynNode* DynLeaf::stackRPath[STACKSIZE];     
-
-
-BlockAllocator<DynNode> DynRoot::blockAllocator;
-
-
 /***************************************************
  *** DynNode *****************************************
  ***************************************************/
 DynNode::DynNode() {
   reversed = 0;
 
-  bParent = 0;
-  bHead   = 0;
-  bTail   = 0;
-  bLeft   = 0;
-  bRight  = 0;
+  bParent = DynNodeRef();
+  bHead   = DynNodeRef();
+  bTail   = DynNodeRef();
+  bLeft   = DynNodeRef();
+  bRight  = DynNodeRef();
 
   netCost  = CapType(0);
   netMin   = CapType(0);
   netCostR = CapType(0);
   netMinR  = CapType(0);
 
-  data = 0;
-
   height  = 0;
 }
 
 
 
 
-void DynNode::rotateRight(CapType grossminU, CapType grossminUR) {
+void DynNode::rotateRight(DynArena &a, CapType grossminU, CapType grossminUR) {
   DynNode *u, *v;
   CapType *pNetMin, *pNetMinR;
   bool rState;
 
   if (isLeaf()) return;
-  normalizeReverseState();
+  normalizeReverseState(a);
 
   u = this;
-  v = bLeft;
+  v = a[bLeft];
 
   if (v->isLeaf()) return;
-  v->normalizeReverseState();
+  v->normalizeReverseState(a);
   
   //save original node data of u and v
   DynNode uold = *this;
@@ -101,8 +72,8 @@ void DynNode::rotateRight(CapType grossminU, CapType grossminUR) {
   bool uMapping = uold.getMapping();
   bool vMapping = vold.getMapping();
 
-  void *uData = uold.data;
-  void *vData = vold.data;
+  DynData uData = a.dataOf(u);
+  DynData vData = a.dataOf(v);
 
   CapType minU  = grossminU;   //TODO: use grossminU/R directly?
   CapType minUR = grossminUR;
@@ -125,22 +96,22 @@ void DynNode::rotateRight(CapType grossminU, CapType grossminUR) {
   CapType minUr  = CAP_INF;
   CapType minUrR = CAP_INF;
 
-  if (!v->bLeft->isLeaf()) {
-    v->bLeft->getNetMinPtr(&pNetMin, &pNetMinR);
+  if (!a[v->bLeft]->isLeaf()) {
+    a[v->bLeft]->getNetMinPtr(&pNetMin, &pNetMinR);
     
     minVl  = *pNetMin  + minVOld;
     minVlR = *pNetMinR + minVOldR;
   }
 
-  if (!v->bRight->isLeaf()) {
-    v->bRight->getNetMinPtr(&pNetMin, &pNetMinR);
+  if (!a[v->bRight]->isLeaf()) {
+    a[v->bRight]->getNetMinPtr(&pNetMin, &pNetMinR);
     
     minVr  = *pNetMin  + minVOld;
     minVrR = *pNetMinR + minVOldR;
   }
 
-  if (!u->bRight->isLeaf()) {
-    u->bRight->getNetMinPtr(&pNetMin, &pNetMinR);
+  if (!a[u->bRight]->isLeaf()) {
+    a[u->bRight]->getNetMinPtr(&pNetMin, &pNetMinR);
 
     minUr  = *pNetMin  + minU;
     minUrR = *pNetMinR + minUR;
@@ -152,10 +123,10 @@ void DynNode::rotateRight(CapType grossminU, CapType grossminUR) {
   DynNode *unew = v; //let the old DynNode for v be the u after rotation
 
   //restructure tree with u being new root
-  vnew->setAsLChild(vold.bLeft, false);
-  unew->setAsLChild(vold.bRight, false);
-  unew->setAsRChild(uold.bRight, false);
-  vnew->setAsRChild(unew, false);
+  vnew->setAsLChild(a, a[vold.bLeft], false);
+  unew->setAsLChild(a, a[vold.bRight], false);
+  unew->setAsRChild(a, a[uold.bRight], false);
+  vnew->setAsRChild(a, unew, false);
 
   //update netMin fields of unew, vnew and their respective children
 
@@ -170,25 +141,25 @@ void DynNode::rotateRight(CapType grossminU, CapType grossminUR) {
   unew->setNetMin(minUNew  - minVNew,  false);
   unew->setNetMin(minUNewR - minVNewR, true);
 
-  if (!vnew->bLeft->isLeaf()) {
-    rState = vnew->bLeft->getReversed();
+  if (!a[vnew->bLeft]->isLeaf()) {
+    rState = a[vnew->bLeft]->getReversed();
 
-    vnew->bLeft->setNetMin(minVl  - minVNew,   rState);
-    vnew->bLeft->setNetMin(minVlR - minVNewR, !rState);
+    a[vnew->bLeft]->setNetMin(minVl  - minVNew,   rState);
+    a[vnew->bLeft]->setNetMin(minVlR - minVNewR, !rState);
   }
 
-  if (!unew->bLeft->isLeaf()) {
-    rState = unew->bLeft->getReversed();
+  if (!a[unew->bLeft]->isLeaf()) {
+    rState = a[unew->bLeft]->getReversed();
 
-    unew->bLeft->setNetMin(minVr  - minUNew,   rState);
-    unew->bLeft->setNetMin(minVrR - minUNewR, !rState);
+    a[unew->bLeft]->setNetMin(minVr  - minUNew,   rState);
+    a[unew->bLeft]->setNetMin(minVrR - minUNewR, !rState);
   }
 
-  if (!unew->bRight->isLeaf()) {
-    rState = unew->bRight->getReversed();
+  if (!a[unew->bRight]->isLeaf()) {
+    rState = a[unew->bRight]->getReversed();
 
-    unew->bRight->setNetMin(minUr  - minUNew,   rState);
-    unew->bRight->setNetMin(minUrR - minUNewR, !rState);
+    a[unew->bRight]->setNetMin(minUr  - minUNew,   rState);
+    a[unew->bRight]->setNetMin(minUrR - minUNewR, !rState);
   }
 
 
@@ -200,19 +171,19 @@ void DynNode::rotateRight(CapType grossminU, CapType grossminUR) {
   vnew->setNetCost(costV  - minVNew,  false);
   vnew->setNetCost(costVR - minVNewR, true);
   vnew->setMapping(vMapping);
-  vnew->data = vData;
+  a.dataOf(vnew) = vData;
 
   unew->setNetCost(costU  - minUNew,  false);
   unew->setNetCost(costUR - minUNewR, true);
   unew->setMapping(uMapping);
-  unew->data = uData;
+  a.dataOf(unew) = uData;
 
   //fix height fields
-  unew->height = max(unew->bLeft->height, unew->bRight->height) + 1;
-  vnew->height = max(vnew->bLeft->height, vnew->bRight->height) + 1;
+  unew->height = max(a[unew->bLeft]->height, a[unew->bRight]->height) + 1;
+  vnew->height = max(a[vnew->bLeft]->height, a[vnew->bRight]->height) + 1;
 }
 
-void DynNode::rotateLeft(CapType grossminU, CapType grossminUR) {
+void DynNode::rotateLeft(DynArena &a, CapType grossminU, CapType grossminUR) {
   
   DynNode *u, *v;
   CapType *pNetMin, *pNetMinR;
@@ -220,13 +191,13 @@ void DynNode::rotateLeft(CapType grossminU, CapType grossminUR) {
 
 
   if (isLeaf()) return;
-  normalizeReverseState();
+  normalizeReverseState(a);
 
   u = this;
-  v = bRight; //u->bRight
+  v = a[bRight]; //u->bRight
 
   if (v->isLeaf()) return;
-  v->normalizeReverseState();
+  v->normalizeReverseState(a);
   
   //save original node data of u and v
   DynNode uold = *(this);
@@ -235,8 +206,8 @@ void DynNode::rotateLeft(CapType grossminU, CapType grossminUR) {
   bool uMapping = uold.getMapping();
   bool vMapping = vold.getMapping();
 
-  void *uData = uold.data;
-  void *vData = vold.data;
+  DynData uData = a.dataOf(u);
+  DynData vData = a.dataOf(v);
 
   CapType minU  = grossminU; //TODO: use grossminU/R directly?
   CapType minUR = grossminUR;
@@ -259,22 +230,22 @@ void DynNode::rotateLeft(CapType grossminU, CapType grossminUR) {
   CapType minUl  = CAP_INF;
   CapType minUlR = CAP_INF;
 
-  if (!v->bLeft->isLeaf()) {
-    v->bLeft->getNetMinPtr(&pNetMin, &pNetMinR);
+  if (!a[v->bLeft]->isLeaf()) {
+    a[v->bLeft]->getNetMinPtr(&pNetMin, &pNetMinR);
 
     minVl  = *pNetMin  + minVOld;
     minVlR = *pNetMinR + minVOldR;
   }
 
-  if (!v->bRight->isLeaf()) {
-    v->bRight->getNetMinPtr(&pNetMin, &pNetMinR);
+  if (!a[v->bRight]->isLeaf()) {
+    a[v->bRight]->getNetMinPtr(&pNetMin, &pNetMinR);
 
     minVr  = *pNetMin  + minVOld;
     minVrR = *pNetMinR + minVOldR;
   }
 
-  if (!u->bLeft->isLeaf()) {
-    u->bLeft->getNetMinPtr(&pNetMin, &pNetMinR);
+  if (!a[u->bLeft]->isLeaf()) {
+    a[u->bLeft]->getNetMinPtr(&pNetMin, &pNetMinR);
 
     minUl  = *pNetMin  + minU;
     minUlR = *pNetMinR + minUR;
@@ -286,10 +257,10 @@ void DynNode::rotateLeft(CapType grossminU, CapType grossminUR) {
   DynNode *unew = v; //let the old DynNode for v be the u after rotation
 
   //restructure tree with u being new root
-  vnew->setAsRChild(vold.bRight, false);
-  unew->setAsRChild(vold.bLeft, false);
-  unew->setAsLChild(uold.bLeft, false);
-  vnew->setAsLChild(unew, false);
+  vnew->setAsRChild(a, a[vold.bRight], false);
+  unew->setAsRChild(a, a[vold.bLeft], false);
+  unew->setAsLChild(a, a[uold.bLeft], false);
+  vnew->setAsLChild(a, unew, false);
 
   //update netMin fields of unew, vnew and their respective children
 
@@ -305,25 +276,25 @@ void DynNode::rotateLeft(CapType grossminU, CapType grossminUR) {
   unew->setNetMin(minUNewR - minVNewR, true);
 
 
-  if (!vnew->bRight->isLeaf()) {
-    rState = vnew->bRight->getReversed();
+  if (!a[vnew->bRight]->isLeaf()) {
+    rState = a[vnew->bRight]->getReversed();
 
-    vnew->bRight->setNetMin(minVr  - minVNew,   rState);
-    vnew->bRight->setNetMin(minVrR - minVNewR, !rState);
+    a[vnew->bRight]->setNetMin(minVr  - minVNew,   rState);
+    a[vnew->bRight]->setNetMin(minVrR - minVNewR, !rState);
   }
 
-  if (!unew->bRight->isLeaf()) {
-    rState = unew->bRight->getReversed();
+  if (!a[unew->bRight]->isLeaf()) {
+    rState = a[unew->bRight]->getReversed();
 
-    unew->bRight->setNetMin(minVl  - minUNew,   rState);
-    unew->bRight->setNetMin(minVlR - minUNewR, !rState);
+    a[unew->bRight]->setNetMin(minVl  - minUNew,   rState);
+    a[unew->bRight]->setNetMin(minVlR - minUNewR, !rState);
   }
 
-  if (!unew->bLeft->isLeaf()) {
-    rState = unew->bLeft->getReversed();
+  if (!a[unew->bLeft]->isLeaf()) {
+    rState = a[unew->bLeft]->getReversed();
 
-    unew->bLeft->setNetMin(minUl  - minUNew,   rState);
-    unew->bLeft->setNetMin(minUlR - minUNewR, !rState);
+    a[unew->bLeft]->setNetMin(minUl  - minUNew,   rState);
+    a[unew->bLeft]->setNetMin(minUlR - minUNewR, !rState);
   }
 
   //update netCost fields of unew and vnew 
@@ -334,36 +305,36 @@ void DynNode::rotateLeft(CapType grossminU, CapType grossminUR) {
   vnew->setNetCost(costV  - minVNew,  false);
   vnew->setNetCost(costVR - minVNewR, true);
   vnew->setMapping(vMapping);
-  vnew->data = vData;
+  a.dataOf(vnew) = vData;
 
   unew->setNetCost(costU  - minUNew,  false);
   unew->setNetCost(costUR - minUNewR, true);
   unew->setMapping(uMapping);
-  unew->data = uData;
+  a.dataOf(unew) = uData;
 
   //fix height fields
-  unew->height = max(unew->bLeft->height, unew->bRight->height) + 1;
-  vnew->height = max(vnew->bLeft->height, vnew->bRight->height) + 1;
+  unew->height = max(a[unew->bLeft]->height, a[unew->bRight]->height) + 1;
+  vnew->height = max(a[vnew->bLeft]->height, a[vnew->bRight]->height) + 1;
 
 }
 
-void DynNode::doubleRotateRight(CapType grossminU, CapType grossminUR) {
+void DynNode::doubleRotateRight(DynArena &a, CapType grossminU, CapType grossminUR) {
   DynNode *u, *v, *w;
   bool rState;
   
   if (isLeaf()) return;
-  normalizeReverseState();
+  normalizeReverseState(a);
 
   u = this;
-  v = bLeft;
+  v = a[bLeft];
 
   if (v->isLeaf()) return;
-  v->normalizeReverseState();
+  v->normalizeReverseState(a);
 
-  w = v->bRight;
+  w = a[v->bRight];
 
   if (w->isLeaf()) return;
-  w->normalizeReverseState();
+  w->normalizeReverseState(a);
 
   DynNode uold = *(this);
   DynNode vold = *v;
@@ -373,9 +344,9 @@ void DynNode::doubleRotateRight(CapType grossminU, CapType grossminUR) {
   bool vMapping = vold.getMapping();
   bool wMapping = wold.getMapping();
 
-  void *uData = uold.data;
-  void *vData = vold.data;
-  void *wData = wold.data;
+  DynData uData = a.dataOf(u);
+  DynData vData = a.dataOf(v);
+  DynData wData = a.dataOf(w);
 
   CapType minU  = grossminU;
   CapType minUR = grossminUR;
@@ -407,32 +378,32 @@ void DynNode::doubleRotateRight(CapType grossminU, CapType grossminUR) {
   CapType minWr  = CAP_INF;
   CapType minWrR = CAP_INF;
 
-  if (!v->bLeft->isLeaf()) {
-    rState = v->bLeft->getReversed();
+  if (!a[v->bLeft]->isLeaf()) {
+    rState = a[v->bLeft]->getReversed();
 
-    minVl  = v->bLeft->getNetMin(rState)  + minVOld;
-    minVlR = v->bLeft->getNetMin(!rState) + minVOldR;
+    minVl  = a[v->bLeft]->getNetMin(rState)  + minVOld;
+    minVlR = a[v->bLeft]->getNetMin(!rState) + minVOldR;
   }
 
-  if (!u->bRight->isLeaf()) {
-    rState = u->bRight->getReversed();
+  if (!a[u->bRight]->isLeaf()) {
+    rState = a[u->bRight]->getReversed();
 
-    minUr  = u->bRight->getNetMin(rState)  + minU;
-    minUrR = u->bRight->getNetMin(!rState) + minUR;
+    minUr  = a[u->bRight]->getNetMin(rState)  + minU;
+    minUrR = a[u->bRight]->getNetMin(!rState) + minUR;
   }
 
-  if (!w->bLeft->isLeaf()) {
-    rState = w->bLeft->getReversed();
+  if (!a[w->bLeft]->isLeaf()) {
+    rState = a[w->bLeft]->getReversed();
 
-    minWl  = w->bLeft->getNetMin(rState)  + minWOld;
-    minWlR = w->bLeft->getNetMin(!rState) + minWOldR;
+    minWl  = a[w->bLeft]->getNetMin(rState)  + minWOld;
+    minWlR = a[w->bLeft]->getNetMin(!rState) + minWOldR;
   }
 
-  if (!w->bRight->isLeaf()) {
-    rState = w->bRight->getReversed();
+  if (!a[w->bRight]->isLeaf()) {
+    rState = a[w->bRight]->getReversed();
 
-    minWr  = w->bRight->getNetMin(rState)  + minWOld;
-    minWrR = w->bRight->getNetMin(!rState) + minWOldR;
+    minWr  = a[w->bRight]->getNetMin(rState)  + minWOld;
+    minWrR = a[w->bRight]->getNetMin(!rState) + minWOldR;
   }
 
   DynNode *wnew = u; //let the old DynNode for u be the w after rotation
@@ -440,11 +411,11 @@ void DynNode::doubleRotateRight(CapType grossminU, CapType grossminUR) {
   DynNode *vnew = v; //let the old DynNode for v be still v after rotation
 
   //restructure tree with u being new root
-  unew->setAsLChild(wold.bRight, false);
-  unew->setAsRChild(uold.bRight, false);
+  unew->setAsLChild(a, a[wold.bRight], false);
+  unew->setAsRChild(a, a[uold.bRight], false);
 
-  vnew->setAsRChild(wold.bLeft, false);
-  wnew->setAsRChild(unew, false);
+  vnew->setAsRChild(a, a[wold.bLeft], false);
+  wnew->setAsRChild(a, unew, false);
 
   
   //update netMin fields of unew, vnew and their respective children
@@ -466,33 +437,33 @@ void DynNode::doubleRotateRight(CapType grossminU, CapType grossminUR) {
   unew->setNetMin(minUNew  - minWNew,  false);
   unew->setNetMin(minUNewR - minWNewR, true);
 
-  if (!vnew->bLeft->isLeaf()) {
-    rState = vnew->bLeft->getReversed();
+  if (!a[vnew->bLeft]->isLeaf()) {
+    rState = a[vnew->bLeft]->getReversed();
 
-    vnew->bLeft->setNetMin(minVl  - minVNew,   rState);
-    vnew->bLeft->setNetMin(minVlR - minVNewR, !rState);
+    a[vnew->bLeft]->setNetMin(minVl  - minVNew,   rState);
+    a[vnew->bLeft]->setNetMin(minVlR - minVNewR, !rState);
   }
   
-  if (!vnew->bRight->isLeaf()) {
-    rState = vnew->bRight->getReversed();
+  if (!a[vnew->bRight]->isLeaf()) {
+    rState = a[vnew->bRight]->getReversed();
 
-    vnew->bRight->setNetMin(minWl  - minVNew,   rState);
-    vnew->bRight->setNetMin(minWlR - minVNewR, !rState);
+    a[vnew->bRight]->setNetMin(minWl  - minVNew,   rState);
+    a[vnew->bRight]->setNetMin(minWlR - minVNewR, !rState);
   }
   
 
-  if (!unew->bLeft->isLeaf()) {
-    rState = unew->bLeft->getReversed();
+  if (!a[unew->bLeft]->isLeaf()) {
+    rState = a[unew->bLeft]->getReversed();
 
-    unew->bLeft->setNetMin(minWr  - minUNew,   rState);
-    unew->bLeft->setNetMin(minWrR - minUNewR, !rState);
+    a[unew->bLeft]->setNetMin(minWr  - minUNew,   rState);
+    a[unew->bLeft]->setNetMin(minWrR - minUNewR, !rState);
   }
 
-  if (!unew->bRight->isLeaf()) {
-    rState = unew->bRight->getReversed();
+  if (!a[unew->bRight]->isLeaf()) {
+    rState = a[unew->bRight]->getReversed();
 
-    unew->bRight->setNetMin(minUr  - minUNew,   rState);
-    unew->bRight->setNetMin(minUrR - minUNewR, !rState);
+    a[unew->bRight]->setNetMin(minUr  - minUNew,   rState);
+    a[unew->bRight]->setNetMin(minUrR - minUNewR, !rState);
   }
   
   //update netCost fields of wnew, vnew and unew 
@@ -503,44 +474,44 @@ void DynNode::doubleRotateRight(CapType grossminU, CapType grossminUR) {
   wnew->setNetCost(costW  - minWNew,  false);
   wnew->setNetCost(costWR - minWNewR, true);
   wnew->setMapping(wMapping);
-  wnew->data = wData;
+  a.dataOf(wnew) = wData;
 
   vnew->setNetCost(costV  - minVNew,  false);
   vnew->setNetCost(costVR - minVNewR, true);
   vnew->setMapping(vMapping);
-  vnew->data = vData;
+  a.dataOf(vnew) = vData;
 
   unew->setNetCost(costU  - minUNew,  false);  
   unew->setNetCost(costUR - minUNewR, true);
   unew->setMapping(uMapping);
-  unew->data = uData;
+  a.dataOf(unew) = uData;
 
   //fix height fields while minding the order!
-  vnew->height = max(vnew->bLeft->height, vnew->bRight->height) + 1;
-  unew->height = max(unew->bLeft->height, unew->bRight->height) + 1;
-  wnew->height = max(wnew->bLeft->height, wnew->bRight->height) + 1;
+  vnew->height = max(a[vnew->bLeft]->height, a[vnew->bRight]->height) + 1;
+  unew->height = max(a[unew->bLeft]->height, a[unew->bRight]->height) + 1;
+  wnew->height = max(a[wnew->bLeft]->height, a[wnew->bRight]->height) + 1;
 
 }
 
-void DynNode::doubleRotateLeft(CapType grossminU, CapType grossminUR) {
+void DynNode::doubleRotateLeft(DynArena &a, CapType grossminU, CapType grossminUR) {
 
   DynNode *u, *v, *w;
   bool rState;
   
 
   if (isLeaf()) return;
-  normalizeReverseState();
+  normalizeReverseState(a);
 
   u = this;
-  v = bRight; //u->bRight
+  v = a[bRight]; //u->bRight
 
   if (v->isLeaf()) return;
-  v->normalizeReverseState();
+  v->normalizeReverseState(a);
 
-  w = v->bLeft;
+  w = a[v->bLeft];
 
   if (w->isLeaf()) return;
-  w->normalizeReverseState();
+  w->normalizeReverseState(a);
 
   DynNode uold = *(this);
   DynNode vold = *v;
@@ -550,9 +521,9 @@ void DynNode::doubleRotateLeft(CapType grossminU, CapType grossminUR) {
   bool vMapping = vold.getMapping();
   bool wMapping = wold.getMapping();
 
-  void *uData = uold.data;
-  void *vData = vold.data;
-  void *wData = wold.data;
+  DynData uData = a.dataOf(u);
+  DynData vData = a.dataOf(v);
+  DynData wData = a.dataOf(w);
 
   CapType minU  = grossminU;
   CapType minUR = grossminUR;
@@ -585,33 +556,33 @@ void DynNode::doubleRotateLeft(CapType grossminU, CapType grossminUR) {
   CapType minWlR = CAP_INF;
 
 
-  if (!v->bRight->isLeaf()) {
-    rState = v->bRight->getReversed();
+  if (!a[v->bRight]->isLeaf()) {
+    rState = a[v->bRight]->getReversed();
 
-    minVr  = v->bRight->getNetMin(rState)  + minVOld;
-    minVrR = v->bRight->getNetMin(!rState) + minVOldR;
+    minVr  = a[v->bRight]->getNetMin(rState)  + minVOld;
+    minVrR = a[v->bRight]->getNetMin(!rState) + minVOldR;
   }
 
-  if (!u->bLeft->isLeaf()) {
-    rState = u->bLeft->getReversed();
+  if (!a[u->bLeft]->isLeaf()) {
+    rState = a[u->bLeft]->getReversed();
     
-    minUl  = u->bLeft->getNetMin(rState)   + minU;
-    minUlR = u->bLeft->getNetMin(!rState)  + minUR;
+    minUl  = a[u->bLeft]->getNetMin(rState)   + minU;
+    minUlR = a[u->bLeft]->getNetMin(!rState)  + minUR;
 
   }
 
-  if (!w->bRight->isLeaf()) {
-    rState = w->bRight->getReversed();
+  if (!a[w->bRight]->isLeaf()) {
+    rState = a[w->bRight]->getReversed();
 
-    minWr  = w->bRight->getNetMin(rState)  + minWOld;
-    minWrR = w->bRight->getNetMin(!rState) + minWOldR;
+    minWr  = a[w->bRight]->getNetMin(rState)  + minWOld;
+    minWrR = a[w->bRight]->getNetMin(!rState) + minWOldR;
   }
 
-  if (!w->bLeft->isLeaf()) {
-    rState = w->bLeft->getReversed();
+  if (!a[w->bLeft]->isLeaf()) {
+    rState = a[w->bLeft]->getReversed();
 
-    minWl  = w->bLeft->getNetMin(rState)  + minWOld;
-    minWlR = w->bLeft->getNetMin(!rState) + minWOldR;
+    minWl  = a[w->bLeft]->getNetMin(rState)  + minWOld;
+    minWlR = a[w->bLeft]->getNetMin(!rState) + minWOldR;
   }
 
   
@@ -620,11 +591,11 @@ void DynNode::doubleRotateLeft(CapType grossminU, CapType grossminUR) {
   DynNode *vnew = v; //let the old DynNode for v be still v after rotation
 
   //restructure tree with u being new root
-  unew->setAsRChild(wold.bLeft, false);
-  unew->setAsLChild(uold.bLeft, false);
+  unew->setAsRChild(a, a[wold.bLeft], false);
+  unew->setAsLChild(a, a[uold.bLeft], false);
 
-  vnew->setAsLChild(wold.bRight, false);
-  wnew->setAsLChild(unew, false);
+  vnew->setAsLChild(a, a[wold.bRight], false);
+  wnew->setAsLChild(a, unew, false);
 
   
   //update netMin fields of unew, vnew and their respective children
@@ -647,32 +618,32 @@ void DynNode::doubleRotateLeft(CapType grossminU, CapType grossminUR) {
   unew->setNetMin(minUNew  - minWNew,  false);
   unew->setNetMin(minUNewR - minWNewR, true);
 
-  if (!vnew->bRight->isLeaf()) {
-    rState = vnew->bRight->getReversed();
+  if (!a[vnew->bRight]->isLeaf()) {
+    rState = a[vnew->bRight]->getReversed();
 
-    vnew->bRight->setNetMin(minVr  - minVNew,   rState);
-    vnew->bRight->setNetMin(minVrR - minVNewR, !rState);
+    a[vnew->bRight]->setNetMin(minVr  - minVNew,   rState);
+    a[vnew->bRight]->setNetMin(minVrR - minVNewR, !rState);
   }
 
-  if (!vnew->bLeft->isLeaf()) {
-    rState = vnew->bLeft->getReversed();
+  if (!a[vnew->bLeft]->isLeaf()) {
+    rState = a[vnew->bLeft]->getReversed();
 
-    vnew->bLeft->setNetMin(minWr  - minVNew,   rState);
-    vnew->bLeft->setNetMin(minWrR - minVNewR, !rState);
+    a[vnew->bLeft]->setNetMin(minWr  - minVNew,   rState);
+    a[vnew->bLeft]->setNetMin(minWrR - minVNewR, !rState);
   }
   
-  if (!unew->bRight->isLeaf()) {
-    rState = unew->bRight->getReversed();
+  if (!a[unew->bRight]->isLeaf()) {
+    rState = a[unew->bRight]->getReversed();
 
-    unew->bRight->setNetMin(minWl  - minUNew,   rState);
-    unew->bRight->setNetMin(minWlR - minUNewR, !rState);
+    a[unew->bRight]->setNetMin(minWl  - minUNew,   rState);
+    a[unew->bRight]->setNetMin(minWlR - minUNewR, !rState);
   }
 
-  if (!unew->bLeft->isLeaf()) {
-    rState = unew->bLeft->getReversed();
+  if (!a[unew->bLeft]->isLeaf()) {
+    rState = a[unew->bLeft]->getReversed();
 
-    unew->bLeft->setNetMin(minUl  - minUNew,   rState);
-    unew->bLeft->setNetMin(minUlR - minUNewR, !rState);
+    a[unew->bLeft]->setNetMin(minUl  - minUNew,   rState);
+    a[unew->bLeft]->setNetMin(minUlR - minUNewR, !rState);
   }
   
 
@@ -684,23 +655,23 @@ void DynNode::doubleRotateLeft(CapType grossminU, CapType grossminUR) {
   wnew->setNetCost(costW  - minWNew,  false);
   wnew->setNetCost(costWR - minWNewR, true);
   wnew->setMapping(wMapping);
-  wnew->data = wData;
+  a.dataOf(wnew) = wData;
   
   vnew->setNetCost(costV  - minVNew,  false);
   vnew->setNetCost(costVR - minVNewR, true);
   vnew->setMapping(vMapping);
-  vnew->data = vData;
+  a.dataOf(vnew) = vData;
 
   unew->setNetCost(costU  - minUNew,  false);
   unew->setNetCost(costUR - minUNewR, true);
   unew->setMapping(uMapping);
-  unew->data = uData;
+  a.dataOf(unew) = uData;
 
   
   //fix height fields while minding the order!
-  vnew->height = max(vnew->bLeft->height, vnew->bRight->height) + 1;
-  unew->height = max(unew->bLeft->height, unew->bRight->height) + 1;
-  wnew->height = max(wnew->bLeft->height, wnew->bRight->height) + 1;
+  vnew->height = max(a[vnew->bLeft]->height, a[vnew->bRight]->height) + 1;
+  unew->height = max(a[unew->bLeft]->height, a[unew->bRight]->height) + 1;
+  wnew->height = max(a[wnew->bLeft]->height, a[wnew->bRight]->height) + 1;
 }
 
 
@@ -808,162 +779,149 @@ DynRoot::DynRoot() {
 // }
 
 
-DynRoot *DynRoot::DynRootFromLeafChain(DynLeaf **leaves, int numLeaves) {
+DynLeaf *DynRoot::allocLeaves(DynArena &a, PlanarIdx numLeaves) {
 
-  //depending on the number of leaves in "leaves" the resulting tree may
-  //have a lowest row which is "incomplete" (#nodes != 2^height) -
-  //this last row is handled separately in the following
+  //leaves are addressed like inner nodes
+  static_assert(sizeof(DynLeaf) == sizeof(DynNode), "DynLeaf must not add fields to DynNode");
 
-  //this is where inner nodes are stored during successive tree construction
-  DynNode **nodes;
-  DynNode *pn, *pnl, *pnr;
-  DynLeaf *pl, *pll, *plr;
+  //n leaves require at most n-1 inner nodes, a few more are kept 
+  //as reserve for intermediate states
+  DynIdx size = 2*numLeaves + 64;
 
-  int maxNodes = numLeaves;
-  int plIdx   = maxNodes - 1;
-  int pnIdx   = maxNodes - 1; //points to the currently treated node in "nodes"
-  int saveIdx = maxNodes - 1; //used to save newly created nodes in "nodes"
-  int nLowerPairs; //number of node pairs in the lowest row
-  int nLastFullRow = 1; //number of nodes in last full row
-  int h = (int)(floor(log((float)numLeaves)/log((float)2))); //number of full rows
-
-  //helper
-  CapType grmin_l, grmin_r, rgrmin_l, rgrmin_r; 
-  CapType cost, costR;
-  bool mapping;
-  void *data;
-  int i, j;
+  //the memory of a previous solve is reused if large enough,
+  //otherwise the arena grows at least by a factor of two
+  if (size > a.capacity) {
+    DynIdx capacity = (size > 2*a.capacity) ? size : 2*a.capacity;
 
-  //detect trivial cases
-  if (numLeaves == 1)
-    return static_cast<DynRoot*>(static_cast<DynNode*>(leaves[0]));
+    releaseArena(a);
 
-  //compute number of nodes in the last full row
-  for (i=0; i<h; i++)
-    nLastFullRow *= 2;
+    a.bytes = sizeof(DynNode) * (size_t)capacity;
+    a.nodes = static_cast<DynNode*>(allocPages(a.bytes, DYN_TREE_HUGE_PAGES));
+    a.data  = new DynData[capacity];
+    //only the leaves have weak links, and there are less than capacity/2
+    a.leafCold = new DynLeafCold[capacity/2];
+    a.capacity = capacity;
+  }
 
-  if (h==0)
-    nLastFullRow = 0;
+  a.numLeaves = numLeaves;
+  a.size = size;
+  a.top  = numLeaves + 1;
+  a.freeList = DynNodeRef();
 
-  nodes = new DynNode*[maxNodes]; 
+  DynLeaf *leaves = static_cast<DynLeaf*>(a.nodes + 1);
 
-  nLowerPairs = numLeaves - nLastFullRow;
+  for (PlanarIdx i=0; i<numLeaves; i++) {
+    new (static_cast<DynNode*>(leaves + i)) DynLeaf;
+    leaves[i].setWeakLink(a, 0, 0, 0, false, 0);
+  }
 
-  //firstly construct the incomplete lowest row
-  for (i=0; i<nLowerPairs; i++) {
-    
-    pll = leaves[plIdx--];
-    plr = leaves[plIdx--];
+  return leaves;
 
-    pn = blockAllocator.alloc();
+}
 
-    pn->setAsLChild(pll,0);
-    pn->setAsRChild(plr,0);
 
-    pn->netMin  = pll->wCost;
-    pn->netMinR = pll->wCostR;
+void DynRoot::releaseArena(DynArena &a) {
 
-    pn->netCost  = 0;
-    pn->netCostR = 0;
+  freePages(a.nodes, a.bytes);
+  if (a.data)
+    delete [] a.data;
+  if (a.leafCold)
+    delete [] a.leafCold;
 
-    pn->setMapping(pll->getWeakMapping());
-    pn->data = pll->getWeakData();
-    pn->height = 1;
-    pn->setReversed(false);
+  DynLeaf::freeStacks(a);
 
-    nodes[saveIdx--] = pn;
+  a.nodes     = 0;
+  a.data      = 0;
+  a.leafCold  = 0;
+  a.size      = 0;
+  a.top       = 1;
+  a.numLeaves = 0;
+  a.freeList  = DynNodeRef();
+  a.capacity  = 0;
+  a.bytes     = 0;
 
-  }
+}
 
-  //push back remaining nodes
-  //  if (nLowerPairs > 0)
-  while(plIdx >= 0)
-    nodes[saveIdx--] = leaves[plIdx--];
 
-  //build up the remaining tree rows by iteratively merging pairs of nodes
-  for (i=0; i<h; i++) {
+DynRoot *DynRoot::DynRootFromLeafChain(DynArena &a, DynLeaf **leaves, PlanarIdx numLeaves) {
 
-    pnIdx   = maxNodes - 1;
-    saveIdx = maxNodes - 1;
+  //detect trivial cases
+  if (numLeaves == 1)
+    return static_cast<DynRoot*>(static_cast<DynNode*>(leaves[0]));
 
-    nLastFullRow >>= 1; //nLastFullRow /= 2;
+  //the n-1 inner nodes are taken from one contiguous slab if the arena 
+  //has room for it, otherwise they are allocated one by one
+  DynNode *slab = allocNodes(a, numLeaves - 1);
 
-    for (j=0; j<nLastFullRow; j++) {
+  return static_cast<DynRoot*>(buildFromLeafChain(a, leaves, numLeaves - 1, numLeaves, slab));
 
-      pnl = nodes[pnIdx--];
-      pnr = nodes[pnIdx--];
+}
 
-      pn = blockAllocator.alloc();
 
-      pn->setAsLChild(pnl,0);
-      pn->setAsRChild(pnr,0);
+//builds the subtree over the "numLeaves" leaves ending at leaves[hi] in
+//post order. leaves[hi] becomes the head and leaves[hi-numLeaves+1] the 
+//tail of the subtree. The shape is that of a complete binary tree whose
+//lowest row is filled from the head side.
+DynNode *DynRoot::buildFromLeafChain(DynArena &a, DynLeaf **leaves, PlanarIdx hi, PlanarIdx numLeaves,
+				     DynNode *&slab) {
 
-      if (pnl->isLeaf()) {
-	pl = static_cast<DynLeaf*>(pnl);
-	cost     = pl->getWeakCost();
-	costR    = pl->getWeakRevCost();
-	mapping  = pl->getWeakMapping();
-	data     = pl->getWeakData();
+  if (numLeaves == 1)
+    return leaves[hi];
 
-	grmin_l  = CAP_INF;
-	rgrmin_l = CAP_INF;
-      } else {
-	pl = static_cast<DynLeaf*>(pnl->bTail);
-	cost     = pl->getWeakCost();
-	costR    = pl->getWeakRevCost();
-	mapping  = pl->getMapping();
-	data     = pl->getWeakData();
-
-	grmin_l  = pnl->netMin;
-	rgrmin_l = pnl->netMinR;
-      }
+  //number of leaves in the left subtree: half of the last full row plus
+  //as many of the lowest row pairs as fit into that half
+  PlanarIdx halfRow = 1;
+  while (4*halfRow <= numLeaves)
+    halfRow *= 2;
+  PlanarIdx nLeft = halfRow + min(numLeaves - 2*halfRow, halfRow);
 
-      if (pnr->isLeaf()) {
-	grmin_r  = CAP_INF;
-	rgrmin_r = CAP_INF;
-      } else {
-	grmin_r  = pnr->netMin;
-	rgrmin_r = pnr->netMin;
-      }
+  DynNode *pnl = buildFromLeafChain(a, leaves, hi, nLeft, slab);
+  DynNode *pnr = buildFromLeafChain(a, leaves, hi - nLeft, numLeaves - nLeft, slab);
 
-      pn->netMin  = mmin3(cost, grmin_l,  grmin_r);
-      pn->netMinR = mmin3(costR, rgrmin_l, rgrmin_r);
-    
-      pn->netCost  = cost  - pn->netMin;
-      pn->netCostR = costR - pn->netMinR;
+  DynNode *pn = slab ? slab++ : allocNode(a);
 
-      pn->setMapping(mapping);
-      pn->setReversed(false);
-      pn->data = data;
-    
-      if (!pnl->isLeaf()) {
-	pnl->netMin  -= pn->netMin;
-	pnl->netMinR -= pn->netMinR;
-      }
+  pn->setAsLChild(a, pnl,0);
+  pn->setAsRChild(a, pnr,0);
 
-      if (!pnr->isLeaf()) {
-	pnr->netMin  -= pn->netMin;
-	pnr->netMinR -= pn->netMinR;
-      }
+  //the edge between both subtrees is the weak link of the left tail
+  DynLeaf *pl = leaves[hi - nLeft + 1];
+  CapType cost  = pl->getWeakCost(a);
+  CapType costR = pl->getWeakRevCost(a);
 
-      pn->height = max(pnr->height, pnl->height) + 1;
+  CapType grmin_l  = pnl->isLeaf() ? CAP_INF : pnl->netMin;
+  CapType rgrmin_l = pnl->isLeaf() ? CAP_INF : pnl->netMinR;
+  CapType grmin_r  = pnr->isLeaf() ? CAP_INF : pnr->netMin;
+  CapType rgrmin_r = pnr->isLeaf() ? CAP_INF : pnr->netMinR;
 
-      nodes[saveIdx--] = pn;
+  pn->netMin  = mmin3(cost,  grmin_l,  grmin_r);
+  pn->netMinR = mmin3(costR, rgrmin_l, rgrmin_r);
     
-    } 
+  pn->netCost  = cost  - pn->netMin;
+  pn->netCostR = costR - pn->netMinR;
+
+  pn->setMapping(pl->getWeakMapping(a));
+  pn->setReversed(false);
+  a.dataOf(pn) = pl->getWeakData(a);
     
+  if (!pnl->isLeaf()) {
+    pnl->netMin  -= pn->netMin;
+    pnl->netMinR -= pn->netMinR;
   }
 
-  pn = nodes[maxNodes-1];
-  delete [] nodes;
-  
-  return static_cast<DynRoot*>(pn);
+  if (!pnr->isLeaf()) {
+    pnr->netMin  -= pn->netMin;
+    pnr->netMinR -= pn->netMinR;
+  }
+
+  pn->height = max(pnr->height, pnl->height) + 1;
+
+  return pn;
 
 }
 
 
 
-DynLeaf *DynRoot::getMinCostLeaf() {
+DynLeaf *DynRoot::getMinCostLeaf(DynArena &a) {
   bool rState;
   DynNode *pn, *rChild = 0, *lChild = 0;
   DynLeaf *minCostLeaf;
@@ -974,11 +932,11 @@ DynLeaf *DynRoot::getMinCostLeaf() {
   while (!pn->isLeaf()) {
     rState ^= pn->getReversed();
     if (rState) {
-      rChild = pn->bLeft;
-      lChild = pn->bRight;
+      rChild = a[pn->bLeft];
+      lChild = a[pn->bRight];
     } else {
-      rChild = pn->bRight;
-      lChild = pn->bLeft;
+      rChild = a[pn->bRight];
+      lChild = a[pn->bLeft];
     }
     rChildNetMin = rChild->getNetMin(rState ^ rChild->getReversed());
     //node already found?
@@ -1001,18 +959,18 @@ DynLeaf *DynRoot::getMinCostLeaf() {
   else {
     rState ^= lChild->getReversed();
     if (rState)
-      minCostLeaf = static_cast<DynLeaf*>(lChild->bHead);
+      minCostLeaf = static_cast<DynLeaf*>(a[lChild->bHead]);
     else
-      minCostLeaf = static_cast<DynLeaf*>(lChild->bTail);
+      minCostLeaf = static_cast<DynLeaf*>(a[lChild->bTail]);
   }
   return minCostLeaf;
 }
 
 
-DynRoot *DynRoot::concatenate(DynRoot *rightPath, 
+DynRoot *DynRoot::concatenate(DynArena &a, DynRoot *rightPath, 
 			      CapType cost, CapType costR, 
 			      bool revMapping, 
-			      void *data) 
+			      DynData data) 
 {
 
   DynRoot *pdp;
@@ -1024,7 +982,7 @@ DynRoot *DynRoot::concatenate(DynRoot *rightPath,
     return 0;
   
   //create a new root with left and right part as children
-  pdp = construct(rightPath, cost, costR, revMapping, data);
+  pdp = construct(a, rightPath, cost, costR, revMapping, data);
 
   u = pdp;
   minU  = u->netMin;
@@ -1044,23 +1002,23 @@ DynRoot *DynRoot::concatenate(DynRoot *rightPath,
   //is not higher than its sibling. Otherwise a right rotation on the
   //right subtree in the next step would again result in an unbalanced
   //tree, since the height of the right subtree is again reduced by 1.
-  while (u->bLeft->height - u->bRight->height > 1) {
+  while (a[u->bLeft]->height - a[u->bRight]->height > 1) {
 
-    v = u->bLeft;
+    v = a[u->bLeft];
     revFac = (v->getReversed() ? -1 : 1);
 
-    if (revFac * (v->bLeft->height - v->bRight->height) >= 0) {
+    if (revFac * (a[v->bLeft]->height - a[v->bRight]->height) >= 0) {
       
-      u->rotateRight(minU, minUR);
+      u->rotateRight(a, minU, minUR);
 
     } else {
 
-      u->doubleRotateRight(minU, minUR);
+      u->doubleRotateRight(a, minU, minUR);
 
       //extra right rotation required? (see above)
-      if (u->bLeft->height > u->bRight->height) {
-	u->rotateRight(minU, minUR);
-	u = u->bRight;
+      if (a[u->bLeft]->height > a[u->bRight]->height) {
+	u->rotateRight(a, minU, minUR);
+	u = a[u->bRight];
 
 	minU  += u->netMin;  //successor of u has normalized reverse state due to rotation
 	minUR += u->netMinR;
@@ -1068,7 +1026,7 @@ DynRoot *DynRoot::concatenate(DynRoot *rightPath,
 
     }
       
-    u = u->bRight;
+    u = a[u->bRight];
 
     minU  += u->netMin; //already normalized
     minUR += u->netMinR;
@@ -1080,22 +1038,22 @@ DynRoot *DynRoot::concatenate(DynRoot *rightPath,
 
   //do the same procedure as above for the case that the right subtree
   //is significantly higher than the left one
-  while (u->bRight->height - u->bLeft->height > 1) {
+  while (a[u->bRight]->height - a[u->bLeft]->height > 1) {
 
-    v = u->bRight;
+    v = a[u->bRight];
     revFac = (v->getReversed() ? -1 : 1);
 
-    if (revFac * (v->bRight->height - v->bLeft->height) >= 0) {
+    if (revFac * (a[v->bRight]->height - a[v->bLeft]->height) >= 0) {
       
-      u->rotateLeft(minU, minUR);
+      u->rotateLeft(a, minU, minUR);
     } else {
 
-      u->doubleRotateLeft(minU, minUR);
+      u->doubleRotateLeft(a, minU, minUR);
 
       //extra left rotation required? (see above)
-      if (u->bRight->height > u->bLeft->height) {
-	u->rotateLeft(minU, minUR);
-	u = u->bLeft;
+      if (a[u->bRight]->height > a[u->bLeft]->height) {
+	u->rotateLeft(a, minU, minUR);
+	u = a[u->bLeft];
 	
 	minU  += u->netMin;
 	minUR += u->netMinR;
@@ -1103,7 +1061,7 @@ DynRoot *DynRoot::concatenate(DynRoot *rightPath,
 
     }
       
-    u = u->bLeft;
+    u = a[u->bLeft];
 
     minU  += u->netMin;
     minUR += u->netMinR;
@@ -1116,8 +1074,8 @@ DynRoot *DynRoot::concatenate(DynRoot *rightPath,
   //fix the height fields on the way to the root
   while (u->bParent) {
     
-    u = u->bParent;
-    u->height = max(u->bLeft->height, u->bRight->height) + 1;
+    u = a[u->bParent];
+    u->height = max(a[u->bLeft]->height, a[u->bRight]->height) + 1;
     
   }
 
@@ -1126,7 +1084,7 @@ DynRoot *DynRoot::concatenate(DynRoot *rightPath,
 }
 
 
-void DynRoot::destroy(ResultDestroy *dr) {
+void DynRoot::destroy(DynArena &a, ResultDestroy *dr) {
 
   CapType *pNetMin, *pNetMinR;
 
@@ -1134,49 +1092,49 @@ void DynRoot::destroy(ResultDestroy *dr) {
     return;
 
   //propagate reversed state downward
-  normalizeReverseState();
+  normalizeReverseState(a);
 
   if (dr) {
     dr->cost      = netCost  + netMin;
     dr->costR     = netCostR + netMinR;
-    dr->leftPath  = static_cast<DynRoot*>(bLeft);
-    dr->rightPath = static_cast<DynRoot*>(bRight);
+    dr->leftPath  = static_cast<DynRoot*>(a[bLeft]);
+    dr->rightPath = static_cast<DynRoot*>(a[bRight]);
   }
 
-  if (!bLeft->isLeaf()) {
+  if (!a[bLeft]->isLeaf()) {
     
-    bLeft->getNetMinPtr(&pNetMin, &pNetMinR);
+    a[bLeft]->getNetMinPtr(&pNetMin, &pNetMinR);
 
     *pNetMin  += netMin;
     *pNetMinR += netMinR;
 
   }
 
-  if (!bRight->isLeaf()) {
+  if (!a[bRight]->isLeaf()) {
 
-    bRight->getNetMinPtr(&pNetMin, &pNetMinR);
+    a[bRight]->getNetMinPtr(&pNetMin, &pNetMinR);
 
     *pNetMin  += netMin;
     *pNetMinR += netMinR;
 
   }
 
-  bLeft->bParent  = 0;
-  bRight->bParent = 0;
+  a[bLeft]->bParent  = DynNodeRef();
+  a[bRight]->bParent = DynNodeRef();
 
-  bLeft  = 0;
-  bRight = 0;
+  bLeft  = DynNodeRef();
+  bRight = DynNodeRef();
 
-  blockAllocator.dealloc(this); 
+  deallocNode(a, this); 
 
 }
  
-DynRoot *DynRoot::construct(DynRoot *rightPath, 
+DynRoot *DynRoot::construct(DynArena &a, DynRoot *rightPath, 
 			    CapType cost, CapType costR, 
 			    bool revMapping, 
-			    void *data) {
+			    DynData data) {
 
-  DynNode *pn = blockAllocator.alloc();
+  DynNode *pn = allocNode(a);
 
   CapType infCap = CAP_INF;
 
@@ -1195,22 +1153,22 @@ DynRoot *DynRoot::construct(DynRoot *rightPath,
   pn->netCost  = cost  - pn->netMin;
   pn->netCostR = costR - pn->netMinR;
 
-  pn->setAsLChild(this, 0);
-  pn->setAsRChild(rightPath, 0);
+  pn->setAsLChild(a, this, 0);
+  pn->setAsRChild(a, rightPath, 0);
 
-  if (!pn->bRight->isLeaf()) {
+  if (!a[pn->bRight]->isLeaf()) {
     *pRNetMin  -= pn->netMin;
     *pRNetMinR -= pn->netMinR;
   }
 
-  if (!pn->bLeft->isLeaf()) {
+  if (!a[pn->bLeft]->isLeaf()) {
     *pLNetMin  -= pn->netMin;
     *pLNetMinR -= pn->netMinR;
   }
 
   pn->height = max(rightPath->height, this->height) + 1;
   pn->setMapping(revMapping);
-  pn->data = data;
+  a.dataOf(pn) = data;
 
   //  return DynRoot::DynNodeToDynRoot(pn);
   return static_cast<DynRoot*>(pn);
@@ -1218,24 +1176,24 @@ DynRoot *DynRoot::construct(DynRoot *rightPath,
 }
 
 
-DynRoot *DynRoot::splice() {
+DynRoot *DynRoot::splice(DynArena &a) {
 
   ResultSplit sres;
   DynLeaf *pl;
   DynRoot *pdp;
   
   //get the "weak" parent node of the last path node within the DynTree 
-  pl = this->getTail()->getWeakParent();
+  pl = this->getTail(a)->getWeakParent(a);
 
   if (!pl)
     return this;
 
   //split up the parent nodes path
-  pl->divide(&sres);
+  pl->divide(a, &sres);
 
   //and reconnect the left subpath weakly to the parent node
   if (sres.leftPath) {
-    sres.leftPath->getTail()->setWeakLink(pl,
+    sres.leftPath->getTail(a)->setWeakLink(a, pl,
 					  sres.costBefore,
 					  sres.costBeforeR,
 					  sres.mappingBefore,
@@ -1243,11 +1201,11 @@ DynRoot *DynRoot::splice() {
   }
   
   //now convert the connection to the parent node to a "strong" one
-  pdp = this->concatenate(sres.rightPath,
-			  this->getTail()->getWeakCost(),
-			  this->getTail()->getWeakRevCost(),
-			  this->getTail()->getWeakMapping(),
-			  this->getTail()->getWeakData());
+  pdp = this->concatenate(a, sres.rightPath,
+			  this->getTail(a)->getWeakCost(a),
+			  this->getTail(a)->getWeakRevCost(a),
+			  this->getTail(a)->getWeakMapping(a),
+			  this->getTail(a)->getWeakData(a));
   
   return pdp;
 
@@ -1256,16 +1214,16 @@ DynRoot *DynRoot::splice() {
 
 #if defined DYNPATH_DEBUG
 
-void DynRoot::print(bool weights) {
+void DynRoot::print(DynArena &a, bool weights) {
 
   DynLeaf *pl;
   CapType cost, costR;
 
-  pl = getHead();
+  pl = getHead(a);
 
   do {
 
-    if (pl != getHead()) {
+    if (pl != getHead(a)) {
       cout << " - ";
 
       if (weights)
@@ -1274,12 +1232,12 @@ void DynRoot::print(bool weights) {
 
     cout << pl->id;
     
-    if (weights && getTail() != pl) {
-      pl->getEdgeCostDbl(cost, costR);
+    if (weights && getTail(a) != pl) {
+      pl->getEdgeCostDbl(a, cost, costR);
       cout << " - " << cost << " / " << costR;
     }
 
-  }  while ((pl = pl->getNextDyn()));
+  }  while ((pl = pl->getNextDyn(a)));
     
   cout << "\n\n";
 
@@ -1291,7 +1249,7 @@ void DynRoot::print(bool weights) {
 #ifdef DYNPATH_DEBUG
 
 //normalizes the reverse state of all tree nodes in the process
-bool DynRoot::checkCostIntegrity() { 
+bool DynRoot::checkCostIntegrity(DynArena &a) { 
 
   if (this->isLeaf())
     return true;
@@ -1302,29 +1260,29 @@ bool DynRoot::checkCostIntegrity() {
   while(true) {
 
     while (!pn->isLeaf()) {
-      pn->normalizeReverseState();
+      pn->normalizeReverseState(a);
       if (pn->bParent) 
-	pn->grossMin = pn->netMin + pn->bParent->grossMin;
+	pn->grossMin = pn->netMin + a[pn->bParent]->grossMin;
       else
 	pn->grossMin = pn->netMin;
       pn->grossCost = pn->grossMin + pn->netCost;
 
-      pn = pn->bLeft;
+      pn = a[pn->bLeft];
     }
 
-    while (pn->bParent->bRight == pn) {
-      pn = pn->bParent;
+    while (a[a[pn->bParent]->bRight] == pn) {
+      pn = a[pn->bParent];
       if (pn == this)
 	goto precomputed;
     }
 
-    pn = pn->bParent->bRight;
+    pn = a[a[pn->bParent]->bRight];
 
   }
 
  precomputed:
 
-  DynLeaf *pl = getHead();
+  DynLeaf *pl = getHead(a);
   pn = pl;
   bool fromRight;
   CapType minCost = 1e6;
@@ -1339,24 +1297,24 @@ bool DynRoot::checkCostIntegrity() {
       if (!pn->bParent)
 	goto finished; //we arrived at the root
 
-      if (pn->bParent->bRight == pn)
+      if (a[a[pn->bParent]->bRight] == pn)
 	fromRight = true;
-      else if (pn->bParent->bLeft == pn)
+      else if (a[a[pn->bParent]->bLeft] == pn)
 	fromRight = false;
       
-      pn = pn->bParent; //ascend
+      pn = a[pn->bParent]; //ascend
 
       //check grossmin integrity
-      if (pn->bRight->isLeaf() && pn->bLeft->isLeaf()) {
+      if (a[pn->bRight]->isLeaf() && a[pn->bLeft]->isLeaf()) {
 	minCost = pn->grossMin;
 	if (fabs(pn->grossMin - pn->grossCost) > 1e-4)
 	  return false;
-      } else if (pn->bRight->isLeaf() && !pn->bLeft->isLeaf()) {
-	minCost = pn->bLeft->grossMin;
-      } else if (!pn->bRight->isLeaf() && pn->bLeft->isLeaf()) {
-	minCost = pn->bRight->grossMin;
+      } else if (a[pn->bRight]->isLeaf() && !a[pn->bLeft]->isLeaf()) {
+	minCost = a[pn->bLeft]->grossMin;
+      } else if (!a[pn->bRight]->isLeaf() && a[pn->bLeft]->isLeaf()) {
+	minCost = a[pn->bRight]->grossMin;
       } else {
-	minCost = pn->bRight->grossMin < pn->bLeft->grossMin ? pn->bRight->grossMin : pn->bLeft->grossMin;
+	minCost = a[pn->bRight]->grossMin < a[pn->bLeft]->grossMin ? a[pn->bRight]->grossMin : a[pn->bLeft]->grossMin;
       }
       
       if (fabs(pn->grossMin - pn->grossCost) > 1e-4 &&
@@ -1366,10 +1324,10 @@ bool DynRoot::checkCostIntegrity() {
     } while (fromRight); // while(fromRight)
     
     //we came from the left - ascend further right
-    pn = pn->bRight;
+    pn = a[pn->bRight];
     
     if (!pn->isLeaf())
-      pn = pn->bHead;
+      pn = a[pn->bHead];
     
     pl = static_cast<DynLeaf*>(pn);
     
@@ -1385,9 +1343,9 @@ bool DynRoot::checkCostIntegrity() {
 
 #if defined DYNPATH_DEBUG
 
-bool DynRoot::checkStructuralIntegrity() {
+bool DynRoot::checkStructuralIntegrity(DynArena &a) {
 
-  DynLeaf *pl = getHead();
+  DynLeaf *pl = getHead(a);
   DynNode *pn = pl, *pnRoot = this;
   bool fromRight, relationShipError;
   
@@ -1418,10 +1376,10 @@ bool DynRoot::checkStructuralIntegrity() {
 
       relationShipError = true;
 
-      if (pn->bParent->bRight == pn) {
+      if (a[a[pn->bParent]->bRight] == pn) {
 	fromRight = true;
 	relationShipError = false;
-      } else if (pn->bParent->bLeft == pn) {
+      } else if (a[a[pn->bParent]->bLeft] == pn) {
 	fromRight = false;
 	relationShipError = false;
       }
@@ -1429,19 +1387,19 @@ bool DynRoot::checkStructuralIntegrity() {
       if (relationShipError)
 	return false;
     
-      pn = pn->bParent; //ascend
+      pn = a[pn->bParent]; //ascend
     
       //we came from the right
       if (fromRight) {
 
 	int heightB, heightS;
       
-	if (pn->bLeft->height > pn->bRight->height) {
-	  heightB = pn->bLeft->height;
-	  heightS = pn->bRight->height;
+	if (a[pn->bLeft]->height > a[pn->bRight]->height) {
+	  heightB = a[pn->bLeft]->height;
+	  heightS = a[pn->bRight]->height;
 	} else {
-	  heightB = pn->bRight->height;
-	  heightS = pn->bLeft->height;
+	  heightB = a[pn->bRight]->height;
+	  heightS = a[pn->bLeft]->height;
 	}
 
 	int ballance = heightB - heightS;
@@ -1459,10 +1417,10 @@ bool DynRoot::checkStructuralIntegrity() {
     } while (fromRight); // while(fromRight)
 
     //we came from the left - ascend further right
-    pn = pn->bRight;
+    pn = a[pn->bRight];
     
     if (!pn->isLeaf())
-      pn = pn->bHead;
+      pn = a[pn->bHead];
     
     pl = static_cast<DynLeaf*>(pn);
     
@@ -1483,7 +1441,66 @@ bool DynRoot::checkStructuralIntegrity() {
 /***************************************************
  *** DynLeaf ***************************************
  ***************************************************/
-DynLeaf::DynLeaf() : wParent(0), wCost(0), wCostR(0) {
+//replaces stack by an array of newSize elements holding its first oldSize ones
+template <class T>
+static void growStack(T *&stack, int oldSize, int newSize) {
+
+  T *grown = new T[newSize];
+
+  if (oldSize) {
+    std::copy(stack, stack + oldSize, grown);
+    delete [] stack;
+  }
+  stack = grown;
+
+}
+
+
+void DynLeaf::growStacks(DynArena &a) {
+
+  //the stacks only grow with the height of the deepest path tree
+  //seen so far - their contents are kept
+  int oldSize   = a.stackSize;
+  int stackSize = oldSize ? 2 * oldSize : 64;
+
+  growStack(a.stackRightSide, oldSize, stackSize);
+  growStack(a.stackLeftSide,  oldSize, stackSize);
+  growStack(a.stackCostR,     2 * oldSize, 2 * stackSize); //two costs per level
+  growStack(a.stackCostL,     2 * oldSize, 2 * stackSize);
+  growStack(a.stackMappingR,  oldSize, stackSize);
+  growStack(a.stackMappingL,  oldSize, stackSize);
+  growStack(a.stackDataR,     oldSize, stackSize);
+  growStack(a.stackDataL,     oldSize, stackSize);
+  growStack(a.stackRPath,     oldSize, stackSize);
+
+  a.stackSize = stackSize;
+
+}
+
+
+void DynLeaf::freeStacks(DynArena &a) {
+
+  if (!a.stackSize)
+    return;
+
+  delete [] a.stackRightSide;
+  delete [] a.stackLeftSide;
+  delete [] a.stackCostR;
+  delete [] a.stackCostL;
+  delete [] a.stackMappingR;
+  delete [] a.stackMappingL;
+  delete [] a.stackDataR;
+  delete [] a.stackDataL;
+  delete [] a.stackRPath;
+
+  a.stackSize = 0;
+
+}
+
+
+DynLeaf::DynLeaf() {
+
+  //the weak link is cleared by DynRoot::allocLeaves()
 
 #if defined DYNPATH_DEBUG
   id = 0; 
@@ -1492,22 +1509,24 @@ DynLeaf::DynLeaf() : wParent(0), wCost(0), wCostR(0) {
 }
 
 
-void DynLeaf::setWeakLink(DynLeaf *parent, 
+void DynLeaf::setWeakLink(DynArena &a, DynLeaf *parent, 
 			  CapType cap, CapType rcap, 
 			  bool mapping,
-			  void *linkData) {
+			  DynData linkData) {
+
+  DynLeafCold &c = cold(a);
 
-  wParent = parent;
-  wCost   = cap;
-  wCostR  = rcap;
-  data    = linkData;
+  c.wParent      = parent;
+  c.wCost        = cap;
+  c.wCostR       = rcap;
+  a.dataOf(this) = linkData;
 
   DynNode::setMapping(mapping);
 
 }
 
 
-CapType DynLeaf::prepareRootPath() {
+CapType DynLeaf::prepareRootPath(DynArena &a) {
 
   int idxRPath = 0;
 
@@ -1518,9 +1537,11 @@ CapType DynLeaf::prepareRootPath() {
   pn = this;
 //std::cout  <<"  [<" << this << ">::prepareRootPath():] \n";   
 
-  while (pn->bParent != 0) {
-    stackRPath[idxRPath++] = pn;
-    pn = pn->bParent;
+  while (pn->bParent) {
+    if (idxRPath == a.stackSize)
+      growStacks(a);
+    a.stackRPath[idxRPath++] = pn;
+    pn = a[pn->bParent];
   }
 
   //for each node on the path compute the reversed state
@@ -1531,7 +1552,7 @@ CapType DynLeaf::prepareRootPath() {
 
   while (idxRPath != 0) {
 
-    pn = stackRPath[--idxRPath];
+    pn = a.stackRPath[--idxRPath];
     rState ^= pn->getReversed();
 
     if (!pn->isLeaf()) {
@@ -1546,7 +1567,7 @@ CapType DynLeaf::prepareRootPath() {
 }
 
 
-void DynLeaf::prepareRootPathDbl(CapType &grossMin, CapType &grossMinR) {
+void DynLeaf::prepareRootPathDbl(DynArena &a, CapType &grossMin, CapType &grossMinR) {
 
   int idxRPath = 0;
 
@@ -1555,10 +1576,12 @@ void DynLeaf::prepareRootPathDbl(CapType &grossMin, CapType &grossMinR) {
   //compute and save the path to the root node
   pn = this;
 
-  while (pn->bParent != 0) {
+  while (pn->bParent) {
 
-    stackRPath[idxRPath++] = pn;
-    pn = pn->bParent;
+    if (idxRPath == a.stackSize)
+      growStacks(a);
+    a.stackRPath[idxRPath++] = pn;
+    pn = a[pn->bParent];
 
   }
 
@@ -1571,7 +1594,7 @@ void DynLeaf::prepareRootPathDbl(CapType &grossMin, CapType &grossMinR) {
 
   while (idxRPath != 0) {
 
-    pn = stackRPath[--idxRPath];
+    pn = a.stackRPath[--idxRPath];
     rState ^= pn->getReversed();
 
     if (!pn->isLeaf()) {
@@ -1585,36 +1608,39 @@ void DynLeaf::prepareRootPathDbl(CapType &grossMin, CapType &grossMinR) {
 }
 
 
-void DynLeaf::disassemble() {
+void DynLeaf::disassemble(DynArena &a) {
   DynNode *pn, *pnP, *pnC;       //node variables for parent and child
   DynRoot *pdp;
 
   CapType grossMin, grossMinR;   //current grossmin value
   CapType cost, costR;           //cost of recently deleted node
   bool mapping;               //arc / anti-arc association of costs
-  void    *data;
+  DynData  data;
 
   ResultDestroy dr;                 //receives result of destroy()       
 
   //empty stacks
-  idxRPath = 0;
-  idxRightSide = 0;
-  idxLeftSide = 0;
-  idxCostR = 0;
-  idxCostL = 0;
-  idxMappingR = 0;
-  idxMappingL = 0;
-  idxDataL = 0;
-  idxDataR = 0;
+  int idxRPath = 0;
+  a.idxRightSide = 0;
+  a.idxLeftSide = 0;
+  a.idxCostR = 0;
+  a.idxCostL = 0;
+  a.idxMappingR = 0;
+  a.idxMappingL = 0;
+  a.idxDataL = 0;
+  a.idxDataR = 0;
 
   
   //compute and save path to root node
   pn = this;
 
-  while (pn->bParent != 0) { 
+  while (pn->bParent) { 
 
-    stackRPath[idxRPath++] = pn;
-    pn = pn->bParent;
+    //each level takes one entry on the side stacks plus one for "this"
+    if (idxRPath + 1 >= a.stackSize)
+      growStacks(a);
+    a.stackRPath[idxRPath++] = pn;
+    pn = a[pn->bParent];
 
   }
 
@@ -1625,7 +1651,7 @@ void DynLeaf::disassemble() {
 
   while(pnP != this) {
 
-    pnP->normalizeReverseState(); //make sure the reversed state is zero
+    pnP->normalizeReverseState(a); //make sure the reversed state is zero
 
     grossMin  = pnP->netMin; //during disassembly pnP is always a root => grossMin = netMin
     grossMinR = pnP->netMinR;
@@ -1633,28 +1659,28 @@ void DynLeaf::disassemble() {
     cost  = grossMin  + pnP->netCost;
     costR = grossMinR + pnP->netCostR;
 
-    pnC = stackRPath[--idxRPath]; //get next child on path to destination node
+    pnC = a.stackRPath[--idxRPath]; //get next child on path to destination node
 
-    bool toRPath = (pnC == pnP->bLeft); //true, if the path continues left
+    bool toRPath = (pnC == a[pnP->bLeft]); //true, if the path continues left
 
     mapping = pnP->getMapping();
-    data    = pnP->data;
+    data    = a.dataOf(pnP);
     
     pdp = static_cast<DynRoot*>(pnP);
-    pdp->destroy(&dr);
+    pdp->destroy(a, &dr);
     
     if (toRPath) { //cut subtree belongs to the right half of the splitted path
-      stackRightSide[idxRightSide++] = dr.rightPath;
-      stackCostR[idxCostR++]         = cost;
-      stackCostR[idxCostR++]         = costR;
-      stackMappingR[idxMappingR++]   = mapping;
-      stackDataR[idxDataR++]         = data;
+      a.stackRightSide[a.idxRightSide++] = dr.rightPath;
+      a.stackCostR[a.idxCostR++]         = cost;
+      a.stackCostR[a.idxCostR++]         = costR;
+      a.stackMappingR[a.idxMappingR++]   = mapping;
+      a.stackDataR[a.idxDataR++]         = data;
     } else { //cut subtree belongs to the left half of the splitted path
-      stackLeftSide[idxLeftSide++]   = dr.leftPath;
-      stackCostL[idxCostL++]         = cost;
-      stackCostL[idxCostL++]         = costR;
-      stackMappingL[idxMappingL++]   = mapping;
-      stackDataL[idxDataL++]         = data;
+      a.stackLeftSide[a.idxLeftSide++]   = dr.leftPath;
+      a.stackCostL[a.idxCostL++]         = cost;
+      a.stackCostL[a.idxCostL++]         = costR;
+      a.stackMappingL[a.idxMappingL++]   = mapping;
+      a.stackDataL[a.idxDataL++]         = data;
     }
 
     pnP = pnC;
@@ -1662,56 +1688,56 @@ void DynLeaf::disassemble() {
   }
 
   //the calling node is part of the right subpath
-  stackRightSide[idxRightSide++] = static_cast<DynRoot*>(static_cast<DynNode*>(this));
+  a.stackRightSide[a.idxRightSide++] = static_cast<DynRoot*>(static_cast<DynNode*>(this));
 }
 
 
-void DynLeaf::reassemble(DynRoot*& pdpl, DynRoot*& pdpr) {
+void DynLeaf::reassemble(DynArena &a, DynRoot*& pdpl, DynRoot*& pdpr) {
   CapType cost, costR;           //cost of recently deleted node
   bool  mapping;               //arc / anti-arc association of costs
-  void    *data;
+  DynData  data;
 
   //reassemble left subpath from inside to outside
   //otherwise no log-runtime is guaranteed
-  if (idxLeftSide != 0)
-    pdpl = stackLeftSide[--idxLeftSide];
-
-  while (idxLeftSide != 0) {
-    costR   = stackCostL[--idxCostL];
-    cost    = stackCostL[--idxCostL];
-    mapping = stackMappingL[--idxMappingL];
-    data    = stackDataL[--idxDataL];
-    pdpl    = stackLeftSide[--idxLeftSide]->concatenate(pdpl, cost, costR, mapping, data);
+  if (a.idxLeftSide != 0)
+    pdpl = a.stackLeftSide[--a.idxLeftSide];
+
+  while (a.idxLeftSide != 0) {
+    costR   = a.stackCostL[--a.idxCostL];
+    cost    = a.stackCostL[--a.idxCostL];
+    mapping = a.stackMappingL[--a.idxMappingL];
+    data    = a.stackDataL[--a.idxDataL];
+    pdpl    = a.stackLeftSide[--a.idxLeftSide]->concatenate(a, pdpl, cost, costR, mapping, data);
   }
 
 
   //reassemble right subpath from inside to outside
   //otherwise no log-runtime is guaranteed
-  if (idxRightSide != 0)
-    pdpr = stackRightSide[--idxRightSide];
-
-  while (idxRightSide != 0) {
-    costR   = stackCostR[--idxCostR];
-    cost    = stackCostR[--idxCostR];
-    mapping = stackMappingR[--idxMappingR];
-    data    = stackDataR[--idxDataR];
-    pdpr    = pdpr->concatenate(stackRightSide[--idxRightSide], 
+  if (a.idxRightSide != 0)
+    pdpr = a.stackRightSide[--a.idxRightSide];
+
+  while (a.idxRightSide != 0) {
+    costR   = a.stackCostR[--a.idxCostR];
+    cost    = a.stackCostR[--a.idxCostR];
+    mapping = a.stackMappingR[--a.idxMappingR];
+    data    = a.stackDataR[--a.idxDataR];
+    pdpr    = pdpr->concatenate(a, a.stackRightSide[--a.idxRightSide], 
 				cost, costR, 
 				mapping, data);
   }
 }
 
 
-DynRoot *DynLeaf::getPath() {
+DynRoot *DynLeaf::getPath(DynArena &a) {
   DynNode *pn;
 
   if (!bParent) //this DynPath is only a leaf (= a single node)
     return static_cast<DynRoot*>(static_cast<DynNode*>(this)); 
 
-  pn = bParent;
+  pn = a[bParent];
 
-  while (pn->bParent != 0) {    
-    pn = pn->bParent;
+  while (pn->bParent) {    
+    pn = a[pn->bParent];
   }
 
   //now we have arrived at the root node
@@ -1720,37 +1746,37 @@ DynRoot *DynLeaf::getPath() {
 }
 
 
-void DynLeaf::split(ResultSplit *psr) {
+void DynLeaf::split(DynArena &a, ResultSplit *psr) {
   
   DynRoot *pdpl = 0, *pdpr = 0;
 
   //decompose the path tree in order to reassemble left and right subpath separately
-  disassemble();
+  disassemble(a);
 
   if (psr)
     memset(psr, 0, sizeof(ResultSplit));
 
   //save data of the two edges where the split happens and delete from the stack
-  if (idxCostL != 0)
+  if (a.idxCostL != 0)
     if (psr) {
-      psr->costBeforeR   = stackCostL[--idxCostL];
-      psr->costBefore    = stackCostL[--idxCostL];
-      psr->mappingBefore = stackMappingL[--idxMappingL];
-      psr->dataBefore    = stackDataL[--idxDataL];
+      psr->costBeforeR   = a.stackCostL[--a.idxCostL];
+      psr->costBefore    = a.stackCostL[--a.idxCostL];
+      psr->mappingBefore = a.stackMappingL[--a.idxMappingL];
+      psr->dataBefore    = a.stackDataL[--a.idxDataL];
     }
 
-  if (idxCostR != 0) 
+  if (a.idxCostR != 0) 
     if (psr) { 
-      psr->costAfterR   = stackCostR[--idxCostR];
-      psr->costAfter    = stackCostR[--idxCostR];
-      psr->mappingAfter = stackMappingR[--idxMappingR];
-      psr->dataAfter    = stackDataR[--idxDataR];
+      psr->costAfterR   = a.stackCostR[--a.idxCostR];
+      psr->costAfter    = a.stackCostR[--a.idxCostR];
+      psr->mappingAfter = a.stackMappingR[--a.idxMappingR];
+      psr->dataAfter    = a.stackDataR[--a.idxDataR];
     }
 
-  idxRightSide--; //the calling node should not be contained in any of the two subpaths
+  a.idxRightSide--; //the calling node should not be contained in any of the two subpaths
 
   //reassemble the left and right subpath from the stack
-  reassemble(pdpl, pdpr);
+  reassemble(a, pdpl, pdpr);
 
   //return both subpaths
   if (psr) {
@@ -1760,27 +1786,27 @@ void DynLeaf::split(ResultSplit *psr) {
   
 }
 
-void DynLeaf::divide(ResultSplit *psr) {
+void DynLeaf::divide(DynArena &a, ResultSplit *psr) {
   
   DynRoot *pdpl = 0, *pdpr = 0;
 
   //decompose the path tree in order to reassemble left and right subpath separately
-  disassemble();
+  disassemble(a);
 
   if (psr)
     memset(psr, 0, sizeof(ResultSplit));
 
   //save data of the edge where the divide happens and delete from the stack
-  if (idxCostL != 0)
+  if (a.idxCostL != 0)
     if (psr) {
-      psr->costBeforeR   = stackCostL[--idxCostL];
-      psr->costBefore    = stackCostL[--idxCostL];
-      psr->mappingBefore = stackMappingL[--idxMappingL];
-      psr->dataBefore    = stackDataL[--idxDataL];
+      psr->costBeforeR   = a.stackCostL[--a.idxCostL];
+      psr->costBefore    = a.stackCostL[--a.idxCostL];
+      psr->mappingBefore = a.stackMappingL[--a.idxMappingL];
+      psr->dataBefore    = a.stackDataL[--a.idxDataL];
     }
 
   //reassemble the left and right subpath from the stack
-  reassemble(pdpl, pdpr);
+  reassemble(a, pdpl, pdpr);
 
   //return both subpaths
   if (psr) {
@@ -1791,31 +1817,30 @@ void DynLeaf::divide(ResultSplit *psr) {
 }
 
 
-DynRoot *DynLeaf::expose() {
+DynRoot *DynLeaf::expose(DynArena &a) {
 
   ResultSplit sres;
   DynRoot *pdp;
 
   //make "this" the first node in the path
-  divide(&sres); 
+  divide(a, &sres); 
   
   if (sres.leftPath) {
 
-    DynLeaf *plT = sres.leftPath->getTail();
-    plT->wParent = this;
-    plT->wCost   = sres.costBefore;
-    plT->wCostR  = sres.costBeforeR;
-    plT->setMapping(sres.mappingBefore);
-    plT->data    = sres.dataBefore;
+    sres.leftPath->getTail(a)->setWeakLink(a, this,
+					   sres.costBefore,
+					   sres.costBeforeR,
+					   sres.mappingBefore,
+					   sres.dataBefore);
 
   }
 
   pdp = sres.rightPath;
 
   //connect nodes on the root path to one path
-  while (pdp->getTail()->wParent) {
+  while (pdp->getTail(a)->cold(a).wParent) {
 
-    pdp = pdp->splice();
+    pdp = pdp->splice(a);
 
   }
 
@@ -24,14 +24,15 @@
 #define __DYNPATH_H__
 
 #include "BlockAllocator.h"
+#include <new>
 #include <memory.h>
 #include <limits.h>
 #include <float.h>
 #include <math.h>
+#include <type_traits>
 
 #include "CutPlanarDefs.h"
 
-#define STACKSIZE 100
 //#define DYNPATH_DEBUG
 
 
@@ -43,6 +44,10 @@
 class DynNode;
 class DynRoot;
 class DynLeaf;
+struct DynArena;
+
+//user defined data of an edge (e.g. its index in the graph)
+typedef PlanarIdx DynData;
 
 //returned by DynRoot::destroy()
 struct ResultDestroy {
@@ -62,17 +67,94 @@ struct ResultSplit {
   CapType  costAfterR;
   bool     mappingBefore;
   bool     mappingAfter;
-  void    *dataBefore;
-  void    *dataAfter;
+  DynData  dataBefore;
+  DynData  dataAfter;
 };
 
+//index of a node within a DynArena (0 = no node) - an arena holds less 
+//than two nodes per leaf, and there is one leaf per vertex
+typedef std::make_unsigned<PlanarIdx>::type DynIdx;
+
+//reference to a node of a DynArena, resolved by DynArena::operator[]. 
+//With a 32-bit PlanarIdx it needs half the memory of a pointer on 
+//64-bit machines.
+class DynNodeRef {
+
+  friend struct DynArena;
+
+  DynIdx idx;
+
+  explicit DynNodeRef(DynIdx i) : idx(i) {};
+
+ public:
+  DynNodeRef() : idx(0) {};
+
+  explicit operator bool() const { return idx != 0; };
+  bool operator==(DynNodeRef r) const { return idx == r.idx; };
+  bool operator!=(DynNodeRef r) const { return idx != r.idx; };
+};
+
+//weak link fields of a DynLeaf - these are rarely accessed and 
+//therefore kept apart from the nodes
+struct DynLeafCold {
+  DynLeaf *wParent; //weak parent in the DynTree
+  CapType  wCost;   //cost of the weak connection in forward direction
+  CapType  wCostR;  //cost of the weak connection in backward direction
+};
+
+//Nodes and stacks of one owner of dynamic trees (e.g. a CutPlanar
+//instance). All operations that reach other nodes than the calling one
+//take the arena holding the tree as first argument.
+//Slot 0 of the nodes is unused, the slots 1..numLeaves hold the leaves
+//(cf. DynRoot::allocLeaves()) and the remaining ones the inner nodes,
+//which are recycled via a free list.
+struct DynArena {
+  DynNode     *nodes;
+  DynData     *data;      //user data of the nodes, parallel to nodes
+  DynLeafCold *leafCold;  //weak link fields of the leaves
+  DynIdx       size;      //number of slots
+  DynIdx       top;       //first slot that has never been used
+  DynIdx       numLeaves;
+  DynNodeRef   freeList;  //first free inner node (linked by bLeft)
+  //memory is kept by allocLeaves() while large enough
+  DynIdx       capacity;  //slots backed by memory
+  size_t       bytes;     //reserved by allocPages()
+
+  //stacks for the path computations of DynLeaf - they belong to the
+  //owner of the arena and are grown by DynLeaf::growStacks() whenever a
+  //path to a root is longer than stackSize
+  int       stackSize;
+  int       idxRightSide, idxLeftSide;
+  int       idxCostR, idxCostL;
+  int       idxMappingR, idxMappingL;
+  int       idxDataR, idxDataL;
+  DynRoot **stackRightSide; //subtrees of resulting right path
+  DynRoot **stackLeftSide;  //subtrees of resulting left path
+  CapType  *stackCostR;     //costs of the temporarily deleted edges right of the split
+  CapType  *stackCostL;     //costs of the temporarily deleted edges left of the split
+  bool     *stackMappingR;  //mapping of the costs to arc / anti-arc right of the split
+  bool     *stackMappingL;  //mapping of the costs to arc / anti-arc left of the split
+  DynData  *stackDataR;     //data fields for temporarily deleted nodes right of split
+  DynData  *stackDataL;     //data fields for temporarily deleted nodes left of split
+  DynNode **stackRPath;     //path to the root (used by DynLeaf::prepareRootPath())
+
+  DynArena() { memset(this, 0, sizeof(DynArena)); top = 1; };
+
+  DynNode   *operator[](DynNodeRef r) const;
+  DynNodeRef ref(const DynNode *pn) const;
+  DynData   &dataOf(const DynNode *pn) { return data[ref(pn).idx]; };
+};
+
+
 
 
 class DynNode {
 
   unsigned char reversed;
-  
+
 public: 
+  short height;  //height of tree with root "this"
+
   //the temp flag is used by prepareRootPath to remember the
   //computed reverse states of the nodes on the path to the root
   bool getTemp() { return (reversed & TMP_MASK) != 0; };
@@ -90,29 +172,27 @@ public:
   //sets pn as the left/right child - this will only set the structural relationship!
   //no cost fields are reset or updated!
   //rState is the reversed state of the parent node
-  void setAsLChild(DynNode *pn, bool rState);
-  void setAsRChild(DynNode *pn, bool rState);
+  void setAsLChild(DynArena &a, DynNode *pn, bool rState);
+  void setAsRChild(DynArena &a, DynNode *pn, bool rState);
 
   //balancing methods for the binary path tree
-  void rotateLeft(CapType grossminU, CapType rgrossminU);
-  void rotateRight(CapType grossminU, CapType rgrossminU);
-  void doubleRotateLeft(CapType grossminU, CapType rgrossminU);
-  void doubleRotateRight(CapType grossminU, CapType rgrossminU);
+  void rotateLeft(DynArena &a, CapType grossminU, CapType rgrossminU);
+  void rotateRight(DynArena &a, CapType grossminU, CapType rgrossminU);
+  void doubleRotateLeft(DynArena &a, CapType grossminU, CapType rgrossminU);
+  void doubleRotateRight(DynArena &a, CapType grossminU, CapType rgrossminU);
 
 
   //DynRoot-fields
-  DynNode *bParent;   //strong parent in the DynRoot
-  DynNode *bHead;     //pointer to first node in the DynRoot
-  DynNode *bTail;     //pointer to last node
-  DynNode *bLeft;     //left child
-  DynNode *bRight;    //right child
-
-  void *data;  //user defined data
+  DynNodeRef bParent;   //strong parent in the DynRoot
+  DynNodeRef bHead;     //first node in the DynRoot
+  DynNodeRef bTail;     //last node
+  DynNodeRef bLeft;     //left child
+  DynNodeRef bRight;    //right child
 
   CapType netCost, netCostR; //net costs
   CapType netMin, netMinR;   //net minimal costs of an edge in the path
 
-  int height;  //height of tree with root "this"
+  //the user defined data is kept in DynArena::data
 
 #ifdef DYNPATH_DEBUG
   CapType grossMin, grossMinR;
@@ -133,11 +213,16 @@ public:
   void getNetCostPtr(CapType **pNetCost, CapType **pNetCostR, bool rState=false);
 
   //normalizes reverse state to zero while leaving the tree structure unchanged
-  void normalizeReverseState();
+  void normalizeReverseState(DynArena &a);
 
   bool isLeaf() { return !bLeft; };
 };
 
+#ifndef DYNPATH_DEBUG
+//the flags and the height share the space of one node index
+static_assert(sizeof(DynNode) == 6*sizeof(DynIdx) + 4*sizeof(CapType), 
+	      "DynNode should not contain padding");
+#endif
 
 
 
@@ -159,46 +244,59 @@ class DynRoot : private DynNode {
 
   friend class DynLeaf;  //authorize DynRoot to convert from DynNode to DynLeaf
 
-  //used in order to avoid frequent allocation and deallocation of nodes on the heap
-  static BlockAllocator<DynNode> blockAllocator;
+  static inline DynNode *allocNode(DynArena &a);
+  static inline DynNode *allocNodes(DynArena &a, PlanarIdx count); //contiguous slab or 0
+  static inline void     deallocNode(DynArena &a, DynNode *pn);
 
   //creates a new root with "this" as left and rightPath as right child
   //NOTE: does no rebalancing of resulting tree!
-  DynRoot *construct(DynRoot *rightPath, CapType cost, CapType costR, 
-		     bool revMapping=false, void *data=0);
+  DynRoot *construct(DynArena &a, DynRoot *rightPath, CapType cost, CapType costR,
+		     bool revMapping=false, DynData data=0);
 
   //used by DynLeaf::expose(): detects the next weak connection on the
   //path to the DynTree root and converts it to a strong one 
-  DynRoot *splice(); 
+  DynRoot *splice(DynArena &a);
+
+  //used by DynRootFromLeafChain(): builds the subtree over the leaves
+  //leaves[hi-numLeaves+1..hi], taking inner nodes from slab if non-zero
+  static DynNode *buildFromLeafChain(DynArena &a, DynLeaf **leaves, PlanarIdx hi, PlanarIdx numLeaves,
+				     DynNode *&slab);
 
  public:
 
   DynRoot();
 
-  static DynRoot *DynRootFromLeafChain(DynLeaf **leaves, int numLeaves);
-  static void resetBlockAllocator() { blockAllocator.reset(); };
+  //builds a balanced path from the weakly linked chain leaves[numLeaves-1..0]
+  //in O(numLeaves), leaves[0] becoming the tail
+  static DynRoot *DynRootFromLeafChain(DynArena &a, DynLeaf **leaves, PlanarIdx numLeaves);
+  //(re)creates the node arena with numLeaves leaves, freeing all nodes
+  static DynLeaf *allocLeaves(DynArena &a, PlanarIdx numLeaves);
+  //frees all inner nodes while the leaves remain valid
+  static void resetBlockAllocator(DynArena &a)
+  { a.freeList = DynNodeRef(); a.top = a.numLeaves + 1; };
+  //frees all nodes including the leaves
+  static void releaseArena(DynArena &a);
 
   unsigned int getHeight () { return height; };
-  //  void setData(void *data);
-
-  DynLeaf *getHead();
-  DynLeaf *getTail();
-  DynLeaf *getMinCostLeaf();      //get node closest to tail having minimal edge costs along path
-  void     addCost(CapType cost); //increases weights of all edges within path
-  void     reverse();             //NOTE: may be applied to the root only!
-  DynRoot *concatenate(DynRoot *rightPath, 
+
+  DynLeaf *getHead(DynArena &a);
+  DynLeaf *getTail(DynArena &a);
+  DynLeaf *getMinCostLeaf(DynArena &a); //get node closest to tail having minimal edge costs along path
+  void     addCost(CapType cost);       //increases weights of all edges within path
+  void     reverse();                   //NOTE: may be applied to the root only!
+  DynRoot *concatenate(DynArena &a, DynRoot *rightPath,
 		       CapType cost, CapType costR, 
 		       bool revMapping=false, 
-		       void *data=0); 
-  void     destroy(ResultDestroy *dr);
+		       DynData data=0);
+  void     destroy(DynArena &a, ResultDestroy *dr);
 
 
 #if defined DYNPATH_DEBUG
-  void print(bool weights = false); //prints the id fields of the leafs in order
-  bool checkCostIntegrity(); //checks on the cost field integrity of the DynRoot
-  bool checkStructuralIntegrity(); //checks on the structural integrity of the DynRoot
+  void print(DynArena &a, bool weights = false); //prints the id fields of the leafs in order
+  bool checkCostIntegrity(DynArena &a); //checks on the cost field integrity of the DynRoot
+  bool checkStructuralIntegrity(DynArena &a); //checks on the structural integrity of the DynRoot
 #endif
- 
+
 };
 
 
@@ -217,51 +315,27 @@ class DynLeaf : private DynNode {
 
   friend class DynRoot; //authorize DynLeaf to convert from DynNode to DynRoot
 
-  //DynTree-fields
-  DynLeaf *wParent; //weak parent in the DynTree
-  CapType  wCost;   //cost of the weak connection in forward direction
-  CapType  wCostR;  //cost of the weak connection in backward direction
+  //DynTree-fields (stored in DynArena::leafCold)
+  inline DynLeafCold &cold(DynArena &a);
 
-  //static stack declarations - 
-  //use a global stacks for path computations so they do not have to be 
-  //allocated for each call separately
-
-  //stack pointer
-  static int idxRightSide;
-  static int idxLeftSide;
-  static int idxCostR;
-  static int idxCostL;
-  static int idxMappingR;
-  static int idxMappingL;
-  static int idxDataL;
-  static int idxDataR;
-  static int idxRPath;
-  
-  //stacks
-  static DynRoot* stackRightSide[STACKSIZE]; //subtrees of resulting right path
-  static DynRoot* stackLeftSide[STACKSIZE];  //subtrees of resulting left path
-  static CapType  stackCostR[STACKSIZE];     //costs of the temporarily deleted edges right of the split
-  static CapType  stackCostL[STACKSIZE];     //costs of the temporarily deleted edges left of the split
-  static bool     stackMappingR[STACKSIZE];  //mapping of the costs to arc / anti-arc right of the split
-  static bool     stackMappingL[STACKSIZE];  //mapping og the costs to arc / anti-arc left of the split
-  static void*    stackDataR[STACKSIZE];     //data fields for temporarily deleted nodes right of split
-  static void*    stackDataL[STACKSIZE];     //data fields for temporarily deleted nodes left of split
-  static DynNode* stackRPath[STACKSIZE];     //path to the root (used by DynNode::prepareRootPath())
+  //doubles the stacks of the arena, keeping their contents
+  static void growStacks(DynArena &a);
+  static void freeStacks(DynArena &a);
 
  protected:
 
   //computes for each node on the path from "this" to the root 
   //the reversed state and returns grossmin(this).
   //(used by getPrev, getNext, getEdgeCost(Dbl))
-  CapType prepareRootPath();
-  void prepareRootPathDbl(CapType &grossMin, CapType &grossMinR);
+  CapType prepareRootPath(DynArena &a);
+  void prepareRootPathDbl(DynArena &a, CapType &grossMin, CapType &grossMinR);
 
   //decomposes the path tree along the path from the calling node to the root
   //and sorts the ensuing subtrees according to wether they belong to the left 
   //or right subpath
-  void disassemble();
-  //recomposes the subpath from the subtrees on the global stacks 
-  void reassemble(DynRoot*& pdpl, DynRoot*& pdpr); 
+  void disassemble(DynArena &a);
+  //recomposes the subpath from the subtrees on the stacks of the arena
+  void reassemble(DynArena &a, DynRoot*& pdpl, DynRoot*& pdpr);
   //(used by split() and divide() for convencience)
 
  public:
@@ -273,48 +347,63 @@ class DynLeaf : private DynNode {
   DynLeaf();
 
   //access to weak link fields
-  DynLeaf *getWeakParent() { return wParent; };
-  CapType  getWeakCost() { return wCost; };
-  CapType  getWeakRevCost() { return wCostR; };
-  bool     getWeakMapping() { return DynNode::getMapping(); };
-  void    *getWeakData() { return data; };
+  DynLeaf *getWeakParent(DynArena &a) { return cold(a).wParent; };
+  CapType  getWeakCost(DynArena &a) { return cold(a).wCost; };
+  CapType  getWeakRevCost(DynArena &a) { return cold(a).wCostR; };
+  bool     getWeakMapping(DynArena &) { return DynNode::getMapping(); };
+  DynData  getWeakData(DynArena &a) { return a.dataOf(this); };
 
-  void setWeakLink(DynLeaf *parent, 
+  void setWeakLink(DynArena &a, DynLeaf *parent,
 		   CapType cap, CapType rcap, 
 		   bool mapping,
-		   void *linkData);
-
-  DynRoot *getPath();  //returns the path containing the calling node
-  DynLeaf *getNext();  //returns the next node on the DynTree-path
-  DynLeaf *getPrevDyn(); //return the previous node if it is on the same DynPath
-  DynLeaf *getNextDyn(); //return the next node if it is on the same DynPath
-  CapType  getEdgeCost();  //returns the cost of the edge after the calling node
-  bool     getEdgeCostDbl(CapType &cost, CapType &costR);
+		   DynData linkData);
+
+  DynRoot *getPath(DynArena &a);  //returns the path containing the calling node
+  DynLeaf *getNext(DynArena &a);  //returns the next node on the DynTree-path
+  DynLeaf *getPrevDyn(DynArena &a); //return the previous node if it is on the same DynPath
+  DynLeaf *getNextDyn(DynArena &a); //return the next node if it is on the same DynPath
+  CapType  getEdgeCost(DynArena &a);  //returns the cost of the edge after the calling node
+  bool     getEdgeCostDbl(DynArena &a, CapType &cost, CapType &costR);
   //splits the path (of which the calling node is part of) in three
   //subpaths: the first path contains all nodes to the left of the calling
   //node, the second path is the calling node itself and the third part
   //consists of the remaining nodes
-  void split(ResultSplit *psr); 
+  void split(DynArena &a, ResultSplit *psr);
   //divides the path at the calling node, with the calling node 
   //ending up in the right part
-  void divide(ResultSplit *psr);
-  
+  void divide(DynArena &a, ResultSplit *psr);
+
   //makes sure the path from the calling node to the root of the
   //DynTREE has no weak connections (i.e. it is a single a DynRoot) 
-  DynRoot *expose();
+  DynRoot *expose(DynArena &a);
 
 };
 
+/***************************************************
+ *** DynArena INLINE *******************************
+ ***************************************************/
+inline DynNode *DynArena::operator[](DynNodeRef r) const {
+  return r.idx ? nodes + r.idx : 0;
+}
+
+
+inline DynNodeRef DynArena::ref(const DynNode *pn) const {
+  return DynNodeRef(pn ? DynIdx(pn - nodes) : 0);
+}
+
 /***************************************************
  *** DynNode INLINE ********************************
  ***************************************************/
-inline void DynNode::setAsLChild(DynNode *pn, bool rState) {
-  DynNode *newHead;
+inline void DynNode::setAsLChild(DynArena &a, DynNode *pn, bool rState) {
+  DynNodeRef newHead;
 
-  this->bLeft = pn;
-  pn->bParent = this;
-  
-  newHead = pn->isLeaf()?pn:((pn->getReversed()==rState)?pn->bHead:pn->bTail);
+  this->bLeft = a.ref(pn);
+  pn->bParent = a.ref(this);
+
+  if (pn->isLeaf())
+    newHead = this->bLeft;
+  else
+    newHead = (pn->getReversed()==rState)?pn->bHead:pn->bTail;
 
   if (rState)
     this->bTail = newHead;
@@ -323,14 +412,17 @@ inline void DynNode::setAsLChild(DynNode *pn, bool rState) {
 }
 
 
-inline void DynNode::setAsRChild(DynNode *pn, bool rState) {
-  DynNode *newTail;
+inline void DynNode::setAsRChild(DynArena &a, DynNode *pn, bool rState) {
+  DynNodeRef newTail;
+
+  this->bRight = a.ref(pn);
+  pn->bParent  = a.ref(this);
 
-  this->bRight = pn;
-  pn->bParent  = this;
+  if (pn->isLeaf())
+    newTail = this->bRight;
+  else
+    newTail = (pn->getReversed()==rState)?pn->bTail:pn->bHead;
 
-  newTail = pn->isLeaf()?pn:((pn->getReversed()==rState)?pn->bTail:pn->bHead);
-    
   if (rState)
     this->bHead = newTail;
   else
@@ -353,7 +445,7 @@ inline void DynNode::setNetCost(CapType netCost, bool rState) {
     this->netCost = netCost;
 }
 
-  
+
 inline void DynNode::getNetMinPtr(CapType **pNetMin, CapType **pNetMinR, bool rState) {
   rState ^= getReversed();
 
@@ -381,19 +473,19 @@ inline void DynNode::getNetCostPtr(CapType **pNetCost, CapType **pNetCostR, bool
 
 
 
-inline void DynNode::normalizeReverseState() {
+inline void DynNode::normalizeReverseState(DynArena &a) {
   if (!getReversed()) return; //is normalized already
 
   setReversed(false);
   setMapping(!getMapping());
 
-  DynNode *pn = bLeft;
+  DynNodeRef r = bLeft;
   bLeft = bRight;
-  bRight = pn;
+  bRight = r;
 
-  pn = bHead;
+  r = bHead;
   bHead = bTail;
-  bTail = pn;
+  bTail = r;
 
   CapType c = netMin;
   netMin = netMinR;
@@ -404,35 +496,37 @@ inline void DynNode::normalizeReverseState() {
   netCostR = c;
 
   //keep reversed state for children
-  if (bRight && !bRight->isLeaf())
-    bRight->setReversed(bRight->getReversed() ^ 1);
+  DynNode *pn = a[bRight];
+  if (pn && !pn->isLeaf())
+    pn->setReversed(pn->getReversed() ^ 1);
 
-  if (bLeft && !bLeft->isLeaf())
-    bLeft->setReversed(bLeft->getReversed() ^ 1);
+  pn = a[bLeft];
+  if (pn && !pn->isLeaf())
+    pn->setReversed(pn->getReversed() ^ 1);
 }
 
 /***************************************************
  *** DynRoot INLINE ********************************
  ***************************************************/
-inline DynLeaf *DynRoot::getHead() {
+inline DynLeaf *DynRoot::getHead(DynArena &a) {
   if (isLeaf())
     return static_cast<DynLeaf*>(static_cast<DynNode*>(this));
 
   if (getReversed())
-    return static_cast<DynLeaf*>(bTail);
-  
-  return static_cast<DynLeaf*>(bHead);
+    return static_cast<DynLeaf*>(a[bTail]);
+
+  return static_cast<DynLeaf*>(a[bHead]);
 }
 
 
-inline DynLeaf *DynRoot::getTail() {
+inline DynLeaf *DynRoot::getTail(DynArena &a) {
   if (isLeaf())
     return static_cast<DynLeaf*>(static_cast<DynNode*>(this));
 
   if (getReversed())
-    return static_cast<DynLeaf*>(bHead);
+    return static_cast<DynLeaf*>(a[bHead]);
 
-  return static_cast<DynLeaf*>(bTail);
+  return static_cast<DynLeaf*>(a[bTail]);
 }
 
 
@@ -454,33 +548,72 @@ inline void DynRoot::reverse() {
     setReversed(!getReversed());
 }
 
+inline DynNode *DynRoot::allocNode(DynArena &a) {
+  DynNode *pn;
+
+  if (a.freeList) {
+    pn = a[a.freeList];
+    a.freeList = pn->bLeft;
+    return pn;
+  }
+
+  //a forest of n leaves never needs more than n-1 inner nodes
+  if (a.top >= a.size)
+    throw std::bad_alloc();
+
+  return new (a.nodes + a.top++) DynNode;
+}
+
+
+inline DynNode *DynRoot::allocNodes(DynArena &a, PlanarIdx count) {
+
+  //only slots that have never been used are contiguous
+  if (count <= 0 || a.top + DynIdx(count) > a.size)
+    return 0;
+
+  DynNode *pn = a.nodes + a.top;
+  for (PlanarIdx i=0; i<count; i++)
+    new (pn + i) DynNode;
+  a.top += count;
+
+  return pn;
+}
+
+
+inline void DynRoot::deallocNode(DynArena &a, DynNode *pn) {
+  pn->bLeft  = a.freeList;
+  a.freeList = a.ref(pn);
+}
+
 /***************************************************
  *** DynLeaf INLINE ********************************
  ***************************************************/
 
-inline DynLeaf *DynLeaf::getNext() {
-//std::cout  <<"  [<" << this << ">::getNext():] Entering\n";   
-  
+inline DynLeafCold &DynLeaf::cold(DynArena &a) {
+  return a.leafCold[static_cast<DynNode*>(this) - a.nodes];
+}
+
+inline DynLeaf *DynLeaf::getNext(DynArena &a) {
+
   DynLeaf *pl;
 
-  pl = getNextDyn();
-//std::cout  <<"  [<" << this << ">::getNext():] getNextDyn: "<<pl<<"\n";   
+  pl = getNextDyn(a);
 
   if (!pl) //this leaf is tail of the DynPath it belongs to
-    return wParent;
+    return cold(a).wParent;
 
   return pl;
 
 }
 
-inline DynLeaf *DynLeaf::getPrevDyn() {
+inline DynLeaf *DynLeaf::getPrevDyn(DynArena &a) {
 
-  DynNode *pn, *pnSib, *rChild = 0;
+  DynNode *pn, *pnP, *pnSib, *rChild = 0;
   DynLeaf *prevLeaf = 0;
   bool parentRState = false, lChildRState = false;
   bool found = false;
 
-  prepareRootPath();
+  prepareRootPath(a);
 
   //on the path to the root, search for the first node being the right child of its parent
   pn = this;
@@ -488,17 +621,18 @@ inline DynLeaf *DynLeaf::getPrevDyn() {
   while (!found && pn->bParent) {
 
     //is pn the right child of its parent?
-    parentRState = pn->bParent->getTemp();
+    pnP = a[pn->bParent];
+    parentRState = pnP->getTemp();
 
     if (parentRState)  //check reversed state
-      rChild = pn->bParent->bLeft;
+      rChild = a[pnP->bLeft];
     else
-      rChild = pn->bParent->bRight;
+      rChild = a[pnP->bRight];
 
     if (rChild == pn)
       found = true;
 
-    pn = pn->bParent;
+    pn = pnP;
 
   }
 
@@ -507,18 +641,18 @@ inline DynLeaf *DynLeaf::getPrevDyn() {
 
   //determine sibling of pn
   if (parentRState)
-    pnSib = pn->bRight;
+    pnSib = a[pn->bRight];
   else
-    pnSib = pn->bLeft;
+    pnSib = a[pn->bLeft];
 
   lChildRState = pnSib->getReversed() ^ parentRState;
-  
+
   //the previous node on the path is the tail of the subpath of which 
   //the sibling is the root node
   if (lChildRState) 
-    prevLeaf = static_cast<DynLeaf*>(pnSib->bHead);
+    prevLeaf = static_cast<DynLeaf*>(a[pnSib->bHead]);
   else
-    prevLeaf = static_cast<DynLeaf*>(pnSib->bTail);
+    prevLeaf = static_cast<DynLeaf*>(a[pnSib->bTail]);
 
   if (!prevLeaf)
     return static_cast<DynLeaf*>(pnSib); 
@@ -527,31 +661,32 @@ inline DynLeaf *DynLeaf::getPrevDyn() {
 
 }
 
-inline DynLeaf *DynLeaf::getNextDyn() {
+inline DynLeaf *DynLeaf::getNextDyn(DynArena &a) {
 
-  DynNode *pn, *pnSib, *lChild = 0;
+  DynNode *pn, *pnP, *pnSib, *lChild = 0;
   DynLeaf *nextLeaf = 0;
   bool parentRState = false, lChildRState = false;
   bool found = false;
 
-  prepareRootPath();
+  prepareRootPath(a);
   pn = this;
 
   //search for first node on the path to the root being left child of its parent
   while (!found && pn->bParent) {
 
     //is pn the left child of its parent?
-    parentRState = pn->bParent->getTemp();
+    pnP = a[pn->bParent];
+    parentRState = pnP->getTemp();
 
     if (parentRState) //check reversed state
-      lChild = pn->bParent->bRight;
+      lChild = a[pnP->bRight];
     else
-      lChild = pn->bParent->bLeft;
+      lChild = a[pnP->bLeft];
 
     if (lChild == pn)
       found = true;
 
-    pn = pn->bParent;
+    pn = pnP;
 
   }
 
@@ -560,18 +695,18 @@ inline DynLeaf *DynLeaf::getNextDyn() {
 
   //determine sibling of pn
   if (parentRState)
-    pnSib = pn->bLeft;
+    pnSib = a[pn->bLeft];
   else
-    pnSib = pn->bRight;
+    pnSib = a[pn->bRight];
 
   lChildRState = pnSib->getReversed() ^ parentRState;
 
   //the next node on the path is the head of the subpath of which 
   //the sibling is the root node
   if (lChildRState) 
-    nextLeaf = static_cast<DynLeaf*>(pnSib->bTail);
+    nextLeaf = static_cast<DynLeaf*>(a[pnSib->bTail]);
   else
-    nextLeaf = static_cast<DynLeaf*>(pnSib->bHead);
+    nextLeaf = static_cast<DynLeaf*>(a[pnSib->bHead]);
 
   if (!nextLeaf)
     return static_cast<DynLeaf*>(pnSib); 
@@ -582,27 +717,27 @@ inline DynLeaf *DynLeaf::getNextDyn() {
 
 
 
-inline CapType DynLeaf::getEdgeCost() {
+inline CapType DynLeaf::getEdgeCost(DynArena &a) {
 
   DynNode *pn = this, *ch, *lChild = 0;
   bool parentRState = false;
   bool found = false;
 
   //prepare path to the root node
-  CapType grossMin = prepareRootPath();
+  CapType grossMin = prepareRootPath(a);
 
   //on the path to the root, search for the first node being the left child of its parent
   while (!found && pn->bParent) {
-    parentRState = pn->bParent->getTemp();
+    ch = pn;
+    pn = a[pn->bParent];
+    parentRState = pn->getTemp();
     if (parentRState) //reversed state == true?
-      lChild = pn->bParent->bRight;
+      lChild = a[pn->bRight];
     else
-      lChild = pn->bParent->bLeft;
-    //is pn left child of its parent?
-    if (lChild == pn)
+      lChild = a[pn->bLeft];
+    //is ch left child of its parent?
+    if (lChild == ch)
       found = true;
-    ch = pn;
-    pn = pn->bParent;
 
     //compute grossMin for current node
     if (!pn->bParent) //root node
@@ -618,11 +753,11 @@ inline CapType DynLeaf::getEdgeCost() {
 }
 
 
-inline bool DynLeaf::getEdgeCostDbl(CapType &cost, CapType &costR) {
+inline bool DynLeaf::getEdgeCostDbl(DynArena &a, CapType &cost, CapType &costR) {
 
   //prepare path to the root node
   CapType grossMin, grossMinR;
-  prepareRootPathDbl(grossMin, grossMinR);
+  prepareRootPathDbl(a, grossMin, grossMinR);
 
   DynNode *pn = this, *ch, *lChild = 0;
   bool parentRState = false;
@@ -631,19 +766,18 @@ inline bool DynLeaf::getEdgeCostDbl(CapType &cost, CapType &costR) {
   //on the path to the root, search for the first node being the left child of its parent
   while (!found && pn->bParent) {
 
-    parentRState = pn->bParent->getTemp();
+    ch = pn;
+    pn = a[pn->bParent];
+    parentRState = pn->getTemp();
 
     if (parentRState) //reversed-state == true?
-      lChild = pn->bParent->bRight;
+      lChild = a[pn->bRight];
     else
-      lChild = pn->bParent->bLeft;
+      lChild = a[pn->bLeft];
 
-    if (lChild == pn)
+    if (lChild == ch)
       found = true;
 
-    ch = pn;
-    pn = pn->bParent;
-
     //compute grossMin for current node
     if (!pn->bParent) { //root node
       grossMin  = pn->getNetMin(pn->getTemp());
@@ -667,4 +801,22 @@ inline bool DynLeaf::getEdgeCostDbl(CapType &cost, CapType &costR) {
 
 }
 
+/***************************************************
+ *** DynPathTree ***********************************
+ ***************************************************/
+
+//dynamic tree backend of CutPlanarT (cf. CutPlanar.h)
+struct DynPathTree {
+  typedef DynLeaf     Leaf;
+  typedef DynRoot     Root;
+  typedef ResultSplit Split;
+  typedef DynArena    Arena;
+
+  static Leaf *allocLeaves(Arena &a, PlanarIdx numLeaves) { return DynRoot::allocLeaves(a, numLeaves); };
+  static void  releaseArena(Arena &a) { DynRoot::releaseArena(a); };
+  static void  resetBlockAllocator(Arena &a) { DynRoot::resetBlockAllocator(a); };
+  static Root *rootFromLeafChain(Arena &a, Leaf **leaves, PlanarIdx numLeaves)
+  { return DynRoot::DynRootFromLeafChain(a, leaves, numLeaves); };
+};
+
 #endif
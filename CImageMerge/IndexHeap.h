@@ -0,0 +1,423 @@
+/*****************************************************************************
+*    PlanarCut - software to compute MinCut / MaxFlow in a planar graph      *
+*                              Version 1.0.2                                 *
+*                                                                            *
+*    Copyright 2011 - 2013 Eno Töppe <toeppe@in.tum.de>                      *
+*                          Frank R. Schmidt <info@frank-r-schmidt.de>        *
+******************************************************************************
+
+  If you use this software for research purposes, YOU MUST CITE the following 
+  paper in any resulting publication:
+
+    [1] Efficient Planar Graph Cuts with Applications in Computer Vision.
+        F. R. Schmidt, E. Töppe, D. Cremers, 
+	    IEEE CVPR, Miami, Florida, June 2009		
+
+******************************************************************************
+
+  This software is released under the LGPL license. Details are explained
+  in the files 'COPYING' and 'COPYING.LESSER'.
+	
+*****************************************************************************/
+
+#ifndef __INDEXHEAP_H__
+#define __INDEXHEAP_H__
+
+#include "CutPlanarDefs.h"
+#include <vector>
+
+//Priority queues over the integers 0..maxHeapSize-1 used for shortest
+//path computations. All of them share the same interface, so that they 
+//can be passed as template argument (cf. CutPlanar::runDualDijkstra()):
+//
+//  insert(idx, key)   - inserts idx, which must not be contained
+//  decrease(idx, key) - lowers the key of the contained idx
+//  deleteMin(idx)     - removes the element with minimal key, 
+//                       returns false if the heap is empty
+//  contains(idx)      - whether idx is currently contained
+//
+//The type of the integers is given by the template argument Idx.
+
+
+
+/********************************************************************
+     DAryHeap
+********************************************************************/
+
+//D-ary min-heap keeping the (key, index) pairs inline in a single array
+//pos[] maps an index to its position in the heap (-1 if absent)
+template<int D, class Idx = int>
+class DAryHeap {
+
+  struct Entry {
+    CapType key;
+    Idx     idx;
+  };
+
+  Entry *heap;
+  Idx   *pos;
+
+  Idx maxIdx;
+
+  inline void ascend(Idx heapId);
+  inline void descend(Idx heapId);
+
+ public:
+
+  DAryHeap(Idx maxHeapSize);
+  ~DAryHeap();
+
+  inline void insert(Idx idx, CapType key);
+  inline void decrease(Idx idx, CapType key);
+  inline bool deleteMin(Idx &idx);
+  bool contains(Idx idx) { return pos[idx] >= 0; }
+  bool isempty()         { return (maxIdx == 0); }
+};
+
+
+
+/********************************************************************
+     RadixHeap
+********************************************************************/
+
+//monotone radix heap for non-negative integral keys < 2^63: the key of
+//an inserted element must not be smaller than the last extracted one.
+//Elements are kept in buckets according to the highest bit in which
+//their key differs from the last extracted key. decrease() inserts a 
+//new entry, outdated entries are skipped lazily.
+template<class Idx = int>
+class RadixHeapT {
+
+  typedef unsigned long long Key;
+
+  struct Entry {
+    Key key;
+    Idx idx;
+  };
+
+  std::vector<Entry> buckets[65];
+
+  Key *keys;   //current key of each index
+  bool *inHeap;
+
+  Key last;    //last extracted key
+  Idx  num;    //number of contained indices
+
+  //bucket of key k w.r.t. last
+  inline int getBucket(Key k);
+
+ public:
+
+  RadixHeapT(Idx maxHeapSize);
+  ~RadixHeapT();
+
+  inline void insert(Idx idx, CapType key);
+  inline void decrease(Idx idx, CapType key);
+  inline bool deleteMin(Idx &idx);
+  bool contains(Idx idx) { return inHeap[idx]; }
+  bool isempty()         { return (num == 0); }
+
+  //whether a key can be handled by RadixHeap
+  static bool isValidKey(CapType key) 
+  { return key >= 0 && key < 9.0e15 && key == (CapType)(Key)key; }
+};
+
+typedef RadixHeapT<> RadixHeap;
+
+
+
+
+
+
+
+/********************************************************************
+     DAryHeap - implementation
+********************************************************************/
+
+template<int D, class Idx>
+DAryHeap<D, Idx>::DAryHeap(Idx maxHeapSize) : maxIdx(0) {
+
+  heap = new Entry[maxHeapSize];
+  pos  = new Idx[maxHeapSize];
+
+  for (Idx i=0; i<maxHeapSize; i++)
+    pos[i] = -1;
+
+}
+
+
+
+template<int D, class Idx>
+DAryHeap<D, Idx>::~DAryHeap() {
+
+  delete [] heap;
+  delete [] pos;
+
+}
+
+
+
+template<int D, class Idx>
+inline void DAryHeap<D, Idx>::ascend(Idx heapId) {
+
+  Entry e = heap[heapId];
+  Idx cIdx = heapId;
+  Idx pIdx;
+
+  //let the element bubble up as far as possible
+  while (cIdx > 0) {
+
+    pIdx = (cIdx-1) / D;
+
+    if (!(heap[pIdx].key > e.key))
+      break;
+
+    heap[cIdx] = heap[pIdx];
+    pos[heap[cIdx].idx] = cIdx;
+
+    cIdx = pIdx;
+
+  }
+
+  heap[cIdx] = e;
+  pos[e.idx] = cIdx;
+
+}
+
+
+
+template<int D, class Idx>
+inline void DAryHeap<D, Idx>::descend(Idx heapId) {
+
+  Entry e = heap[heapId];
+  Idx cIdx = heapId;
+  Idx fIdx, lIdx, pIdx, i;
+
+  while (true) {
+
+    fIdx = D*cIdx + 1; //first child
+
+    if (fIdx >= maxIdx)
+      break;
+
+    lIdx = fIdx + D;   //behind the last child
+    if (lIdx > maxIdx)
+      lIdx = maxIdx;
+
+    //find the child with minimal key
+    pIdx = fIdx;
+    for (i=fIdx+1; i<lIdx; i++)
+      if (heap[i].key < heap[pIdx].key)
+	pIdx = i;
+
+    if (!(e.key > heap[pIdx].key))
+      break;
+
+    heap[cIdx] = heap[pIdx];
+    pos[heap[cIdx].idx] = cIdx;
+
+    cIdx = pIdx;
+
+  }
+
+  heap[cIdx] = e;
+  pos[e.idx] = cIdx;
+
+}
+
+
+
+template<int D, class Idx>
+inline void DAryHeap<D, Idx>::insert(Idx idx, CapType key) {
+
+  heap[maxIdx].key = key;
+  heap[maxIdx].idx = idx;
+  maxIdx++;
+  ascend(maxIdx-1);
+
+}
+
+
+
+template<int D, class Idx>
+inline void DAryHeap<D, Idx>::decrease(Idx idx, CapType key) {
+
+  heap[pos[idx]].key = key;
+  ascend(pos[idx]);
+
+}
+
+
+
+template<int D, class Idx>
+inline bool DAryHeap<D, Idx>::deleteMin(Idx &idx) {
+
+  if (maxIdx == 0) //heap empty?
+    return false;
+
+  idx = heap[0].idx;
+  pos[idx] = -1;
+
+  if (--maxIdx == 0) //heap empty now?
+    return true;
+
+  heap[0] = heap[maxIdx];
+  descend(0);
+
+  return true;
+
+}
+
+
+
+
+
+
+
+/********************************************************************
+     RadixHeap - implementation
+********************************************************************/
+
+template<class Idx>
+inline RadixHeapT<Idx>::RadixHeapT(Idx maxHeapSize) : last(0), num(0) {
+
+  keys   = new Key[maxHeapSize];
+  inHeap = new bool[maxHeapSize];
+
+  for (Idx i=0; i<maxHeapSize; i++)
+    inHeap[i] = false;
+
+}
+
+
+
+template<class Idx>
+inline RadixHeapT<Idx>::~RadixHeapT() {
+
+  delete [] keys;
+  delete [] inHeap;
+
+}
+
+
+
+template<class Idx>
+inline int RadixHeapT<Idx>::getBucket(Key k) {
+
+  Key x = k ^ last;
+  int b = 0;
+
+  if (!x)
+    return 0;
+
+  //position of the highest set bit (1-based)
+  if (x >> 32) { b += 32; x >>= 32; }
+  if (x >> 16) { b += 16; x >>= 16; }
+  if (x >> 8)  { b += 8;  x >>= 8;  }
+  if (x >> 4)  { b += 4;  x >>= 4;  }
+  if (x >> 2)  { b += 2;  x >>= 2;  }
+  if (x >> 1)  { b += 1;  x >>= 1;  }
+
+  return b + 1;
+
+}
+
+
+
+template<class Idx>
+inline void RadixHeapT<Idx>::insert(Idx idx, CapType key) {
+
+  Entry e;
+  e.key = (Key)key;
+  e.idx = idx;
+
+  keys[idx]   = e.key;
+  inHeap[idx] = true;
+  num++;
+
+  buckets[getBucket(e.key)].push_back(e);
+
+}
+
+
+
+template<class Idx>
+inline void RadixHeapT<Idx>::decrease(Idx idx, CapType key) {
+
+  Entry e;
+  e.key = (Key)key;
+  e.idx = idx;
+
+  //the old entry remains in its bucket and is skipped later
+  keys[idx] = e.key;
+
+  buckets[getBucket(e.key)].push_back(e);
+
+}
+
+
+
+template<class Idx>
+inline bool RadixHeapT<Idx>::deleteMin(Idx &idx) {
+
+  std::vector<Entry> *b = buckets;
+  Key minKey;
+  int i;
+  size_t j;
+
+  if (num == 0) //heap empty?
+    return false;
+
+  while (true) {
+
+    //bucket 0 only holds keys equal to last
+    while (!b->empty()) {
+      Entry e = b->back();
+      b->pop_back();
+
+      if (inHeap[e.idx] && keys[e.idx] == e.key) {
+	idx = e.idx;
+	inHeap[idx] = false;
+	num--;
+	return true;
+      }
+    }
+
+    //find the first non-empty bucket and its minimal valid key
+    for (i=1; i<65; i++) {
+
+      minKey = 0;
+      bool found = false;
+
+      for (j=0; j<buckets[i].size(); j++) {
+	Entry &e = buckets[i][j];
+	if (inHeap[e.idx] && keys[e.idx] == e.key &&
+	    (!found || e.key < minKey)) {
+	  minKey = e.key;
+	  found  = true;
+	}
+      }
+
+      if (found)
+	break;
+
+      buckets[i].clear(); //only outdated entries
+    }
+
+    //redistribute the bucket w.r.t. the new minimum
+    last = minKey;
+
+    for (j=0; j<buckets[i].size(); j++) {
+      Entry &e = buckets[i][j];
+      if (inHeap[e.idx] && keys[e.idx] == e.key)
+	buckets[getBucket(e.key)].push_back(e);
+    }
+
+    buckets[i].clear();
+
+  }
+
+}
+
+
+#endif //#ifndef __INDEXHEAP_H__
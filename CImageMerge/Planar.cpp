@@ -59,14 +59,14 @@ void PlanarEdge::setEdge(PlanarVertex *tail,     PlanarVertex *head,     \
     // Depending on the order of the calls setEdgesCCW() and setEdge(), 
     // the respective Edge Ids of tail and head still have to be set
     if (tailEdgeID < 0 && tail)
-      for (int i=0; i<tail->nEdges; i++)
+      for (PlanarIdx i=0; i<tail->nEdges; i++)
 	if (tail->edgesCCW[i] == this) { 
 	  tailEdgeID = i;
 	  break;
 	}
 	  
     if (headEdgeID < 0 && head)
-      for (int i=0; i<head->nEdges; i++)
+      for (PlanarIdx i=0; i<head->nEdges; i++)
 	if (head->edgesCCW[i] == this) { 
 	  headEdgeID = i;
 	  break;
@@ -92,3 +92,116 @@ PlanarVertex::~PlanarVertex() {
 
 }
 
+
+
+/***************************************************
+ *** PlanarGraph ***********************************
+ ***************************************************/
+
+PlanarGraph::PlanarGraph() : nVerts(0), nEdges(0), nFaces(0),
+			     cap(0), rcap(0), tail(0), head(0),
+			     tailDual(0), headDual(0),
+			     tailEdgeID(0), headEdgeID(0), flags(0),
+			     firstEdge(0), edgesCCW(0)
+{
+}
+
+
+PlanarGraph::~PlanarGraph() {
+
+  release();
+
+}
+
+
+void PlanarGraph::build(PlanarIdx numVerts, PlanarVertex *vertexList,
+			PlanarIdx numEdges, PlanarEdge   *edgeList,
+			PlanarIdx numFaces, PlanarFace   *faceList) {
+
+  PlanarIdx v, e, i, n;
+
+  release();
+
+  nVerts = numVerts;
+  nEdges = numEdges;
+  nFaces = numFaces;
+
+  cap        = new CapType[nEdges];
+  rcap       = new CapType[nEdges];
+  tail       = new PlanarIdx[nEdges];
+  head       = new PlanarIdx[nEdges];
+  tailDual   = new PlanarIdx[nEdges];
+  headDual   = new PlanarIdx[nEdges];
+  tailEdgeID = new PlanarIdx[nEdges];
+  headEdgeID = new PlanarIdx[nEdges];
+  flags      = new uchar[nEdges];
+
+  for (e=0; e<nEdges; e++) {
+    PlanarEdge *pe = edgeList + e;
+    cap[e]        = pe->getCapacity();
+    rcap[e]       = pe->getRevCapacity();
+    tail[e]       = pe->getTail() - vertexList;
+    head[e]       = pe->getHead() - vertexList;
+    tailDual[e]   = pe->getTailDual() - faceList;
+    headDual[e]   = pe->getHeadDual() - faceList;
+    tailEdgeID[e] = -1;
+    headEdgeID[e] = -1;
+    flags[e]      = 0;
+  }
+
+  firstEdge = new PlanarIdx[nVerts+1];
+  firstEdge[0] = 0;
+  for (v=0; v<nVerts; v++)
+    firstEdge[v+1] = firstEdge[v] + vertexList[v].getNumEdges();
+
+  edgesCCW = new PlanarIdx[firstEdge[nVerts]];
+
+  //the edge IDs are assigned as by PlanarVertex::setEdgesCCW()
+  for (v=0; v<nVerts; v++) {
+    n = vertexList[v].getNumEdges();
+    for (i=0; i<n; i++) {
+      e = vertexList[v].getEdge(i) - edgeList;
+      edgesCCW[firstEdge[v] + i] = e;
+      if (tail[e] == v)
+	tailEdgeID[e] = i;
+      else if (head[e] == v)
+	headEdgeID[e] = i;
+    }
+  }
+
+}
+
+
+void PlanarGraph::release() {
+
+  if (cap)
+    delete [] cap;
+  if (rcap)
+    delete [] rcap;
+  if (tail)
+    delete [] tail;
+  if (head)
+    delete [] head;
+  if (tailDual)
+    delete [] tailDual;
+  if (headDual)
+    delete [] headDual;
+  if (tailEdgeID)
+    delete [] tailEdgeID;
+  if (headEdgeID)
+    delete [] headEdgeID;
+  if (flags)
+    delete [] flags;
+  if (firstEdge)
+    delete [] firstEdge;
+  if (edgesCCW)
+    delete [] edgesCCW;
+
+  cap = rcap = 0;
+  tail = head = tailDual = headDual = tailEdgeID = headEdgeID = 0;
+  flags = 0;
+  firstEdge = edgesCCW = 0;
+  nVerts = nEdges = nFaces = 0;
+
+}
+
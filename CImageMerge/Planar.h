@@ -45,8 +45,8 @@ class PlanarEdge
     PlanarFace   *headDual; //the face right of the edge wrt. the pointing direction
 
     //these are for fast access to edge IDs
-    int tailEdgeID; //the ID of this edge with respect to the tail vertex
-    int headEdgeID; //the ID of this edge with respect to the head vertex
+    PlanarIdx tailEdgeID; //the ID of this edge with respect to the tail vertex
+    PlanarIdx headEdgeID; //the ID of this edge with respect to the head vertex
 
     uchar  flags; //a maximum of 8 flags that can be used freely
 
@@ -78,24 +78,70 @@ class PlanarVertex
 {
   friend class PlanarEdge; //for efficiency vertex and edge are closely connected
 
-  int nEdges;             //number of adjacent edges
+  PlanarIdx nEdges;       //number of adjacent edges
   PlanarEdge **edgesCCW;  //ccw list of adjacent edges
 
  public:
   PlanarVertex();
   ~PlanarVertex();
   
-  int         getNumEdges() { return nEdges; };
-  PlanarEdge *getEdge(int id) { id=id%nEdges; return (id<0)?edgesCCW[id+nEdges]:edgesCCW[id]; };
-  inline void setEdgesCCW(PlanarEdge **ccw, int nEdges);
-  inline int  getEdgeID(PlanarEdge *e);
+  PlanarIdx   getNumEdges() { return nEdges; };
+  PlanarEdge *getEdge(PlanarIdx id) { id=id%nEdges; return (id<0)?edgesCCW[id+nEdges]:edgesCCW[id]; };
+  inline void setEdgesCCW(PlanarEdge **ccw, PlanarIdx nEdges);
+  inline PlanarIdx getEdgeID(PlanarEdge *e);
+};
+
+
+//Compact form of the planar graph given by arrays of PlanarVertex, 
+//PlanarEdge and PlanarFace objects. Each property of the edges is kept
+//in an array of its own and vertices and faces are referred to by 
+//their indices, so that a pass over the edges only reads what it needs.
+//CutPlanarT works on this form, while the objects above remain the 
+//interface to the user.
+class PlanarGraph
+{
+ public:
+  PlanarIdx nVerts;
+  PlanarIdx nEdges;
+  PlanarIdx nFaces;
+
+  //edges
+  CapType   *cap;        //forward edge capacities
+  CapType   *rcap;       //backward edge capacities
+  PlanarIdx *tail;       //vertex indices
+  PlanarIdx *head;
+  PlanarIdx *tailDual;   //face indices
+  PlanarIdx *headDual;
+  PlanarIdx *tailEdgeID; //position of the edge in the ccw list of the tail
+  PlanarIdx *headEdgeID; //position of the edge in the ccw list of the head
+  uchar     *flags;
+
+  //ccw list of the edges of vertex v: edgesCCW[firstEdge[v]..firstEdge[v+1]-1]
+  PlanarIdx *firstEdge;
+  PlanarIdx *edgesCCW;
+
+  PlanarGraph();
+  ~PlanarGraph();
+
+  //copies the graph, all flags are set to zero
+  void build(PlanarIdx numVerts, PlanarVertex *vertexList,
+	     PlanarIdx numEdges, PlanarEdge   *edgeList,
+	     PlanarIdx numFaces, PlanarFace   *faceList);
+  void release();
+
+  //cf. PlanarVertex
+  PlanarIdx getNumEdges(PlanarIdx v) { return firstEdge[v+1] - firstEdge[v]; };
+  PlanarIdx getEdge(PlanarIdx v, PlanarIdx id) 
+  { PlanarIdx n = getNumEdges(v); id=id%n; return edgesCCW[firstEdge[v] + ((id<0)?id+n:id)]; };
+  PlanarIdx getEdgeID(PlanarIdx v, PlanarIdx e)
+  { return (tail[e] == v) ? tailEdgeID[e] : ((head[e] == v) ? headEdgeID[e] : -1); };
 };
 
 
 /***************************************************
  *** PlanarVertex INLINE ***************************
  ***************************************************/
-void PlanarVertex::setEdgesCCW(PlanarEdge **ccw, int nEdges) {
+void PlanarVertex::setEdgesCCW(PlanarEdge **ccw, PlanarIdx nEdges) {
 
   if (nEdges != this->nEdges) {
     if (this->nEdges)
@@ -104,7 +150,7 @@ void PlanarVertex::setEdgesCCW(PlanarEdge **ccw, int nEdges) {
       edgesCCW = new PlanarEdge*[nEdges];
     this->nEdges = nEdges;
   }
-  for (int i=0; i<nEdges; i++) {
+  for (PlanarIdx i=0; i<nEdges; i++) {
     edgesCCW[i] = ccw[i];
     if (edgesCCW[i]->getTail() == this)
       edgesCCW[i]->tailEdgeID = i;
@@ -115,7 +161,7 @@ void PlanarVertex::setEdgesCCW(PlanarEdge **ccw, int nEdges) {
 }
 
 
-int PlanarVertex::getEdgeID(PlanarEdge *e) {
+PlanarIdx PlanarVertex::getEdgeID(PlanarEdge *e) {
   //for efficiency edge IDs are stored in the edges themselves
   if (e->getTail() == this)
     return e->tailEdgeID;
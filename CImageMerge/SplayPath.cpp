@@ -0,0 +1,458 @@
+/*****************************************************************************
+*    PlanarCut - software to compute MinCut / MaxFlow in a planar graph      *
+*                              Version 1.0.2                                 *
+*                                                                            *
+*    Copyright 2011 - 2013 Eno Töppe <toeppe@in.tum.de>                      *
+*                          Frank R. Schmidt <info@frank-r-schmidt.de>        *
+******************************************************************************
+
+  If you use this software for research purposes, YOU MUST CITE the following 
+  paper in any resulting publication:
+
+    [1] Efficient Planar Graph Cuts with Applications in Computer Vision.
+        F. R. Schmidt, E. Töppe, D. Cremers, 
+	    IEEE CVPR, Miami, Florida, June 2009		
+
+******************************************************************************
+
+  This software is released under the LGPL license. Details are explained
+  in the files 'COPYING' and 'COPYING.LESSER'.
+	
+*****************************************************************************/
+
+#include "SplayPath.h"
+
+using namespace std;
+
+/***************************************************
+ *** SplayNode *************************************
+ ***************************************************/
+SplayNode::SplayNode() {
+  parent = left = right = 0;
+
+  cost = costR = 0;
+  min  = minR  = CAP_INF;
+  add  = addR  = 0;
+
+  flags = 0;
+  data  = 0;
+}
+
+
+SplayRoot *SplayNode::splay(SplayArena &a) {
+  SplayNode *pn, *p, *g;
+  PlanarIdx n = 0;
+
+  //pass the pending changes down the path from the root
+  for (pn = this; !pn->isHeader(); pn = pn->parent)
+    a.stack[n++] = pn;
+  while (n)
+    a.stack[--n]->push();
+
+  while (!(p = parent)->isHeader()) {
+    g = p->parent;
+    if (!g->isHeader())
+      ((g->left == p) == (p->left == this) ? p : this)->rotate();
+    rotate();
+  }
+
+  return static_cast<SplayRoot*>(parent);
+}
+
+
+SplayNode *SplayNode::first() {
+  SplayNode *pn = this;
+
+  pn->push();
+  while (pn->left) {
+    pn = pn->left;
+    pn->push();
+  }
+
+  return pn;
+}
+
+
+SplayNode *SplayNode::last() {
+  SplayNode *pn = this;
+
+  pn->push();
+  while (pn->right) {
+    pn = pn->right;
+    pn->push();
+  }
+
+  return pn;
+}
+
+
+
+/***************************************************
+ *** SplayRoot *************************************
+ ***************************************************/
+SplayLeaf *SplayRoot::allocLeaves(SplayArena &a, PlanarIdx numLeaves) {
+
+  releaseArena(a);
+
+  //every leaf starts out as a path of its own
+  a.poolSize = 2*numLeaves + 64;
+  a.poolTop  = 0;
+  a.freeList = 0;
+  a.pool  = static_cast<SplayNode*>(::operator new(sizeof(SplayNode) * a.poolSize));
+  a.stack = new SplayNode*[2*numLeaves];
+
+  a.leaves = new SplayLeaf[numLeaves];
+
+  for (PlanarIdx i=0; i<numLeaves; i++) {
+    SplayNode *ph = allocNode(a, SPLAY_HEADER);
+    SplayNode *pl = &a.leaves[i];
+    ph->left   = pl;
+    pl->parent = ph;
+  }
+
+  return a.leaves;
+
+}
+
+
+void SplayRoot::releaseArena(SplayArena &a) {
+
+  if (a.pool)
+    ::operator delete(a.pool);
+  if (a.stack)
+    delete [] a.stack;
+  if (a.leaves)
+    delete [] a.leaves;
+
+  a.pool   = 0;
+  a.stack  = 0;
+  a.leaves = 0;
+  a.poolSize = a.poolTop = 0;
+  a.freeList = 0;
+
+}
+
+
+SplayRoot *SplayRoot::SplayRootFromLeafChain(SplayArena &a, SplayLeaf **leaves, PlanarIdx numLeaves) {
+
+  //the leaves are single paths - their headers are replaced by one 
+  //header for the whole path
+  SplayNode *ph = leaves[0]->parent;
+
+  for (PlanarIdx i=1; i<numLeaves; i++)
+    freeNode(a, leaves[i]->parent);
+
+  SplayNode *pn = build(a, leaves, numLeaves, 0, 2*numLeaves - 2);
+  ph->left   = pn;
+  pn->parent = ph;
+
+  return static_cast<SplayRoot*>(ph);
+
+}
+
+
+//builds the subtree over the elements lo..hi of the path: the even
+//elements are the leaves (starting with leaves[numLeaves-1]), the odd 
+//ones the edges given by the weak links of the preceding leaves
+SplayNode *SplayRoot::build(SplayArena &a, SplayLeaf **leaves, PlanarIdx numLeaves, PlanarIdx lo, PlanarIdx hi) {
+
+  if (lo > hi)
+    return 0;
+
+  PlanarIdx mid = (lo + hi) / 2;
+  SplayNode *pn;
+
+  if (mid & 1) {
+    SplayLeaf *pl = leaves[numLeaves - 1 - mid/2];
+    pn = allocNode(a, SPLAY_EDGE | (pl->getWeakMapping(a) ? SPLAY_MAP : 0));
+    pn->cost  = pl->wCost;
+    pn->costR = pl->wCostR;
+    pn->data  = pl->data;
+  } else {
+    pn = leaves[numLeaves - 1 - mid/2];
+  }
+
+  pn->left  = build(a, leaves, numLeaves, lo, mid - 1);
+  pn->right = build(a, leaves, numLeaves, mid + 1, hi);
+  if (pn->left)
+    pn->left->parent = pn;
+  if (pn->right)
+    pn->right->parent = pn;
+
+  pn->update();
+
+  return pn;
+
+}
+
+
+SplayLeaf *SplayRoot::getHead(SplayArena &a) {
+  SplayNode *pn = left->first();
+  pn->splay(a);
+  return static_cast<SplayLeaf*>(pn);
+}
+
+
+SplayLeaf *SplayRoot::getTail(SplayArena &a) {
+  SplayNode *pn = left->last();
+  pn->splay(a);
+  return static_cast<SplayLeaf*>(pn);
+}
+
+
+SplayLeaf *SplayRoot::getMinCostLeaf(SplayArena &a) {
+  SplayNode *pn = left;
+  CapType rMin, lMin, own;
+
+  if (pn->min == CAP_INF)
+    return 0; //path consists of a single node
+
+  //find the minimal edge closest to the tail - pending cost changes
+  //are accumulated before being passed on, so the minima of the
+  //subtrees are compared instead of being matched exactly
+  while (true) {
+    pn->push();
+    rMin = pn->right ? pn->right->min : CAP_INF;
+    lMin = pn->left  ? pn->left->min  : CAP_INF;
+    own  = pn->isEdge() ? pn->cost : CAP_INF;
+
+    if (rMin <= own && rMin <= lMin)
+      pn = pn->right;
+    else if (own <= lMin)
+      break;
+    else
+      pn = pn->left;
+  }
+
+  //the edge becomes the root, so that its cost is exact when the
+  //minimum is subtracted by addCost() 
+  pn->splay(a);
+
+  //return the node left of the edge
+  pn = pn->left->last();
+  pn->splay(a);
+
+  return static_cast<SplayLeaf*>(pn);
+}
+
+
+void SplayRoot::addCost(CapType cost) {
+  left->applyAdd(cost, -cost);
+}
+
+
+void SplayRoot::reverse() {
+  left->applyReverse();
+}
+
+
+SplayRoot *SplayRoot::concatenate(SplayArena &a, SplayRoot *rightPath, 
+				  CapType cost, CapType costR, 
+				  bool revMapping, 
+				  DynData data) 
+{
+
+  if (!rightPath)
+    return 0;
+
+  //the new edge becomes the root above both paths
+  SplayNode *pn = allocNode(a, SPLAY_EDGE | (revMapping ? SPLAY_MAP : 0));
+  pn->cost  = cost;
+  pn->costR = costR;
+  pn->data  = data;
+
+  pn->left  = left;
+  pn->right = rightPath->left;
+  pn->left->parent  = pn;
+  pn->right->parent = pn;
+  pn->update();
+
+  left = pn;
+  pn->parent = this;
+
+  freeNode(a, rightPath);
+
+  return this;
+
+}
+
+
+SplayRoot *SplayRoot::splice(SplayArena &a) {
+
+  SplayResultSplit sres;
+  SplayLeaf *pl, *plTail;
+  
+  //get the "weak" parent node of the last path node within the tree
+  plTail = getTail(a);
+  pl = plTail->getWeakParent(a);
+
+  if (!pl)
+    return this;
+
+  //split up the parent nodes path
+  pl->divide(a, &sres);
+
+  //and reconnect the left subpath weakly to the parent node
+  if (sres.leftPath) {
+    sres.leftPath->getTail(a)->setWeakLink(a, pl,
+					  sres.costBefore,
+					  sres.costBeforeR,
+					  sres.mappingBefore,
+					  sres.dataBefore);
+  }
+  
+  //now convert the connection to the parent node to a "strong" one
+  return concatenate(a, sres.rightPath,
+		     plTail->getWeakCost(a),
+		     plTail->getWeakRevCost(a),
+		     plTail->getWeakMapping(a),
+		     plTail->getWeakData(a));
+
+}
+
+
+
+/***************************************************
+ *** SplayLeaf *************************************
+ ***************************************************/
+SplayLeaf::SplayLeaf() {
+  wParent = 0;
+  wCost   = 0;
+  wCostR  = 0;
+}
+
+
+void SplayLeaf::setWeakLink(SplayArena &, SplayLeaf *parent, 
+			    CapType cap, CapType rcap, 
+			    bool mapping,
+			    DynData linkData) {
+
+  wParent = parent;
+  wCost   = cap;
+  wCostR  = rcap;
+  data    = linkData;
+
+  if (mapping)
+    flags |= SPLAY_MAP;
+  else
+    flags &= ~SPLAY_MAP;
+
+}
+
+
+SplayRoot *SplayLeaf::getPath(SplayArena &a) {
+  return splay(a);
+}
+
+
+SplayLeaf *SplayLeaf::getNext(SplayArena &a) {
+  SplayLeaf *pl = getNextDyn(a);
+
+  if (!pl) //this leaf is tail of the path it belongs to
+    return wParent;
+
+  return pl;
+}
+
+
+SplayLeaf *SplayLeaf::getNextDyn(SplayArena &a) {
+  SplayNode *pn;
+
+  splay(a);
+  if (!right)
+    return 0;
+
+  //the edge following this node is the leftmost element of the right 
+  //subtree and is itself followed by the next node
+  pn = right->first();
+  if (pn->right)
+    pn = pn->right->first();
+  else
+    pn = pn->parent;
+
+  pn->splay(a);
+
+  return static_cast<SplayLeaf*>(pn);
+}
+
+
+CapType SplayLeaf::getEdgeCost(SplayArena &a) {
+  SplayNode *pn;
+
+  splay(a);
+  if (!right)
+    return 0;
+
+  pn = right->first();
+  pn->splay(a);
+
+  return pn->cost;
+}
+
+
+void SplayLeaf::divide(SplayArena &a, SplayResultSplit *psr) {
+
+  SplayRoot *ph = splay(a);
+  SplayNode *pn = left, *pe;
+
+  if (psr)
+    memset(psr, 0, sizeof(SplayResultSplit));
+
+  if (psr)
+    psr->rightPath = ph;
+
+  if (!pn) //this is the head already
+    return;
+
+  //cut off the left part and give it a header of its own
+  left = 0;
+  update();
+
+  SplayNode *phl = allocNode(a, SPLAY_HEADER);
+  phl->left  = pn;
+  pn->parent = phl;
+
+  //remove the edge before this node which is the last element of the left part
+  pe = pn->last();
+  pe->splay(a);
+
+  phl->left = pe->left;
+  pe->left->parent = phl;
+
+  if (psr) {
+    psr->leftPath      = static_cast<SplayRoot*>(phl);
+    psr->costBefore    = pe->cost;
+    psr->costBeforeR   = pe->costR;
+    psr->mappingBefore = (pe->flags & SPLAY_MAP) != 0;
+    psr->dataBefore    = pe->data;
+  }
+
+  freeNode(a, pe);
+
+}
+
+
+SplayRoot *SplayLeaf::expose(SplayArena &a) {
+
+  SplayResultSplit sres;
+  SplayRoot *pdp;
+
+  //make "this" the first node in the path
+  divide(a, &sres); 
+  
+  if (sres.leftPath)
+    sres.leftPath->getTail(a)->setWeakLink(a, this,
+					  sres.costBefore,
+					  sres.costBeforeR,
+					  sres.mappingBefore,
+					  sres.dataBefore);
+
+  pdp = sres.rightPath;
+
+  //connect nodes on the root path to one path
+  while (pdp->getTail(a)->wParent)
+    pdp = pdp->splice(a);
+
+  return pdp;
+
+}
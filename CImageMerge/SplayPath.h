@@ -0,0 +1,367 @@
+/*****************************************************************************
+*    PlanarCut - software to compute MinCut / MaxFlow in a planar graph      *
+*                              Version 1.0.2                                 *
+*                                                                            *
+*    Copyright 2011 - 2013 Eno Töppe <toeppe@in.tum.de>                      *
+*                          Frank R. Schmidt <info@frank-r-schmidt.de>        *
+******************************************************************************
+
+  If you use this software for research purposes, YOU MUST CITE the following 
+  paper in any resulting publication:
+
+    [1] Efficient Planar Graph Cuts with Applications in Computer Vision.
+        F. R. Schmidt, E. Töppe, D. Cremers, 
+	    IEEE CVPR, Miami, Florida, June 2009		
+
+******************************************************************************
+
+  This software is released under the LGPL license. Details are explained
+  in the files 'COPYING' and 'COPYING.LESSER'.
+	
+*****************************************************************************/
+
+#ifndef __SPLAYPATH_H__
+#define __SPLAYPATH_H__
+
+#include <new>
+#include <memory.h>
+
+#include "CutPlanarDefs.h"
+#include "DynPath.h"
+
+
+//Alternative to DynPath: the paths of the dynamic tree are kept in splay
+//trees instead of height balanced trees. A path is the sequence 
+//head, edge, node, edge, ..., edge, tail in which nodes (SplayLeaf) and 
+//edges are both elements of the splay tree. Every access splays the 
+//accessed element to the root, so that paths that are used repeatedly 
+//(e.g. the ones close to the sink) stay shallow.
+//The root of each tree hangs below a header (SplayRoot) which represents 
+//the path and - unlike the root - does not change while the path is 
+//accessed.
+
+#define SPLAY_EDGE   1 //element is an edge
+#define SPLAY_HEADER 2 //element is the header of a path
+#define SPLAY_REV    4 //children have to be reversed
+#define SPLAY_MAP    8 //mapping of an edge (or of the weak link of a leaf)
+
+//forward declarations
+class SplayNode;
+class SplayRoot;
+class SplayLeaf;
+
+//nodes and stack of one owner of splay paths (cf. DynArena) - it is passed
+//to all operations that reach other nodes than the calling one
+struct SplayArena {
+  SplayNode  *pool;
+  PlanarIdx   poolSize;
+  PlanarIdx   poolTop;
+  SplayNode  *freeList;
+  SplayNode **stack;
+  SplayLeaf  *leaves;
+
+  SplayArena() : pool(0), poolSize(0), poolTop(0), freeList(0), stack(0), leaves(0) {};
+};
+
+//returned by SplayLeaf::divide()
+struct SplayResultSplit {
+  SplayRoot *leftPath;
+  SplayRoot *rightPath;
+  CapType    costBefore;
+  CapType    costBeforeR;
+  bool       mappingBefore;
+  DynData    dataBefore;
+};
+
+
+
+class SplayNode {
+
+  friend class SplayRoot;
+  friend class SplayLeaf;
+
+  SplayNode *parent; //the header for the root
+  SplayNode *left;
+  SplayNode *right;
+
+  CapType cost, costR; //costs of an edge in forward and backward direction
+  CapType min, minR;   //minimal costs of the edges in the subtree
+  CapType add, addR;   //cost changes the children have not received yet
+                       //(w.r.t. the orientation of the children)
+
+  unsigned char flags;
+
+  DynData data;  //user defined data of an edge
+
+  //nodes that are no leaves (edges and headers) are taken from the pool
+  //of the arena (2*numLeaves+64 elements) which is recycled via a free 
+  //list linked by left
+  static inline SplayNode *allocNode(SplayArena &a, unsigned char flags);
+  static inline void       freeNode(SplayArena &a, SplayNode *pn);
+
+  bool isEdge()   { return (flags & SPLAY_EDGE) != 0; };
+  bool isHeader() { return (flags & SPLAY_HEADER) != 0; };
+
+  //lazy operations: they are applied to the node itself at once
+  //and passed to the children by push()
+  inline void applyAdd(CapType a, CapType aR);
+  inline void applyReverse();
+  inline void push();
+
+  //recomputes min and minR from the node and its children
+  inline void update();
+
+  inline void rotate();
+
+  //moves the node to the root of its tree and returns the header
+  SplayRoot *splay(SplayArena &a);
+
+  //leftmost and rightmost element of the subtree
+  SplayNode *first();
+  SplayNode *last();
+
+ public:
+
+  SplayNode();
+};
+
+
+
+//A SplayRoot is the header of a path. It provides the operations acting
+//on the path as a whole (cf. DynRoot).
+class SplayRoot : private SplayNode {
+
+  friend class SplayNode;
+  friend class SplayLeaf;
+
+  static SplayNode *build(SplayArena &a, SplayLeaf **leaves, PlanarIdx numLeaves, PlanarIdx lo, PlanarIdx hi);
+
+ public:
+
+  //builds a balanced path from the weakly linked chain leaves[numLeaves-1..0]
+  //in O(numLeaves), leaves[0] becoming the tail
+  static SplayRoot *SplayRootFromLeafChain(SplayArena &a, SplayLeaf **leaves, PlanarIdx numLeaves);
+  //(re)creates the leaves and the node pool, freeing all nodes
+  static SplayLeaf *allocLeaves(SplayArena &a, PlanarIdx numLeaves);
+  //frees all edges and headers while the leaves remain valid
+  static void resetBlockAllocator(SplayArena &a) { a.poolTop = 0; a.freeList = 0; };
+  //frees all nodes including the leaves
+  static void releaseArena(SplayArena &a);
+
+  SplayLeaf *getHead(SplayArena &a);
+  SplayLeaf *getTail(SplayArena &a);
+  SplayLeaf *getMinCostLeaf(SplayArena &a); //get node closest to tail having minimal edge costs along path
+  void       addCost(CapType cost);         //increases weights of all edges within path
+  void       reverse();
+  SplayRoot *concatenate(SplayArena &a, SplayRoot *rightPath, 
+			 CapType cost, CapType costR, 
+			 bool revMapping=false, 
+			 DynData data=0); 
+
+  //used by SplayLeaf::expose(), cf. DynRoot::splice()
+  SplayRoot *splice(SplayArena &a);
+};
+
+
+
+//A SplayLeaf is a node of the dynamic tree (cf. DynLeaf).
+class SplayLeaf : private SplayNode {
+
+  friend class SplayNode;
+  friend class SplayRoot;
+
+  //weak link - its mapping and data are held by the flags and 
+  //the data field of SplayNode
+  SplayLeaf *wParent;
+  CapType    wCost;
+  CapType    wCostR;
+
+ public:
+
+  SplayLeaf();
+
+  //access to weak link fields - the arena is not needed, but taken 
+  //for the sake of a common interface with DynLeaf
+  SplayLeaf *getWeakParent(SplayArena &) { return wParent; };
+  CapType    getWeakCost(SplayArena &) { return wCost; };
+  CapType    getWeakRevCost(SplayArena &) { return wCostR; };
+  bool       getWeakMapping(SplayArena &) { return (flags & SPLAY_MAP) != 0; };
+  DynData    getWeakData(SplayArena &) { return data; };
+
+  void setWeakLink(SplayArena &a, SplayLeaf *parent, 
+		   CapType cap, CapType rcap, 
+		   bool mapping,
+		   DynData linkData);
+
+  SplayRoot *getPath(SplayArena &a);     //returns the path containing the calling node
+  SplayLeaf *getNext(SplayArena &a);     //returns the next node on the tree path
+  SplayLeaf *getNextDyn(SplayArena &a);  //return the next node if it is on the same path
+  CapType    getEdgeCost(SplayArena &a); //returns the cost of the edge after the calling node
+
+  //divides the path at the calling node, with the calling node 
+  //ending up in the right part
+  void divide(SplayArena &a, SplayResultSplit *psr);
+
+  //makes sure the path from the calling node to the root of the
+  //tree has no weak connections (i.e. it is a single path) 
+  SplayRoot *expose(SplayArena &a);
+};
+
+
+
+//dynamic tree backend of CutPlanarT (cf. CutPlanar.h)
+struct SplayPathTree {
+  typedef SplayLeaf        Leaf;
+  typedef SplayRoot        Root;
+  typedef SplayResultSplit Split;
+  typedef SplayArena       Arena;
+
+  static Leaf *allocLeaves(Arena &a, PlanarIdx numLeaves) { return SplayRoot::allocLeaves(a, numLeaves); };
+  static void  releaseArena(Arena &a) { SplayRoot::releaseArena(a); };
+  static void  resetBlockAllocator(Arena &a) { SplayRoot::resetBlockAllocator(a); };
+  static Root *rootFromLeafChain(Arena &a, Leaf **leaves, PlanarIdx numLeaves) 
+  { return SplayRoot::SplayRootFromLeafChain(a, leaves, numLeaves); };
+};
+
+
+
+/***************************************************
+ *** SplayNode INLINE ******************************
+ ***************************************************/
+inline SplayNode *SplayNode::allocNode(SplayArena &a, unsigned char flags) {
+  SplayNode *pn;
+
+  if (a.freeList) {
+    pn = a.freeList;
+    a.freeList = pn->left;
+  } else {
+    //a forest of n leaves never has more than n paths and n-1 edges
+    if (a.poolTop >= a.poolSize)
+      throw std::bad_alloc();
+    pn = a.pool + a.poolTop++;
+  }
+
+  new (pn) SplayNode;
+  pn->flags = flags;
+
+  return pn;
+}
+
+
+inline void SplayNode::freeNode(SplayArena &a, SplayNode *pn) {
+  pn->left   = a.freeList;
+  a.freeList = pn;
+}
+
+
+inline void SplayNode::applyAdd(CapType a, CapType aR) {
+  if (flags & SPLAY_EDGE) {
+    cost  += a;
+    costR += aR;
+  }
+
+  //a subtree without edges consists of a single leaf
+  if (min != CAP_INF) {
+    min  += a;
+    minR += aR;
+  }
+
+  if (flags & SPLAY_REV) {
+    add  += aR;
+    addR += a;
+  } else {
+    add  += a;
+    addR += aR;
+  }
+}
+
+
+inline void SplayNode::applyReverse() {
+  SplayNode *pn = left;
+  left  = right;
+  right = pn;
+
+  CapType c = cost;
+  cost  = costR;
+  costR = c;
+
+  c    = min;
+  min  = minR;
+  minR = c;
+
+  if (flags & SPLAY_EDGE)
+    flags ^= SPLAY_MAP;
+
+  flags ^= SPLAY_REV;
+}
+
+
+inline void SplayNode::push() {
+  if (add != 0 || addR != 0) {
+    if (left)
+      left->applyAdd(add, addR);
+    if (right)
+      right->applyAdd(add, addR);
+    add = addR = 0;
+  }
+
+  if (flags & SPLAY_REV) {
+    if (left)
+      left->applyReverse();
+    if (right)
+      right->applyReverse();
+    flags ^= SPLAY_REV;
+  }
+}
+
+
+inline void SplayNode::update() {
+  if (flags & SPLAY_EDGE) {
+    min  = cost;
+    minR = costR;
+  } else {
+    min  = CAP_INF;
+    minR = CAP_INF;
+  }
+
+  if (left) {
+    min  = mmin(min,  left->min);
+    minR = mmin(minR, left->minR);
+  }
+
+  if (right) {
+    min  = mmin(min,  right->min);
+    minR = mmin(minR, right->minR);
+  }
+}
+
+
+inline void SplayNode::rotate() {
+  SplayNode *p = parent, *g = p->parent;
+
+  if (p->left == this) {
+    p->left = right;
+    if (right) 
+      right->parent = p;
+    right = p;
+  } else {
+    p->right = left;
+    if (left) 
+      left->parent = p;
+    left = p;
+  }
+
+  p->parent = this;
+  parent    = g;
+
+  //the header keeps the root as its left child
+  if (g->left == p)
+    g->left = this;
+  else
+    g->right = this;
+
+  p->update();
+  update();
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*****************************************************************************
+*    PlanarCut - software to compute MinCut / MaxFlow in a planar graph      *
+*                              Version 1.0.2                                 *
+*                                                                            *
+*    Copyright 2011 - 2013 Eno Töppe <toeppe@in.tum.de>                      *
+*                          Frank R. Schmidt <info@frank-r-schmidt.de>        *
+******************************************************************************
+
+  If you use this software for research purposes, YOU MUST CITE the following 
+  paper in any resulting publication:
+
+    [1] Efficient Planar Graph Cuts with Applications in Computer Vision.
+        F. R. Schmidt, E. Töppe, D. Cremers, 
+	    IEEE CVPR, Miami, Florida, June 2009		
+
+******************************************************************************
+
+  This software is released under the LGPL license. Details are explained
+  in the files 'COPYING' and 'COPYING.LESSER'.
+	
+*****************************************************************************/
+
+#include "ThreadPool.h"
+
+
+
+ThreadPool::ThreadPool(int numThreads) : func(0), arg(0),
+					 generation(0), numRunning(0),
+					 terminate(false) {
+
+  //the calling thread acts as thread 0
+  for (int i=1; i<numThreads; i++)
+    workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+
+}
+
+
+
+ThreadPool::~ThreadPool() {
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    terminate = true;
+  }
+  cvStart.notify_all();
+
+  for (size_t i=0; i<workers.size(); i++)
+    workers[i].join();
+
+}
+
+
+
+void ThreadPool::workerLoop(int threadIdx) {
+
+  unsigned int seen = 0;
+
+  while (true) {
+
+    ThreadFunc f;
+    void *a;
+
+    //wait for the next job
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      while (!terminate && generation == seen)
+	cvStart.wait(lock);
+
+      if (terminate)
+	return;
+
+      seen = generation;
+      f = func;
+      a = arg;
+    }
+
+    f(a, threadIdx);
+
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      if (--numRunning == 0)
+	cvDone.notify_one();
+    }
+
+  }
+
+}
+
+
+
+void ThreadPool::run(ThreadFunc func, void *arg) {
+
+  if (workers.empty()) {
+    func(arg, 0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->func = func;
+    this->arg  = arg;
+    numRunning = (int)workers.size();
+    generation++;
+  }
+  cvStart.notify_all();
+
+  func(arg, 0);
+
+  //wait for the workers to finish
+  std::unique_lock<std::mutex> lock(mtx);
+  while (numRunning > 0)
+    cvDone.wait(lock);
+
+}
@@ -0,0 +1,66 @@
+/*****************************************************************************
+*    PlanarCut - software to compute MinCut / MaxFlow in a planar graph      *
+*                              Version 1.0.2                                 *
+*                                                                            *
+*    Copyright 2011 - 2013 Eno Töppe <toeppe@in.tum.de>                      *
+*                          Frank R. Schmidt <info@frank-r-schmidt.de>        *
+******************************************************************************
+
+  If you use this software for research purposes, YOU MUST CITE the following 
+  paper in any resulting publication:
+
+    [1] Efficient Planar Graph Cuts with Applications in Computer Vision.
+        F. R. Schmidt, E. Töppe, D. Cremers, 
+	    IEEE CVPR, Miami, Florida, June 2009		
+
+******************************************************************************
+
+  This software is released under the LGPL license. Details are explained
+  in the files 'COPYING' and 'COPYING.LESSER'.
+	
+*****************************************************************************/
+
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+//function executed by the threads of a ThreadPool
+typedef void (*ThreadFunc)(void *arg, int threadIdx);
+
+
+//Fixed set of worker threads for bulk-synchronous parallel loops. 
+//run() executes a function on all threads (the calling thread being 
+//thread 0) and returns as soon as all of them are done.
+class ThreadPool {
+
+  std::vector<std::thread> workers;
+
+  std::mutex              mtx;
+  std::condition_variable cvStart;
+  std::condition_variable cvDone;
+
+  ThreadFunc func;
+  void      *arg;
+
+  unsigned int generation; //incremented with each call of run()
+  int  numRunning;         //workers still executing func
+  bool terminate;
+
+  void workerLoop(int threadIdx);
+
+ public:
+
+  ThreadPool(int numThreads);
+  ~ThreadPool();
+
+  int getNumThreads() { return (int)workers.size() + 1; }
+
+  void run(ThreadFunc func, void *arg);
+};
+
+
+#endif //#ifndef __THREADPOOL_H__
@@ -21,6 +21,11 @@ freely, subject to the following restrictions:
 
     3. This notice may not be removed or altered from any source
     distribution.
+
+This copy of LodePNG has been modified for CImageMerge (faster inflate, SSE2
+unfiltering, parallel filter selection, fast compression levels, faster
+checksums, lodepng_decode_into, row streaming decoder, segments decodable in
+parallel, buffers kept in the state, SSE2 color conversion, fast color profile of opaque images, see the comments at the modified functions).
 */
 
 /*
@@ -33,10 +38,31 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef __cplusplus
+#include <thread>
+#include <vector>
+#endif
+
 #ifdef LODEPNG_COMPILE_CPP
 #include <fstream>
 #endif /*LODEPNG_COMPILE_CPP*/
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LODEPNG_SSE2
+#include <emmintrin.h>
+/*the checksums have PCLMULQDQ and AVX2 versions and some color conversions SSSE3 versions, used if the CPU supports them*/
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define LODEPNG_X86_DISPATCH
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define LODEPNG_TARGET(x)
+#else
+#define LODEPNG_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+#endif
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
 #pragma warning( disable : 4996 ) /*VS does not like fopen, but fopen_s is not standard C so unusable here*/
@@ -53,6 +79,57 @@ with the "LODEPNG_COMPILE_" #defines divide this up further in an intermixed way
 -The C++ wrapper around all of the above
 */
 
+#ifdef LODEPNG_X86_DISPATCH
+/*runtime detection of the instruction sets of the checksum and color conversion functions*/
+#define CPU_AVX2 1u
+#define CPU_PCLMUL 2u
+#define CPU_SSSE3 4u
+
+static unsigned detectCpuFeatures(void)
+{
+  unsigned features = 0;
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if(info[0] >= 7)
+  {
+    __cpuid(info, 1);
+    /*AVX2 also needs OSXSAVE and an OS that saves the YMM registers*/
+    if(((info[2] >> 27) & 1) && (_xgetbv(0) & 6) == 6)
+    {
+      __cpuidex(info, 7, 0);
+      if((info[1] >> 5) & 1) features |= CPU_AVX2;
+    }
+  }
+  __cpuid(info, 1);
+  if((info[2] >> 1) & 1) features |= CPU_PCLMUL;
+  if((info[2] >> 9) & 1) features |= CPU_SSSE3;
+#else
+  if(__builtin_cpu_supports("avx2")) features |= CPU_AVX2;
+  if(__builtin_cpu_supports("pclmul")) features |= CPU_PCLMUL;
+  if(__builtin_cpu_supports("ssse3")) features |= CPU_SSSE3;
+#endif
+  return features;
+}
+
+/*the result of detectCpuFeatures, which is determined once instead of on every checksum or conversion call*/
+static unsigned cpuFeatures(void)
+{
+#ifdef __cplusplus
+  static const unsigned features = detectCpuFeatures();
+  return features;
+#else /*every thread that sees no result yet computes the same value*/
+  static int features = -1;
+  if(features < 0) features = (int)detectCpuFeatures();
+  return (unsigned)features;
+#endif
+}
+
+static unsigned cpuHasAVX2(void) { return (cpuFeatures() & CPU_AVX2) != 0; }
+static unsigned cpuHasPCLMUL(void) { return (cpuFeatures() & CPU_PCLMUL) != 0; }
+static unsigned cpuHasSSSE3(void) { return (cpuFeatures() & CPU_SSSE3) != 0; }
+#endif /*LODEPNG_X86_DISPATCH*/
+
 /*The malloc, realloc and free functions defined here with "lodepng_" in front
 of the name, so that you can easily change them to others related to your
 platform if needed. Everything else in the code calls these. Pass
@@ -251,17 +328,6 @@ static void ucvector_init(ucvector* p)
   p->data = NULL;
   p->size = p->allocsize = 0;
 }
-
-#ifdef LODEPNG_COMPILE_DECODER
-/*resize and give all new elements the value*/
-static unsigned ucvector_resizev(ucvector* p, size_t size, unsigned char value)
-{
-  size_t oldsize = p->size, i;
-  if(!ucvector_resize(p, size)) return 0;
-  for(i = oldsize; i < size; ++i) p->data[i] = value;
-  return 1;
-}
-#endif /*LODEPNG_COMPILE_DECODER*/
 #endif /*LODEPNG_COMPILE_PNG*/
 
 #ifdef LODEPNG_COMPILE_ZLIB
@@ -421,14 +487,26 @@ unsigned lodepng_save_file(const unsigned char* buffer, size_t buffersize, const
 
 static void addBitsToStream(size_t* bitpointer, ucvector* bitstream, unsigned value, size_t nbits)
 {
-  size_t i;
-  for(i = 0; i != nbits; ++i) addBitToStream(bitpointer, bitstream, (unsigned char)((value >> i) & 1));
+  /*fills up the last byte, then adds new bytes, instead of going bit by bit*/
+  while(nbits)
+  {
+    unsigned used = (unsigned)((*bitpointer) & 7);
+    unsigned num = 8 - used;
+    if(num > nbits) num = (unsigned)nbits;
+    if(used == 0) ucvector_push_back(bitstream, (unsigned char)0);
+    bitstream->data[bitstream->size - 1] |= (unsigned char)((value & ((1u << num) - 1u)) << used);
+    value >>= num;
+    nbits -= num;
+    (*bitpointer) += num;
+  }
 }
 
 static void addBitsToStreamReversed(size_t* bitpointer, ucvector* bitstream, unsigned value, size_t nbits)
 {
+  unsigned reversed = 0;
   size_t i;
-  for(i = 0; i != nbits; ++i) addBitToStream(bitpointer, bitstream, (unsigned char)((value >> (nbits - 1 - i)) & 1));
+  for(i = 0; i != nbits; ++i) reversed |= ((value >> i) & 1u) << (nbits - 1 - i);
+  addBitsToStream(bitpointer, bitstream, reversed, nbits);
 }
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
@@ -453,6 +531,30 @@ static unsigned readBitsFromStream(size_t* bitpointer, const unsigned char* bits
   }
   return result;
 }
+
+/*
+returns the bits of the stream starting at bitpointer, the first one in the lowest bit of the result. At least
+57 bits are valid, bits past the end of the stream (bitlength is the length in bits) read as zero. Away from the
+end of the stream this is a single 64-bit read, which the compiler generates from the byte expression below.
+*/
+static unsigned long long peekBitsFromStream(size_t bitpointer, const unsigned char* bitstream, size_t bitlength)
+{
+  size_t start = bitpointer >> 3, end = (bitlength + 7) >> 3, i;
+  unsigned long long result = 0;
+  if(start + 8 <= end)
+  {
+    const unsigned char* p = bitstream + start;
+    result = (unsigned long long)p[0]         | ((unsigned long long)p[1] << 8)
+          | ((unsigned long long)p[2] << 16) | ((unsigned long long)p[3] << 24)
+          | ((unsigned long long)p[4] << 32) | ((unsigned long long)p[5] << 40)
+          | ((unsigned long long)p[6] << 48) | ((unsigned long long)p[7] << 56);
+  }
+  else
+  {
+    for(i = 0; start + i < end; ++i) result |= (unsigned long long)bitstream[start + i] << (8 * i);
+  }
+  return result >> (bitpointer & 7);
+}
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -467,6 +569,8 @@ static unsigned readBitsFromStream(size_t* bitpointer, const unsigned char* bits
 #define NUM_DISTANCE_SYMBOLS 32
 /*the code length codes. 0-15: code lengths, 16: copy previous 3-6 times, 17: 3-10 zeros, 18: 11-138 zeros*/
 #define NUM_CODE_LENGTH_CODES 19
+/*the maximum length of the codes of the deflate Huffman trees*/
+#define MAX_CODE_BITS 15
 
 /*the base lengths represented by codes 257-285*/
 static const unsigned LENGTHBASE[29]
@@ -500,11 +604,15 @@ Huffman tree struct, containing multiple representations of the tree
 */
 typedef struct HuffmanTree
 {
-  unsigned* tree2d;
+  unsigned char* table_len; /*decoding table, see HuffmanTree_makeTable*/
+  unsigned short* table_value;
   unsigned* tree1d;
   unsigned* lengths; /*the lengths of the codes of the 1d-tree*/
   unsigned maxbitlen; /*maximum number of bits a single code can get*/
   unsigned numcodes; /*number of symbols in the alphabet = number of codes*/
+  /*the arrays are kept for the next tree made with this struct, they only grow*/
+  size_t codesize; /*number of codes lengths and tree1d have room for*/
+  size_t tablesize; /*number of entries the decoding table has room for*/
 } HuffmanTree;
 
 /*function used for debug purposes to draw the tree in ascii art with C++*/
@@ -522,74 +630,149 @@ static void HuffmanTree_draw(HuffmanTree* tree)
 
 static void HuffmanTree_init(HuffmanTree* tree)
 {
-  tree->tree2d = 0;
+  tree->table_len = 0;
+  tree->table_value = 0;
   tree->tree1d = 0;
   tree->lengths = 0;
+  tree->numcodes = 0;
+  tree->codesize = 0;
+  tree->tablesize = 0;
 }
 
 static void HuffmanTree_cleanup(HuffmanTree* tree)
 {
-  lodepng_free(tree->tree2d);
+  lodepng_free(tree->table_len);
+  lodepng_free(tree->table_value);
   lodepng_free(tree->tree1d);
   lodepng_free(tree->lengths);
 }
 
-/*the tree representation used by the decoder. return value is error*/
-static unsigned HuffmanTree_make2DTree(HuffmanTree* tree)
+/*sets the number of codes, enlarging lengths and tree1d if needed. return value is error*/
+static unsigned HuffmanTree_resize(HuffmanTree* tree, size_t numcodes)
 {
-  unsigned nodefilled = 0; /*up to which node it is filled*/
-  unsigned treepos = 0; /*position in the tree (1 of the numcodes columns)*/
-  unsigned n, i;
+  if(numcodes > tree->codesize)
+  {
+    /*room for all deflate symbols, so that the arrays fit the trees of later blocks too*/
+    size_t newsize = numcodes > NUM_DEFLATE_CODE_SYMBOLS ? numcodes : NUM_DEFLATE_CODE_SYMBOLS;
+    unsigned* lengths = (unsigned*)lodepng_realloc(tree->lengths, newsize * sizeof(unsigned));
+    unsigned* tree1d;
+    if(!lengths) return 83; /*alloc fail*/
+    tree->lengths = lengths;
+    tree1d = (unsigned*)lodepng_realloc(tree->tree1d, newsize * sizeof(unsigned));
+    if(!tree1d) return 83; /*alloc fail*/
+    tree->tree1d = tree1d;
+    tree->codesize = newsize;
+  }
+  tree->numcodes = (unsigned)numcodes;
+  return 0;
+}
 
-  tree->tree2d = (unsigned*)lodepng_malloc(tree->numcodes * 2 * sizeof(unsigned));
-  if(!tree->tree2d) return 83; /*alloc fail*/
+/*number of stream bits resolved by the first level of the decoding table*/
+#define FIRSTBITS 9u
+/*value of table entries that belong to no code (incomplete trees)*/
+#define INVALIDSYMBOL 65535u
 
-  /*
-  convert tree1d[] to tree2d[][]. In the 2D array, a value of 32767 means
-  uninited, a value >= numcodes is an address to another bit, a value < numcodes
-  is a code. The 2 rows are the 2 possible bit values (0 or 1), there are as
-  many columns as codes - 1.
-  A good huffman tree has N * 2 - 1 nodes, of which N - 1 are internal nodes.
-  Here, the internal nodes are stored (what their 0 and 1 option point to).
-  There is only memory for such good tree currently, if there are more nodes
-  (due to too long length codes), error 55 will happen
-  */
-  for(n = 0; n < tree->numcodes * 2; ++n)
+static unsigned reverseBits(unsigned bits, unsigned num)
+{
+  unsigned i, result = 0;
+  for(i = 0; i < num; ++i) result |= ((bits >> (num - i - 1u)) & 1u) << i;
+  return result;
+}
+
+/*
+the lookup table used by the decoder, it replaces walking the tree bit by bit. The first level is indexed by the
+next FIRSTBITS bits of the stream (the first one in the lowest bit). An entry holds the code length and the
+symbol, or for codes longer than FIRSTBITS, the length of the longest code with this prefix and the position of
+the second level table. That table is indexed by the stream bits following the first FIRSTBITS ones.
+return value is error.
+*/
+static unsigned HuffmanTree_makeTable(HuffmanTree* tree)
+{
+  static const unsigned headsize = 1u << FIRSTBITS;
+  static const unsigned mask = (1u << FIRSTBITS) - 1u;
+  unsigned maxlens[1u << FIRSTBITS];
+  unsigned long kraft = 0;
+  size_t i, j, size, pointer;
+
+  /*an oversubscribed tree has no unique decoding, see comment in lodepng_error_text*/
+  for(i = 0; i != tree->numcodes; ++i)
+  {
+    if(tree->lengths[i]) kraft += 1ul << (15 - tree->lengths[i]);
+  }
+  if(kraft > (1ul << 15)) return 55;
+
+  /*length of the longest code for each first level entry*/
+  for(i = 0; i != headsize; ++i) maxlens[i] = 0;
+  for(i = 0; i != tree->numcodes; ++i)
+  {
+    unsigned l = tree->lengths[i];
+    unsigned index;
+    if(l <= FIRSTBITS) continue;
+    index = reverseBits(tree->tree1d[i] >> (l - FIRSTBITS), FIRSTBITS);
+    if(l > maxlens[index]) maxlens[index] = l;
+  }
+
+  size = headsize;
+  for(i = 0; i != headsize; ++i)
+  {
+    if(maxlens[i] > FIRSTBITS) size += 1u << (maxlens[i] - FIRSTBITS);
+  }
+
+  if(size > tree->tablesize)
+  {
+    size_t newsize = (size > tree->tablesize * 2) ? size : (size * 3 / 2);
+    unsigned char* table_len = (unsigned char*)lodepng_realloc(tree->table_len, newsize * sizeof(unsigned char));
+    unsigned short* table_value;
+    if(!table_len) return 83; /*alloc fail*/
+    tree->table_len = table_len;
+    table_value = (unsigned short*)lodepng_realloc(tree->table_value, newsize * sizeof(unsigned short));
+    if(!table_value) return 83; /*alloc fail*/
+    tree->table_value = table_value;
+    tree->tablesize = newsize;
+  }
+
+  for(i = 0; i != size; ++i)
+  {
+    tree->table_len[i] = 0;
+    tree->table_value[i] = INVALIDSYMBOL;
+  }
+
+  /*the first level entries pointing to second level tables*/
+  pointer = headsize;
+  for(i = 0; i != headsize; ++i)
   {
-    tree->tree2d[n] = 32767; /*32767 here means the tree2d isn't filled there yet*/
+    if(maxlens[i] <= FIRSTBITS) continue;
+    tree->table_len[i] = (unsigned char)maxlens[i];
+    tree->table_value[i] = (unsigned short)pointer;
+    pointer += 1u << (maxlens[i] - FIRSTBITS);
   }
 
-  for(n = 0; n < tree->numcodes; ++n) /*the codes*/
+  /*fill in the symbols, a code of length l occupies all entries that start with its (reversed) bits*/
+  for(i = 0; i != tree->numcodes; ++i)
   {
-    for(i = 0; i != tree->lengths[n]; ++i) /*the bits for this code*/
+    unsigned l = tree->lengths[i];
+    unsigned reverse;
+    if(!l) continue;
+    reverse = reverseBits(tree->tree1d[i], l);
+    if(l <= FIRSTBITS)
     {
-      unsigned char bit = (unsigned char)((tree->tree1d[n] >> (tree->lengths[n] - i - 1)) & 1);
-      /*oversubscribed, see comment in lodepng_error_text*/
-      if(treepos > 2147483647 || treepos + 2 > tree->numcodes) return 55;
-      if(tree->tree2d[2 * treepos + bit] == 32767) /*not yet filled in*/
+      for(j = reverse; j < headsize; j += (size_t)1 << l)
       {
-        if(i + 1 == tree->lengths[n]) /*last bit*/
-        {
-          tree->tree2d[2 * treepos + bit] = n; /*put the current code in it*/
-          treepos = 0;
-        }
-        else
-        {
-          /*put address of the next step in here, first that address has to be found of course
-          (it's just nodefilled + 1)...*/
-          ++nodefilled;
-          /*addresses encoded with numcodes added to it*/
-          tree->tree2d[2 * treepos + bit] = nodefilled + tree->numcodes;
-          treepos = nodefilled;
-        }
+        tree->table_len[j] = (unsigned char)l;
+        tree->table_value[j] = (unsigned short)i;
+      }
+    }
+    else
+    {
+      unsigned index = reverse & mask;
+      unsigned tablebits = tree->table_len[index] - FIRSTBITS;
+      size_t start = tree->table_value[index];
+      for(j = reverse >> FIRSTBITS; j < ((size_t)1 << tablebits); j += (size_t)1 << (l - FIRSTBITS))
+      {
+        tree->table_len[start + j] = (unsigned char)l;
+        tree->table_value[start + j] = (unsigned short)i;
       }
-      else treepos = tree->tree2d[2 * treepos + bit] - tree->numcodes;
     }
-  }
-
-  for(n = 0; n < tree->numcodes * 2; ++n)
-  {
-    if(tree->tree2d[n] == 32767) tree->tree2d[n] = 0; /*remove possible remaining 32767's*/
   }
 
   return 0;
@@ -602,42 +785,28 @@ value is error.
 */
 static unsigned HuffmanTree_makeFromLengths2(HuffmanTree* tree)
 {
-  uivector blcount;
-  uivector nextcode;
-  unsigned error = 0;
+  unsigned blcount[MAX_CODE_BITS + 1];
+  unsigned nextcode[MAX_CODE_BITS + 1];
   unsigned bits, n;
 
-  uivector_init(&blcount);
-  uivector_init(&nextcode);
+  if(tree->maxbitlen > MAX_CODE_BITS) return 80; /*deflate codes have at most 15 bits*/
 
-  tree->tree1d = (unsigned*)lodepng_malloc(tree->numcodes * sizeof(unsigned));
-  if(!tree->tree1d) error = 83; /*alloc fail*/
+  for(bits = 0; bits <= tree->maxbitlen; ++bits) blcount[bits] = nextcode[bits] = 0;
 
-  if(!uivector_resizev(&blcount, tree->maxbitlen + 1, 0)
-  || !uivector_resizev(&nextcode, tree->maxbitlen + 1, 0))
-    error = 83; /*alloc fail*/
-
-  if(!error)
+  /*step 1: count number of instances of each code length*/
+  for(bits = 0; bits != tree->numcodes; ++bits) ++blcount[tree->lengths[bits]];
+  /*step 2: generate the nextcode values*/
+  for(bits = 1; bits <= tree->maxbitlen; ++bits)
   {
-    /*step 1: count number of instances of each code length*/
-    for(bits = 0; bits != tree->numcodes; ++bits) ++blcount.data[tree->lengths[bits]];
-    /*step 2: generate the nextcode values*/
-    for(bits = 1; bits <= tree->maxbitlen; ++bits)
-    {
-      nextcode.data[bits] = (nextcode.data[bits - 1] + blcount.data[bits - 1]) << 1;
-    }
-    /*step 3: generate all the codes*/
-    for(n = 0; n != tree->numcodes; ++n)
-    {
-      if(tree->lengths[n] != 0) tree->tree1d[n] = nextcode.data[tree->lengths[n]]++;
-    }
+    nextcode[bits] = (nextcode[bits - 1] + blcount[bits - 1]) << 1;
+  }
+  /*step 3: generate all the codes*/
+  for(n = 0; n != tree->numcodes; ++n)
+  {
+    if(tree->lengths[n] != 0) tree->tree1d[n] = nextcode[tree->lengths[n]]++;
   }
 
-  uivector_cleanup(&blcount);
-  uivector_cleanup(&nextcode);
-
-  if(!error) return HuffmanTree_make2DTree(tree);
-  else return error;
+  return HuffmanTree_makeTable(tree);
 }
 
 /*
@@ -649,10 +818,13 @@ static unsigned HuffmanTree_makeFromLengths(HuffmanTree* tree, const unsigned* b
                                             size_t numcodes, unsigned maxbitlen)
 {
   unsigned i;
-  tree->lengths = (unsigned*)lodepng_malloc(numcodes * sizeof(unsigned));
-  if(!tree->lengths) return 83; /*alloc fail*/
-  for(i = 0; i != numcodes; ++i) tree->lengths[i] = bitlen[i];
-  tree->numcodes = (unsigned)numcodes; /*number of symbols*/
+  /*bitlen may be the lengths of the tree already, sized with HuffmanTree_resize by the caller*/
+  if(bitlen != tree->lengths)
+  {
+    unsigned error = HuffmanTree_resize(tree, numcodes);
+    if(error) return error;
+    for(i = 0; i != numcodes; ++i) tree->lengths[i] = bitlen[i];
+  }
   tree->maxbitlen = maxbitlen;
   return HuffmanTree_makeFromLengths2(tree);
 }
@@ -761,19 +933,16 @@ static void boundaryPM(BPMLists* lists, BPMNode* leaves, size_t numpresent, int
   }
 }
 
-unsigned lodepng_huffman_code_lengths(unsigned* lengths, const unsigned* frequencies,
-                                      size_t numcodes, unsigned maxbitlen)
+/*
+lodepng_huffman_code_lengths with the given memory: leaves has room for numcodes nodes, the memory and freelist
+of lists for lists->memsize nodes and the chains for maxbitlen lists
+*/
+static unsigned huffmanCodeLengthsBPM(unsigned* lengths, const unsigned* frequencies, size_t numcodes,
+                                      unsigned maxbitlen, BPMNode* leaves, BPMLists* lists)
 {
-  unsigned error = 0;
   unsigned i;
   size_t numpresent = 0; /*number of symbols with non-zero frequency*/
-  BPMNode* leaves; /*the symbols, only those with > 0 frequency*/
-
-  if(numcodes == 0) return 80; /*error: a tree of 0 symbols is not supposed to be made*/
-  if((1u << maxbitlen) < numcodes) return 80; /*error: represent all symbols*/
-
-  leaves = (BPMNode*)lodepng_malloc(numcodes * sizeof(*leaves));
-  if(!leaves) return 83; /*alloc fail*/
+  BPMNode* node;
 
   for(i = 0; i != numcodes; ++i)
   {
@@ -795,75 +964,101 @@ unsigned lodepng_huffman_code_lengths(unsigned* lengths, const unsigned* frequen
   if(numpresent == 0)
   {
     lengths[0] = lengths[1] = 1; /*note that for RFC 1951 section 3.2.7, only lengths[0] = 1 is needed*/
+    return 0;
   }
   else if(numpresent == 1)
   {
     lengths[leaves[0].index] = 1;
     lengths[leaves[0].index == 0 ? 1 : 0] = 1;
+    return 0;
   }
-  else
-  {
-    BPMLists lists;
-    BPMNode* node;
-
-    qsort(leaves, numpresent, sizeof(BPMNode), bpmnode_compare);
 
-    lists.listsize = maxbitlen;
-    lists.memsize = 2 * maxbitlen * (maxbitlen + 1);
-    lists.nextfree = 0;
-    lists.numfree = lists.memsize;
-    lists.memory = (BPMNode*)lodepng_malloc(lists.memsize * sizeof(*lists.memory));
-    lists.freelist = (BPMNode**)lodepng_malloc(lists.memsize * sizeof(BPMNode*));
-    lists.chains0 = (BPMNode**)lodepng_malloc(lists.listsize * sizeof(BPMNode*));
-    lists.chains1 = (BPMNode**)lodepng_malloc(lists.listsize * sizeof(BPMNode*));
-    if(!lists.memory || !lists.freelist || !lists.chains0 || !lists.chains1) error = 83; /*alloc fail*/
+  qsort(leaves, numpresent, sizeof(BPMNode), bpmnode_compare);
 
-    if(!error)
-    {
-      for(i = 0; i != lists.memsize; ++i) lists.freelist[i] = &lists.memory[i];
+  lists->listsize = maxbitlen;
+  lists->nextfree = 0;
+  lists->numfree = lists->memsize;
 
-      bpmnode_create(&lists, leaves[0].weight, 1, 0);
-      bpmnode_create(&lists, leaves[1].weight, 2, 0);
+  for(i = 0; i != lists->memsize; ++i) lists->freelist[i] = &lists->memory[i];
 
-      for(i = 0; i != lists.listsize; ++i)
-      {
-        lists.chains0[i] = &lists.memory[0];
-        lists.chains1[i] = &lists.memory[1];
-      }
+  bpmnode_create(lists, leaves[0].weight, 1, 0);
+  bpmnode_create(lists, leaves[1].weight, 2, 0);
 
-      /*each boundaryPM call adds one chain to the last list, and we need 2 * numpresent - 2 chains.*/
-      for(i = 2; i != 2 * numpresent - 2; ++i) boundaryPM(&lists, leaves, numpresent, (int)maxbitlen - 1, (int)i);
+  for(i = 0; i != lists->listsize; ++i)
+  {
+    lists->chains0[i] = &lists->memory[0];
+    lists->chains1[i] = &lists->memory[1];
+  }
 
-      for(node = lists.chains1[maxbitlen - 1]; node; node = node->tail)
-      {
-        for(i = 0; i != node->index; ++i) ++lengths[leaves[i].index];
-      }
-    }
+  /*each boundaryPM call adds one chain to the last list, and we need 2 * numpresent - 2 chains.*/
+  for(i = 2; i != 2 * numpresent - 2; ++i) boundaryPM(lists, leaves, numpresent, (int)maxbitlen - 1, (int)i);
 
-    lodepng_free(lists.memory);
-    lodepng_free(lists.freelist);
-    lodepng_free(lists.chains0);
-    lodepng_free(lists.chains1);
+  for(node = lists->chains1[maxbitlen - 1]; node; node = node->tail)
+  {
+    for(i = 0; i != node->index; ++i) ++lengths[leaves[i].index];
   }
 
+  return 0;
+}
+
+unsigned lodepng_huffman_code_lengths(unsigned* lengths, const unsigned* frequencies,
+                                      size_t numcodes, unsigned maxbitlen)
+{
+  unsigned error = 0;
+  BPMNode* leaves; /*the symbols, only those with > 0 frequency*/
+  BPMLists lists;
+
+  if(numcodes == 0) return 80; /*error: a tree of 0 symbols is not supposed to be made*/
+  if((1u << maxbitlen) < numcodes) return 80; /*error: represent all symbols*/
+
+  lists.memsize = 2 * maxbitlen * (maxbitlen + 1);
+  leaves = (BPMNode*)lodepng_malloc(numcodes * sizeof(*leaves));
+  lists.memory = (BPMNode*)lodepng_malloc(lists.memsize * sizeof(*lists.memory));
+  lists.freelist = (BPMNode**)lodepng_malloc(lists.memsize * sizeof(BPMNode*));
+  lists.chains0 = (BPMNode**)lodepng_malloc(maxbitlen * sizeof(BPMNode*));
+  lists.chains1 = (BPMNode**)lodepng_malloc(maxbitlen * sizeof(BPMNode*));
+  if(!leaves || !lists.memory || !lists.freelist || !lists.chains0 || !lists.chains1) error = 83; /*alloc fail*/
+
+  if(!error) error = huffmanCodeLengthsBPM(lengths, frequencies, numcodes, maxbitlen, leaves, &lists);
+
   lodepng_free(leaves);
+  lodepng_free(lists.memory);
+  lodepng_free(lists.freelist);
+  lodepng_free(lists.chains0);
+  lodepng_free(lists.chains1);
   return error;
 }
 
-/*Create the Huffman tree given the symbol frequencies*/
+/*the memory of huffmanCodeLengthsBPM for the trees of deflate, so that making them allocates nothing*/
+typedef struct BPMMemory
+{
+  BPMNode leaves[NUM_DEFLATE_CODE_SYMBOLS];
+  BPMNode memory[2 * MAX_CODE_BITS * (MAX_CODE_BITS + 1)];
+  BPMNode* freelist[2 * MAX_CODE_BITS * (MAX_CODE_BITS + 1)];
+  BPMNode* chains0[MAX_CODE_BITS];
+  BPMNode* chains1[MAX_CODE_BITS];
+} BPMMemory;
+
+/*Create the Huffman tree given the symbol frequencies, at most NUM_DEFLATE_CODE_SYMBOLS of them*/
 static unsigned HuffmanTree_makeFromFrequencies(HuffmanTree* tree, const unsigned* frequencies,
-                                                size_t mincodes, size_t numcodes, unsigned maxbitlen)
+                                                size_t mincodes, size_t numcodes, unsigned maxbitlen,
+                                                BPMMemory* bpm)
 {
   unsigned error = 0;
+  BPMLists lists;
   while(!frequencies[numcodes - 1] && numcodes > mincodes) --numcodes; /*trim zeroes*/
+  if(numcodes > NUM_DEFLATE_CODE_SYMBOLS || maxbitlen > MAX_CODE_BITS) return 80;
+  if((1u << maxbitlen) < numcodes) return 80; /*error: represent all symbols*/
   tree->maxbitlen = maxbitlen;
-  tree->numcodes = (unsigned)numcodes; /*number of symbols*/
-  tree->lengths = (unsigned*)lodepng_realloc(tree->lengths, numcodes * sizeof(unsigned));
-  if(!tree->lengths) return 83; /*alloc fail*/
-  /*initialize all lengths to 0*/
-  memset(tree->lengths, 0, numcodes * sizeof(unsigned));
+  error = HuffmanTree_resize(tree, numcodes); /*number of symbols*/
+  if(error) return error;
 
-  error = lodepng_huffman_code_lengths(tree->lengths, frequencies, numcodes, maxbitlen);
+  lists.memsize = 2 * maxbitlen * (maxbitlen + 1);
+  lists.memory = bpm->memory;
+  lists.freelist = bpm->freelist;
+  lists.chains0 = bpm->chains0;
+  lists.chains1 = bpm->chains1;
+  error = huffmanCodeLengthsBPM(tree->lengths, frequencies, numcodes, maxbitlen, bpm->leaves, &lists);
   if(!error) error = HuffmanTree_makeFromLengths2(tree);
   return error;
 }
@@ -882,9 +1077,8 @@ static unsigned HuffmanTree_getLength(const HuffmanTree* tree, unsigned index)
 /*get the literal and length code tree of a deflated block with fixed tree, as per the deflate specification*/
 static unsigned generateFixedLitLenTree(HuffmanTree* tree)
 {
-  unsigned i, error = 0;
-  unsigned* bitlen = (unsigned*)lodepng_malloc(NUM_DEFLATE_CODE_SYMBOLS * sizeof(unsigned));
-  if(!bitlen) return 83; /*alloc fail*/
+  unsigned i;
+  unsigned bitlen[NUM_DEFLATE_CODE_SYMBOLS];
 
   /*288 possible codes: 0-255=literals, 256=endcode, 257-285=lengthcodes, 286-287=unused*/
   for(i =   0; i <= 143; ++i) bitlen[i] = 8;
@@ -892,29 +1086,41 @@ static unsigned generateFixedLitLenTree(HuffmanTree* tree)
   for(i = 256; i <= 279; ++i) bitlen[i] = 7;
   for(i = 280; i <= 287; ++i) bitlen[i] = 8;
 
-  error = HuffmanTree_makeFromLengths(tree, bitlen, NUM_DEFLATE_CODE_SYMBOLS, 15);
-
-  lodepng_free(bitlen);
-  return error;
+  return HuffmanTree_makeFromLengths(tree, bitlen, NUM_DEFLATE_CODE_SYMBOLS, 15);
 }
 
 /*get the distance code tree of a deflated block with fixed tree, as specified in the deflate specification*/
 static unsigned generateFixedDistanceTree(HuffmanTree* tree)
 {
-  unsigned i, error = 0;
-  unsigned* bitlen = (unsigned*)lodepng_malloc(NUM_DISTANCE_SYMBOLS * sizeof(unsigned));
-  if(!bitlen) return 83; /*alloc fail*/
+  unsigned i;
+  unsigned bitlen[NUM_DISTANCE_SYMBOLS];
 
   /*there are 32 distance codes, but 30-31 are unused*/
   for(i = 0; i != NUM_DISTANCE_SYMBOLS; ++i) bitlen[i] = 5;
-  error = HuffmanTree_makeFromLengths(tree, bitlen, NUM_DISTANCE_SYMBOLS, 15);
-
-  lodepng_free(bitlen);
-  return error;
+  return HuffmanTree_makeFromLengths(tree, bitlen, NUM_DISTANCE_SYMBOLS, 15);
 }
 
 #ifdef LODEPNG_COMPILE_DECODER
 
+/*
+decodes the symbol at the start of bits (the next bits of the stream, cf. peekBitsFromStream), *len receives
+the length of its code. Returns INVALIDSYMBOL if the bits are no code of the tree.
+*/
+static unsigned huffmanDecodeBits(const HuffmanTree* codetree, unsigned long long bits, unsigned* len)
+{
+  unsigned index = (unsigned)bits & ((1u << FIRSTBITS) - 1u);
+  unsigned l = codetree->table_len[index];
+  unsigned value = codetree->table_value[index];
+  if(l > FIRSTBITS)
+  {
+    index = value + ((unsigned)(bits >> FIRSTBITS) & ((1u << (l - FIRSTBITS)) - 1u));
+    l = codetree->table_len[index];
+    value = codetree->table_value[index];
+  }
+  *len = l;
+  return value;
+}
+
 /*
 returns the code, or (unsigned)(-1) if error happened
 inbitlength is the length of the complete buffer, in bits (so its byte length times 8)
@@ -922,21 +1128,13 @@ inbitlength is the length of the complete buffer, in bits (so its byte length ti
 static unsigned huffmanDecodeSymbol(const unsigned char* in, size_t* bp,
                                     const HuffmanTree* codetree, size_t inbitlength)
 {
-  unsigned treepos = 0, ct;
-  for(;;)
-  {
-    if(*bp >= inbitlength) return (unsigned)(-1); /*error: end of input memory reached without endcode*/
-    /*
-    decode the symbol from the tree. The "readBitFromStream" code is inlined in
-    the expression below because this is the biggest bottleneck while decoding
-    */
-    ct = codetree->tree2d[(treepos << 1) + READBIT(*bp, in)];
-    ++(*bp);
-    if(ct < codetree->numcodes) return ct; /*the symbol is decoded, return it*/
-    else treepos = ct - codetree->numcodes; /*symbol not yet decoded, instead move tree position*/
-
-    if(treepos >= codetree->numcodes) return (unsigned)(-1); /*error: it appeared outside the codetree*/
-  }
+  unsigned len, code;
+  if(*bp >= inbitlength) return (unsigned)(-1); /*error: end of input memory reached without endcode*/
+  code = huffmanDecodeBits(codetree, peekBitsFromStream(*bp, in, inbitlength), &len);
+  if(code == INVALIDSYMBOL) return (unsigned)(-1); /*error: the bits are no code of the tree*/
+  *bp += len;
+  if(*bp > inbitlength) return (unsigned)(-1); /*error: the code runs past the end of the input*/
+  return code;
 }
 #endif /*LODEPNG_COMPILE_DECODER*/
 
@@ -946,17 +1144,41 @@ static unsigned huffmanDecodeSymbol(const unsigned char* in, size_t* bp,
 /* / Inflator (Decompressor)                                                / */
 /* ////////////////////////////////////////////////////////////////////////// */
 
+/*the Huffman trees of the inflater, whose memory is reused by the next block and, in LodePNGBuffers, the next call*/
+typedef struct InflateTrees
+{
+  HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
+  HuffmanTree tree_d; /*the huffman tree for distance codes*/
+  HuffmanTree tree_cl; /*the code tree for code length codes (the huffman tree for compressed huffman trees)*/
+} InflateTrees;
+
+static void inflateTrees_init(InflateTrees* trees)
+{
+  HuffmanTree_init(&trees->tree_ll);
+  HuffmanTree_init(&trees->tree_d);
+  HuffmanTree_init(&trees->tree_cl);
+}
+
+static void inflateTrees_cleanup(InflateTrees* trees)
+{
+  HuffmanTree_cleanup(&trees->tree_ll);
+  HuffmanTree_cleanup(&trees->tree_d);
+  HuffmanTree_cleanup(&trees->tree_cl);
+}
+
 /*get the tree of a deflated block with fixed tree, as specified in the deflate specification*/
-static void getTreeInflateFixed(HuffmanTree* tree_ll, HuffmanTree* tree_d)
+static unsigned getTreeInflateFixed(HuffmanTree* tree_ll, HuffmanTree* tree_d)
 {
-  /*TODO: check for out of memory errors*/
-  generateFixedLitLenTree(tree_ll);
-  generateFixedDistanceTree(tree_d);
+  unsigned error = generateFixedLitLenTree(tree_ll);
+  if(!error) error = generateFixedDistanceTree(tree_d);
+  return error;
 }
 
-/*get the tree of a deflated block with dynamic tree, the tree itself is also Huffman compressed with a known tree*/
-static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
-                                      const unsigned char* in, size_t* bp, size_t inlength)
+/*
+get the tree of a deflated block with dynamic tree, the tree itself is also Huffman compressed with a known tree.
+The code lengths are read into the lengths of the trees.
+*/
+static unsigned getTreeInflateDynamic(InflateTrees* trees, const unsigned char* in, size_t* bp, size_t inlength)
 {
   /*make sure that length values that aren't filled in will be 0, or a wrong tree will be generated*/
   unsigned error = 0;
@@ -964,11 +1186,13 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   size_t inbitlength = inlength * 8;
 
   /*see comments in deflateDynamic for explanation of the context and these variables, it is analogous*/
+  HuffmanTree* tree_ll = &trees->tree_ll;
+  HuffmanTree* tree_d = &trees->tree_d;
+  HuffmanTree* tree_cl = &trees->tree_cl;
   unsigned* bitlen_ll = 0; /*lit,len code lengths*/
   unsigned* bitlen_d = 0; /*dist code lengths*/
   /*code length code lengths ("clcl"), the bit lengths of the huffman tree used to compress bitlen_ll and bitlen_d*/
   unsigned* bitlen_cl = 0;
-  HuffmanTree tree_cl; /*the code tree for code length codes (the huffman tree for compressed huffman trees)*/
 
   if((*bp) + 14 > (inlength << 3)) return 49; /*error: the bit pointer is or will go past the memory*/
 
@@ -981,14 +1205,13 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
 
   if((*bp) + HCLEN * 3 > (inlength << 3)) return 50; /*error: the bit pointer is or will go past the memory*/
 
-  HuffmanTree_init(&tree_cl);
-
   while(!error)
   {
     /*read the code length codes out of 3 * (amount of code length codes) bits*/
 
-    bitlen_cl = (unsigned*)lodepng_malloc(NUM_CODE_LENGTH_CODES * sizeof(unsigned));
-    if(!bitlen_cl) ERROR_BREAK(83 /*alloc fail*/);
+    error = HuffmanTree_resize(tree_cl, NUM_CODE_LENGTH_CODES);
+    if(error) break;
+    bitlen_cl = tree_cl->lengths;
 
     for(i = 0; i != NUM_CODE_LENGTH_CODES; ++i)
     {
@@ -996,13 +1219,15 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
       else bitlen_cl[CLCL_ORDER[i]] = 0; /*if not, it must stay 0*/
     }
 
-    error = HuffmanTree_makeFromLengths(&tree_cl, bitlen_cl, NUM_CODE_LENGTH_CODES, 7);
+    error = HuffmanTree_makeFromLengths(tree_cl, bitlen_cl, NUM_CODE_LENGTH_CODES, 7);
     if(error) break;
 
     /*now we can use this tree to read the lengths for the tree that this function will return*/
-    bitlen_ll = (unsigned*)lodepng_malloc(NUM_DEFLATE_CODE_SYMBOLS * sizeof(unsigned));
-    bitlen_d = (unsigned*)lodepng_malloc(NUM_DISTANCE_SYMBOLS * sizeof(unsigned));
-    if(!bitlen_ll || !bitlen_d) ERROR_BREAK(83 /*alloc fail*/);
+    error = HuffmanTree_resize(tree_ll, NUM_DEFLATE_CODE_SYMBOLS);
+    if(!error) error = HuffmanTree_resize(tree_d, NUM_DISTANCE_SYMBOLS);
+    if(error) break;
+    bitlen_ll = tree_ll->lengths;
+    bitlen_d = tree_d->lengths;
     for(i = 0; i != NUM_DEFLATE_CODE_SYMBOLS; ++i) bitlen_ll[i] = 0;
     for(i = 0; i != NUM_DISTANCE_SYMBOLS; ++i) bitlen_d[i] = 0;
 
@@ -1010,7 +1235,7 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
     i = 0;
     while(i < HLIT + HDIST)
     {
-      unsigned code = huffmanDecodeSymbol(in, bp, &tree_cl, inbitlength);
+      unsigned code = huffmanDecodeSymbol(in, bp, tree_cl, inbitlength);
       if(code <= 15) /*a length code*/
       {
         if(i < HLIT) bitlen_ll[i] = code;
@@ -1094,33 +1319,76 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
     break; /*end of error-while*/
   }
 
-  lodepng_free(bitlen_cl);
-  lodepng_free(bitlen_ll);
-  lodepng_free(bitlen_d);
-  HuffmanTree_cleanup(&tree_cl);
+  return error;
+}
+
+/*the largest backward distance of deflate*/
+#define INFLATE_WINDOW 32768
+/*when inflating as a stream, the output is handed on in pieces of about this size*/
+#define INFLATE_STREAM_CHUNK 131072
 
+static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len);
+
+/*receives the inflated data piece by piece when inflating as a stream (see zlib_decompress_stream)*/
+typedef struct InflateSink
+{
+  unsigned (*write)(void* user, const unsigned char* data, size_t size); /*returns an error code or 0*/
+  void* user;
+  size_t written; /*the bytes of the out buffer before this index were handed to write already*/
+  unsigned adler; /*Adler-32 of all data handed to write*/
+} InflateSink;
+
+/*hands the new bytes of out to the sink, then keeps only the last INFLATE_WINDOW bytes of out*/
+static unsigned inflateStreamFlush(ucvector* out, size_t* pos, InflateSink* sink)
+{
+  unsigned error = 0;
+  if(*pos > sink->written)
+  {
+    size_t keep = *pos < INFLATE_WINDOW ? *pos : INFLATE_WINDOW;
+    sink->adler = update_adler32(sink->adler, &out->data[sink->written], (unsigned)(*pos - sink->written));
+    error = sink->write(sink->user, &out->data[sink->written], *pos - sink->written);
+    memmove(out->data, &out->data[*pos - keep], keep);
+    out->size = *pos = sink->written = keep;
+  }
   return error;
 }
 
-/*inflate a block with dynamic of fixed Huffman tree*/
+/*inflate a block with dynamic of fixed Huffman tree made in trees, sink is 0 unless inflating as a stream*/
 static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size_t* bp,
-                                    size_t* pos, size_t inlength, unsigned btype)
+                                    size_t* pos, size_t inlength, unsigned btype, InflateSink* sink,
+                                    InflateTrees* trees)
 {
   unsigned error = 0;
-  HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
-  HuffmanTree tree_d; /*the huffman tree for distance codes*/
+  const HuffmanTree* tree_ll = &trees->tree_ll; /*the huffman tree for literal and length codes*/
+  const HuffmanTree* tree_d = &trees->tree_d; /*the huffman tree for distance codes*/
   size_t inbitlength = inlength * 8;
 
-  HuffmanTree_init(&tree_ll);
-  HuffmanTree_init(&tree_d);
-
-  if(btype == 1) getTreeInflateFixed(&tree_ll, &tree_d);
-  else if(btype == 2) error = getTreeInflateDynamic(&tree_ll, &tree_d, in, bp, inlength);
+  if(btype == 1) error = getTreeInflateFixed(&trees->tree_ll, &trees->tree_d);
+  else if(btype == 2) error = getTreeInflateDynamic(trees, in, bp, inlength);
 
   while(!error) /*decode all symbols until end reached, breaks at end code*/
   {
+    /*
+    one read of the stream yields at least 57 bits, enough for a length code with its extra bits (15 + 5)
+    and the distance code with its extra bits (15 + 13)
+    */
+    unsigned long long bits;
+    unsigned code_ll, len;
+
+    if(sink && *pos >= INFLATE_WINDOW + INFLATE_STREAM_CHUNK)
+    {
+      error = inflateStreamFlush(out, pos, sink);
+      if(error) break;
+    }
+
+    if(*bp >= inbitlength) ERROR_BREAK(10); /*error: end of input memory reached without endcode*/
+    bits = peekBitsFromStream(*bp, in, inbitlength);
+
     /*code_ll is literal, length or end code*/
-    unsigned code_ll = huffmanDecodeSymbol(in, bp, &tree_ll, inbitlength);
+    code_ll = huffmanDecodeBits(tree_ll, bits, &len);
+    bits >>= len;
+    *bp += len;
+
     if(code_ll <= 255) /*literal symbol*/
     {
       /*ucvector_push_back would do the same, but for some reason the two lines below run 10% faster*/
@@ -1139,18 +1407,21 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
 
       /*part 2: get extra bits and add the value of that to length*/
       numextrabits_l = LENGTHEXTRA[code_ll - FIRST_LENGTH_CODE_INDEX];
-      if((*bp + numextrabits_l) > inbitlength) ERROR_BREAK(51); /*error, bit pointer will jump past memory*/
-      length += readBitsFromStream(bp, in, numextrabits_l);
+      length += (unsigned)bits & ((1u << numextrabits_l) - 1u);
+      bits >>= numextrabits_l;
+      *bp += numextrabits_l;
 
       /*part 3: get distance code*/
-      code_d = huffmanDecodeSymbol(in, bp, &tree_d, inbitlength);
+      code_d = huffmanDecodeBits(tree_d, bits, &len);
+      bits >>= len;
+      *bp += len;
       if(code_d > 29)
       {
-        if(code_ll == (unsigned)(-1)) /*huffmanDecodeSymbol returns (unsigned)(-1) in case of error*/
+        if(code_d == INVALIDSYMBOL)
         {
-          /*return error code 10 or 11 depending on the situation that happened in huffmanDecodeSymbol
-          (10=no endcode, 11=wrong jump outside of tree)*/
-          error = (*bp) > inlength * 8 ? 10 : 11;
+          /*return error code 10 or 11 depending on whether the end of the input was reached
+          (10=no endcode, 11=invalid code)*/
+          error = (*bp) > inbitlength ? 10 : 11;
         }
         else error = 18; /*error: invalid distance code (30-31 are never used)*/
         break;
@@ -1159,8 +1430,9 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
 
       /*part 4: get extra bits from distance*/
       numextrabits_d = DISTANCEEXTRA[code_d];
-      if((*bp + numextrabits_d) > inbitlength) ERROR_BREAK(51); /*error, bit pointer will jump past memory*/
-      distance += readBitsFromStream(bp, in, numextrabits_d);
+      distance += (unsigned)bits & ((1u << numextrabits_d) - 1u);
+      *bp += numextrabits_d;
+      if(*bp > inbitlength) ERROR_BREAK(51); /*error, bit pointer jumped past memory*/
 
       /*part 5: fill in all the out[n] values based on the length and dist*/
       start = (*pos);
@@ -1180,19 +1452,20 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
     }
     else if(code_ll == 256)
     {
+      /*the bits read past the end of the input may form an end code, too*/
+      if(*bp > inbitlength) error = 10;
       break; /*end code, break the loop*/
     }
-    else /*if(code == (unsigned)(-1))*/ /*huffmanDecodeSymbol returns (unsigned)(-1) in case of error*/
+    else /*huffmanDecodeBits returns INVALIDSYMBOL for bits that are no code*/
     {
-      /*return error code 10 or 11 depending on the situation that happened in huffmanDecodeSymbol
-      (10=no endcode, 11=wrong jump outside of tree)*/
-      error = ((*bp) > inlength * 8) ? 10 : 11;
+      /*return error code 10 or 11 depending on whether the end of the input was reached
+      (10=no endcode, 11=invalid code)*/
+      error = ((*bp) > inbitlength) ? 10 : 11;
       break;
     }
-  }
 
-  HuffmanTree_cleanup(&tree_ll);
-  HuffmanTree_cleanup(&tree_d);
+    if(*bp > inbitlength) ERROR_BREAK(10); /*error: the code ran past the end of the input*/
+  }
 
   return error;
 }
@@ -1207,7 +1480,7 @@ static unsigned inflateNoCompression(ucvector* out, const unsigned char* in, siz
   p = (*bp) / 8; /*byte position*/
 
   /*read LEN (2 bytes) and NLEN (2 bytes)*/
-  if(p + 4 >= inlength) return 52; /*error, bit pointer will jump past memory*/
+  if(p + 4 > inlength) return 52; /*error, bit pointer will jump past memory*/
   LEN = in[p] + 256u * in[p + 1]; p += 2;
   NLEN = in[p] + 256u * in[p + 1]; p += 2;
 
@@ -1225,33 +1498,52 @@ static unsigned inflateNoCompression(ucvector* out, const unsigned char* in, siz
   return error;
 }
 
+/*
+with a sink, the output is handed to the sink and out holds only the window of the last 32 KB at the end.
+trees holds the Huffman trees kept between calls by the caller, or is NULL to use temporary ones.
+*/
 static unsigned lodepng_inflatev(ucvector* out,
                                  const unsigned char* in, size_t insize,
-                                 const LodePNGDecompressSettings* settings)
+                                 const LodePNGDecompressSettings* settings, InflateSink* sink,
+                                 InflateTrees* trees)
 {
   /*bit pointer in the "in" data, current byte is bp >> 3, current bit is bp & 0x7 (from lsb to msb of the byte)*/
   size_t bp = 0;
   unsigned BFINAL = 0;
   size_t pos = 0; /*byte position in the out buffer*/
   unsigned error = 0;
+  InflateTrees temp;
 
   (void)settings;
 
-  while(!BFINAL)
+  if(!trees)
+  {
+    inflateTrees_init(&temp);
+    trees = &temp;
+  }
+
+  while(!BFINAL && !error)
   {
     unsigned BTYPE;
-    if(bp + 2 >= insize * 8) return 52; /*error, bit pointer will jump past memory*/
+    if(bp + 2 >= insize * 8) ERROR_BREAK(52); /*error, bit pointer will jump past memory*/
     BFINAL = readBitFromStream(&bp, in);
     BTYPE = 1u * readBitFromStream(&bp, in);
     BTYPE += 2u * readBitFromStream(&bp, in);
 
-    if(BTYPE == 3) return 20; /*error: invalid BTYPE*/
-    else if(BTYPE == 0) error = inflateNoCompression(out, in, &bp, &pos, insize); /*no compression*/
-    else error = inflateHuffmanBlock(out, in, &bp, &pos, insize, BTYPE); /*compression, BTYPE 01 or 10*/
+    if(BTYPE == 3) ERROR_BREAK(20); /*error: invalid BTYPE*/
 
-    if(error) return error;
+    if(BTYPE == 0) error = inflateNoCompression(out, in, &bp, &pos, insize); /*no compression*/
+    else error = inflateHuffmanBlock(out, in, &bp, &pos, insize, BTYPE, sink, trees); /*compression, BTYPE 01 or 10*/
+
+    /*blocks without compression are flushed here, they have up to 65535 bytes*/
+    if(!error && sink && (BFINAL || pos >= INFLATE_WINDOW + INFLATE_STREAM_CHUNK))
+    {
+      error = inflateStreamFlush(out, &pos, sink);
+    }
   }
 
+  if(trees == &temp) inflateTrees_cleanup(&temp);
+
   return error;
 }
 
@@ -1262,7 +1554,7 @@ unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
   unsigned error;
   ucvector v;
   ucvector_init_buffer(&v, *out, *outsize);
-  error = lodepng_inflatev(&v, in, insize, settings);
+  error = lodepng_inflatev(&v, in, insize, settings, 0, 0);
   *out = v.data;
   *outsize = v.size;
   return error;
@@ -1355,22 +1647,81 @@ typedef struct Hash
   int* headz; /*similar to head, but for chainz*/
   unsigned short* chainz; /*those with same amount of zeros*/
   unsigned short* zeros; /*length of zeros streak, used as a second hash chain*/
+
+  unsigned windowsize; /*the size the tables above are allocated for*/
+
+  /*used instead of the above by the fast compression levels, see encodeLZ77Fast*/
+  size_t* fast; /*hash value of 4 bytes to their last position + 1, 0 if none*/
+  unsigned fastbits; /*the hash values have fastbits bits*/
+
+  uivector lz77; /*the lz77 encoded values of the current block, its memory is reused by the next block*/
+
+  /*like lz77, the Huffman trees and code lengths of deflateDynamic and deflateFixed reuse their memory*/
+  HuffmanTree tree_ll, tree_d, tree_cl;
+  uivector frequencies_ll, frequencies_d, frequencies_cl;
+  uivector bitlen_lld, bitlen_lld_e, bitlen_cl;
+  BPMMemory* bpm; /*allocated by the first dynamic block*/
 } Hash;
 
-static unsigned hash_init(Hash* hash, unsigned windowsize)
+/*the tables are allocated by hash_reset or hash_reset_fast, and kept until hash_cleanup*/
+static void hash_init(Hash* hash)
+{
+  hash->head = 0;
+  hash->chain = 0;
+  hash->val = 0;
+  hash->headz = 0;
+  hash->chainz = 0;
+  hash->zeros = 0;
+  hash->windowsize = 0;
+  hash->fast = 0;
+  hash->fastbits = 0;
+  uivector_init(&hash->lz77);
+  HuffmanTree_init(&hash->tree_ll);
+  HuffmanTree_init(&hash->tree_d);
+  HuffmanTree_init(&hash->tree_cl);
+  uivector_init(&hash->frequencies_ll);
+  uivector_init(&hash->frequencies_d);
+  uivector_init(&hash->frequencies_cl);
+  uivector_init(&hash->bitlen_lld);
+  uivector_init(&hash->bitlen_lld_e);
+  uivector_init(&hash->bitlen_cl);
+  hash->bpm = 0;
+}
+
+static void hash_free_chains(Hash* hash)
+{
+  lodepng_free(hash->head);
+  lodepng_free(hash->val);
+  lodepng_free(hash->chain);
+  lodepng_free(hash->zeros);
+  lodepng_free(hash->headz);
+  lodepng_free(hash->chainz);
+  hash->head = hash->val = hash->headz = 0;
+  hash->chain = hash->zeros = hash->chainz = 0;
+  hash->windowsize = 0;
+}
+
+/*empties the hash chains for new data, allocating them unless they are there from an earlier use*/
+static unsigned hash_reset(Hash* hash, unsigned windowsize)
 {
   unsigned i;
-  hash->head = (int*)lodepng_malloc(sizeof(int) * HASH_NUM_VALUES);
-  hash->val = (int*)lodepng_malloc(sizeof(int) * windowsize);
-  hash->chain = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
+  if(!hash->head || hash->windowsize != windowsize)
+  {
+    hash_free_chains(hash);
+    hash->head = (int*)lodepng_malloc(sizeof(int) * HASH_NUM_VALUES);
+    hash->val = (int*)lodepng_malloc(sizeof(int) * windowsize);
+    hash->chain = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
 
-  hash->zeros = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
-  hash->headz = (int*)lodepng_malloc(sizeof(int) * (MAX_SUPPORTED_DEFLATE_LENGTH + 1));
-  hash->chainz = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
+    hash->zeros = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
+    hash->headz = (int*)lodepng_malloc(sizeof(int) * (MAX_SUPPORTED_DEFLATE_LENGTH + 1));
+    hash->chainz = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
 
-  if(!hash->head || !hash->chain || !hash->val  || !hash->headz|| !hash->chainz || !hash->zeros)
-  {
-    return 83; /*alloc fail*/
+    if(!hash->head || !hash->chain || !hash->val  || !hash->headz|| !hash->chainz || !hash->zeros)
+    {
+      hash_free_chains(hash);
+      return 83; /*alloc fail*/
+    }
+    hash->windowsize = windowsize;
   }
 
   /*initialize hash table*/
@@ -1384,15 +1735,38 @@ static unsigned hash_init(Hash* hash, unsigned windowsize)
   return 0;
 }
 
-static void hash_cleanup(Hash* hash)
+/*like hash_reset, for the table of the fast compression levels*/
+static unsigned hash_reset_fast(Hash* hash, unsigned numbits)
 {
-  lodepng_free(hash->head);
-  lodepng_free(hash->val);
-  lodepng_free(hash->chain);
+  size_t i, size = (size_t)1 << numbits;
+  if(!hash->fast || hash->fastbits != numbits)
+  {
+    lodepng_free(hash->fast);
+    hash->fastbits = numbits;
+    hash->fast = (size_t*)lodepng_malloc(sizeof(size_t) * size);
+    if(!hash->fast) return 83; /*alloc fail*/
+  }
+  for(i = 0; i != size; ++i) hash->fast[i] = 0;
+  return 0;
+}
 
-  lodepng_free(hash->zeros);
-  lodepng_free(hash->headz);
-  lodepng_free(hash->chainz);
+static void hash_cleanup(Hash* hash)
+{
+  hash_free_chains(hash);
+  lodepng_free(hash->fast);
+  hash->fast = 0;
+  uivector_cleanup(&hash->lz77);
+  HuffmanTree_cleanup(&hash->tree_ll);
+  HuffmanTree_cleanup(&hash->tree_d);
+  HuffmanTree_cleanup(&hash->tree_cl);
+  uivector_cleanup(&hash->frequencies_ll);
+  uivector_cleanup(&hash->frequencies_d);
+  uivector_cleanup(&hash->frequencies_cl);
+  uivector_cleanup(&hash->bitlen_lld);
+  uivector_cleanup(&hash->bitlen_lld_e);
+  uivector_cleanup(&hash->bitlen_cl);
+  lodepng_free(hash->bpm);
+  hash->bpm = 0;
 }
 
 
@@ -1627,16 +2001,114 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
   return error;
 }
 
-/* /////////////////////////////////////////////////////////////////////////// */
-
-static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize)
+static unsigned readUint32(const unsigned char* data)
 {
-  /*non compressed deflate block data: 1 bit BFINAL,2 bits BTYPE,(5 bits): it jumps to start of next byte,
-  2 bytes LEN, 2 bytes NLEN, LEN bytes literal DATA*/
+  unsigned result;
+  memcpy(&result, data, 4);
+  return result;
+}
 
-  size_t i, j, numdeflateblocks = (datasize + 65534) / 65535;
-  unsigned datapos = 0;
-  for(i = 0; i != numdeflateblocks; ++i)
+/*size of the hash table of the fast compression levels 1, 2 and 3, in bits*/
+static const unsigned FAST_HASH_BITS[3] = {14, 15, 16};
+
+/*
+LZ77 encoding for the fast compression levels, same output format as encodeLZ77. Instead of hash chains there
+is a single table with the last position of each hash value of 4 bytes, so each position is tested against
+one candidate only, and the match is taken without lazy matching. Level 1 does not add the positions inside
+matches to the table and skips ahead faster the longer no match is found, level 2 adds them, and level 3 in
+addition has the largest table.
+*/
+static unsigned encodeLZ77Fast(uivector* out, Hash* hash,
+                               const unsigned char* in, size_t inpos, size_t insize, unsigned level)
+{
+  size_t* table = hash->fast;
+  unsigned shift = 32 - hash->fastbits;
+  size_t pos = inpos, i;
+  unsigned misses = 0;
+
+  /*the table holds positions of the whole input, matches may reach back into the previous block*/
+  while(pos + 4 <= insize)
+  {
+    unsigned current = readUint32(&in[pos]);
+    unsigned hashval = (current * 2654435761u) >> shift;
+    size_t candidate = table[hashval];
+    table[hashval] = pos + 1;
+
+    if(candidate && pos + 1 - candidate <= 32768 && readUint32(&in[candidate - 1]) == current)
+    {
+      const unsigned char* backptr = &in[candidate - 1 + 4];
+      const unsigned char* foreptr = &in[pos + 4];
+      const unsigned char* lastptr = &in[insize < pos + MAX_SUPPORTED_DEFLATE_LENGTH ?
+                                         insize : pos + MAX_SUPPORTED_DEFLATE_LENGTH];
+      unsigned length;
+      while(foreptr != lastptr && *backptr == *foreptr)
+      {
+        ++backptr;
+        ++foreptr;
+      }
+      length = (unsigned)(foreptr - &in[pos]);
+
+      addLengthDistance(out, length, pos + 1 - candidate);
+      if(level >= 2)
+      {
+        /*level 2 adds the last positions of the match only, which are the most likely to continue it*/
+        for(i = (level == 2 && length > 4) ? pos + length - 3 : pos + 1; i != pos + length && i + 4 <= insize; ++i)
+        {
+          table[(readUint32(&in[i]) * 2654435761u) >> shift] = i + 1;
+        }
+      }
+      pos += length;
+      misses = 0;
+    }
+    else
+    {
+      /*level 1: after 32 misses in a row, emit 2 literals per probe, after 64 misses 3, ...*/
+      size_t step = level == 1 ? 1 + (misses >> 5) : 1;
+      if(pos + step > insize) step = insize - pos;
+      for(i = 0; i != step; ++i)
+      {
+        if(!uivector_push_back(out, in[pos + i])) return 83; /*alloc fail*/
+      }
+      pos += step;
+      ++misses;
+    }
+  }
+
+  /*the last bytes are too few to be hashed*/
+  for(; pos < insize; ++pos)
+  {
+    if(!uivector_push_back(out, in[pos])) return 83; /*alloc fail*/
+  }
+
+  return 0;
+}
+
+/*whether the settings select one of the fast compression levels*/
+static unsigned isFastLevel(const LodePNGCompressSettings* settings)
+{
+  return settings->level >= 1 && settings->level <= 3;
+}
+
+/*LZ77 encoding with the method chosen by the settings*/
+static unsigned encodeLZ77Settings(uivector* out, Hash* hash, const unsigned char* in, size_t inpos, size_t insize,
+                                   const LodePNGCompressSettings* settings)
+{
+  if(isFastLevel(settings)) return encodeLZ77Fast(out, hash, in, inpos, insize, settings->level);
+  return encodeLZ77(out, hash, in, inpos, insize, settings->windowsize,
+                    settings->minmatch, settings->nicematch, settings->lazymatching);
+}
+
+/* /////////////////////////////////////////////////////////////////////////// */
+
+static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize)
+{
+  /*non compressed deflate block data: 1 bit BFINAL,2 bits BTYPE,(5 bits): it jumps to start of next byte,
+  2 bytes LEN, 2 bytes NLEN, LEN bytes literal DATA*/
+
+  size_t i, j, numdeflateblocks = (datasize + 65534) / 65535;
+  unsigned datapos = 0;
+  if(numdeflateblocks == 0) numdeflateblocks = 1; /*empty data still needs a final block*/
+  for(i = 0; i != numdeflateblocks; ++i)
   {
     unsigned BFINAL, BTYPE, LEN, NLEN;
     unsigned char firstbyte;
@@ -1671,32 +2143,84 @@ write the lz77-encoded data, which has lit, len and dist codes, to compressed st
 tree_ll: the tree for lit and len codes.
 tree_d: the tree for distance codes.
 */
-static void writeLZ77data(size_t* bp, ucvector* out, const uivector* lz77_encoded,
-                          const HuffmanTree* tree_ll, const HuffmanTree* tree_d)
+/*
+writes the lz77 encoded symbols with the huffman codes of the trees. The bits are collected in a 64-bit buffer
+and written 4 bytes at a time, with the same result as addHuffmanSymbol and addBitsToStream for each symbol.
+return value is error.
+*/
+static unsigned writeLZ77data(size_t* bp, ucvector* out, const uivector* lz77_encoded,
+                              const HuffmanTree* tree_ll, const HuffmanTree* tree_d)
 {
-  size_t i = 0;
-  for(i = 0; i != lz77_encoded->size; ++i)
+  unsigned codes_ll[288], codes_d[32]; /*the codes in the order they are written*/
+  unsigned long long buffer = 0;
+  unsigned numbits = (unsigned)((*bp) & 7), i, j;
+  size_t k, pos = out->size;
+  unsigned char* data;
+
+  for(i = 0; i != tree_ll->numcodes && i != 288; ++i)
+  {
+    unsigned code = HuffmanTree_getCode(tree_ll, i), len = HuffmanTree_getLength(tree_ll, i);
+    codes_ll[i] = 0;
+    for(j = 0; j != len; ++j) codes_ll[i] |= ((code >> j) & 1u) << (len - 1 - j);
+  }
+  for(i = 0; i != tree_d->numcodes && i != 32; ++i)
   {
-    unsigned val = lz77_encoded->data[i];
-    addHuffmanSymbol(bp, out, HuffmanTree_getCode(tree_ll, val), HuffmanTree_getLength(tree_ll, val));
+    unsigned code = HuffmanTree_getCode(tree_d, i), len = HuffmanTree_getLength(tree_d, i);
+    codes_d[i] = 0;
+    for(j = 0; j != len; ++j) codes_d[i] |= ((code >> j) & 1u) << (len - 1 - j);
+  }
+
+  /*a literal takes up to 15 bits, a length/distance pair up to 48 bits for its 4 values, so every value
+  needs at most 2 bytes*/
+  if(!ucvector_reserve(out, out->size + 2 * lz77_encoded->size + 8)) return 83; /*alloc fail*/
+  data = out->data;
+  if(numbits) buffer = data[--pos]; /*continue in the partially filled last byte*/
+
+#define FLUSH_BITS() if(numbits >= 32)\
+  {\
+    data[pos + 0] = (unsigned char)(buffer); data[pos + 1] = (unsigned char)(buffer >> 8);\
+    data[pos + 2] = (unsigned char)(buffer >> 16); data[pos + 3] = (unsigned char)(buffer >> 24);\
+    pos += 4; buffer >>= 32; numbits -= 32;\
+  }
+
+  for(k = 0; k != lz77_encoded->size; ++k)
+  {
+    unsigned val = lz77_encoded->data[k];
+    buffer |= (unsigned long long)codes_ll[val] << numbits;
+    numbits += HuffmanTree_getLength(tree_ll, val);
+    FLUSH_BITS();
     if(val > 256) /*for a length code, 3 more things have to be added*/
     {
       unsigned length_index = val - FIRST_LENGTH_CODE_INDEX;
       unsigned n_length_extra_bits = LENGTHEXTRA[length_index];
-      unsigned length_extra_bits = lz77_encoded->data[++i];
+      unsigned length_extra_bits = lz77_encoded->data[++k];
 
-      unsigned distance_code = lz77_encoded->data[++i];
+      unsigned distance_code = lz77_encoded->data[++k];
 
       unsigned distance_index = distance_code;
       unsigned n_distance_extra_bits = DISTANCEEXTRA[distance_index];
-      unsigned distance_extra_bits = lz77_encoded->data[++i];
+      unsigned distance_extra_bits = lz77_encoded->data[++k];
 
-      addBitsToStream(bp, out, length_extra_bits, n_length_extra_bits);
-      addHuffmanSymbol(bp, out, HuffmanTree_getCode(tree_d, distance_code),
-                       HuffmanTree_getLength(tree_d, distance_code));
-      addBitsToStream(bp, out, distance_extra_bits, n_distance_extra_bits);
+      buffer |= (unsigned long long)length_extra_bits << numbits;
+      numbits += n_length_extra_bits;
+      buffer |= (unsigned long long)codes_d[distance_code] << numbits;
+      numbits += HuffmanTree_getLength(tree_d, distance_code);
+      FLUSH_BITS();
+      buffer |= (unsigned long long)distance_extra_bits << numbits;
+      numbits += n_distance_extra_bits;
+      FLUSH_BITS();
     }
   }
+#undef FLUSH_BITS
+
+  *bp = pos * 8 + numbits;
+  for(; numbits > 0; numbits = numbits > 8 ? numbits - 8 : 0)
+  {
+    data[pos++] = (unsigned char)buffer;
+    buffer >>= 8;
+  }
+  out->size = pos;
+  return 0;
 }
 
 /*Deflate for a block of type "dynamic", that is, with freely, optimally, created huffman trees*/
@@ -1744,31 +2268,36 @@ static unsigned deflateDynamic(ucvector* out, size_t* bp, Hash* hash,
   size_t numcodes_ll, numcodes_d, i;
   unsigned HLIT, HDIST, HCLEN;
 
-  uivector_init(&lz77_encoded);
-  HuffmanTree_init(&tree_ll);
-  HuffmanTree_init(&tree_d);
-  HuffmanTree_init(&tree_cl);
-  uivector_init(&frequencies_ll);
-  uivector_init(&frequencies_d);
-  uivector_init(&frequencies_cl);
-  uivector_init(&bitlen_lld);
-  uivector_init(&bitlen_lld_e);
-  uivector_init(&bitlen_cl);
+  /*all of these reuse the memory of the previous block, given back to the hash at the end*/
+  lz77_encoded = hash->lz77;
+  tree_ll = hash->tree_ll;
+  tree_d = hash->tree_d;
+  tree_cl = hash->tree_cl;
+  frequencies_ll = hash->frequencies_ll;
+  frequencies_d = hash->frequencies_d;
+  frequencies_cl = hash->frequencies_cl;
+  bitlen_lld = hash->bitlen_lld;
+  bitlen_lld_e = hash->bitlen_lld_e;
+  bitlen_cl = hash->bitlen_cl;
+  lz77_encoded.size = frequencies_ll.size = frequencies_d.size = frequencies_cl.size = 0;
+  bitlen_lld.size = bitlen_lld_e.size = bitlen_cl.size = 0;
 
   /*This while loop never loops due to a break at the end, it is here to
   allow breaking out of it to the cleanup phase on error conditions.*/
   while(!error)
   {
+    if(!hash->bpm) hash->bpm = (BPMMemory*)lodepng_malloc(sizeof(BPMMemory));
+    if(!hash->bpm) ERROR_BREAK(83 /*alloc fail*/);
+
     if(settings->use_lz77)
     {
-      error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                         settings->minmatch, settings->nicematch, settings->lazymatching);
+      error = encodeLZ77Settings(&lz77_encoded, hash, data, datapos, dataend, settings);
       if(error) break;
     }
     else
     {
       if(!uivector_resize(&lz77_encoded, datasize)) ERROR_BREAK(83 /*alloc fail*/);
-      for(i = datapos; i < dataend; ++i) lz77_encoded.data[i] = data[i]; /*no LZ77, but still will be Huffman compressed*/
+      for(i = datapos; i < dataend; ++i) lz77_encoded.data[i - datapos] = data[i]; /*no LZ77, but still will be Huffman compressed*/
     }
 
     if(!uivector_resizev(&frequencies_ll, 286, 0)) ERROR_BREAK(83 /*alloc fail*/);
@@ -1789,10 +2318,10 @@ static unsigned deflateDynamic(ucvector* out, size_t* bp, Hash* hash,
     frequencies_ll.data[256] = 1; /*there will be exactly 1 end code, at the end of the block*/
 
     /*Make both huffman trees, one for the lit and len codes, one for the dist codes*/
-    error = HuffmanTree_makeFromFrequencies(&tree_ll, frequencies_ll.data, 257, frequencies_ll.size, 15);
+    error = HuffmanTree_makeFromFrequencies(&tree_ll, frequencies_ll.data, 257, frequencies_ll.size, 15, hash->bpm);
     if(error) break;
     /*2, not 1, is chosen for mincodes: some buggy PNG decoders require at least 2 symbols in the dist tree*/
-    error = HuffmanTree_makeFromFrequencies(&tree_d, frequencies_d.data, 2, frequencies_d.size, 15);
+    error = HuffmanTree_makeFromFrequencies(&tree_d, frequencies_d.data, 2, frequencies_d.size, 15, hash->bpm);
     if(error) break;
 
     numcodes_ll = tree_ll.numcodes; if(numcodes_ll > 286) numcodes_ll = 286;
@@ -1860,7 +2389,7 @@ static unsigned deflateDynamic(ucvector* out, size_t* bp, Hash* hash,
     }
 
     error = HuffmanTree_makeFromFrequencies(&tree_cl, frequencies_cl.data,
-                                            frequencies_cl.size, frequencies_cl.size, 7);
+                                            frequencies_cl.size, frequencies_cl.size, 7, hash->bpm);
     if(error) break;
 
     if(!uivector_resize(&bitlen_cl, tree_cl.numcodes)) ERROR_BREAK(83 /*alloc fail*/);
@@ -1920,7 +2449,8 @@ static unsigned deflateDynamic(ucvector* out, size_t* bp, Hash* hash,
     }
 
     /*write the compressed data symbols*/
-    writeLZ77data(bp, out, &lz77_encoded, &tree_ll, &tree_d);
+    error = writeLZ77data(bp, out, &lz77_encoded, &tree_ll, &tree_d);
+    if(error) break;
     /*error: the length of the end code 256 must be larger than 0*/
     if(HuffmanTree_getLength(&tree_ll, 256) == 0) ERROR_BREAK(64);
 
@@ -1930,17 +2460,17 @@ static unsigned deflateDynamic(ucvector* out, size_t* bp, Hash* hash,
     break; /*end of error-while*/
   }
 
-  /*cleanup*/
-  uivector_cleanup(&lz77_encoded);
-  HuffmanTree_cleanup(&tree_ll);
-  HuffmanTree_cleanup(&tree_d);
-  HuffmanTree_cleanup(&tree_cl);
-  uivector_cleanup(&frequencies_ll);
-  uivector_cleanup(&frequencies_d);
-  uivector_cleanup(&frequencies_cl);
-  uivector_cleanup(&bitlen_lld_e);
-  uivector_cleanup(&bitlen_lld);
-  uivector_cleanup(&bitlen_cl);
+  /*give the memory back to the hash*/
+  hash->lz77 = lz77_encoded;
+  hash->tree_ll = tree_ll;
+  hash->tree_d = tree_d;
+  hash->tree_cl = tree_cl;
+  hash->frequencies_ll = frequencies_ll;
+  hash->frequencies_d = frequencies_d;
+  hash->frequencies_cl = frequencies_cl;
+  hash->bitlen_lld = bitlen_lld;
+  hash->bitlen_lld_e = bitlen_lld_e;
+  hash->bitlen_cl = bitlen_cl;
 
   return error;
 }
@@ -1950,18 +2480,17 @@ static unsigned deflateFixed(ucvector* out, size_t* bp, Hash* hash,
                              size_t datapos, size_t dataend,
                              const LodePNGCompressSettings* settings, unsigned final)
 {
-  HuffmanTree tree_ll; /*tree for literal values and length codes*/
-  HuffmanTree tree_d; /*tree for distance codes*/
+  /*the trees are made in the memory of the hash*/
+  HuffmanTree* tree_ll = &hash->tree_ll; /*tree for literal values and length codes*/
+  HuffmanTree* tree_d = &hash->tree_d; /*tree for distance codes*/
 
   unsigned BFINAL = final;
   unsigned error = 0;
   size_t i;
 
-  HuffmanTree_init(&tree_ll);
-  HuffmanTree_init(&tree_d);
-
-  generateFixedLitLenTree(&tree_ll);
-  generateFixedDistanceTree(&tree_d);
+  error = generateFixedLitLenTree(tree_ll);
+  if(!error) error = generateFixedDistanceTree(tree_d);
+  if(error) return error;
 
   addBitToStream(bp, out, BFINAL);
   addBitToStream(bp, out, 1); /*first bit of BTYPE*/
@@ -1969,37 +2498,37 @@ static unsigned deflateFixed(ucvector* out, size_t* bp, Hash* hash,
 
   if(settings->use_lz77) /*LZ77 encoded*/
   {
-    uivector lz77_encoded;
-    uivector_init(&lz77_encoded);
-    error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                       settings->minmatch, settings->nicematch, settings->lazymatching);
-    if(!error) writeLZ77data(bp, out, &lz77_encoded, &tree_ll, &tree_d);
-    uivector_cleanup(&lz77_encoded);
+    uivector lz77_encoded = hash->lz77;
+    lz77_encoded.size = 0;
+    error = encodeLZ77Settings(&lz77_encoded, hash, data, datapos, dataend, settings);
+    if(!error) error = writeLZ77data(bp, out, &lz77_encoded, tree_ll, tree_d);
+    hash->lz77 = lz77_encoded;
   }
   else /*no LZ77, but still will be Huffman compressed*/
   {
     for(i = datapos; i < dataend; ++i)
     {
-      addHuffmanSymbol(bp, out, HuffmanTree_getCode(&tree_ll, data[i]), HuffmanTree_getLength(&tree_ll, data[i]));
+      addHuffmanSymbol(bp, out, HuffmanTree_getCode(tree_ll, data[i]), HuffmanTree_getLength(tree_ll, data[i]));
     }
   }
   /*add END code*/
-  if(!error) addHuffmanSymbol(bp, out, HuffmanTree_getCode(&tree_ll, 256), HuffmanTree_getLength(&tree_ll, 256));
-
-  /*cleanup*/
-  HuffmanTree_cleanup(&tree_ll);
-  HuffmanTree_cleanup(&tree_d);
+  if(!error) addHuffmanSymbol(bp, out, HuffmanTree_getCode(tree_ll, 256), HuffmanTree_getLength(tree_ll, 256));
 
   return error;
 }
 
+/*
+if final is 0, the data does not end with the final block but with a sync flush (an empty block without
+compression), so that more deflate data can follow at the next byte. This needs btype 1 or 2.
+hash holds the tables kept between calls by the caller, or is NULL to use temporary ones.
+*/
 static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t insize,
-                                 const LodePNGCompressSettings* settings)
+                                 const LodePNGCompressSettings* settings, unsigned final, Hash* hash)
 {
   unsigned error = 0;
   size_t i, blocksize, numdeflateblocks;
   size_t bp = 0; /*the bit pointer*/
-  Hash hash;
+  Hash temp;
 
   if(settings->btype > 2) return 61;
   else if(settings->btype == 0) return deflateNoCompression(out, in, insize);
@@ -2015,21 +2544,37 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   numdeflateblocks = (insize + blocksize - 1) / blocksize;
   if(numdeflateblocks == 0) numdeflateblocks = 1;
 
-  error = hash_init(&hash, settings->windowsize);
-  if(error) return error;
+  if(!hash)
+  {
+    hash_init(&temp);
+    hash = &temp;
+  }
+  if(isFastLevel(settings)) error = hash_reset_fast(hash, FAST_HASH_BITS[settings->level - 1]);
+  else error = hash_reset(hash, settings->windowsize);
 
   for(i = 0; i != numdeflateblocks && !error; ++i)
   {
-    unsigned final = (i == numdeflateblocks - 1);
+    unsigned BFINAL = final && (i == numdeflateblocks - 1);
     size_t start = i * blocksize;
     size_t end = start + blocksize;
     if(end > insize) end = insize;
 
-    if(settings->btype == 1) error = deflateFixed(out, &bp, &hash, in, start, end, settings, final);
-    else if(settings->btype == 2) error = deflateDynamic(out, &bp, &hash, in, start, end, settings, final);
+    if(settings->btype == 1) error = deflateFixed(out, &bp, hash, in, start, end, settings, BFINAL);
+    else if(settings->btype == 2) error = deflateDynamic(out, &bp, hash, in, start, end, settings, BFINAL);
+  }
+
+  if(!error && !final)
+  {
+    addBitToStream(&bp, out, 0); /*BFINAL*/
+    addBitsToStream(&bp, out, 0, 2); /*BTYPE 00, no compression*/
+    /*LEN 0 and NLEN 65535 start at the next byte*/
+    ucvector_push_back(out, 0);
+    ucvector_push_back(out, 0);
+    ucvector_push_back(out, 255);
+    ucvector_push_back(out, 255);
   }
 
-  hash_cleanup(&hash);
+  if(hash == &temp) hash_cleanup(&temp);
 
   return error;
 }
@@ -2041,7 +2586,7 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
   unsigned error;
   ucvector v;
   ucvector_init_buffer(&v, *out, *outsize);
-  error = lodepng_deflatev(&v, in, insize, settings);
+  error = lodepng_deflatev(&v, in, insize, settings, 1, 0);
   *out = v.data;
   *outsize = v.size;
   return error;
@@ -2067,10 +2612,67 @@ static unsigned deflate(unsigned char** out, size_t* outsize,
 /* / Adler32                                                                  */
 /* ////////////////////////////////////////////////////////////////////////// */
 
+#ifdef LODEPNG_X86_DISPATCH
+/*
+update_adler32 for a multiple of 32 bytes, at most 5536. Over a block of 32 bytes b[0..31], s1 grows by the sum
+of the bytes and s2 by 32 * s1 plus the sum of (32 - i) * b[i]. The sums are kept in the lanes of AVX2
+registers and only added up at the end.
+*/
+LODEPNG_TARGET("avx2")
+static unsigned update_adler32_AVX2(unsigned adler, const unsigned char* data, unsigned len)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                           16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  __m256i s1 = _mm256_setr_epi32((int)(adler & 0xffff), 0, 0, 0, 0, 0, 0, 0);
+  __m256i s2 = _mm256_setr_epi32((int)((adler >> 16) & 0xffff), 0, 0, 0, 0, 0, 0, 0);
+  __m256i prevs1 = zero; /*sum of s1 before each block*/
+  __m128i sum;
+  unsigned i, r1, r2;
+
+  for(i = 0; i != len; i += 32)
+  {
+    __m256i bytes = _mm256_loadu_si256((const __m256i*)(data + i));
+    prevs1 = _mm256_add_epi32(prevs1, s1);
+    s1 = _mm256_add_epi32(s1, _mm256_sad_epu8(bytes, zero));
+    s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, weights), ones));
+  }
+  s2 = _mm256_add_epi32(s2, _mm256_slli_epi32(prevs1, 5));
+
+  sum = _mm_add_epi32(_mm256_castsi256_si128(s1), _mm256_extracti128_si256(s1, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  r1 = (unsigned)_mm_cvtsi128_si32(sum);
+  sum = _mm_add_epi32(_mm256_castsi256_si128(s2), _mm256_extracti128_si256(s2, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  r2 = (unsigned)_mm_cvtsi128_si32(sum);
+
+  return ((r2 % 65521) << 16) | (r1 % 65521);
+}
+#endif /*LODEPNG_X86_DISPATCH*/
+
 static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len)
 {
-   unsigned s1 = adler & 0xffff;
-   unsigned s2 = (adler >> 16) & 0xffff;
+   unsigned s1, s2;
+
+#ifdef LODEPNG_X86_DISPATCH
+  if(len >= 64 && cpuHasAVX2())
+  {
+    while(len >= 32)
+    {
+      /*5536 is the largest multiple of 32 for which the sums cannot overflow, cf. 5550 below*/
+      unsigned amount = len > 5536 ? 5536 : (len & ~31u);
+      adler = update_adler32_AVX2(adler, data, amount);
+      data += amount;
+      len -= amount;
+    }
+  }
+#endif /*LODEPNG_X86_DISPATCH*/
+
+  s1 = adler & 0xffff;
+  s2 = (adler >> 16) & 0xffff;
 
   while(len > 0)
   {
@@ -2102,10 +2704,8 @@ static unsigned adler32(const unsigned char* data, unsigned len)
 
 #ifdef LODEPNG_COMPILE_DECODER
 
-unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                                 size_t insize, const LodePNGDecompressSettings* settings)
+static unsigned zlib_check_header(const unsigned char* in, size_t insize)
 {
-  unsigned error = 0;
   unsigned CM, CINFO, FDICT;
 
   if(insize < 2) return 53; /*error, size of zlib data too small*/
@@ -2134,6 +2734,15 @@ unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const uns
     return 26;
   }
 
+  return 0;
+}
+
+unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
+                                 size_t insize, const LodePNGDecompressSettings* settings)
+{
+  unsigned error = zlib_check_header(in, insize);
+  if(error) return error;
+
   error = inflate(out, outsize, in + 2, insize - 2, settings);
   if(error) return error;
 
@@ -2160,10 +2769,80 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsi
   }
 }
 
+/*
+zlib_decompress into out, which is emptied first. The default inflate keeps the memory of out and makes the
+Huffman trees in trees, so nothing is allocated if enough was reserved, see lodepng_inflatev.
+*/
+static unsigned zlib_decompressv(ucvector* out, const unsigned char* in, size_t insize,
+                                 const LodePNGDecompressSettings* settings, InflateTrees* trees)
+{
+  unsigned error;
+  out->size = 0;
+  if(settings->custom_zlib || settings->custom_inflate)
+  {
+    error = zlib_decompress(&out->data, &out->size, in, insize, settings);
+    out->allocsize = out->size; /*the custom function may have reallocated it*/
+    return error;
+  }
+
+  error = zlib_check_header(in, insize);
+  if(error) return error;
+  error = lodepng_inflatev(out, in + 2, insize - 2, settings, 0, trees);
+  if(error) return error;
+
+  if(!settings->ignore_adler32)
+  {
+    unsigned ADLER32 = lodepng_read32bitInt(&in[insize - 4]);
+    if(adler32(out->data, (unsigned)out->size) != ADLER32) return 58; /*error, adler checksum not correct*/
+  }
+
+  return 0; /*no error*/
+}
+
+/*
+Like lodepng_zlib_decompress, but the inflated data is handed to sink->write in pieces while inflating,
+only a window of 32 KB of it is kept, in window. The Adler-32 checksum is checked at the end, after all data was
+written. custom_zlib and custom_inflate are not used.
+*/
+static unsigned zlib_decompress_stream(InflateSink* sink, ucvector* window, const unsigned char* in, size_t insize,
+                                       const LodePNGDecompressSettings* settings, InflateTrees* trees)
+{
+  unsigned error = zlib_check_header(in, insize);
+  if(error) return error;
+
+  window->size = 0;
+  sink->written = 0;
+  sink->adler = 1;
+  error = lodepng_inflatev(window, in + 2, insize - 2, settings, sink, trees);
+  if(error) return error;
+
+  if(!settings->ignore_adler32)
+  {
+    unsigned ADLER32 = lodepng_read32bitInt(&in[insize - 4]);
+    if(sink->adler != ADLER32) return 58; /*error, adler checksum not correct, data must be corrupted*/
+  }
+
+  return 0; /*no error*/
+}
+
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
 
+/*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
+static void addZlibHeader(ucvector* out)
+{
+  unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
+  unsigned FLEVEL = 0;
+  unsigned FDICT = 0;
+  unsigned CMFFLG = 256 * CMF + FDICT * 32 + FLEVEL * 64;
+  unsigned FCHECK = 31 - CMFFLG % 31;
+  CMFFLG += FCHECK;
+
+  ucvector_push_back(out, (unsigned char)(CMFFLG / 256));
+  ucvector_push_back(out, (unsigned char)(CMFFLG % 256));
+}
+
 unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
                                size_t insize, const LodePNGCompressSettings* settings)
 {
@@ -2175,19 +2854,10 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
   unsigned char* deflatedata = 0;
   size_t deflatesize = 0;
 
-  /*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
-  unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
-  unsigned FLEVEL = 0;
-  unsigned FDICT = 0;
-  unsigned CMFFLG = 256 * CMF + FDICT * 32 + FLEVEL * 64;
-  unsigned FCHECK = 31 - CMFFLG % 31;
-  CMFFLG += FCHECK;
-
   /*ucvector-controlled version of the output buffer, for dynamic array*/
   ucvector_init_buffer(&outv, *out, *outsize);
 
-  ucvector_push_back(&outv, (unsigned char)(CMFFLG / 256));
-  ucvector_push_back(&outv, (unsigned char)(CMFFLG % 256));
+  addZlibHeader(&outv);
 
   error = deflate(&deflatedata, &deflatesize, in, insize, settings);
 
@@ -2219,6 +2889,31 @@ static unsigned zlib_compress(unsigned char** out, size_t* outsize, const unsign
   }
 }
 
+/*
+zlib_compress appending to out. The default deflate uses the tables of hash, which the caller can keep
+between calls, see lodepng_deflatev.
+*/
+static unsigned zlib_compressv(ucvector* out, const unsigned char* in, size_t insize,
+                               const LodePNGCompressSettings* settings, Hash* hash)
+{
+  unsigned error;
+  if(settings->custom_zlib || settings->custom_deflate)
+  {
+    unsigned char* data = 0;
+    size_t size = 0, oldsize = out->size;
+    error = zlib_compress(&data, &size, in, insize, settings);
+    if(!error && !ucvector_resize(out, oldsize + size)) error = 83; /*alloc fail*/
+    if(!error && size) memcpy(&out->data[oldsize], data, size);
+    lodepng_free(data);
+    return error;
+  }
+
+  addZlibHeader(out);
+  error = lodepng_deflatev(out, in, insize, settings, 1, hash);
+  if(!error) lodepng_add32bitInt(out, adler32(in, (unsigned)insize));
+  return error;
+}
+
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #else /*no LODEPNG_COMPILE_ZLIB*/
@@ -2230,6 +2925,17 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsi
   if(!settings->custom_zlib) return 87; /*no custom zlib function provided */
   return settings->custom_zlib(out, outsize, in, insize, settings);
 }
+
+/*zlib_decompress into out, which is emptied first*/
+static unsigned zlib_decompressv(ucvector* out, const unsigned char* in, size_t insize,
+                                 const LodePNGDecompressSettings* settings)
+{
+  unsigned error;
+  out->size = 0;
+  error = zlib_decompress(&out->data, &out->size, in, insize, settings);
+  out->allocsize = out->size; /*the custom function may have reallocated it*/
+  return error;
+}
 #endif /*LODEPNG_COMPILE_DECODER*/
 #ifdef LODEPNG_COMPILE_ENCODER
 static unsigned zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
@@ -2238,6 +2944,19 @@ static unsigned zlib_compress(unsigned char** out, size_t* outsize, const unsign
   if(!settings->custom_zlib) return 87; /*no custom zlib function provided */
   return settings->custom_zlib(out, outsize, in, insize, settings);
 }
+
+/*zlib_compress appending to out*/
+static unsigned zlib_compressv(ucvector* out, const unsigned char* in, size_t insize,
+                               const LodePNGCompressSettings* settings)
+{
+  unsigned char* data = 0;
+  size_t size = 0, oldsize = out->size;
+  unsigned error = zlib_compress(&data, &size, in, insize, settings);
+  if(!error && !ucvector_resize(out, oldsize + size)) error = 83; /*alloc fail*/
+  if(!error && size) memcpy(&out->data[oldsize], data, size);
+  lodepng_free(data);
+  return error;
+}
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #endif /*LODEPNG_COMPILE_ZLIB*/
@@ -2258,13 +2977,14 @@ void lodepng_compress_settings_init(LodePNGCompressSettings* settings)
   settings->minmatch = 3;
   settings->nicematch = 128;
   settings->lazymatching = 1;
+  settings->level = 0;
 
   settings->custom_zlib = 0;
   settings->custom_deflate = 0;
   settings->custom_context = 0;
 }
 
-const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0};
+const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0, 0};
 
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
@@ -2299,7 +3019,13 @@ const LodePNGDecompressSettings lodepng_default_decompress_settings = {0, 0, 0,
 
 #ifndef LODEPNG_NO_COMPILE_CRC
 /* CRC polynomial: 0xedb88320 */
-static unsigned lodepng_crc32_table[256] = {
+/*
+lodepng_crc32_table[0] is the table of the byte-by-byte algorithm. lodepng_crc32_table[k][n] is the CRC of byte n
+followed by k zero bytes, which lets the slice-by-8 loop in lodepng_crc32 process 8 bytes with 8 independent
+lookups.
+*/
+static const unsigned lodepng_crc32_table[8][256] = {
+  {
            0u, 1996959894u, 3993919788u, 2567524794u,  124634137u, 1886057615u, 3915621685u, 2657392035u,
    249268274u, 2044508324u, 3772115230u, 2547177864u,  162941995u, 2125561021u, 3887607047u, 2428444049u,
    498536548u, 1789927666u, 4089016648u, 2227061214u,  450548861u, 1843258603u, 4107580753u, 2211677639u,
@@ -2332,17 +3058,362 @@ static unsigned lodepng_crc32_table[256] = {
   2932959818u, 3654703836u, 1088359270u,  936918000u, 2847714899u, 3736837829u, 1202900863u,  817233897u,
   3183342108u, 3401237130u, 1404277552u,  615818150u, 3134207493u, 3453421203u, 1423857449u,  601450431u,
   3009837614u, 3294710456u, 1567103746u,  711928724u, 3020668471u, 3272380065u, 1510334235u,  755167117u
+  },
+  {
+           0u,  421212481u,  842424962u,  724390851u, 1684849924u, 2105013317u, 1448781702u, 1329698503u,
+  3369699848u, 3519200073u, 4210026634u, 3824474571u, 2897563404u, 3048111693u, 2659397006u, 2274893007u,
+  1254232657u, 1406739216u, 2029285587u, 1643069842u,  783210325u,  934667796u,  479770071u,   92505238u,
+  2182846553u, 2600511768u, 2955803355u, 2838940570u, 3866582365u, 4285295644u, 3561045983u, 3445231262u,
+  2508465314u, 2359236067u, 2813478432u, 3198777185u, 4058571174u, 3908292839u, 3286139684u, 3670389349u,
+  1566420650u, 1145479147u, 1869335592u, 1987116393u,  959540142u,  539646703u,  185010476u,  303839341u,
+  3745920755u, 3327985586u, 3983561841u, 4100678960u, 3140154359u, 2721170102u, 2300350837u, 2416418868u,
+   396344571u,  243568058u,  631889529u, 1018359608u, 1945336319u, 1793607870u, 1103436669u, 1490954812u,
+  4034481925u, 3915546180u, 3259968903u, 3679722694u, 2484439553u, 2366552896u, 2787371139u, 3208174018u,
+   950060301u,  565965900u,  177645455u,  328046286u, 1556873225u, 1171730760u, 1861902987u, 2011255754u,
+  3132841300u, 2745199637u, 2290958294u, 2442530455u, 3738671184u, 3352078609u, 3974232786u, 4126854035u,
+  1919080284u, 1803150877u, 1079293406u, 1498383519u,  370020952u,  253043481u,  607678682u, 1025720731u,
+  1711106983u, 2095471334u, 1472923941u, 1322268772u,   26324643u,  411738082u,  866634785u,  717028704u,
+  2904875439u, 3024081134u, 2668790573u, 2248782444u, 3376948395u, 3495106026u, 4219356713u, 3798300520u,
+   792689142u,  908347575u,  487136116u,   68299317u, 1263779058u, 1380486579u, 2036719216u, 1618931505u,
+  3890672638u, 4278043327u, 3587215740u, 3435896893u, 2206873338u, 2593195963u, 2981909624u, 2829542713u,
+   998479947u,  580430090u,  162921161u,  279890824u, 1609522511u, 1190423566u, 1842954189u, 1958874764u,
+  4082766403u, 3930137346u, 3245109441u, 3631694208u, 2536953671u, 2385372678u, 2768287173u, 3155920004u,
+  1900120602u, 1750776667u, 1131931800u, 1517083097u,  355290910u,  204897887u,  656092572u, 1040194781u,
+  3113746450u, 2692952403u, 2343461520u, 2461357009u, 3723805974u, 3304059991u, 4022511508u, 4141455061u,
+  2919742697u, 3072101800u, 2620513899u, 2234183466u, 3396041197u, 3547351212u, 4166851439u, 3779471918u,
+  1725839073u, 2143618976u, 1424512099u, 1307796770u,   45282277u,  464110244u,  813994343u,  698327078u,
+  3838160568u, 4259225593u, 3606301754u, 3488152955u, 2158586812u, 2578602749u, 2996767038u, 2877569151u,
+   740041904u,  889656817u,  506086962u,  120682355u, 1215357364u, 1366020341u, 2051441462u, 1667084919u,
+  3422213966u, 3538019855u, 4190942668u, 3772220557u, 2945847882u, 3062702859u, 2644537544u, 2226864521u,
+    52649286u,  439905287u,  823476164u,  672009861u, 1733269570u, 2119477507u, 1434057408u, 1281543041u,
+  2167981343u, 2552493150u, 3004082077u, 2853541596u, 3847487515u, 4233048410u, 3613549209u, 3464057816u,
+  1239502615u, 1358593622u, 2077699477u, 1657543892u,  764250643u,  882293586u,  532408465u,  111204816u,
+  1585378284u, 1197851309u, 1816695150u, 1968414767u,  974272232u,  587794345u,  136598634u,  289367339u,
+  2527558116u, 2411481253u, 2760973158u, 3179948583u, 4073438432u, 3956313505u, 3237863010u, 3655790371u,
+   347922877u,  229101820u,  646611775u, 1066513022u, 1892689081u, 1774917112u, 1122387515u, 1543337850u,
+  3697634229u, 3313392372u, 3998419255u, 4148705398u, 3087642289u, 2702352368u, 2319436851u, 2468674930u
+  },
+  {
+           0u,   29518391u,   59036782u,   38190681u,  118073564u,  114017003u,   76381362u,   89069189u,
+   236147128u,  265370511u,  228034006u,  206958561u,  152762724u,  148411219u,  178138378u,  190596925u,
+   472294256u,  501532999u,  530741022u,  509615401u,  456068012u,  451764635u,  413917122u,  426358261u,
+   305525448u,  334993663u,  296822438u,  275991697u,  356276756u,  352202787u,  381193850u,  393929805u,
+   944588512u,  965684439u, 1003065998u,  973863097u, 1061482044u, 1049003019u, 1019230802u, 1023561829u,
+   912136024u,  933002607u,  903529270u,  874031361u,  827834244u,  815125939u,  852716522u,  856752605u,
+   611050896u,  631869351u,  669987326u,  640506825u,  593644876u,  580921211u,  551983394u,  556069653u,
+   712553512u,  733666847u,  704405574u,  675154545u,  762387700u,  749958851u,  787859610u,  792175277u,
+  1889177024u, 1901651959u, 1931368878u, 1927033753u, 2006131996u, 1985040171u, 1947726194u, 1976933189u,
+  2122964088u, 2135668303u, 2098006038u, 2093965857u, 2038461604u, 2017599123u, 2047123658u, 2076625661u,
+  1824272048u, 1836991623u, 1866005214u, 1861914857u, 1807058540u, 1786244187u, 1748062722u, 1777547317u,
+  1655668488u, 1668093247u, 1630251878u, 1625932113u, 1705433044u, 1684323811u, 1713505210u, 1742760333u,
+  1222101792u, 1226154263u, 1263738702u, 1251046777u, 1339974652u, 1310460363u, 1281013650u, 1301863845u,
+  1187289752u, 1191637167u, 1161842422u, 1149379777u, 1103966788u, 1074747507u, 1112139306u, 1133218845u,
+  1425107024u, 1429406311u, 1467333694u, 1454888457u, 1408811148u, 1379576507u, 1350309090u, 1371438805u,
+  1524775400u, 1528845279u, 1499917702u, 1487177649u, 1575719220u, 1546255107u, 1584350554u, 1605185389u,
+  3778354048u, 3774312887u, 3803303918u, 3816007129u, 3862737756u, 3892238699u, 3854067506u, 3833203973u,
+  4012263992u, 4007927823u, 3970080342u, 3982554209u, 3895452388u, 3924658387u, 3953866378u, 3932773565u,
+  4245928176u, 4241609415u, 4271336606u, 4283762345u, 4196012076u, 4225268251u, 4187931714u, 4166823541u,
+  4076923208u, 4072833919u, 4035198246u, 4047918865u, 4094247316u, 4123732899u, 4153251322u, 4132437965u,
+  3648544096u, 3636082519u, 3673983246u, 3678331705u, 3732010428u, 3753090955u, 3723829714u, 3694611429u,
+  3614117080u, 3601426159u, 3572488374u, 3576541825u, 3496125444u, 3516976691u, 3555094634u, 3525581405u,
+  3311336976u, 3298595879u, 3336186494u, 3340255305u, 3260503756u, 3281337595u, 3251864226u, 3222399125u,
+  3410866088u, 3398419871u, 3368647622u, 3372945905u, 3427010420u, 3448139075u, 3485520666u, 3456284973u,
+  2444203584u, 2423127159u, 2452308526u, 2481530905u, 2527477404u, 2539934891u, 2502093554u, 2497740997u,
+  2679949304u, 2659102159u, 2620920726u, 2650438049u, 2562027300u, 2574714131u, 2603727690u, 2599670141u,
+  2374579504u, 2353749767u, 2383274334u, 2412743529u, 2323684844u, 2336421851u, 2298759554u, 2294686645u,
+  2207933576u, 2186809023u, 2149495014u, 2178734801u, 2224278612u, 2236720739u, 2266437690u, 2262135309u,
+  2850214048u, 2820717207u, 2858812622u, 2879680249u, 2934667388u, 2938704459u, 2909776914u, 2897069605u,
+  2817622296u, 2788420399u, 2759153014u, 2780249921u, 2700618180u, 2704950259u, 2742877610u, 2730399645u,
+  3049550800u, 3020298727u, 3057690558u, 3078802825u, 2999835404u, 3004150075u, 2974355298u, 2961925461u,
+  3151438440u, 3121956959u, 3092510214u, 3113327665u, 3168701108u, 3172786307u, 3210370778u, 3197646061u
+  },
+  {
+           0u, 3099354981u, 2852767883u,  313896942u, 2405603159u,  937357362u,  627793884u, 2648127673u,
+  3316918511u, 2097696650u, 1874714724u, 3607201537u, 1255587768u, 4067088605u, 3772741427u, 1482887254u,
+  1343838111u, 3903140090u, 4195393300u, 1118632049u, 3749429448u, 1741137837u, 1970407491u, 3452858150u,
+  2511175536u,  756094997u, 1067759611u, 2266550430u,  449832999u, 2725482306u, 2965774508u,  142231497u,
+  2687676222u,  412010587u,  171665333u, 2995192016u,  793786473u, 2548850444u, 2237264098u, 1038456711u,
+  1703315409u, 3711623348u, 3482275674u, 1999841343u, 3940814982u, 1381529571u, 1089329165u, 4166106984u,
+  4029413537u, 1217896388u, 1512189994u, 3802027855u, 2135519222u, 3354724499u, 3577784189u, 1845280792u,
+   899665998u, 2367928107u, 2677414085u,  657096608u, 3137160985u,   37822588u,  284462994u, 2823350519u,
+  2601801789u,  598228824u,  824021174u, 2309093331u,  343330666u, 2898962447u, 3195996129u,  113467524u,
+  1587572946u, 3860600759u, 4104763481u, 1276501820u, 3519211397u, 1769898208u, 2076913422u, 3279374443u,
+  3406630818u, 1941006535u, 1627703081u, 3652755532u, 1148164341u, 4241751952u, 3999682686u, 1457141531u,
+   247015245u, 3053797416u, 2763059142u,  470583459u, 2178658330u,  963106687u,  735213713u, 2473467892u,
+   992409347u, 2207944806u, 2435792776u,  697522413u, 3024379988u,  217581361u,  508405983u, 2800865210u,
+  4271038444u, 1177467017u, 1419450215u, 3962007554u, 1911572667u, 3377213406u, 3690561584u, 1665525589u,
+  1799331996u, 3548628985u, 3241568279u, 2039091058u, 3831314379u, 1558270126u, 1314193216u, 4142438437u,
+  2928380019u,  372764438u,   75645176u, 3158189981u,  568925988u, 2572515393u, 2346768303u,  861712586u,
+  3982079547u, 1441124702u, 1196457648u, 4293663189u, 1648042348u, 3666298377u, 3358779879u, 1888390786u,
+   686661332u, 2421291441u, 2196002399u,  978858298u, 2811169155u,  523464422u,  226935048u, 3040519789u,
+  3175145892u,  100435649u,  390670639u, 2952089162u,  841119475u, 2325614998u, 2553003640u,  546822429u,
+  2029308235u, 3225988654u, 3539796416u, 1782671013u, 4153826844u, 1328167289u, 1570739863u, 3844338162u,
+  1298864389u, 4124540512u, 3882013070u, 1608431339u, 3255406162u, 2058742071u, 1744848601u, 3501990332u,
+  2296328682u,  811816591u,  584513889u, 2590678532u,  129869501u, 3204563416u, 2914283062u,  352848211u,
+   494030490u, 2781751807u, 3078325777u,  264757620u, 2450577869u,  715964072u,  941166918u, 2158327331u,
+  3636881013u, 1618608400u, 1926213374u, 3396585883u, 1470427426u, 4011365959u, 4255988137u, 1158766284u,
+  1984818694u, 3471935843u, 3695453837u, 1693991400u, 4180638033u, 1100160564u, 1395044826u, 3952793279u,
+  3019491049u,  189112716u,  435162722u, 2706139399u, 1016811966u, 2217162459u, 2526189877u,  774831696u,
+   643086745u, 2666061564u, 2354934034u,  887166583u, 2838900430u,  294275499u,   54519365u, 3145957664u,
+  3823145334u, 1532818963u, 1240029693u, 4048895640u, 1820460577u, 3560857924u, 3331051178u, 2117577167u,
+  3598663992u, 1858283101u, 2088143283u, 3301633750u, 1495127663u, 3785470218u, 4078182116u, 1269332353u,
+   332098007u, 2876706482u, 3116540252u,   25085497u, 2628386432u,  605395429u,  916469259u, 2384220526u,
+  2254837415u, 1054503362u,  745528876u, 2496903497u,  151290352u, 2981684885u, 2735556987u,  464596510u,
+  1137851976u, 4218313005u, 3923506883u, 1365741990u, 3434129695u, 1946996346u, 1723425172u, 3724871409u
+  },
+  {
+           0u, 1029712304u, 2059424608u, 1201699536u, 4118849216u, 3370159984u, 2403399072u, 2988497936u,
+   812665793u,  219177585u, 1253054625u, 2010132753u, 3320900865u, 4170237105u, 3207642721u, 2186319825u,
+  1625331586u, 1568718386u,  438355170u,  658566482u, 2506109250u, 2818578674u, 4020265506u, 3535817618u,
+  1351670851u, 1844508147u,  709922595u,  389064339u, 2769320579u, 2557498163u, 3754961379u, 3803185235u,
+  3250663172u, 4238411444u, 3137436772u, 2254525908u,  876710340u,  153198708u, 1317132964u, 1944187668u,
+  4054934725u, 3436268917u, 2339452837u, 3054575125u,   70369797u,  961670069u, 2129760613u, 1133623509u,
+  2703341702u, 2621542710u, 3689016294u, 3867263574u, 1419845190u, 1774270454u,  778128678u,  318858390u,
+  2438067015u, 2888948471u, 3952189479u, 3606153623u, 1691440519u, 1504803895u,  504432359u,  594620247u,
+  1492342857u, 1704161785u,  573770537u,  525542041u, 2910060169u, 2417219385u, 3618876905u, 3939730521u,
+  1753420680u, 1440954936u,  306397416u,  790849880u, 2634265928u, 2690882808u, 3888375336u, 3668168600u,
+   940822475u,   91481723u, 1121164459u, 2142483739u, 3448989963u, 4042473659u, 3075684971u, 2318603227u,
+   140739594u,  889433530u, 1923340138u, 1338244826u, 4259521226u, 3229813626u, 2267247018u, 3124975642u,
+  2570221389u, 2756861693u, 3824297005u, 3734113693u, 1823658381u, 1372780605u,  376603373u,  722643805u,
+  2839690380u, 2485261628u, 3548540908u, 4007806556u, 1556257356u, 1638052860u,  637716780u,  459464860u,
+  4191346895u, 3300051327u, 2199040943u, 3195181599u,  206718479u,  825388991u, 1989285231u, 1274166495u,
+  3382881038u, 4106388158u, 3009607790u, 2382549470u, 1008864718u,   21111934u, 1189240494u, 2072147742u,
+  2984685714u, 2357631266u, 3408323570u, 4131834434u, 1147541074u, 2030452706u, 1051084082u,   63335554u,
+  2174155603u, 3170292451u, 4216760371u, 3325460867u, 1947622803u, 1232499747u,  248909555u,  867575619u,
+  3506841360u, 3966111392u, 2881909872u, 2527485376u,  612794832u,  434546784u, 1581699760u, 1663499008u,
+  3782634705u, 3692447073u, 2612412337u, 2799048193u,  351717905u,  697754529u, 1849071985u, 1398190273u,
+  1881644950u, 1296545318u,  182963446u,  931652934u, 2242328918u, 3100053734u, 4284967478u, 3255255942u,
+  1079497815u, 2100821479u,  983009079u,  133672583u, 3050795671u, 2293717799u, 3474399735u, 4067887175u,
+   281479188u,  765927844u, 1778867060u, 1466397380u, 3846680276u, 3626469220u, 2676489652u, 2733102084u,
+   548881365u,  500656741u, 1517752501u, 1729575173u, 3577210133u, 3898068133u, 2952246901u, 2459410373u,
+  3910527195u, 3564487019u, 2480257979u, 2931134987u,  479546907u,  569730987u, 1716854139u, 1530213579u,
+  3647316762u, 3825568426u, 2745561210u, 2663766474u,  753206746u,  293940330u, 1445287610u, 1799716618u,
+  2314567513u, 3029685993u, 4080348217u, 3461678473u, 2088098201u, 1091956777u,  112560889u, 1003856713u,
+  3112514712u, 2229607720u, 3276105720u, 4263857736u, 1275433560u, 1902492648u,  918929720u,  195422344u,
+   685033439u,  364179055u, 1377080511u, 1869921551u, 3713294623u, 3761522863u, 2811507327u, 2599689167u,
+   413436958u,  633644462u, 1650777982u, 1594160846u, 3978570462u, 3494118254u, 2548332990u, 2860797966u,
+  1211387997u, 1968470509u,  854852413u,  261368461u, 3182753437u, 2161434413u, 3346310653u, 4195650637u,
+  2017729436u, 1160000044u,   42223868u, 1071931724u, 2378480988u, 2963576044u, 4144295484u, 3395602316u
+  },
+  {
+           0u, 3411858341u, 1304994059u, 2257875630u, 2609988118u, 1355649459u, 3596215069u,  486879416u,
+  3964895853u,  655315400u, 2711298918u, 1791488195u, 2009251963u, 3164476382u,  973758832u, 4048990933u,
+    64357019u, 3364540734u, 1310630800u, 2235723829u, 2554806413u, 1394316072u, 3582976390u,  517157411u,
+  4018503926u,  618222419u, 2722963965u, 1762783832u, 1947517664u, 3209171269u,  970744811u, 4068520014u,
+   128714038u, 3438335635u, 1248109629u, 2167961496u, 2621261600u, 1466012805u, 3522553387u,  447296910u,
+  3959392091u,  547575038u, 2788632144u, 1835791861u, 1886307661u, 3140622056u, 1034314822u, 4143626211u,
+    75106221u, 3475428360u, 1236444838u, 2196665603u, 2682996155u, 1421317662u, 3525567664u,  427767573u,
+  3895035328u,  594892389u, 2782995659u, 1857943406u, 1941489622u, 3101955187u, 1047553757u, 4113347960u,
+   257428076u, 3288652233u, 1116777319u, 2311878850u, 2496219258u, 1603640287u, 3640781169u,  308099796u,
+  3809183745u,  676813732u, 2932025610u, 1704983215u, 2023410199u, 3016104370u,  894593820u, 4262377657u,
+   210634999u, 3352484690u, 1095150076u, 2316991065u, 2535410401u, 1547934020u, 3671583722u,  294336591u,
+  3772615322u,  729897279u, 2903845777u, 1716123700u, 2068629644u, 2953845545u,  914647431u, 4258839074u,
+   150212442u, 3282623743u, 1161604689u, 2388688372u, 2472889676u, 1480171241u, 3735940167u,  368132066u,
+  3836185911u,  805002898u, 2842635324u, 1647574937u, 2134298401u, 3026852996u,  855535146u, 4188192143u,
+   186781121u, 3229539940u, 1189784778u, 2377547631u, 2427670487u, 1542429810u, 3715886812u,  371670393u,
+  3882979244u,  741170185u, 2864262823u, 1642462466u, 2095107514u, 3082559007u,  824732849u, 4201955092u,
+   514856152u, 3589064573u, 1400419795u, 2552522358u, 2233554638u, 1316849003u, 3370776517u,   62202976u,
+  4075001525u,  968836368u, 3207280574u, 1954014235u, 1769133219u, 2720925446u,  616199592u, 4024870413u,
+   493229635u, 3594175974u, 1353627464u, 2616354029u, 2264355925u, 1303087088u, 3409966430u,    6498043u,
+  4046820398u,  979978123u, 3170710821u, 2007099008u, 1789187640u, 2717386141u,  661419827u, 3962610838u,
+   421269998u, 3527459403u, 1423225061u, 2676515648u, 2190300152u, 1238466653u, 3477467891u,   68755798u,
+  4115633027u, 1041448998u, 3095868040u, 1943789869u, 1860096405u, 2776760880u,  588673182u, 3897205563u,
+   449450869u, 3516317904u, 1459794558u, 2623431131u, 2170245475u, 1242006214u, 3432247400u,  131015629u,
+  4137259288u, 1036337853u, 3142660115u, 1879958454u, 1829294862u, 2790523051u,  549483013u, 3952910752u,
+   300424884u, 3669282065u, 1545650111u, 2541513754u, 2323209378u, 1092980487u, 3350330793u,  216870412u,
+  4256931033u,  921128828u, 2960342482u, 2066738807u, 1714085583u, 2910195050u,  736264132u, 3770592353u,
+   306060335u, 3647131530u, 1610005796u, 2494197377u, 2309971513u, 1123257756u, 3295149874u,  255536279u,
+  4268596802u,  892423655u, 3013951305u, 2029645036u, 1711070292u, 2929725425u,  674528607u, 3815288570u,
+   373562242u, 3709388839u, 1535949449u, 2429577516u, 2379569556u, 1183418929u, 3223189663u,  188820282u,
+  4195850735u,  827017802u, 3084859620u, 2089020225u, 1636228089u, 2866415708u,  743340786u, 3876759895u,
+   361896217u, 3738094268u, 1482340370u, 2466671543u, 2382584591u, 1163888810u, 3284924932u,  144124321u,
+  4190215028u,  849168593u, 3020503679u, 2136336858u, 1649465698u, 2836138695u,  798521449u, 3838094284u
+  },
+  {
+           0u, 2792819636u, 2543784233u,  837294749u, 4098827283u, 1379413927u, 1674589498u, 3316072078u,
+   871321191u, 2509784531u, 2758827854u,   34034938u, 3349178996u, 1641505216u, 1346337629u, 4131942633u,
+  1742642382u, 3249117050u, 4030828007u, 1446413907u, 2475800797u,  904311657u,   68069876u, 2725880384u,
+  1412551337u, 4064729373u, 3283010432u, 1708771380u, 2692675258u,  101317902u,  937551763u, 2442587175u,
+  3485284764u, 1774858792u, 1478633653u, 4266992385u, 1005723023u, 2642744891u, 2892827814u,  169477906u,
+  4233263099u, 1512406095u, 1808623314u, 3451546982u,  136139752u, 2926205020u, 2676114113u,  972376437u,
+  2825102674u,  236236518u, 1073525883u, 2576072655u, 1546420545u, 4200303349u, 3417542760u, 1841601500u,
+  2609703733u, 1039917185u,  202635804u, 2858742184u, 1875103526u, 3384067218u, 4166835727u, 1579931067u,
+  1141601657u, 3799809741u, 3549717584u, 1977839588u, 2957267306u,  372464350u,  668680259u, 2175552503u,
+  2011446046u, 3516084394u, 3766168119u, 1175200131u, 2209029901u,  635180217u,  338955812u, 2990736784u,
+   601221559u, 2242044419u, 3024812190u,  306049834u, 3617246628u, 1911408144u, 1074125965u, 3866285881u,
+   272279504u, 3058543716u, 2275784441u,  567459149u, 3832906691u, 1107462263u, 1944752874u, 3583875422u,
+  2343980261u,  767641425u,  472473036u, 3126744696u, 2147051766u, 3649987394u, 3899029983u, 1309766251u,
+  3092841090u,  506333494u,  801510315u, 2310084639u, 1276520081u, 3932237093u, 3683203000u, 2113813516u,
+  3966292011u, 1243601823u, 2079834370u, 3716205238u,  405271608u, 3192979340u, 2411259153u,  701492901u,
+  3750207052u, 2045810168u, 1209569125u, 4000285905u,  734575199u, 2378150379u, 3159862134u,  438345922u,
+  2283203314u,  778166598u,  529136603u, 3120492655u, 2086260449u, 3660498261u, 3955679176u, 1303499900u,
+  3153699989u,  495890209u,  744928700u, 2316418568u, 1337360518u, 3921775410u, 3626602927u, 2120129051u,
+  4022892092u, 1237286280u, 2018993941u, 3726666913u,  461853231u, 3186645403u, 2350400262u,  711936178u,
+  3693557851u, 2052076527u, 1270360434u, 3989775046u,  677911624u, 2384402428u, 3220639073u,  427820757u,
+  1202443118u, 3789347034u, 3493118535u, 1984154099u, 3018127229u,  362020041u,  612099668u, 2181885408u,
+  1950653705u, 3526596285u, 3822816288u, 1168934804u, 2148251930u,  645706414u,  395618355u, 2984485767u,
+   544559008u, 2248295444u, 3085590153u,  295523645u, 3560598451u, 1917673479u, 1134918298u, 3855773998u,
+   328860103u, 3052210803u, 2214924526u,  577903450u, 3889505748u, 1101147744u, 1883911421u, 3594338121u,
+  3424493451u, 1785369663u, 1535282850u, 4260726038u,  944946072u, 2653270060u, 2949491377u,  163225861u,
+  4294103532u, 1501944408u, 1752023237u, 3457862513u,  196998655u, 2915761739u, 2619532502u,  978710370u,
+  2881684293u,  229902577u, 1012666988u, 2586515928u, 1603020630u, 4193987810u, 3356702335u, 1852063179u,
+  2553040162u, 1046169238u,  263412747u, 2848217023u, 1818454321u, 3390333573u, 4227627032u, 1569420204u,
+    60859927u, 2782375331u, 2487203646u,  843627658u, 4159668740u, 1368951216u, 1617990445u, 3322386585u,
+   810543216u, 2520310724u, 2815490393u,   27783917u, 3288386659u, 1652017111u, 1402985802u, 4125677310u,
+  1685994201u, 3255382381u, 4091620336u, 1435902020u, 2419138250u,  910562686u,  128847843u, 2715354199u,
+  1469150398u, 4058414858u, 3222168983u, 1719234083u, 2749255853u,   94984985u,  876691844u, 2453031472u
+  },
+  {
+           0u, 3433693342u, 1109723005u, 2391738339u, 2219446010u, 1222643300u, 3329165703u,  180685081u,
+  3555007413u,  525277995u, 2445286600u, 1567235158u, 1471092047u, 2600801745u,  361370162u, 3642757804u,
+  2092642603u, 2953916853u, 1050555990u, 4063508168u, 4176560081u,  878395215u, 3134470316u, 1987983410u,
+  2942184094u, 1676945920u, 3984272867u,  567356797u,  722740324u, 3887998202u, 1764827929u, 2778407815u,
+  4185285206u,  903635656u, 3142804779u, 2012833205u, 2101111980u, 2979425330u, 1058630609u, 4088621903u,
+   714308067u, 3862526333u, 1756790430u, 2753330688u, 2933487385u, 1651734407u, 3975966820u,  542535930u,
+  2244825981u, 1231508451u, 3353891840u,  188896414u,   25648519u, 3442302233u, 1134713594u, 2399689316u,
+  1445480648u, 2592229462u,  336416693u, 3634843435u, 3529655858u,  516441772u, 2420588879u, 1559052753u,
+   698204909u, 3845636723u, 1807271312u, 2803025166u, 2916600855u, 1635634313u, 4025666410u,  593021940u,
+  4202223960u,  919787974u, 3093159461u, 1962401467u, 2117261218u, 2996361020u, 1008193759u, 4038971457u,
+  1428616134u, 2576151384u,  386135227u, 3685348389u, 3513580860u,  499580322u, 2471098945u, 1608776415u,
+  2260985971u, 1248454893u, 3303468814u,  139259792u,   42591881u, 3458459159u, 1085071860u, 2349261162u,
+  3505103035u,  474062885u, 2463016902u, 1583654744u, 1419882049u, 2550902495u,  377792828u, 3660491170u,
+    51297038u, 3483679632u, 1093385331u, 2374089965u, 2269427188u, 1273935210u, 3311514249u,  164344343u,
+  2890961296u, 1627033870u, 4000683757u,  585078387u,  672833386u, 3836780532u, 1782552599u, 2794821769u,
+  2142603813u, 3005188795u, 1032883544u, 4047146438u, 4227826911u,  928351297u, 3118105506u, 1970307900u,
+  1396409818u, 2677114180u,  287212199u, 3719594553u, 3614542624u,  467372990u, 2505346141u, 1509854403u,
+  2162073199u, 1282711281u, 3271268626u,  240228748u,   76845205u, 3359543307u, 1186043880u, 2317064054u,
+   796964081u, 3811226735u, 1839575948u, 2702160658u, 2882189835u, 1734392469u, 3924802934u,  625327592u,
+  4234522436u,  818917338u, 3191908409u, 1927981223u, 2016387518u, 3028656416u,  973776579u, 4137723485u,
+  2857232268u, 1726474002u, 3899187441u,  616751215u,  772270454u, 3803048424u, 1814228491u, 2693328533u,
+  2041117753u, 3036871847u,  999160644u, 4146592730u, 4259508931u,  826864221u, 3217552830u, 1936586016u,
+  3606501031u,  442291769u, 2496909786u, 1484378436u, 1388107869u, 2652297411u,  278519584u, 3694387134u,
+    85183762u, 3384397196u, 1194773103u, 2342308593u, 2170143720u, 1307820918u, 3279733909u,  265733131u,
+  2057717559u, 3054258089u,  948125770u, 4096344276u, 4276898253u,  843467091u, 3167309488u, 1885556270u,
+  2839764098u, 1709792284u, 3949353983u,  667704161u,  755585656u, 3785577190u, 1865176325u, 2743489947u,
+   102594076u, 3401021058u, 1144549729u, 2291298815u, 2186770662u, 1325234296u, 3228729243u,  215514885u,
+  3589828009u,  424832311u, 2547870420u, 1534552650u, 1370645331u, 2635621325u,  328688686u, 3745342640u,
+  2211456353u, 1333405183u, 3254067740u,  224338562u,  127544219u, 3408931589u, 1170156774u, 2299866232u,
+  1345666772u, 2627681866u,  303053225u, 3736746295u, 3565105198u,  416624816u, 2522494803u, 1525692365u,
+  4285207626u,  868291796u, 3176010551u, 1910772649u, 2065767088u, 3079346734u,  956571085u, 4121828691u,
+   747507711u, 3760459617u, 1856702594u, 2717976604u, 2831417605u, 1684930971u, 3940615800u,  642451174u
+  }
 };
 
+#ifdef LODEPNG_X86_DISPATCH
+/*
+the CRC of a multiple of 16 bytes, at least 64, with carry-less multiplication: four 128-bit lanes are folded
+forward over the data, then folded into one and reduced to 32 bits (Barrett reduction). This is the method of
+"Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Intel, 2009), the constants are for
+the reflected polynomial 0xedb88320. crc is the running value, not inverted at the end.
+*/
+LODEPNG_TARGET("pclmul")
+static unsigned crc32_PCLMUL(unsigned crc, const unsigned char* buf, size_t len)
+{
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596ll, 0x0154442bd4ll);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009ell, 0x01751997d0ll);
+  const __m128i k5k0 = _mm_set_epi64x(0ll, 0x0163cd6124ll);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641ll, 0x01db710641ll);
+  const __m128i mask32 = _mm_setr_epi32(-1, 0, -1, 0);
+  __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+  x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+  x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+  x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+  buf += 64;
+  len -= 64;
+
+  /*fold 4 lanes over blocks of 64 bytes*/
+  while(len >= 64)
+  {
+    x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(buf + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(buf + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(buf + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(buf + 0x30)));
+    buf += 64;
+    len -= 64;
+  }
+
+  /*fold the 4 lanes into one*/
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  /*fold the remaining blocks of 16 bytes*/
+  while(len >= 16)
+  {
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)buf)), x5);
+    buf += 16;
+    len -= 16;
+  }
+
+  /*fold 128 to 64 bits*/
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  /*Barrett reduction to 32 bits*/
+  x2 = _mm_and_si128(x1, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+  x2 = _mm_and_si128(x2, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+#endif /*LODEPNG_X86_DISPATCH*/
+
 /*Return the CRC of the bytes buf[0..len-1].*/
 unsigned lodepng_crc32(const unsigned char* buf, size_t len)
 {
   unsigned c = 0xffffffffL;
-  size_t n;
 
-  for(n = 0; n < len; ++n)
+#ifdef LODEPNG_X86_DISPATCH
+  if(len >= 64 && cpuHasPCLMUL())
+  {
+    size_t amount = len & ~(size_t)15;
+    c = crc32_PCLMUL(c, buf, amount);
+    buf += amount;
+    len -= amount;
+  }
+#endif /*LODEPNG_X86_DISPATCH*/
+
+  /*slice-by-8*/
+  while(len >= 8)
+  {
+    c ^= (unsigned)buf[0] | ((unsigned)buf[1] << 8) | ((unsigned)buf[2] << 16) | ((unsigned)buf[3] << 24);
+    c = lodepng_crc32_table[7][c & 0xff] ^ lodepng_crc32_table[6][(c >> 8) & 0xff]
+      ^ lodepng_crc32_table[5][(c >> 16) & 0xff] ^ lodepng_crc32_table[4][c >> 24]
+      ^ lodepng_crc32_table[3][buf[4]] ^ lodepng_crc32_table[2][buf[5]]
+      ^ lodepng_crc32_table[1][buf[6]] ^ lodepng_crc32_table[0][buf[7]];
+    buf += 8;
+    len -= 8;
+  }
+  while(len > 0)
   {
-    c = lodepng_crc32_table[(c ^ buf[n]) & 0xff] ^ (c >> 8);
+    c = lodepng_crc32_table[0][(c ^ *buf) & 0xff] ^ (c >> 8);
+    ++buf;
+    --len;
   }
   return c ^ 0xffffffffL;
 }
@@ -2728,8 +3799,10 @@ static unsigned LodePNGUnknownChunks_copy(LodePNGInfo* dest, const LodePNGInfo*
   {
     size_t j;
     dest->unknown_chunks_size[i] = src->unknown_chunks_size[i];
+    dest->unknown_chunks_data[i] = 0;
+    if(!src->unknown_chunks_size[i]) continue; /*nothing to allocate*/
     dest->unknown_chunks_data[i] = (unsigned char*)lodepng_malloc(src->unknown_chunks_size[i]);
-    if(!dest->unknown_chunks_data[i] && dest->unknown_chunks_size[i]) return 83; /*alloc fail*/
+    if(!dest->unknown_chunks_data[i]) return 83; /*alloc fail*/
     for(j = 0; j < src->unknown_chunks_size[i]; ++j)
     {
       dest->unknown_chunks_data[i][j] = src->unknown_chunks_data[i][j];
@@ -3251,6 +4324,134 @@ static void getPixelColorRGBA8(unsigned char* r, unsigned char* g,
   }
 }
 
+#ifdef LODEPNG_SSE2
+/*
+Vectorized conversions between the common 8-bit color types, used by getPixelColorsRGBA8 and lodepng_convert. Each
+converts a prefix of the n pixels (samples for highBytesSSE2) and returns its length, the scalar code does the rest.
+The ones that shuffle 3-byte pixels need SSSE3 and are only used if the CPU supports it.
+*/
+
+/*out[i] = in[i * 2]: the high bytes of big endian 16-bit samples, which is what 16 to 8 bit conversion keeps*/
+static size_t highBytesSSE2(unsigned char* out, const unsigned char* in, size_t n)
+{
+  const __m128i low = _mm_set1_epi16(0xff);
+  size_t i;
+  for(i = 0; i + 16 <= n; i += 16)
+  {
+    __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 2)), low);
+    __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 2 + 16)), low);
+    _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(a, b));
+  }
+  return i;
+}
+
+/*RGBA to grey, which like rgba8ToPixel takes the red channel*/
+static size_t rgbaToGrey8SSE2(unsigned char* out, const unsigned char* in, size_t n)
+{
+  const __m128i red = _mm_set1_epi32(0xff);
+  size_t i;
+  for(i = 0; i + 16 <= n; i += 16)
+  {
+    __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 4)), red);
+    __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 4 + 16)), red);
+    __m128i c = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 4 + 32)), red);
+    __m128i d = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 4 + 48)), red);
+    _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+  }
+  return i;
+}
+
+/*grey without color key to opaque RGBA*/
+static size_t greyToRGBA8SSE2(unsigned char* out, const unsigned char* in, size_t n)
+{
+  const __m128i opaque = _mm_set1_epi8(-1);
+  size_t i;
+  for(i = 0; i + 16 <= n; i += 16)
+  {
+    __m128i grey = _mm_loadu_si128((const __m128i*)(in + i));
+    __m128i gglo = _mm_unpacklo_epi8(grey, grey), gahi = _mm_unpackhi_epi8(grey, opaque);
+    __m128i galo = _mm_unpacklo_epi8(grey, opaque), gghi = _mm_unpackhi_epi8(grey, grey);
+    _mm_storeu_si128((__m128i*)(out + i * 4), _mm_unpacklo_epi16(gglo, galo));
+    _mm_storeu_si128((__m128i*)(out + i * 4 + 16), _mm_unpackhi_epi16(gglo, galo));
+    _mm_storeu_si128((__m128i*)(out + i * 4 + 32), _mm_unpacklo_epi16(gghi, gahi));
+    _mm_storeu_si128((__m128i*)(out + i * 4 + 48), _mm_unpackhi_epi16(gghi, gahi));
+  }
+  return i;
+}
+
+#ifdef LODEPNG_X86_DISPATCH
+/*RGB without color key to opaque RGBA. The 16-byte loads read 4 bytes past the 4 pixels used, hence i + 6 <= n*/
+LODEPNG_TARGET("ssse3")
+static size_t rgbToRGBA8SSSE3(unsigned char* out, const unsigned char* in, size_t n)
+{
+  const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i opaque = _mm_setr_epi8(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+  size_t i;
+  for(i = 0; i + 6 <= n; i += 4)
+  {
+    __m128i rgb = _mm_loadu_si128((const __m128i*)(in + i * 3));
+    _mm_storeu_si128((__m128i*)(out + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), opaque));
+  }
+  return i;
+}
+
+/*RGBA to RGB. The 16-byte stores write 4 bytes past the 4 pixels done, which the next ones overwrite*/
+LODEPNG_TARGET("ssse3")
+static size_t rgbaToRGB8SSSE3(unsigned char* out, const unsigned char* in, size_t n)
+{
+  const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  size_t i;
+  for(i = 0; i + 6 <= n; i += 4)
+  {
+    __m128i rgba = _mm_loadu_si128((const __m128i*)(in + i * 4));
+    _mm_storeu_si128((__m128i*)(out + i * 3), _mm_shuffle_epi8(rgba, shuffle));
+  }
+  return i;
+}
+
+LODEPNG_TARGET("ssse3")
+static size_t greyToRGB8SSSE3(unsigned char* out, const unsigned char* in, size_t n)
+{
+  const __m128i shuffle0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+  const __m128i shuffle1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+  const __m128i shuffle2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+  size_t i;
+  for(i = 0; i + 16 <= n; i += 16)
+  {
+    __m128i grey = _mm_loadu_si128((const __m128i*)(in + i));
+    _mm_storeu_si128((__m128i*)(out + i * 3), _mm_shuffle_epi8(grey, shuffle0));
+    _mm_storeu_si128((__m128i*)(out + i * 3 + 16), _mm_shuffle_epi8(grey, shuffle1));
+    _mm_storeu_si128((__m128i*)(out + i * 3 + 32), _mm_shuffle_epi8(grey, shuffle2));
+  }
+  return i;
+}
+#endif /*LODEPNG_X86_DISPATCH*/
+
+/*the vectorized part of getPixelColorsRGBA8, returns the number of pixels done*/
+static size_t getPixelColorsRGBA8SSE2(unsigned char* buffer, size_t numpixels,
+                                      unsigned has_alpha, const unsigned char* in,
+                                      const LodePNGColorMode* mode)
+{
+  if(mode->bitdepth == 16 && mode->colortype == (has_alpha ? LCT_RGBA : LCT_RGB))
+  {
+    /*the color key of RGB does not matter without alpha*/
+    unsigned num_channels = has_alpha ? 4 : 3;
+    return highBytesSSE2(buffer, in, numpixels * num_channels) / num_channels;
+  }
+  if(mode->bitdepth != 8) return 0;
+  if(mode->colortype == LCT_GREY && has_alpha && !mode->key_defined) return greyToRGBA8SSE2(buffer, in, numpixels);
+#ifdef LODEPNG_X86_DISPATCH
+  if(numpixels >= 16 && cpuHasSSSE3())
+  {
+    if(mode->colortype == LCT_GREY && !has_alpha) return greyToRGB8SSSE3(buffer, in, numpixels);
+    if(mode->colortype == LCT_RGB && has_alpha && !mode->key_defined) return rgbToRGBA8SSSE3(buffer, in, numpixels);
+    if(mode->colortype == LCT_RGBA && !has_alpha) return rgbaToRGB8SSSE3(buffer, in, numpixels);
+  }
+#endif /*LODEPNG_X86_DISPATCH*/
+  return 0;
+}
+#endif /*LODEPNG_SSE2*/
+
 /*Similar to getPixelColorRGBA8, but with all the for loops inside of the color
 mode test cases, optimized to convert the colors much faster, when converting
 to RGBA or RGB with 8 bit per cannel. buffer must be RGBA or RGB output with
@@ -3262,6 +4463,13 @@ static void getPixelColorsRGBA8(unsigned char* buffer, size_t numpixels,
 {
   unsigned num_channels = has_alpha ? 4 : 3;
   size_t i;
+#ifdef LODEPNG_SSE2
+  /*only color types of whole bytes per pixel are vectorized, continue after the pixels done*/
+  i = getPixelColorsRGBA8SSE2(buffer, numpixels, has_alpha, in, mode);
+  buffer += i * num_channels;
+  in += i * (lodepng_get_bpp(mode) / 8);
+  numpixels -= i;
+#endif /*LODEPNG_SSE2*/
   if(mode->colortype == LCT_GREY)
   {
     if(mode->bitdepth == 8)
@@ -3434,7 +4642,7 @@ unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
   if(lodepng_color_mode_equal(mode_out, mode_in))
   {
     size_t numbytes = lodepng_get_raw_size(w, h, mode_in);
-    for(i = 0; i != numbytes; ++i) out[i] = in[i];
+    memcpy(out, in, numbytes);
     return 0;
   }
 
@@ -3476,6 +4684,26 @@ unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
   {
     getPixelColorsRGBA8(out, numpixels, 0, in, mode_in);
   }
+  else if(mode_out->bitdepth == 8 && mode_in->bitdepth == 16 && mode_out->colortype == mode_in->colortype)
+  {
+    /*grey or grey with alpha from 16 to 8 bit: only the high bytes remain, the color key does not matter*/
+    size_t numsamples = numpixels * getNumColorChannels(mode_in->colortype);
+    i = 0;
+#ifdef LODEPNG_SSE2
+    i = highBytesSSE2(out, in, numsamples);
+#endif /*LODEPNG_SSE2*/
+    for(; i != numsamples; ++i) out[i] = in[i * 2];
+  }
+  else if(mode_out->bitdepth == 8 && mode_out->colortype == LCT_GREY
+          && mode_in->bitdepth == 8 && mode_in->colortype == LCT_RGBA)
+  {
+    /*rgba8ToPixel takes the red channel as grey*/
+    i = 0;
+#ifdef LODEPNG_SSE2
+    i = rgbaToGrey8SSE2(out, in, numpixels);
+#endif /*LODEPNG_SSE2*/
+    for(; i != numpixels; ++i) out[i] = in[i * 4];
+  }
   else
   {
     unsigned char r = 0, g = 0, b = 0, a = 0;
@@ -3688,25 +4916,136 @@ unsigned lodepng_get_color_profile(LodePNGColorProfile* profile,
   return error;
 }
 
-/*Automatically chooses color type that gives smallest amount of bits in the
-output image, e.g. grey if there are only greyscale pixels, palette if there
-are less than 256 colors, ...
-Updates values of mode with a potentially smaller color model. mode_out should
-contain the user chosen color model, but will be overwritten with the new chosen one.*/
-unsigned lodepng_auto_choose_color(LodePNGColorMode* mode_out,
-                                   const unsigned char* image, unsigned w, unsigned h,
-                                   const LodePNGColorMode* mode_in)
+#ifdef LODEPNG_SSE2
+/*ands the alpha values and ors the differences of red to green and to blue of the first pixels of an RGBA image,
+returns the number of pixels done*/
+static size_t getRGBA8StatsSSE2(unsigned char* alpha, unsigned* colored, const unsigned char* in, size_t numpixels)
 {
-  LodePNGColorProfile prof;
-  unsigned error = 0;
-  unsigned i, n, palettebits, grey_ok, palette_ok;
-
-  lodepng_color_profile_init(&prof);
-  error = lodepng_get_color_profile(&prof, image, w, h, mode_in);
-  if(error) return error;
-  mode_out->key_defined = 0;
-
-  if(prof.key && w * h <= 16)
+  __m128i all = _mm_set1_epi8(-1), diff = _mm_setzero_si128();
+  size_t i;
+  for(i = 0; i + 4 <= numpixels; i += 4)
+  {
+    __m128i rgba = _mm_loadu_si128((const __m128i*)(in + i * 4));
+    all = _mm_and_si128(all, rgba);
+    /*the bytes of each pixel become r ^ g, g ^ b, b ^ a, a*/
+    diff = _mm_or_si128(diff, _mm_xor_si128(rgba, _mm_srli_epi32(rgba, 8)));
+  }
+  if((_mm_movemask_epi8(_mm_cmpeq_epi8(all, _mm_set1_epi8(-1))) & 0x8888) != 0x8888) *alpha = 0;
+  if((_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) & 0x3333) != 0x3333) *colored = 1;
+  return i;
+}
+#endif /*LODEPNG_SSE2*/
+
+/*
+Faster lodepng_get_color_profile for opaque 8-bit grey, RGB or RGBA images without color key, the usual input of the
+encoder. A first pass finds out whether the image is opaque and grey, then the distinct colors are counted with a
+table of the grey values or a small hash set of the RGB colors instead of the color tree. Gives the same profile as
+lodepng_get_color_profile with a newly inited profile, returns 0 and leaves it unchanged for other images.
+*/
+unsigned lodepng_get_opaque_color_profile(LodePNGColorProfile* profile,
+                                          const unsigned char* in, unsigned w, unsigned h,
+                                          const LodePNGColorMode* mode)
+{
+  size_t numpixels = (size_t)w * h;
+  unsigned channels = getNumColorChannels(mode->colortype);
+  unsigned colored = 0;
+  unsigned char* p = profile->palette;
+  size_t i = 0;
+
+  if(mode->bitdepth != 8 || mode->key_defined) return 0;
+  if(mode->colortype == LCT_RGBA)
+  {
+    unsigned char alpha = 255;
+#ifdef LODEPNG_SSE2
+    i = getRGBA8StatsSSE2(&alpha, &colored, in, numpixels);
+#endif /*LODEPNG_SSE2*/
+    for(; i != numpixels; ++i)
+    {
+      alpha &= in[i * 4 + 3];
+      if(in[i * 4 + 0] != in[i * 4 + 1] || in[i * 4 + 0] != in[i * 4 + 2]) colored = 1;
+    }
+    if(alpha != 255) return 0;
+  }
+  else if(mode->colortype == LCT_RGB)
+  {
+    for(; i != numpixels && !colored; ++i)
+    {
+      if(in[i * 3 + 0] != in[i * 3 + 1] || in[i * 3 + 0] != in[i * 3 + 2]) colored = 1;
+    }
+  }
+  else if(mode->colortype != LCT_GREY) return 0;
+
+  if(!colored)
+  {
+    /*all 256 grey values present means 8 bits, the rest doesn't matter*/
+    unsigned char seen[256];
+    memset(seen, 0, sizeof(seen));
+    for(i = 0; i != numpixels && profile->numcolors != 256; ++i)
+    {
+      unsigned char value = in[i * channels];
+      if(seen[value]) continue;
+      seen[value] = 1;
+      p[profile->numcolors * 4 + 0] = p[profile->numcolors * 4 + 1] = p[profile->numcolors * 4 + 2] = value;
+      p[profile->numcolors * 4 + 3] = 255;
+      ++profile->numcolors;
+      if(getValueRequiredBits(value) > profile->bits) profile->bits = getValueRequiredBits(value);
+    }
+  }
+  else
+  {
+    /*hash set of (1 << 24 | rgb) with linear probing, 0 is empty. Counting stops at 257 colors,
+    more than a palette can have, so the set never gets more than half full*/
+    unsigned set[512];
+    unsigned last = 0;
+    memset(set, 0, sizeof(set));
+    for(i = 0; i != numpixels && profile->numcolors != 257; ++i)
+    {
+      const unsigned char* c = &in[i * channels];
+      unsigned color = (1u << 24) | ((unsigned)c[0] << 16) | ((unsigned)c[1] << 8) | c[2];
+      unsigned h;
+      if(color == last) continue; /*runs of the same color are common*/
+      last = color;
+      h = ((color * 2654435761u) >> 23) & 511u;
+      while(set[h] && set[h] != color) h = (h + 1) & 511u;
+      if(set[h]) continue;
+      set[h] = color;
+      if(profile->numcolors < 256)
+      {
+        p[profile->numcolors * 4 + 0] = c[0];
+        p[profile->numcolors * 4 + 1] = c[1];
+        p[profile->numcolors * 4 + 2] = c[2];
+        p[profile->numcolors * 4 + 3] = 255;
+      }
+      ++profile->numcolors;
+    }
+    profile->colored = 1;
+    profile->bits = 8;
+  }
+  return 1;
+}
+
+/*Automatically chooses color type that gives smallest amount of bits in the
+output image, e.g. grey if there are only greyscale pixels, palette if there
+are less than 256 colors, ...
+Updates values of mode with a potentially smaller color model. mode_out should
+contain the user chosen color model, but will be overwritten with the new chosen one.*/
+unsigned lodepng_auto_choose_color(LodePNGColorMode* mode_out,
+                                   const unsigned char* image, unsigned w, unsigned h,
+                                   const LodePNGColorMode* mode_in)
+{
+  LodePNGColorProfile prof;
+  unsigned error = 0;
+  unsigned i, n, palettebits, grey_ok, palette_ok;
+
+  lodepng_color_profile_init(&prof);
+  if(!lodepng_get_opaque_color_profile(&prof, image, w, h, mode_in))
+  {
+    error = lodepng_get_color_profile(&prof, image, w, h, mode_in);
+    if(error) return error;
+  }
+  mode_out->key_defined = 0;
+
+  if(prof.key && w * h <= 16)
   {
     prof.alpha = 1; /*too few pixels to justify tRNS chunk overhead*/
     if(prof.bits < 8) prof.bits = 8; /*PNG has no alphachannel modes with less than 8-bit per channel*/
@@ -3776,6 +5115,37 @@ static unsigned char paethPredictor(short a, short b, short c)
   else return (unsigned char)a;
 }
 
+#ifdef LODEPNG_SSE2
+/*
+branch-free paethPredictor on 16-bit lanes: the predictor is a if pa <= pb and pa <= pc, else b if pb <= pc,
+else c, which is the order of the comparisons in paethPredictor
+*/
+static __m128i paethPredictorSSE2(__m128i a, __m128i b, __m128i c)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i pa = _mm_sub_epi16(b, c); /*p - a*/
+  __m128i pb = _mm_sub_epi16(a, c); /*p - b*/
+  __m128i pc = _mm_add_epi16(pa, pb); /*p - c*/
+  __m128i smallest, pred, x;
+  pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+  pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+  pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+  smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+  /*c where pc is smallest, overwritten by b where pb is, overwritten by a where pa is*/
+  pred = c;
+  x = _mm_cmpeq_epi16(pb, smallest);
+  pred = _mm_or_si128(_mm_and_si128(x, b), _mm_andnot_si128(x, pred));
+  x = _mm_cmpeq_epi16(pa, smallest);
+  return _mm_or_si128(_mm_and_si128(x, a), _mm_andnot_si128(x, pred));
+}
+
+/*rounded down average of the bytes, _mm_avg_epu8 rounds up*/
+static __m128i averageSSE2(__m128i a, __m128i b)
+{
+  return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+#endif /*LODEPNG_SSE2*/
+
 /*shared values used by multiple Adam7 related functions*/
 
 static const unsigned ADAM7_IX[7] = { 0, 4, 0, 2, 0, 1, 0 }; /*x start values*/
@@ -3826,6 +5196,93 @@ static void Adam7_getpassvalues(unsigned passw[7], unsigned passh[7], size_t fil
   }
 }
 
+#if defined(LODEPNG_COMPILE_DECODER) || defined(LODEPNG_COMPILE_ENCODER)
+
+/*the working memory of the encoder and decoder, emptied by the functions that use it, not in between*/
+struct LodePNGBuffers
+{
+#ifdef LODEPNG_COMPILE_DECODER
+  ucvector idat; /*the compressed image data of the IDAT chunks*/
+  ucvector scanlines; /*the inflated scanlines, or the window of the row streaming decoder*/
+  ucvector image; /*the decoded image before the color conversion*/
+  ucvector lines; /*the current and the previous scanline of the row streaming decoder*/
+#ifdef LODEPNG_COMPILE_ZLIB
+  InflateTrees trees; /*the Huffman trees of the inflater*/
+#endif /*LODEPNG_COMPILE_ZLIB*/
+#endif /*LODEPNG_COMPILE_DECODER*/
+#ifdef LODEPNG_COMPILE_ENCODER
+  ucvector converted; /*the image converted to the color type of the PNG*/
+  ucvector filtered; /*the filtered scanlines*/
+  ucvector adam7; /*the Adam7 passes of the image before filtering*/
+  ucvector padded; /*the scanlines padded to full bytes before filtering*/
+  ucvector png; /*the encoded PNG, before it is copied to the memory of the caller*/
+#ifdef LODEPNG_COMPILE_ZLIB
+  Hash hash; /*the hash tables of the deflater*/
+#endif /*LODEPNG_COMPILE_ZLIB*/
+#endif /*LODEPNG_COMPILE_ENCODER*/
+};
+
+static void buffers_init(LodePNGBuffers* buffers)
+{
+#ifdef LODEPNG_COMPILE_DECODER
+  ucvector_init(&buffers->idat);
+  ucvector_init(&buffers->scanlines);
+  ucvector_init(&buffers->image);
+  ucvector_init(&buffers->lines);
+#ifdef LODEPNG_COMPILE_ZLIB
+  inflateTrees_init(&buffers->trees);
+#endif /*LODEPNG_COMPILE_ZLIB*/
+#endif /*LODEPNG_COMPILE_DECODER*/
+#ifdef LODEPNG_COMPILE_ENCODER
+  ucvector_init(&buffers->converted);
+  ucvector_init(&buffers->filtered);
+  ucvector_init(&buffers->adam7);
+  ucvector_init(&buffers->padded);
+  ucvector_init(&buffers->png);
+#ifdef LODEPNG_COMPILE_ZLIB
+  hash_init(&buffers->hash);
+#endif /*LODEPNG_COMPILE_ZLIB*/
+#endif /*LODEPNG_COMPILE_ENCODER*/
+}
+
+static void buffers_cleanup(LodePNGBuffers* buffers)
+{
+#ifdef LODEPNG_COMPILE_DECODER
+  ucvector_cleanup(&buffers->idat);
+  ucvector_cleanup(&buffers->scanlines);
+  ucvector_cleanup(&buffers->image);
+  ucvector_cleanup(&buffers->lines);
+#ifdef LODEPNG_COMPILE_ZLIB
+  inflateTrees_cleanup(&buffers->trees);
+#endif /*LODEPNG_COMPILE_ZLIB*/
+#endif /*LODEPNG_COMPILE_DECODER*/
+#ifdef LODEPNG_COMPILE_ENCODER
+  ucvector_cleanup(&buffers->converted);
+  ucvector_cleanup(&buffers->filtered);
+  ucvector_cleanup(&buffers->adam7);
+  ucvector_cleanup(&buffers->padded);
+  ucvector_cleanup(&buffers->png);
+#ifdef LODEPNG_COMPILE_ZLIB
+  hash_cleanup(&buffers->hash);
+#endif /*LODEPNG_COMPILE_ZLIB*/
+#endif /*LODEPNG_COMPILE_ENCODER*/
+}
+
+/*the buffers the state keeps, or otherwise temp, for the call only, to be given back with releaseBuffers*/
+static LodePNGBuffers* getBuffers(const LodePNGState* state, LodePNGBuffers* temp)
+{
+  if(state->buffers) return state->buffers;
+  buffers_init(temp);
+  return temp;
+}
+
+static void releaseBuffers(LodePNGBuffers* buffers, LodePNGBuffers* temp)
+{
+  if(buffers == temp) buffers_cleanup(temp);
+}
+
+#endif /* defined(LODEPNG_COMPILE_DECODER) || defined(LODEPNG_COMPILE_ENCODER) */
+
 #ifdef LODEPNG_COMPILE_DECODER
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -3895,6 +5352,91 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+#ifdef LODEPNG_SSE2
+/*
+SSE2 versions of the filter types for 4 bytes per pixel (8-bit RGBA and 16-bit grey with alpha), which is the
+common case. Sub, Average and Paeth depend on the previous pixel, so they work pixel by pixel with the 4 bytes in
+the lanes of one register, Up and None work on 16 bytes at once. Same parameters as unfilterScanline, length is a
+multiple of 4.
+*/
+
+static __m128i loadPixel4(const unsigned char* p)
+{
+  int v;
+  memcpy(&v, p, 4);
+  return _mm_cvtsi32_si128(v);
+}
+
+static void storePixel4(unsigned char* p, __m128i x)
+{
+  int v = _mm_cvtsi128_si32(x);
+  memcpy(p, &v, 4);
+}
+
+static void unfilterUpSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                           size_t length)
+{
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(scanline + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(precon + i));
+    _mm_storeu_si128((__m128i*)(recon + i), _mm_add_epi8(x, b));
+  }
+  for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+}
+
+static void unfilterSub4SSE2(unsigned char* recon, const unsigned char* scanline, size_t length)
+{
+  /*prefix sum over the 4 pixels of a register, the last pixel is carried into the next register*/
+  __m128i a = _mm_setzero_si128();
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(scanline + i));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi8(x, a);
+    _mm_storeu_si128((__m128i*)(recon + i), x);
+    a = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  for(; i != length; i += 4)
+  {
+    a = _mm_add_epi8(loadPixel4(scanline + i), a);
+    storePixel4(recon + i, a);
+  }
+}
+
+static void unfilterAvg4SSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                             size_t length)
+{
+  __m128i a = _mm_setzero_si128();
+  size_t i;
+  for(i = 0; i != length; i += 4)
+  {
+    a = _mm_add_epi8(loadPixel4(scanline + i), averageSSE2(a, loadPixel4(precon + i)));
+    storePixel4(recon + i, a);
+  }
+}
+
+static void unfilterPaeth4SSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                               size_t length)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero, c = zero; /*left and upper left pixel, widened to 16 bits*/
+  size_t i;
+  for(i = 0; i != length; i += 4)
+  {
+    __m128i b = _mm_unpacklo_epi8(loadPixel4(precon + i), zero);
+    __m128i pred = paethPredictorSSE2(a, b, c);
+    __m128i x = _mm_add_epi8(loadPixel4(scanline + i), _mm_packus_epi16(pred, pred));
+    storePixel4(recon + i, x);
+    a = _mm_unpacklo_epi8(x, zero);
+    c = b;
+  }
+}
+#endif /*LODEPNG_SSE2*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length)
 {
@@ -3908,10 +5450,27 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#ifdef LODEPNG_SSE2
+  if(filterType == 2 && precon)
+  {
+    unfilterUpSSE2(recon, scanline, precon, length);
+    return 0;
+  }
+  if(bytewidth == 4 && length % 4 == 0)
+  {
+    switch(filterType)
+    {
+      case 1: unfilterSub4SSE2(recon, scanline, length); return 0;
+      case 3: if(precon) { unfilterAvg4SSE2(recon, scanline, precon, length); return 0; } break;
+      case 4: if(precon) { unfilterPaeth4SSE2(recon, scanline, precon, length); return 0; } break;
+      default: break;
+    }
+  }
+#endif /*LODEPNG_SSE2*/
   switch(filterType)
   {
     case 0:
-      for(i = 0; i != length; ++i) recon[i] = scanline[i];
+      if(recon != scanline) memmove(recon, scanline, length); /*Adam7 unfilters a few bytes backwards*/
       break;
     case 1:
       for(i = 0; i != bytewidth; ++i) recon[i] = scanline[i];
@@ -4448,16 +6007,17 @@ static unsigned readChunk_pHYs(LodePNGInfo* info, const unsigned char* data, siz
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
 /*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
-static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
-                          LodePNGState* state,
-                          const unsigned char* in, size_t insize)
+/*
+reads the chunks into state->info_png and collects the compressed image data of the IDAT chunks in idat.
+If segments is not 0, it receives the lpIX chunk, or 0 if there is none.
+*/
+static void readChunks(ucvector* idat, const unsigned char** segments, unsigned* w, unsigned* h,
+                       LodePNGState* state,
+                       const unsigned char* in, size_t insize)
 {
   unsigned char IEND = 0;
   const unsigned char* chunk;
   size_t i;
-  ucvector idat; /*the data from idat chunks*/
-  ucvector scanlines;
-  size_t predict;
   size_t numpixels;
 
   /*for unknown chunk order*/
@@ -4466,9 +6026,7 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   unsigned critical_pos = 1; /*1 = after IHDR, 2 = after PLTE, 3 = after IDAT*/
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
-  /*provide some proper output values if error will happen*/
-  *out = 0;
-
+  if(segments) *segments = 0;
   state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
   if(state->error) return;
 
@@ -4480,7 +6038,6 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   bytes with 16-bit RGBA, the rest is room for filter bytes.*/
   if(numpixels > 268435455) CERROR_RETURN(state->error, 92);
 
-  ucvector_init(&idat);
   chunk = &in[33]; /*first byte of the first chunk after the header*/
 
   /*loop through the chunks, ignoring unknown chunks and stopping at IEND chunk.
@@ -4508,9 +6065,9 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     /*IDAT chunk, containing compressed image data*/
     if(lodepng_chunk_type_equals(chunk, "IDAT"))
     {
-      size_t oldsize = idat.size;
-      if(!ucvector_resize(&idat, oldsize + chunkLength)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
-      for(i = 0; i != chunkLength; ++i) idat.data[oldsize + i] = data[i];
+      size_t oldsize = idat->size;
+      if(!ucvector_resize(idat, oldsize + chunkLength)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
+      for(i = 0; i != chunkLength; ++i) idat->data[oldsize + i] = data[i];
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
       critical_pos = 3;
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
@@ -4535,6 +6092,11 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
       state->error = readChunk_tRNS(&state->info_png.color, data, chunkLength);
       if(state->error) break;
     }
+    /*index of the independently compressed segments of the image data (lpIX), see addChunks_lpIX_IDAT*/
+    else if(lodepng_chunk_type_equals(chunk, "lpIX"))
+    {
+      if(segments) *segments = chunk;
+    }
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
     /*background color chunk (bKGD)*/
     else if(lodepng_chunk_type_equals(chunk, "bKGD"))
@@ -4603,91 +6165,600 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
 
     if(!IEND) chunk = lodepng_chunk_next_const(chunk);
   }
+}
+
+/*inflates the image data of readChunks into the scanlines of buffers, which are still filtered*/
+static void inflateScanlines(LodePNGBuffers* buffers, const ucvector* idat, unsigned w, unsigned h,
+                             LodePNGState* state)
+{
+  ucvector* scanlines = &buffers->scanlines;
+  size_t predict;
 
-  ucvector_init(&scanlines);
   /*predict output size, to allocate exact size for output buffer to avoid more dynamic allocation.
   If the decompressed size does not match the prediction, the image must be corrupt.*/
   if(state->info_png.interlace_method == 0)
   {
-    /*The extra *h is added because this are the filter bytes every scanline starts with*/
-    predict = lodepng_get_raw_size_idat(*w, *h, &state->info_png.color) + *h;
+    /*The extra h is added because this are the filter bytes every scanline starts with*/
+    predict = lodepng_get_raw_size_idat(w, h, &state->info_png.color) + h;
   }
   else
   {
     /*Adam-7 interlaced: predicted size is the sum of the 7 sub-images sizes*/
     const LodePNGColorMode* color = &state->info_png.color;
     predict = 0;
-    predict += lodepng_get_raw_size_idat((*w + 7) / 8, (*h + 7) / 8, color) + (*h + 7) / 8;
-    if(*w > 4) predict += lodepng_get_raw_size_idat((*w + 3) / 8, (*h + 7) / 8, color) + (*h + 7) / 8;
-    predict += lodepng_get_raw_size_idat((*w + 3) / 4, (*h + 3) / 8, color) + (*h + 3) / 8;
-    if(*w > 2) predict += lodepng_get_raw_size_idat((*w + 1) / 4, (*h + 3) / 4, color) + (*h + 3) / 4;
-    predict += lodepng_get_raw_size_idat((*w + 1) / 2, (*h + 1) / 4, color) + (*h + 1) / 4;
-    if(*w > 1) predict += lodepng_get_raw_size_idat((*w + 0) / 2, (*h + 1) / 2, color) + (*h + 1) / 2;
-    predict += lodepng_get_raw_size_idat((*w + 0) / 1, (*h + 0) / 2, color) + (*h + 0) / 2;
-  }
-  if(!state->error && !ucvector_reserve(&scanlines, predict)) state->error = 83; /*alloc fail*/
+    predict += lodepng_get_raw_size_idat((w + 7) / 8, (h + 7) / 8, color) + (h + 7) / 8;
+    if(w > 4) predict += lodepng_get_raw_size_idat((w + 3) / 8, (h + 7) / 8, color) + (h + 7) / 8;
+    predict += lodepng_get_raw_size_idat((w + 3) / 4, (h + 3) / 8, color) + (h + 3) / 8;
+    if(w > 2) predict += lodepng_get_raw_size_idat((w + 1) / 4, (h + 3) / 4, color) + (h + 3) / 4;
+    predict += lodepng_get_raw_size_idat((w + 1) / 2, (h + 1) / 4, color) + (h + 1) / 4;
+    if(w > 1) predict += lodepng_get_raw_size_idat((w + 0) / 2, (h + 1) / 2, color) + (h + 1) / 2;
+    predict += lodepng_get_raw_size_idat((w + 0) / 1, (h + 0) / 2, color) + (h + 0) / 2;
+  }
+  if(!state->error && !ucvector_reserve(scanlines, predict)) state->error = 83; /*alloc fail*/
   if(!state->error)
   {
-    state->error = zlib_decompress(&scanlines.data, &scanlines.size, idat.data,
-                                   idat.size, &state->decoder.zlibsettings);
-    if(!state->error && scanlines.size != predict) state->error = 91; /*decompressed size doesn't match prediction*/
+#ifdef LODEPNG_COMPILE_ZLIB
+    state->error = zlib_decompressv(scanlines, idat->data, idat->size, &state->decoder.zlibsettings,
+                                    &buffers->trees);
+#else /*LODEPNG_COMPILE_ZLIB*/
+    state->error = zlib_decompressv(scanlines, idat->data, idat->size, &state->decoder.zlibsettings);
+#endif /*LODEPNG_COMPILE_ZLIB*/
+    if(!state->error && scanlines->size != predict) state->error = 91; /*decompressed size doesn't match prediction*/
   }
-  ucvector_cleanup(&idat);
+}
 
-  if(!state->error)
+#if defined(LODEPNG_COMPILE_ZLIB) && defined(__cplusplus)
+/*Adler-32 of two pieces of data one after another, from their checksums and the size of the second piece*/
+static unsigned adler32_combine(unsigned adler1, unsigned adler2, size_t size2)
+{
+  unsigned rem = (unsigned)(size2 % 65521);
+  unsigned s1 = adler1 & 0xffff;
+  unsigned s2 = (rem * s1) % 65521;
+  s1 += (adler2 & 0xffff) + 65521 - 1;
+  s2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + 65521 - rem;
+  if(s1 >= 65521) s1 -= 65521;
+  if(s1 >= 65521) s1 -= 65521;
+  if(s2 >= 2 * 65521) s2 -= 2 * 65521;
+  if(s2 >= 65521) s2 -= 65521;
+  return (s2 << 16) | s1;
+}
+
+typedef struct InflateSegmentJob
+{
+  const unsigned char* in; /*the deflate data of the segment*/
+  size_t insize;
+  unsigned final; /*the last segment ends with the final block, the others with a sync flush*/
+  unsigned ybegin, yend;
+  size_t linebytes, bytewidth;
+  LodePNGRowCallback callback;
+  void* user;
+  unsigned adler; /*Adler-32 of the scanlines of the segment*/
+  unsigned error;
+} InflateSegmentJob;
+
+static void inflateSegmentJob(InflateSegmentJob* job)
+{
+  ucvector scanlines;
+  InflateTrees trees;
+  size_t rowsize = job->linebytes + 1;
+  size_t size = rowsize * (job->yend - job->ybegin);
+  size_t bp = 0, pos = 0;
+  unsigned BFINAL = 0, y, error = 0;
+
+  ucvector_init(&scanlines);
+  inflateTrees_init(&trees);
+  if(!ucvector_reserve(&scanlines, size)) error = 83; /*alloc fail*/
+  while(!error && !BFINAL && bp < job->insize * 8)
+  {
+    unsigned BTYPE;
+    if(bp + 2 >= job->insize * 8) ERROR_BREAK(52); /*error, bit pointer will jump past memory*/
+    BFINAL = readBitFromStream(&bp, job->in);
+    BTYPE = 1u * readBitFromStream(&bp, job->in);
+    BTYPE += 2u * readBitFromStream(&bp, job->in);
+
+    if(BTYPE == 3) error = 20; /*error: invalid BTYPE*/
+    else if(BTYPE == 0) error = inflateNoCompression(&scanlines, job->in, &bp, &pos, job->insize);
+    else error = inflateHuffmanBlock(&scanlines, job->in, &bp, &pos, job->insize, BTYPE, 0, &trees);
+  }
+  /*the segment must end where the next one starts*/
+  if(!error && (BFINAL != job->final || (!BFINAL && bp != job->insize * 8))) error = 52;
+  if(!error && pos != size) error = 91; /*decompressed size doesn't match prediction*/
+  if(!error) job->adler = update_adler32(1, scanlines.data, (unsigned)size);
+
+  for(y = job->ybegin; y != job->yend && !error; ++y)
   {
-    size_t outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
-    ucvector outv;
-    ucvector_init(&outv);
-    if(!ucvector_resizev(&outv, outsize, 0)) state->error = 83; /*alloc fail*/
-    if(!state->error) state->error = postProcessScanlines(outv.data, scanlines.data, *w, *h, &state->info_png);
-    *out = outv.data;
+    unsigned char* line = &scanlines.data[(y - job->ybegin) * rowsize];
+    /*the previous scanline of the first one is in another segment*/
+    if(y == job->ybegin && y != 0 && line[0] > 1) error = 36;
+    if(!error)
+    {
+      error = unfilterScanline(&line[1], &line[1], y == job->ybegin ? 0 : &line[1 - rowsize],
+                               job->bytewidth, line[0], job->linebytes);
+    }
+    if(!error) error = job->callback(job->user, y, &line[1], job->linebytes);
   }
+
   ucvector_cleanup(&scanlines);
+  inflateTrees_cleanup(&trees);
+  job->error = error;
+}
+
+static void inflateSegmentJobs(InflateSegmentJob* jobs, unsigned numjobs, unsigned first, unsigned step)
+{
+  unsigned i;
+  for(i = first; i < numjobs; i += step) inflateSegmentJob(&jobs[i]);
+}
+
+/*
+Inflates and unfilters the segments listed in the lpIX chunk on several threads, and hands the rows to the
+callback from these threads, each segment in order. Returns 0 on success. Otherwise the segments are not as
+addChunks_lpIX_IDAT writes them, or there is only one thread, and the image must be decoded as usual.
+*/
+static unsigned decodeSegments(LodePNGRowCallback callback, void* user, const ucvector* idat,
+                               const unsigned char* chunk, unsigned w, unsigned h, const LodePNGState* state)
+{
+  const unsigned char* index = lodepng_chunk_data_const(chunk);
+  size_t indexsize = lodepng_chunk_length(chunk);
+  const LodePNGDecompressSettings* zlibsettings = &state->decoder.zlibsettings;
+  size_t linebytes = lodepng_get_raw_size_idat(w, 1, &state->info_png.color);
+  size_t rowsize = linebytes + 1;
+  std::vector<InflateSegmentJob> jobs;
+  std::vector<std::thread> threads;
+  unsigned numsegments, numthreads, i, adler = 1, error = 0;
+
+  if(state->info_png.interlace_method != 0 || zlibsettings->custom_zlib || zlibsettings->custom_inflate) return 1;
+  if(indexsize < 12 || (indexsize - 4) % 8 != 0) return 1;
+  numsegments = lodepng_read32bitInt(index);
+  if(numsegments != (indexsize - 4) / 8) return 1;
+  if(idat->size < 6 || zlib_check_header(idat->data, idat->size)) return 1;
+
+  numthreads = state->decoder.num_threads ? state->decoder.num_threads : std::thread::hardware_concurrency();
+  if(numthreads > numsegments) numthreads = numsegments;
+  if(numthreads < 2) return 1; /*one segment after another is not faster than the usual decoding*/
+
+  jobs.resize(numsegments);
+  for(i = 0; i != numsegments; ++i)
+  {
+    InflateSegmentJob* job = &jobs[i];
+    unsigned last = i + 1 == numsegments;
+    size_t begin = lodepng_read32bitInt(&index[4 + 8 * i]);
+    size_t first = lodepng_read32bitInt(&index[8 + 8 * i]);
+    size_t end = last ? idat->size - 4 : lodepng_read32bitInt(&index[12 + 8 * i]);
+    size_t next = last ? rowsize * h : lodepng_read32bitInt(&index[16 + 8 * i]);
+    /*the segments cover the deflate data and the scanlines one after another*/
+    if(i == 0 && (begin != 2 || first != 0)) return 1;
+    if(begin >= end || end > idat->size - 4) return 1;
+    if(first >= next || next > rowsize * h || first % rowsize != 0 || next % rowsize != 0) return 1;
+
+    job->in = &idat->data[begin];
+    job->insize = end - begin;
+    job->final = last;
+    job->ybegin = (unsigned)(first / rowsize);
+    job->yend = (unsigned)(next / rowsize);
+    job->linebytes = linebytes;
+    job->bytewidth = (lodepng_get_bpp(&state->info_png.color) + 7) / 8;
+    job->callback = callback;
+    job->user = user;
+    job->adler = 1;
+    job->error = 0;
+  }
+
+  /*the calling thread decodes too*/
+  for(i = 1; i != numthreads; ++i) threads.push_back(std::thread(inflateSegmentJobs, &jobs[0], numsegments, i, numthreads));
+  inflateSegmentJobs(&jobs[0], numsegments, 0, numthreads);
+  for(i = 0; i + 1 != numthreads; ++i) threads[i].join();
+
+  for(i = 0; i != numsegments && !error; ++i)
+  {
+    error = jobs[i].error;
+    adler = adler32_combine(adler, jobs[i].adler, rowsize * (jobs[i].yend - jobs[i].ybegin));
+  }
+  if(!error && !zlibsettings->ignore_adler32 && adler != lodepng_read32bitInt(&idat->data[idat->size - 4]))
+  {
+    error = 58; /*error, adler checksum not correct, data must be corrupted*/
+  }
+  return error;
+}
+
+static unsigned copyRow(void* user, unsigned y, const unsigned char* row, size_t linebytes)
+{
+  memcpy(&((unsigned char*)user)[y * linebytes], row, linebytes);
+  return 0;
+}
+#endif /*defined(LODEPNG_COMPILE_ZLIB) && defined(__cplusplus)*/
+
+/*decodes the image data that readChunks collected into out, in the color type of the PNG*/
+static void decodeIdat(unsigned char* out, const ucvector* idat, const unsigned char* segments,
+                       unsigned w, unsigned h, LodePNGState* state, LodePNGBuffers* buffers)
+{
+  unsigned bpp = lodepng_get_bpp(&state->info_png.color);
+  unsigned decoded = 0;
+
+  /*Adam7_deinterlace only sets the 1-bits of small pixels, and the padding bits at the end stay 0*/
+  if(bpp < 8) memset(out, 0, lodepng_get_raw_size(w, h, &state->info_png.color));
+#if defined(LODEPNG_COMPILE_ZLIB) && defined(__cplusplus)
+  /*the rows can be copied into out as they are if they have no padding bits*/
+  if(segments && ((size_t)w * bpp) % 8 == 0)
+  {
+    decoded = decodeSegments(copyRow, out, idat, segments, w, h, state) == 0;
+  }
+#else /*defined(LODEPNG_COMPILE_ZLIB) && defined(__cplusplus)*/
+  (void)segments;
+#endif /*defined(LODEPNG_COMPILE_ZLIB) && defined(__cplusplus)*/
+  if(!decoded)
+  {
+    inflateScanlines(buffers, idat, w, h, state);
+    if(!state->error) state->error = postProcessScanlines(out, buffers->scanlines.data, w, h, &state->info_png);
+  }
+}
+
+/*
+the decoder of lodepng_decode and lodepng_decode_to. Decodes the image in the color type of info_raw, or of the
+PNG if color_convert is off, into *out. If capacity is NULL, memory is allocated for *out, otherwise *out is memory
+of the caller with room for *capacity bytes.
+*/
+static void decodeGeneric(unsigned char** out, const size_t* capacity, size_t* outsize, unsigned* w, unsigned* h,
+                          LodePNGState* state, const unsigned char* in, size_t insize)
+{
+  LodePNGBuffers temp;
+  LodePNGBuffers* buffers = getBuffers(state, &temp);
+  const unsigned char* segments;
+  unsigned char* image = 0; /*the image in the color type of the PNG*/
+  unsigned allocated = 0, convert;
+
+  *outsize = 0;
+  buffers->idat.size = 0;
+  readChunks(&buffers->idat, &segments, w, h, state, in, insize);
+  convert = state->decoder.color_convert && !lodepng_color_mode_equal(&state->info_raw, &state->info_png.color);
+
+  /*TODO: check if this works according to the statement in the documentation: "The converter can convert
+  from greyscale input color type, to 8-bit greyscale or greyscale with alpha"*/
+  if(!state->error && convert && !(state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
+     && !(state->info_raw.bitdepth == 8))
+  {
+    state->error = 56; /*unsupported color mode conversion*/
+  }
+  if(!state->error)
+  {
+    *outsize = lodepng_get_raw_size(*w, *h, convert ? &state->info_raw : &state->info_png.color);
+    if(capacity && *outsize > *capacity) state->error = 96; /*error: the output buffer is too small*/
+    else if(!capacity)
+    {
+      *out = (unsigned char*)lodepng_malloc(*outsize);
+      allocated = 1;
+      if(!*out) state->error = 83; /*alloc fail*/
+    }
+  }
+  if(!state->error && convert)
+  {
+    if(!ucvector_resize(&buffers->image, lodepng_get_raw_size(*w, *h, &state->info_png.color))) state->error = 83;
+    image = buffers->image.data;
+  }
+  else image = *out;
+
+  if(!state->error) decodeIdat(image, &buffers->idat, segments, *w, *h, state, buffers);
+  if(!state->error && convert)
+  {
+    state->error = lodepng_convert(*out, image, &state->info_raw, &state->info_png.color, *w, *h);
+  }
+  else if(!state->error && !state->decoder.color_convert)
+  {
+    /*store the info_png color settings on the info_raw so that the info_raw still reflects what colortype
+    the raw image has to the end user*/
+    state->error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
+  }
+
+  if(state->error && allocated)
+  {
+    lodepng_free(*out);
+    *out = 0;
+  }
+  releaseBuffers(buffers, &temp);
 }
 
 unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
                         LodePNGState* state,
                         const unsigned char* in, size_t insize)
 {
+  size_t outsize;
   *out = 0;
-  decodeGeneric(out, w, h, state, in, insize);
-  if(state->error) return state->error;
-  if(!state->decoder.color_convert || lodepng_color_mode_equal(&state->info_raw, &state->info_png.color))
+  decodeGeneric(out, NULL, &outsize, w, h, state, in, insize);
+  return state->error;
+}
+
+unsigned lodepng_decode_to(unsigned char* out, size_t capacity, size_t* outsize, unsigned* w, unsigned* h,
+                           LodePNGState* state, const unsigned char* in, size_t insize)
+{
+  decodeGeneric(&out, &capacity, outsize, w, h, state, in, insize);
+  return state->error;
+}
+
+/*luminance of an 8-bit color with the weights 0.299, 0.587 and 0.114 in units of 1/256, exact for grey*/
+#define LUMINANCE8(r, g, b) ((unsigned char)((77u * (r) + 150u * (g) + 29u * (b) + 128u) >> 8))
+
+/*writes a row of grey values in the sample format, tofloat[i] is i / 255.0f*/
+static void writeSamplesGrey(unsigned char* out, LodePNGSampleFormat format, const unsigned char* grey,
+                             size_t numpixels, const float* tofloat)
+{
+  size_t i;
+  if(format == LSF_GREY8)
   {
-    /*same color type, no copying or converting of data needed*/
-    /*store the info_png color settings on the info_raw so that the info_raw still reflects what colortype
-    the raw image has to the end user*/
-    if(!state->decoder.color_convert)
+    for(i = 0; i != numpixels; ++i) out[i] = grey[i];
+  }
+  else if(format == LSF_FLOAT_GREY)
+  {
+    float* samples = (float*)out;
+    for(i = 0; i != numpixels; ++i) samples[i] = tofloat[grey[i]];
+  }
+  else
+  {
+    float* samples = (float*)out;
+    for(i = 0; i != numpixels; ++i) samples[3 * i + 0] = samples[3 * i + 1] = samples[3 * i + 2] = tofloat[grey[i]];
+  }
+}
+
+/*writes a row of RGBA8 colors in the sample format, the alpha channel is ignored*/
+static void writeSamplesRGBA8(unsigned char* out, LodePNGSampleFormat format, const unsigned char* rgba,
+                              size_t numpixels, const float* tofloat)
+{
+  size_t i;
+  if(format == LSF_GREY8)
+  {
+    for(i = 0; i != numpixels; ++i) out[i] = LUMINANCE8(rgba[4 * i + 0], rgba[4 * i + 1], rgba[4 * i + 2]);
+  }
+  else if(format == LSF_FLOAT_GREY)
+  {
+    float* samples = (float*)out;
+    for(i = 0; i != numpixels; ++i)
     {
-      state->error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
-      if(state->error) return state->error;
+      samples[i] = tofloat[LUMINANCE8(rgba[4 * i + 0], rgba[4 * i + 1], rgba[4 * i + 2])];
     }
   }
   else
   {
-    /*color conversion needed; sort of copy of the data*/
-    unsigned char* data = *out;
-    size_t outsize;
+    float* samples = (float*)out;
+    for(i = 0; i != numpixels; ++i)
+    {
+      samples[3 * i + 0] = tofloat[rgba[4 * i + 0]];
+      samples[3 * i + 1] = tofloat[rgba[4 * i + 1]];
+      samples[3 * i + 2] = tofloat[rgba[4 * i + 2]];
+    }
+  }
+}
 
-    /*TODO: check if this works according to the statement in the documentation: "The converter can convert
-    from greyscale input color type, to 8-bit greyscale or greyscale with alpha"*/
-    if(!(state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
-       && !(state->info_raw.bitdepth == 8))
+/*assembles the inflated data of a non-interlaced image into scanlines and hands them on unfiltered*/
+typedef struct RowStream
+{
+  LodePNGRowCallback callback;
+  void* user;
+  unsigned char* line; /*the scanline being assembled, starting with its filter type byte*/
+  unsigned char* prevline; /*the previous scanline, unfiltered*/
+  size_t linebytes; /*without the filter type byte*/
+  size_t bytewidth;
+  size_t filled; /*the bytes of line received so far*/
+  unsigned y, h;
+} RowStream;
+
+static unsigned rowStreamWrite(void* user, const unsigned char* data, size_t size)
+{
+  RowStream* stream = (RowStream*)user;
+  size_t rowsize = stream->linebytes + 1;
+
+  while(size != 0)
+  {
+    const unsigned char* row = stream->line; /*the complete scanline, still filtered*/
+    unsigned char* swap;
+    unsigned error;
+
+    if(stream->y == stream->h) return 91; /*error: more data than the scanlines of the image*/
+    if(stream->filled == 0 && size >= rowsize)
+    {
+      row = data; /*the scanline is complete in data, unfilter it from there*/
+      data += rowsize;
+      size -= rowsize;
+    }
+    else
+    {
+      size_t amount = rowsize - stream->filled;
+      if(amount > size) amount = size;
+      memcpy(&stream->line[stream->filled], data, amount);
+      data += amount;
+      size -= amount;
+      stream->filled += amount;
+      if(stream->filled != rowsize) return 0;
+      stream->filled = 0;
+    }
+
+    error = unfilterScanline(&stream->line[1], &row[1], stream->y == 0 ? 0 : &stream->prevline[1],
+                             stream->bytewidth, row[0], stream->linebytes);
+    if(!error) error = stream->callback(stream->user, stream->y, &stream->line[1], stream->linebytes);
+    if(error) return error;
+
+    swap = stream->line;
+    stream->line = stream->prevline;
+    stream->prevline = swap;
+    ++stream->y;
+  }
+  return 0;
+}
+
+/*hands the rows of an Adam7 interlaced image to the callback, after decoding it as a whole*/
+static void decodeRowsAdam7(RowStream* stream, const ucvector* idat, unsigned w, unsigned h,
+                            LodePNGState* state, LodePNGBuffers* buffers)
+{
+  unsigned char* raw = 0;
+  size_t rawsize = lodepng_get_raw_size(w, h, &state->info_png.color);
+  size_t linebits = (size_t)w * lodepng_get_bpp(&state->info_png.color);
+  unsigned y;
+
+  inflateScanlines(buffers, idat, w, h, state);
+  if(!state->error)
+  {
+    if(!ucvector_resize(&buffers->image, rawsize)) state->error = 83; /*alloc fail*/
+    raw = buffers->image.data;
+  }
+  if(!state->error)
+  {
+    memset(raw, 0, rawsize); /*Adam7_deinterlace only sets the 1-bits of small pixels*/
+    state->error = postProcessScanlines(raw, buffers->scanlines.data, w, h, &state->info_png);
+  }
+
+  for(y = 0; y != h && !state->error; ++y)
+  {
+    const unsigned char* row = &raw[y * stream->linebytes];
+    if(linebits % 8 != 0) /*the rows of raw are not padded to full bytes*/
     {
-      return 56; /*unsupported color mode conversion*/
+      size_t ibp = y * linebits, obp = 0, i;
+      stream->line[stream->linebytes - 1] = 0;
+      for(i = 0; i != linebits; ++i) setBitOfReversedStream(&obp, stream->line, readBitFromReversedStream(&ibp, raw));
+      row = stream->line;
     }
+    state->error = stream->callback(stream->user, y, row, stream->linebytes);
+  }
+}
 
-    outsize = lodepng_get_raw_size(*w, *h, &state->info_raw);
-    *out = (unsigned char*)lodepng_malloc(outsize);
-    if(!(*out))
+/*
+the decoder of lodepng_decode_rows. If parallel is true, the segments of an lpIX chunk are decoded on several
+threads, which call the callback concurrently and not in the order of the rows
+*/
+static void decodeRows(LodePNGRowCallback callback, void* user, unsigned* w, unsigned* h,
+                       LodePNGState* state, const unsigned char* in, size_t insize, unsigned parallel)
+{
+  const LodePNGDecompressSettings* zlibsettings = &state->decoder.zlibsettings;
+  LodePNGBuffers temp;
+  LodePNGBuffers* buffers = getBuffers(state, &temp);
+  ucvector* idat = &buffers->idat; /*the data from idat chunks*/
+  const unsigned char* segments;
+  unsigned decoded = 0;
+  RowStream stream;
+
+  idat->size = 0;
+  readChunks(idat, &segments, w, h, state, in, insize);
+#if defined(LODEPNG_COMPILE_ZLIB) && defined(__cplusplus)
+  if(!state->error && parallel && segments)
+  {
+    decoded = decodeSegments(callback, user, idat, segments, *w, *h, state) == 0;
+  }
+#else /*defined(LODEPNG_COMPILE_ZLIB) && defined(__cplusplus)*/
+  (void)parallel;
+#endif /*defined(LODEPNG_COMPILE_ZLIB) && defined(__cplusplus)*/
+  if(!state->error && !decoded)
+  {
+    stream.callback = callback;
+    stream.user = user;
+    stream.linebytes = lodepng_get_raw_size_idat(*w, 1, &state->info_png.color);
+    stream.bytewidth = (lodepng_get_bpp(&state->info_png.color) + 7) / 8;
+    stream.filled = 0;
+    stream.y = 0;
+    stream.h = *h;
+    if(!ucvector_resize(&buffers->lines, 2 * (stream.linebytes + 1))) state->error = 83; /*alloc fail*/
+    stream.line = buffers->lines.data;
+    stream.prevline = &buffers->lines.data[stream.linebytes + 1];
+  }
+
+  if(!state->error && !decoded && state->info_png.interlace_method == 0)
+  {
+#ifdef LODEPNG_COMPILE_ZLIB
+    if(!zlibsettings->custom_zlib && !zlibsettings->custom_inflate)
     {
-      state->error = 83; /*alloc fail*/
+      InflateSink sink;
+      sink.write = rowStreamWrite;
+      sink.user = &stream;
+      state->error = zlib_decompress_stream(&sink, &buffers->scanlines, idat->data, idat->size, zlibsettings,
+                                            &buffers->trees);
     }
-    else state->error = lodepng_convert(*out, data, &state->info_raw,
-                                        &state->info_png.color, *w, *h);
-    lodepng_free(data);
+    else
+#endif /*LODEPNG_COMPILE_ZLIB*/
+    {
+      /*custom zlib decoders inflate all at once*/
+      ucvector* scanlines = &buffers->scanlines;
+#ifdef LODEPNG_COMPILE_ZLIB
+      state->error = zlib_decompressv(scanlines, idat->data, idat->size, zlibsettings, &buffers->trees);
+#else /*LODEPNG_COMPILE_ZLIB*/
+      state->error = zlib_decompressv(scanlines, idat->data, idat->size, zlibsettings);
+#endif /*LODEPNG_COMPILE_ZLIB*/
+      if(!state->error) state->error = rowStreamWrite(&stream, scanlines->data, scanlines->size);
+    }
+    if(!state->error && stream.y != *h) state->error = 91; /*decompressed size doesn't match prediction*/
+  }
+  else if(!state->error && !decoded)
+  {
+    decodeRowsAdam7(&stream, idat, *w, *h, state, buffers);
   }
+
+  releaseBuffers(buffers, &temp);
+}
+
+unsigned lodepng_decode_rows(LodePNGRowCallback callback, void* user, unsigned* w, unsigned* h,
+                             LodePNGState* state, const unsigned char* in, size_t insize)
+{
+  decodeRows(callback, user, w, h, state, in, insize, 0);
+  return state->error;
+}
+
+/*the destination of lodepng_decode_into, filled by writeRowInto*/
+typedef struct DecodeInto
+{
+  unsigned char* out;
+  size_t stride;
+  LodePNGSampleFormat format;
+  unsigned w;
+  const LodePNGColorMode* mode;
+  unsigned bpp;
+  unsigned isgrey8; /*the scanlines of 8-bit grey PNGs are already the grey values*/
+  float tofloat[256];
+} DecodeInto;
+
+/*rows are converted in pieces of this many pixels, a multiple of 8 so that every piece starts at a byte*/
+#define INTO_PIECE 64
+
+static unsigned writeRowInto(void* user, unsigned y, const unsigned char* row, size_t linebytes)
+{
+  DecodeInto* into = (DecodeInto*)user;
+  (void)linebytes;
+  if(into->isgrey8) writeSamplesGrey(&into->out[y * into->stride], into->format, row, into->w, into->tofloat);
+  else
+  {
+    /*on the stack, since the rows can be written from several threads*/
+    unsigned char rgba[INTO_PIECE * 4];
+    size_t samplesize = into->format == LSF_GREY8 ? 1 : into->format == LSF_FLOAT_GREY ? 4 : 12;
+    unsigned x, n;
+    for(x = 0; x < into->w; x += n)
+    {
+      n = into->w - x < INTO_PIECE ? into->w - x : INTO_PIECE;
+      getPixelColorsRGBA8(rgba, n, 1, &row[(size_t)(x / 8) * into->bpp], into->mode);
+      writeSamplesRGBA8(&into->out[y * into->stride + x * samplesize], into->format, rgba, n, into->tofloat);
+    }
+  }
+  return 0;
+}
+
+unsigned lodepng_decode_into(void* out, size_t stride, LodePNGSampleFormat format,
+                             unsigned w, unsigned h, LodePNGState* state,
+                             const unsigned char* in, size_t insize)
+{
+  DecodeInto into;
+  unsigned imagew, imageh, i;
+
+  state->error = lodepng_inspect(&imagew, &imageh, state, in, insize);
+  if(state->error) return state->error;
+  if(imagew != w || imageh != h) CERROR_RETURN_ERROR(state->error, 95); /*error: not the expected size*/
+  if(format != LSF_FLOAT_GREY && format != LSF_FLOAT_RGB && format != LSF_GREY8)
+  {
+    CERROR_RETURN_ERROR(state->error, 94);
+  }
+
+  into.out = (unsigned char*)out;
+  into.stride = stride;
+  into.format = format;
+  into.w = w;
+  into.mode = &state->info_png.color;
+  into.bpp = lodepng_get_bpp(into.mode);
+  into.isgrey8 = into.mode->colortype == LCT_GREY && into.mode->bitdepth == 8;
+  for(i = 0; i != 256; ++i) into.tofloat[i] = i / 255.0f;
+
+  /*writeRowInto can write the rows from several threads*/
+  decodeRows(writeRowInto, &into, &imagew, &imageh, state, in, insize, 1);
   return state->error;
 }
 
@@ -4746,6 +6817,7 @@ void lodepng_decoder_settings_init(LodePNGDecoderSettings* settings)
   settings->remember_unknown_chunks = 0;
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
   settings->ignore_crc = 0;
+  settings->num_threads = 1;
   lodepng_decompress_settings_init(&settings->zlibsettings);
 }
 
@@ -4764,24 +6836,41 @@ void lodepng_state_init(LodePNGState* state)
   lodepng_color_mode_init(&state->info_raw);
   lodepng_info_init(&state->info_png);
   state->error = 1;
+  state->buffers = 0;
 }
 
 void lodepng_state_cleanup(LodePNGState* state)
 {
   lodepng_color_mode_cleanup(&state->info_raw);
   lodepng_info_cleanup(&state->info_png);
+  if(state->buffers)
+  {
+    buffers_cleanup(state->buffers);
+    lodepng_free(state->buffers);
+    state->buffers = 0;
+  }
 }
 
 void lodepng_state_copy(LodePNGState* dest, const LodePNGState* source)
 {
   lodepng_state_cleanup(dest);
   *dest = *source;
+  dest->buffers = 0;
   lodepng_color_mode_init(&dest->info_raw);
   lodepng_info_init(&dest->info_png);
   dest->error = lodepng_color_mode_copy(&dest->info_raw, &source->info_raw); if(dest->error) return;
   dest->error = lodepng_info_copy(&dest->info_png, &source->info_png); if(dest->error) return;
 }
 
+unsigned lodepng_state_keep_buffers(LodePNGState* state)
+{
+  if(state->buffers) return 0;
+  state->buffers = (LodePNGBuffers*)lodepng_malloc(sizeof(LodePNGBuffers));
+  if(!state->buffers) return 83; /*alloc fail*/
+  buffers_init(state->buffers);
+  return 0;
+}
+
 #endif /* defined(LODEPNG_COMPILE_DECODER) || defined(LODEPNG_COMPILE_ENCODER) */
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -4790,12 +6879,32 @@ void lodepng_state_copy(LodePNGState* dest, const LodePNGState* source)
 /* / PNG Encoder                                                            / */
 /* ////////////////////////////////////////////////////////////////////////// */
 
+/*starts a chunk at the end of out, its data is appended next and the chunk completed with endChunk*/
+static unsigned beginChunk(ucvector* out, const char* chunkName)
+{
+  size_t pos = out->size;
+  if(!ucvector_resize(out, pos + 8)) return 83; /*alloc fail*/
+  memcpy(&out->data[pos + 4], chunkName, 4);
+  return 0;
+}
+
+/*fills in the length of the chunk starting at pos and adds its CRC*/
+static unsigned endChunk(ucvector* out, size_t pos)
+{
+  lodepng_set32bitInt(&out->data[pos], (unsigned)(out->size - pos - 8));
+  if(!ucvector_resize(out, out->size + 4)) return 83; /*alloc fail*/
+  lodepng_chunk_generate_crc(&out->data[pos]);
+  return 0;
+}
+
 /*chunkName must be string of 4 characters*/
 static unsigned addChunk(ucvector* out, const char* chunkName, const unsigned char* data, size_t length)
 {
-  CERROR_TRY_RETURN(lodepng_chunk_create(&out->data, &out->size, (unsigned)length, chunkName, data));
-  out->allocsize = out->size; /*fix the allocsize again*/
-  return 0;
+  size_t pos = out->size;
+  CERROR_TRY_RETURN(beginChunk(out, chunkName));
+  if(!ucvector_resize(out, pos + 8 + length)) return 83; /*alloc fail*/
+  if(length) memcpy(&out->data[pos + 8], data, length);
+  return endChunk(out, pos);
 }
 
 static void writeSignature(ucvector* out)
@@ -4814,39 +6923,29 @@ static void writeSignature(ucvector* out)
 static unsigned addChunk_IHDR(ucvector* out, unsigned w, unsigned h,
                               LodePNGColorType colortype, unsigned bitdepth, unsigned interlace_method)
 {
-  unsigned error = 0;
-  ucvector header;
-  ucvector_init(&header);
-
-  lodepng_add32bitInt(&header, w); /*width*/
-  lodepng_add32bitInt(&header, h); /*height*/
-  ucvector_push_back(&header, (unsigned char)bitdepth); /*bit depth*/
-  ucvector_push_back(&header, (unsigned char)colortype); /*color type*/
-  ucvector_push_back(&header, 0); /*compression method*/
-  ucvector_push_back(&header, 0); /*filter method*/
-  ucvector_push_back(&header, interlace_method); /*interlace method*/
+  unsigned char header[13];
 
-  error = addChunk(out, "IHDR", header.data, header.size);
-  ucvector_cleanup(&header);
+  lodepng_set32bitInt(header + 0, w); /*width*/
+  lodepng_set32bitInt(header + 4, h); /*height*/
+  header[8] = (unsigned char)bitdepth; /*bit depth*/
+  header[9] = (unsigned char)colortype; /*color type*/
+  header[10] = 0; /*compression method*/
+  header[11] = 0; /*filter method*/
+  header[12] = (unsigned char)interlace_method; /*interlace method*/
 
-  return error;
+  return addChunk(out, "IHDR", header, 13);
 }
 
 static unsigned addChunk_PLTE(ucvector* out, const LodePNGColorMode* info)
 {
-  unsigned error = 0;
-  size_t i;
-  ucvector PLTE;
-  ucvector_init(&PLTE);
+  unsigned char PLTE[256 * 3];
+  size_t i, j = 0;
   for(i = 0; i != info->palettesize * 4; ++i)
   {
     /*add all channels except alpha channel*/
-    if(i % 4 != 3) ucvector_push_back(&PLTE, info->palette[i]);
+    if(i % 4 != 3) PLTE[j++] = info->palette[i];
   }
-  error = addChunk(out, "PLTE", PLTE.data, PLTE.size);
-  ucvector_cleanup(&PLTE);
-
-  return error;
+  return addChunk(out, "PLTE", PLTE, j);
 }
 
 static unsigned addChunk_tRNS(ucvector* out, const LodePNGColorMode* info)
@@ -4894,20 +6993,113 @@ static unsigned addChunk_tRNS(ucvector* out, const LodePNGColorMode* info)
   return error;
 }
 
+/*the zlib data is compressed straight into out, with the hash tables kept in buffers*/
 static unsigned addChunk_IDAT(ucvector* out, const unsigned char* data, size_t datasize,
-                              LodePNGCompressSettings* zlibsettings)
+                              LodePNGCompressSettings* zlibsettings, LodePNGBuffers* buffers)
 {
-  ucvector zlibdata;
-  unsigned error = 0;
+  size_t pos = out->size;
+  unsigned error = beginChunk(out, "IDAT");
 
   /*compress with the Zlib compressor*/
+#ifdef LODEPNG_COMPILE_ZLIB
+  if(!error) error = zlib_compressv(out, data, datasize, zlibsettings, &buffers->hash);
+#else /*LODEPNG_COMPILE_ZLIB*/
+  (void)buffers;
+  if(!error) error = zlib_compressv(out, data, datasize, zlibsettings);
+#endif /*LODEPNG_COMPILE_ZLIB*/
+  if(!error) error = endChunk(out, pos);
+
+  return error;
+}
+
+#ifdef LODEPNG_COMPILE_ZLIB
+typedef struct DeflateSegmentJob
+{
+  ucvector out;
+  const unsigned char* in; /*the scanlines of the segment*/
+  size_t insize;
+  unsigned final;
+  const LodePNGCompressSettings* settings;
+  unsigned error;
+} DeflateSegmentJob;
+
+static void deflateSegmentJobs(DeflateSegmentJob* jobs, unsigned numjobs, unsigned first, unsigned step)
+{
+  unsigned i;
+  for(i = first; i < numjobs; i += step)
+  {
+    jobs[i].error = lodepng_deflatev(&jobs[i].out, jobs[i].in, jobs[i].insize, jobs[i].settings, jobs[i].final, 0);
+  }
+}
+
+/*
+Writes the lpIX chunk and the IDAT chunk. The scanlines are deflated in independent segments of segmentrows
+scanlines each (see getSegmentRows), so no segment refers back to the data of the previous ones, and all
+segments but the last end with a sync flush, so each starts at a byte. The zlib stream is an ordinary one.
+The lpIX chunk holds the number of segments, then per segment the offset of its deflate data in the zlib
+data of the IDAT chunks and the offset of its first scanline in the scanlines, all as 32-bit integers.
+*/
+static unsigned addChunks_lpIX_IDAT(ucvector* out, const unsigned char* data, size_t datasize, unsigned h,
+                                    unsigned segmentrows, const LodePNGEncoderSettings* settings)
+{
+  size_t segmentsize = datasize / h * segmentrows;
+  unsigned numsegments = (h + segmentrows - 1) / segmentrows;
+  DeflateSegmentJob* jobs = (DeflateSegmentJob*)lodepng_malloc(numsegments * sizeof(DeflateSegmentJob));
+  ucvector index, zlibdata;
+  unsigned i, error = 0;
+#ifdef __cplusplus
+  std::vector<std::thread> threads;
+  unsigned numthreads;
+#endif /*__cplusplus*/
+
+  if(!jobs) return 83; /*alloc fail*/
+  for(i = 0; i != numsegments; ++i)
+  {
+    ucvector_init(&jobs[i].out);
+    jobs[i].in = &data[i * segmentsize];
+    jobs[i].insize = i + 1 == numsegments ? datasize - i * segmentsize : segmentsize;
+    jobs[i].final = i + 1 == numsegments;
+    jobs[i].settings = &settings->zlibsettings;
+    jobs[i].error = 0;
+  }
+
+#ifdef __cplusplus
+  numthreads = settings->num_threads ? settings->num_threads : std::thread::hardware_concurrency();
+  if(numthreads > numsegments) numthreads = numsegments;
+  if(numthreads == 0) numthreads = 1;
+  /*the calling thread deflates too*/
+  for(i = 1; i < numthreads; ++i) threads.push_back(std::thread(deflateSegmentJobs, jobs, numsegments, i, numthreads));
+  deflateSegmentJobs(jobs, numsegments, 0, numthreads);
+  for(i = 0; i + 1 < numthreads; ++i) threads[i].join();
+#else /*__cplusplus*/
+  deflateSegmentJobs(jobs, numsegments, 0, 1);
+#endif /*__cplusplus*/
+
+  ucvector_init(&index);
   ucvector_init(&zlibdata);
-  error = zlib_compress(&zlibdata.data, &zlibdata.size, data, datasize, zlibsettings);
+  addZlibHeader(&zlibdata);
+  lodepng_add32bitInt(&index, numsegments);
+  for(i = 0; i != numsegments && !error; ++i)
+  {
+    size_t oldsize = zlibdata.size;
+    error = jobs[i].error;
+    lodepng_add32bitInt(&index, (unsigned)zlibdata.size);
+    lodepng_add32bitInt(&index, (unsigned)(i * segmentsize));
+    if(!error && !ucvector_resize(&zlibdata, oldsize + jobs[i].out.size)) error = 83; /*alloc fail*/
+    if(!error) memcpy(&zlibdata.data[oldsize], jobs[i].out.data, jobs[i].out.size);
+  }
+  lodepng_add32bitInt(&zlibdata, adler32(data, (unsigned)datasize));
+
+  if(!error) error = addChunk(out, "lpIX", index.data, index.size);
   if(!error) error = addChunk(out, "IDAT", zlibdata.data, zlibdata.size);
-  ucvector_cleanup(&zlibdata);
 
+  for(i = 0; i != numsegments; ++i) ucvector_cleanup(&jobs[i].out);
+  lodepng_free(jobs);
+  ucvector_cleanup(&index);
+  ucvector_cleanup(&zlibdata);
   return error;
 }
+#endif /*LODEPNG_COMPILE_ZLIB*/
 
 static unsigned addChunk_IEND(ucvector* out)
 {
@@ -5067,10 +7259,68 @@ static unsigned addChunk_pHYs(ucvector* out, const LodePNGInfo* info)
 
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
+/*
+one byte of a filtered scanline: s is the byte, a the one of the pixel to the left, b the one above and c the one
+above left (0 where these are outside the image)
+*/
+static unsigned char filterByte(unsigned char filterType, unsigned char s, unsigned char a,
+                                unsigned char b, unsigned char c)
+{
+  switch(filterType)
+  {
+    case 1: return s - a;
+    case 2: return s - b;
+    case 3: return s - ((a + b) / 2);
+    case 4: return s - paethPredictor(a, b, c);
+    default: return s;
+  }
+}
+
+#ifdef LODEPNG_SSE2
+/*16 bytes of a filtered scanline, like filterByte. The filters only depend on the unfiltered image here, so
+unlike in the decoder there is no dependency between the pixels.*/
+static __m128i filterSSE2(unsigned char filterType, __m128i s, __m128i a, __m128i b, __m128i c)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo, hi;
+  switch(filterType)
+  {
+    case 1: return _mm_sub_epi8(s, a);
+    case 2: return _mm_sub_epi8(s, b);
+    case 3: return _mm_sub_epi8(s, averageSSE2(a, b));
+    case 4:
+      lo = paethPredictorSSE2(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+      hi = paethPredictorSSE2(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+      return _mm_sub_epi8(s, _mm_packus_epi16(lo, hi));
+    default: return s;
+  }
+}
+#endif /*LODEPNG_SSE2*/
+
 static void filterScanline(unsigned char* out, const unsigned char* scanline, const unsigned char* prevline,
                            size_t length, size_t bytewidth, unsigned char filterType)
 {
   size_t i;
+#ifdef LODEPNG_SSE2
+  if(prevline && filterType >= 1 && filterType <= 4 && length >= bytewidth)
+  {
+    for(i = 0; i != bytewidth; ++i) out[i] = filterByte(filterType, scanline[i], 0, prevline[i], 0);
+    for(; i + 16 <= length; i += 16)
+    {
+      __m128i x = filterSSE2(filterType,
+                             _mm_loadu_si128((const __m128i*)(scanline + i)),
+                             _mm_loadu_si128((const __m128i*)(scanline + i - bytewidth)),
+                             _mm_loadu_si128((const __m128i*)(prevline + i)),
+                             _mm_loadu_si128((const __m128i*)(prevline + i - bytewidth)));
+      _mm_storeu_si128((__m128i*)(out + i), x);
+    }
+    for(; i != length; ++i)
+    {
+      out[i] = filterByte(filterType, scanline[i], scanline[i - bytewidth], prevline[i], prevline[i - bytewidth]);
+    }
+    return;
+  }
+#endif /*LODEPNG_SSE2*/
   switch(filterType)
   {
     case 0: /*None*/
@@ -5132,46 +7382,87 @@ static float flog2(float f)
   return result + 1.442695f * (f * f * f / 3 - 3 * f * f / 2 + 3 * f - 1.83333f);
 }
 
-static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h,
-                       const LodePNGColorMode* info, const LodePNGEncoderSettings* settings)
+/*
+adds the contribution of one byte to the minimum sum of absolute differences of the five filter types.
+For differences, each byte should be treated as signed, values above 127 are negative (converted to signed
+char). Filtertype 0 isn't a difference though, so use unsigned there. This means filtertype 0 is almost never
+chosen, but that is justified.
+*/
+static void addMinsumScores(size_t sum[5], unsigned char s, unsigned char a, unsigned char b, unsigned char c)
 {
-  /*
-  For PNG filter method 0
-  out must be a buffer with as size: h + (w * h * bpp + 7) / 8, because there are
-  the scanlines with 1 extra byte per scanline
-  */
+  unsigned char type;
+  sum[0] += s;
+  for(type = 1; type != 5; ++type)
+  {
+    unsigned char f = filterByte(type, s, a, b, c);
+    sum[type] += f < 128 ? f : (255U - f);
+  }
+}
 
-  unsigned bpp = lodepng_get_bpp(info);
-  /*the width of a scanline in bytes, not including the filter type*/
-  size_t linebytes = (w * bpp + 7) / 8;
-  /*bytewidth is used for filtering, is 1 when bpp < 8, number of bytes per pixel otherwise*/
-  size_t bytewidth = (bpp + 7) / 8;
-  const unsigned char* prevline = 0;
+/*
+the sums of the LFS_MINSUM heuristic for all five filter types of a scanline, computed without storing the
+filtered scanlines
+*/
+static void getMinsumScores(size_t sum[5], const unsigned char* scanline, const unsigned char* prevline,
+                            size_t length, size_t bytewidth)
+{
+  size_t i = 0;
+  unsigned char type;
+  for(type = 0; type != 5; ++type) sum[type] = 0;
+#ifdef LODEPNG_SSE2
+  if(prevline && length >= bytewidth)
+  {
+    /*|f| of a byte f treated as signed is min(f, ~f), _mm_sad_epu8 sums up 8 bytes each*/
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    __m128i acc[5];
+    for(type = 0; type != 5; ++type) acc[type] = zero;
+    for(; i != bytewidth; ++i) addMinsumScores(sum, scanline[i], 0, prevline[i], 0);
+    for(; i + 16 <= length; i += 16)
+    {
+      __m128i s = _mm_loadu_si128((const __m128i*)(scanline + i));
+      __m128i a = _mm_loadu_si128((const __m128i*)(scanline + i - bytewidth));
+      __m128i b = _mm_loadu_si128((const __m128i*)(prevline + i));
+      __m128i c = _mm_loadu_si128((const __m128i*)(prevline + i - bytewidth));
+      acc[0] = _mm_add_epi64(acc[0], _mm_sad_epu8(s, zero));
+      for(type = 1; type != 5; ++type)
+      {
+        __m128i f = filterSSE2(type, s, a, b, c);
+        acc[type] = _mm_add_epi64(acc[type], _mm_sad_epu8(_mm_min_epu8(f, _mm_xor_si128(f, ones)), zero));
+      }
+    }
+    for(type = 0; type != 5; ++type)
+    {
+      unsigned long long halves[2];
+      _mm_storeu_si128((__m128i*)halves, acc[type]);
+      sum[type] += (size_t)(halves[0] + halves[1]);
+    }
+  }
+#endif /*LODEPNG_SSE2*/
+  for(; i != length; ++i)
+  {
+    unsigned char a = i >= bytewidth ? scanline[i - bytewidth] : 0;
+    unsigned char b = prevline ? prevline[i] : 0;
+    unsigned char c = prevline && i >= bytewidth ? prevline[i - bytewidth] : 0;
+    addMinsumScores(sum, scanline[i], a, b, c);
+  }
+}
+
+/*
+filters the scanlines ybegin to yend - 1 of the image, see filter. The filter choice of a scanline only depends
+on the unfiltered image, so blocks of scanlines can be filtered independently.
+*/
+static unsigned filterRows(unsigned char* out, const unsigned char* in, size_t linebytes, size_t bytewidth,
+                           unsigned ybegin, unsigned yend, LodePNGFilterStrategy strategy,
+                           const LodePNGEncoderSettings* settings)
+{
+  const unsigned char* prevline = ybegin ? &in[(ybegin - 1) * linebytes] : 0;
   unsigned x, y;
   unsigned error = 0;
-  LodePNGFilterStrategy strategy = settings->filter_strategy;
-
-  /*
-  There is a heuristic called the minimum sum of absolute differences heuristic, suggested by the PNG standard:
-   *  If the image type is Palette, or the bit depth is smaller than 8, then do not filter the image (i.e.
-      use fixed filtering, with the filter None).
-   * (The other case) If the image type is Grayscale or RGB (with or without Alpha), and the bit depth is
-     not smaller than 8, then use adaptive filtering heuristic as follows: independently for each row, apply
-     all five filters and select the filter that produces the smallest sum of absolute values per row.
-  This heuristic is used if filter strategy is LFS_MINSUM and filter_palette_zero is true.
-
-  If filter_palette_zero is true and filter_strategy is not LFS_MINSUM, the above heuristic is followed,
-  but for "the other case", whatever strategy filter_strategy is set to instead of the minimum sum
-  heuristic is used.
-  */
-  if(settings->filter_palette_zero &&
-     (info->colortype == LCT_PALETTE || info->bitdepth < 8)) strategy = LFS_ZERO;
-
-  if(bpp == 0) return 31; /*error: invalid color type*/
 
   if(strategy == LFS_ZERO)
   {
-    for(y = 0; y != h; ++y)
+    for(y = ybegin; y != yend; ++y)
     {
       size_t outindex = (1 + linebytes) * y; /*the extra filterbyte added to each row*/
       size_t inindex = linebytes * y;
@@ -5182,62 +7473,30 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
   }
   else if(strategy == LFS_MINSUM)
   {
-    /*adaptive filtering*/
+    /*adaptive filtering: score the five filter types, then filter directly into out with the best one*/
     size_t sum[5];
-    ucvector attempt[5]; /*five filtering attempts, one for each filter type*/
     size_t smallest = 0;
     unsigned char type, bestType = 0;
 
-    for(type = 0; type != 5; ++type)
+    for(y = ybegin; y != yend; ++y)
     {
-      ucvector_init(&attempt[type]);
-      if(!ucvector_resize(&attempt[type], linebytes)) return 83; /*alloc fail*/
-    }
+      size_t outindex = (1 + linebytes) * y; /*the extra filterbyte added to each row*/
+      getMinsumScores(sum, &in[y * linebytes], prevline, linebytes, bytewidth);
 
-    if(!error)
-    {
-      for(y = 0; y != h; ++y)
+      for(type = 0; type != 5; ++type)
       {
-        /*try the 5 filter types*/
-        for(type = 0; type != 5; ++type)
+        /*check if this is smallest sum (or if type == 0 it's the first case so always store the values)*/
+        if(type == 0 || sum[type] < smallest)
         {
-          filterScanline(attempt[type].data, &in[y * linebytes], prevline, linebytes, bytewidth, type);
-
-          /*calculate the sum of the result*/
-          sum[type] = 0;
-          if(type == 0)
-          {
-            for(x = 0; x != linebytes; ++x) sum[type] += (unsigned char)(attempt[type].data[x]);
-          }
-          else
-          {
-            for(x = 0; x != linebytes; ++x)
-            {
-              /*For differences, each byte should be treated as signed, values above 127 are negative
-              (converted to signed char). Filtertype 0 isn't a difference though, so use unsigned there.
-              This means filtertype 0 is almost never chosen, but that is justified.*/
-              unsigned char s = attempt[type].data[x];
-              sum[type] += s < 128 ? s : (255U - s);
-            }
-          }
-
-          /*check if this is smallest sum (or if type == 0 it's the first case so always store the values)*/
-          if(type == 0 || sum[type] < smallest)
-          {
-            bestType = type;
-            smallest = sum[type];
-          }
+          bestType = type;
+          smallest = sum[type];
         }
-
-        prevline = &in[y * linebytes];
-
-        /*now fill the out values*/
-        out[y * (linebytes + 1)] = bestType; /*the first byte of a scanline will be the filter type*/
-        for(x = 0; x != linebytes; ++x) out[y * (linebytes + 1) + 1 + x] = attempt[bestType].data[x];
       }
-    }
 
-    for(type = 0; type != 5; ++type) ucvector_cleanup(&attempt[type]);
+      out[outindex] = bestType; /*the first byte of a scanline will be the filter type*/
+      filterScanline(&out[outindex + 1], &in[y * linebytes], prevline, linebytes, bytewidth, bestType);
+      prevline = &in[y * linebytes];
+    }
   }
   else if(strategy == LFS_ENTROPY)
   {
@@ -5253,7 +7512,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
       if(!ucvector_resize(&attempt[type], linebytes)) return 83; /*alloc fail*/
     }
 
-    for(y = 0; y != h; ++y)
+    for(y = ybegin; y != yend; ++y)
     {
       /*try the 5 filter types*/
       for(type = 0; type != 5; ++type)
@@ -5287,7 +7546,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
   }
   else if(strategy == LFS_PREDEFINED)
   {
-    for(y = 0; y != h; ++y)
+    for(y = ybegin; y != yend; ++y)
     {
       size_t outindex = (1 + linebytes) * y; /*the extra filterbyte added to each row*/
       size_t inindex = linebytes * y;
@@ -5322,7 +7581,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
       ucvector_init(&attempt[type]);
       ucvector_resize(&attempt[type], linebytes); /*todo: give error if resize failed*/
     }
-    for(y = 0; y != h; ++y) /*try the 5 filter types*/
+    for(y = ybegin; y != yend; ++y) /*try the 5 filter types*/
     {
       for(type = 0; type != 5; ++type)
       {
@@ -5352,6 +7611,93 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
   return error;
 }
 
+#ifdef __cplusplus
+/*bytes of image data per thread below which filter does not split the image*/
+#define FILTER_MIN_BYTES 262144u
+
+typedef struct FilterRowsJob
+{
+  unsigned char* out;
+  const unsigned char* in;
+  size_t linebytes, bytewidth;
+  unsigned ybegin, yend;
+  LodePNGFilterStrategy strategy;
+  const LodePNGEncoderSettings* settings;
+  unsigned error;
+} FilterRowsJob;
+
+static void filterRowsJob(FilterRowsJob* job)
+{
+  job->error = filterRows(job->out, job->in, job->linebytes, job->bytewidth,
+                          job->ybegin, job->yend, job->strategy, job->settings);
+}
+#endif /*__cplusplus*/
+
+static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h,
+                       const LodePNGColorMode* info, const LodePNGEncoderSettings* settings)
+{
+  /*
+  For PNG filter method 0
+  out must be a buffer with as size: h + (w * h * bpp + 7) / 8, because there are
+  the scanlines with 1 extra byte per scanline
+  */
+
+  unsigned bpp = lodepng_get_bpp(info);
+  /*the width of a scanline in bytes, not including the filter type*/
+  size_t linebytes = (w * bpp + 7) / 8;
+  /*bytewidth is used for filtering, is 1 when bpp < 8, number of bytes per pixel otherwise*/
+  size_t bytewidth = (bpp + 7) / 8;
+  LodePNGFilterStrategy strategy = settings->filter_strategy;
+#ifdef __cplusplus
+  unsigned numthreads;
+#endif /*__cplusplus*/
+
+  /*
+  There is a heuristic called the minimum sum of absolute differences heuristic, suggested by the PNG standard:
+   *  If the image type is Palette, or the bit depth is smaller than 8, then do not filter the image (i.e.
+      use fixed filtering, with the filter None).
+   * (The other case) If the image type is Grayscale or RGB (with or without Alpha), and the bit depth is
+     not smaller than 8, then use adaptive filtering heuristic as follows: independently for each row, apply
+     all five filters and select the filter that produces the smallest sum of absolute values per row.
+  This heuristic is used if filter strategy is LFS_MINSUM and filter_palette_zero is true.
+
+  If filter_palette_zero is true and filter_strategy is not LFS_MINSUM, the above heuristic is followed,
+  but for "the other case", whatever strategy filter_strategy is set to instead of the minimum sum
+  heuristic is used.
+  */
+  if(settings->filter_palette_zero &&
+     (info->colortype == LCT_PALETTE || info->bitdepth < 8)) strategy = LFS_ZERO;
+
+  if(bpp == 0) return 31; /*error: invalid color type*/
+
+#ifdef __cplusplus
+  /*split the image into blocks of scanlines, one per thread, if it is large enough*/
+  numthreads = settings->num_threads ? settings->num_threads : std::thread::hardware_concurrency();
+  if(numthreads > h) numthreads = h;
+  if(linebytes * h / FILTER_MIN_BYTES < numthreads) numthreads = (unsigned)(linebytes * h / FILTER_MIN_BYTES);
+  if(numthreads > 1)
+  {
+    std::vector<FilterRowsJob> jobs(numthreads);
+    std::vector<std::thread> threads;
+    unsigned i, error = 0;
+    for(i = 0; i != numthreads; ++i)
+    {
+      FilterRowsJob job = {out, in, linebytes, bytewidth, (unsigned)((unsigned long long)h * i / numthreads),
+                           (unsigned)((unsigned long long)h * (i + 1) / numthreads), strategy, settings, 0};
+      jobs[i] = job;
+    }
+    /*the calling thread filters the first block*/
+    for(i = 1; i != numthreads; ++i) threads.push_back(std::thread(filterRowsJob, &jobs[i]));
+    filterRowsJob(&jobs[0]);
+    for(i = 0; i + 1 != numthreads; ++i) threads[i].join();
+    for(i = 0; i != numthreads && !error; ++i) error = jobs[i].error;
+    return error;
+  }
+#endif /*__cplusplus*/
+
+  return filterRows(out, in, linebytes, bytewidth, 0, h, strategy, settings);
+}
+
 static void addPaddingBits(unsigned char* out, const unsigned char* in,
                            size_t olinebits, size_t ilinebits, unsigned h)
 {
@@ -5434,9 +7780,40 @@ static void Adam7_interlace(unsigned char* out, const unsigned char* in, unsigne
   }
 }
 
-/*out must be buffer big enough to contain uncompressed IDAT chunk data, and in must contain the full image.
+/*scanlines per segment of the image data (see segment_size), or 0 to deflate the image data as a whole*/
+static unsigned getSegmentRows(unsigned w, unsigned h, const LodePNGInfo* info_png,
+                               const LodePNGEncoderSettings* settings)
+{
+  const LodePNGCompressSettings* zlibsettings = &settings->zlibsettings;
+  size_t rowsize = ((size_t)w * lodepng_get_bpp(&info_png->color) + 7) / 8 + 1;
+  size_t rows;
+  if(!settings->segment_size || info_png->interlace_method != 0) return 0;
+  if(zlibsettings->custom_zlib || zlibsettings->custom_deflate || zlibsettings->btype == 0) return 0;
+  rows = settings->segment_size / rowsize;
+  if(rows == 0) rows = 1;
+  return rows < h ? (unsigned)rows : 0;
+}
+
+/*filters the first scanline of each segment with Sub instead of a filter type that uses the previous scanline*/
+static void detachSegments(unsigned char* out, const unsigned char* in, unsigned w, unsigned h,
+                           const LodePNGColorMode* info, unsigned segmentrows)
+{
+  unsigned bpp = lodepng_get_bpp(info);
+  size_t linebytes = ((size_t)w * bpp + 7) / 8;
+  unsigned y;
+  if(segmentrows == 0) return; /*no segments*/
+  for(y = segmentrows; y < h; y += segmentrows)
+  {
+    unsigned char* line = &out[y * (linebytes + 1)];
+    if(line[0] <= 1) continue;
+    line[0] = 1;
+    filterScanline(&line[1], &in[y * linebytes], 0, linebytes, (bpp + 7) / 8, 1);
+  }
+}
+
+/*writes the uncompressed IDAT chunk data to buffers->filtered, in must contain the full image.
 return value is error**/
-static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const unsigned char* in,
+static unsigned preProcessScanlines(LodePNGBuffers* buffers, const unsigned char* in,
                                     unsigned w, unsigned h,
                                     const LodePNGInfo* info_png, const LodePNGEncoderSettings* settings)
 {
@@ -5445,33 +7822,34 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
   *) if no Adam7: 1) add padding bits (= posible extra bits per scanline if bpp < 8) 2) filter
   *) if adam7: 1) Adam7_interlace 2) 7x add padding bits 3) 7x filter
   */
+  ucvector* out = &buffers->filtered;
+  ucvector* padded = &buffers->padded;
   unsigned bpp = lodepng_get_bpp(&info_png->color);
   unsigned error = 0;
 
   if(info_png->interlace_method == 0)
   {
-    *outsize = h + (h * ((w * bpp + 7) / 8)); /*image size plus an extra byte per scanline + possible padding bits*/
-    *out = (unsigned char*)lodepng_malloc(*outsize);
-    if(!(*out) && (*outsize)) error = 83; /*alloc fail*/
+    /*image size plus an extra byte per scanline + possible padding bits*/
+    if(!ucvector_resize(out, h + (h * ((w * bpp + 7) / 8)))) error = 83; /*alloc fail*/
 
     if(!error)
     {
       /*non multiple of 8 bits per scanline, padding bits needed per scanline*/
       if(bpp < 8 && w * bpp != ((w * bpp + 7) / 8) * 8)
       {
-        unsigned char* padded = (unsigned char*)lodepng_malloc(h * ((w * bpp + 7) / 8));
-        if(!padded) error = 83; /*alloc fail*/
+        if(!ucvector_resize(padded, h * ((w * bpp + 7) / 8))) error = 83; /*alloc fail*/
         if(!error)
         {
-          addPaddingBits(padded, in, ((w * bpp + 7) / 8) * 8, w * bpp, h);
-          error = filter(*out, padded, w, h, &info_png->color, settings);
+          addPaddingBits(padded->data, in, ((w * bpp + 7) / 8) * 8, w * bpp, h);
+          error = filter(out->data, padded->data, w, h, &info_png->color, settings);
+          if(!error) detachSegments(out->data, padded->data, w, h, &info_png->color, getSegmentRows(w, h, info_png, settings));
         }
-        lodepng_free(padded);
       }
       else
       {
         /*we can immediately filter into the out buffer, no other steps needed*/
-        error = filter(*out, in, w, h, &info_png->color, settings);
+        error = filter(out->data, in, w, h, &info_png->color, settings);
+        if(!error) detachSegments(out->data, in, w, h, &info_png->color, getSegmentRows(w, h, info_png, settings));
       }
     }
   }
@@ -5479,45 +7857,38 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
   {
     unsigned passw[7], passh[7];
     size_t filter_passstart[8], padded_passstart[8], passstart[8];
-    unsigned char* adam7;
+    ucvector* adam7 = &buffers->adam7;
 
     Adam7_getpassvalues(passw, passh, filter_passstart, padded_passstart, passstart, w, h, bpp);
 
-    *outsize = filter_passstart[7]; /*image size plus an extra byte per scanline + possible padding bits*/
-    *out = (unsigned char*)lodepng_malloc(*outsize);
-    if(!(*out)) error = 83; /*alloc fail*/
-
-    adam7 = (unsigned char*)lodepng_malloc(passstart[7]);
-    if(!adam7 && passstart[7]) error = 83; /*alloc fail*/
+    /*image size plus an extra byte per scanline + possible padding bits*/
+    if(!ucvector_resize(out, filter_passstart[7])) error = 83; /*alloc fail*/
+    if(!error && !ucvector_resize(adam7, passstart[7])) error = 83; /*alloc fail*/
 
     if(!error)
     {
       unsigned i;
 
-      Adam7_interlace(adam7, in, w, h, bpp);
+      Adam7_interlace(adam7->data, in, w, h, bpp);
       for(i = 0; i != 7; ++i)
       {
         if(bpp < 8)
         {
-          unsigned char* padded = (unsigned char*)lodepng_malloc(padded_passstart[i + 1] - padded_passstart[i]);
-          if(!padded) ERROR_BREAK(83); /*alloc fail*/
-          addPaddingBits(padded, &adam7[passstart[i]],
+          if(!ucvector_resize(padded, padded_passstart[i + 1] - padded_passstart[i])) ERROR_BREAK(83); /*alloc fail*/
+          addPaddingBits(padded->data, &adam7->data[passstart[i]],
                          ((passw[i] * bpp + 7) / 8) * 8, passw[i] * bpp, passh[i]);
-          error = filter(&(*out)[filter_passstart[i]], padded,
+          error = filter(&out->data[filter_passstart[i]], padded->data,
                          passw[i], passh[i], &info_png->color, settings);
-          lodepng_free(padded);
         }
         else
         {
-          error = filter(&(*out)[filter_passstart[i]], &adam7[padded_passstart[i]],
+          error = filter(&out->data[filter_passstart[i]], &adam7->data[padded_passstart[i]],
                          passw[i], passh[i], &info_png->color, settings);
         }
 
         if(error) break;
       }
     }
-
-    lodepng_free(adam7);
   }
 
   return error;
@@ -5555,129 +7926,131 @@ static unsigned addUnknownChunks(ucvector* out, unsigned char* data, size_t data
   unsigned char* inchunk = data;
   while((size_t)(inchunk - data) < datasize)
   {
-    CERROR_TRY_RETURN(lodepng_chunk_append(&out->data, &out->size, inchunk));
-    out->allocsize = out->size; /*fix the allocsize again*/
+    size_t pos = out->size, total = lodepng_chunk_length(inchunk) + 12;
+    if(!ucvector_resize(out, pos + total)) return 83; /*alloc fail*/
+    memcpy(&out->data[pos], inchunk, total);
     inchunk = lodepng_chunk_next(inchunk);
   }
   return 0;
 }
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
-unsigned lodepng_encode(unsigned char** out, size_t* outsize,
-                        const unsigned char* image, unsigned w, unsigned h,
-                        LodePNGState* state)
+/*the encoder of lodepng_encode and lodepng_encode_to, appends the PNG to outv*/
+static void encodeGeneric(ucvector* outv, const unsigned char* image, unsigned w, unsigned h,
+                          LodePNGState* state, LodePNGBuffers* buffers)
 {
   LodePNGInfo info;
-  ucvector outv;
-  unsigned char* data = 0; /*uncompressed version of the IDAT chunk data*/
-  size_t datasize = 0;
+  ucvector* filtered = &buffers->filtered; /*uncompressed version of the IDAT chunk data*/
+  const unsigned char* data;
+  size_t datasize;
 
-  /*provide some proper output values if error will happen*/
-  *out = 0;
-  *outsize = 0;
   state->error = 0;
 
-  lodepng_info_init(&info);
-  lodepng_info_copy(&info, &state->info_png);
-
-  if((info.color.colortype == LCT_PALETTE || state->encoder.force_palette)
-      && (info.color.palettesize == 0 || info.color.palettesize > 256))
+  if((state->info_png.color.colortype == LCT_PALETTE || state->encoder.force_palette)
+      && (state->info_png.color.palettesize == 0 || state->info_png.color.palettesize > 256))
   {
     state->error = 68; /*invalid palette size, it is only allowed to be 1-256*/
-    return state->error;
-  }
-
-  if(state->encoder.auto_convert)
-  {
-    state->error = lodepng_auto_choose_color(&info.color, image, w, h, &state->info_raw);
+    return;
   }
-  if(state->error) return state->error;
-
   if(state->encoder.zlibsettings.btype > 2)
   {
-    CERROR_RETURN_ERROR(state->error, 61); /*error: unexisting btype*/
+    CERROR_RETURN(state->error, 61); /*error: unexisting btype*/
   }
   if(state->info_png.interlace_method > 1)
   {
-    CERROR_RETURN_ERROR(state->error, 71); /*error: unexisting interlace mode*/
+    CERROR_RETURN(state->error, 71); /*error: unexisting interlace mode*/
+  }
+
+  lodepng_info_init(&info);
+  lodepng_info_copy(&info, &state->info_png);
+
+  if(state->encoder.auto_convert)
+  {
+    state->error = lodepng_auto_choose_color(&info.color, image, w, h, &state->info_raw);
   }
 
-  state->error = checkColorValidity(info.color.colortype, info.color.bitdepth);
-  if(state->error) return state->error; /*error: unexisting color type given*/
-  state->error = checkColorValidity(state->info_raw.colortype, state->info_raw.bitdepth);
-  if(state->error) return state->error; /*error: unexisting color type given*/
+  /*error: unexisting color type given*/
+  if(!state->error) state->error = checkColorValidity(info.color.colortype, info.color.bitdepth);
+  if(!state->error) state->error = checkColorValidity(state->info_raw.colortype, state->info_raw.bitdepth);
 
-  if(!lodepng_color_mode_equal(&state->info_raw, &info.color))
+  if(!state->error && !lodepng_color_mode_equal(&state->info_raw, &info.color))
   {
-    unsigned char* converted;
+    ucvector* converted = &buffers->converted;
     size_t size = (w * h * lodepng_get_bpp(&info.color) + 7) / 8;
 
-    converted = (unsigned char*)lodepng_malloc(size);
-    if(!converted && size) state->error = 83; /*alloc fail*/
+    if(!ucvector_resize(converted, size)) state->error = 83; /*alloc fail*/
     if(!state->error)
     {
-      state->error = lodepng_convert(converted, image, &info.color, &state->info_raw, w, h);
+      state->error = lodepng_convert(converted->data, image, &info.color, &state->info_raw, w, h);
     }
-    if(!state->error) preProcessScanlines(&data, &datasize, converted, w, h, &info, &state->encoder);
-    lodepng_free(converted);
+    if(!state->error) state->error = preProcessScanlines(buffers, converted->data, w, h, &info, &state->encoder);
   }
-  else preProcessScanlines(&data, &datasize, image, w, h, &info, &state->encoder);
+  else if(!state->error) state->error = preProcessScanlines(buffers, image, w, h, &info, &state->encoder);
+  data = filtered->data;
+  datasize = filtered->size;
 
-  ucvector_init(&outv);
   while(!state->error) /*while only executed once, to break on error*/
   {
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
     size_t i;
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     /*write signature and chunks*/
-    writeSignature(&outv);
+    writeSignature(outv);
     /*IHDR*/
-    addChunk_IHDR(&outv, w, h, info.color.colortype, info.color.bitdepth, info.interlace_method);
+    addChunk_IHDR(outv, w, h, info.color.colortype, info.color.bitdepth, info.interlace_method);
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
     /*unknown chunks between IHDR and PLTE*/
     if(info.unknown_chunks_data[0])
     {
-      state->error = addUnknownChunks(&outv, info.unknown_chunks_data[0], info.unknown_chunks_size[0]);
+      state->error = addUnknownChunks(outv, info.unknown_chunks_data[0], info.unknown_chunks_size[0]);
       if(state->error) break;
     }
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     /*PLTE*/
     if(info.color.colortype == LCT_PALETTE)
     {
-      addChunk_PLTE(&outv, &info.color);
+      addChunk_PLTE(outv, &info.color);
     }
     if(state->encoder.force_palette && (info.color.colortype == LCT_RGB || info.color.colortype == LCT_RGBA))
     {
-      addChunk_PLTE(&outv, &info.color);
+      addChunk_PLTE(outv, &info.color);
     }
     /*tRNS*/
     if(info.color.colortype == LCT_PALETTE && getPaletteTranslucency(info.color.palette, info.color.palettesize) != 0)
     {
-      addChunk_tRNS(&outv, &info.color);
+      addChunk_tRNS(outv, &info.color);
     }
     if((info.color.colortype == LCT_GREY || info.color.colortype == LCT_RGB) && info.color.key_defined)
     {
-      addChunk_tRNS(&outv, &info.color);
+      addChunk_tRNS(outv, &info.color);
     }
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
     /*bKGD (must come between PLTE and the IDAt chunks*/
-    if(info.background_defined) addChunk_bKGD(&outv, &info);
+    if(info.background_defined) addChunk_bKGD(outv, &info);
     /*pHYs (must come before the IDAT chunks)*/
-    if(info.phys_defined) addChunk_pHYs(&outv, &info);
+    if(info.phys_defined) addChunk_pHYs(outv, &info);
 
     /*unknown chunks between PLTE and IDAT*/
     if(info.unknown_chunks_data[1])
     {
-      state->error = addUnknownChunks(&outv, info.unknown_chunks_data[1], info.unknown_chunks_size[1]);
+      state->error = addUnknownChunks(outv, info.unknown_chunks_data[1], info.unknown_chunks_size[1]);
       if(state->error) break;
     }
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     /*IDAT (multiple IDAT chunks must be consecutive)*/
-    state->error = addChunk_IDAT(&outv, data, datasize, &state->encoder.zlibsettings);
+#ifdef LODEPNG_COMPILE_ZLIB
+    if(getSegmentRows(w, h, &info, &state->encoder))
+    {
+      state->error = addChunks_lpIX_IDAT(outv, data, datasize, h, getSegmentRows(w, h, &info, &state->encoder),
+                                         &state->encoder);
+    }
+    else
+#endif /*LODEPNG_COMPILE_ZLIB*/
+    state->error = addChunk_IDAT(outv, data, datasize, &state->encoder.zlibsettings, buffers);
     if(state->error) break;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
     /*tIME*/
-    if(info.time_defined) addChunk_tIME(&outv, &info.time);
+    if(info.time_defined) addChunk_tIME(outv, &info.time);
     /*tEXt and/or zTXt*/
     for(i = 0; i != info.text_num; ++i)
     {
@@ -5693,11 +8066,11 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
       }
       if(state->encoder.text_compression)
       {
-        addChunk_zTXt(&outv, info.text_keys[i], info.text_strings[i], &state->encoder.zlibsettings);
+        addChunk_zTXt(outv, info.text_keys[i], info.text_strings[i], &state->encoder.zlibsettings);
       }
       else
       {
-        addChunk_tEXt(&outv, info.text_keys[i], info.text_strings[i]);
+        addChunk_tEXt(outv, info.text_keys[i], info.text_strings[i]);
       }
     }
     /*LodePNG version id in text chunk*/
@@ -5714,7 +8087,7 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
       }
       if(alread_added_id_text == 0)
       {
-        addChunk_tEXt(&outv, "LodePNG", LODEPNG_VERSION_STRING); /*it's shorter as tEXt than as zTXt chunk*/
+        addChunk_tEXt(outv, "LodePNG", LODEPNG_VERSION_STRING); /*it's shorter as tEXt than as zTXt chunk*/
       }
     }
     /*iTXt*/
@@ -5730,7 +8103,7 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
         state->error = 67; /*text chunk too small*/
         break;
       }
-      addChunk_iTXt(&outv, state->encoder.text_compression,
+      addChunk_iTXt(outv, state->encoder.text_compression,
                     info.itext_keys[i], info.itext_langtags[i], info.itext_transkeys[i], info.itext_strings[i],
                     &state->encoder.zlibsettings);
     }
@@ -5738,17 +8111,30 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
     /*unknown chunks between IDAT and IEND*/
     if(info.unknown_chunks_data[2])
     {
-      state->error = addUnknownChunks(&outv, info.unknown_chunks_data[2], info.unknown_chunks_size[2]);
+      state->error = addUnknownChunks(outv, info.unknown_chunks_data[2], info.unknown_chunks_size[2]);
       if(state->error) break;
     }
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
-    addChunk_IEND(&outv);
+    addChunk_IEND(outv);
 
     break; /*this isn't really a while loop; no error happened so break out now!*/
   }
 
   lodepng_info_cleanup(&info);
-  lodepng_free(data);
+}
+
+unsigned lodepng_encode(unsigned char** out, size_t* outsize,
+                        const unsigned char* image, unsigned w, unsigned h,
+                        LodePNGState* state)
+{
+  LodePNGBuffers temp;
+  LodePNGBuffers* buffers = getBuffers(state, &temp);
+  ucvector outv;
+
+  ucvector_init(&outv);
+  encodeGeneric(&outv, image, w, h, state, buffers);
+  releaseBuffers(buffers, &temp);
+
   /*instead of cleaning the vector up, give it to the output*/
   *out = outv.data;
   *outsize = outv.size;
@@ -5756,6 +8142,23 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
   return state->error;
 }
 
+unsigned lodepng_encode_to(unsigned char* out, size_t capacity, size_t* outsize,
+                           const unsigned char* image, unsigned w, unsigned h,
+                           LodePNGState* state)
+{
+  LodePNGBuffers temp;
+  LodePNGBuffers* buffers = getBuffers(state, &temp);
+
+  buffers->png.size = 0;
+  encodeGeneric(&buffers->png, image, w, h, state, buffers);
+  *outsize = state->error ? 0 : buffers->png.size;
+  if(!state->error && *outsize > capacity) state->error = 96; /*error: the output buffer is too small*/
+  if(!state->error) memcpy(out, buffers->png.data, *outsize);
+  releaseBuffers(buffers, &temp);
+
+  return state->error;
+}
+
 unsigned lodepng_encode_memory(unsigned char** out, size_t* outsize, const unsigned char* image,
                                unsigned w, unsigned h, LodePNGColorType colortype, unsigned bitdepth)
 {
@@ -5813,6 +8216,8 @@ void lodepng_encoder_settings_init(LodePNGEncoderSettings* settings)
   settings->auto_convert = 1;
   settings->force_palette = 0;
   settings->predefined_filters = 0;
+  settings->num_threads = 1;
+  settings->segment_size = 0;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   settings->add_id = 0;
   settings->text_compression = 1;
@@ -5923,6 +8328,9 @@ const char* lodepng_error_text(unsigned code)
     case 91: return "invalid decompressed idat size";
     case 92: return "too many pixels, not supported";
     case 93: return "zero width or height is invalid";
+    case 94: return "invalid sample format";
+    case 95: return "the image size differs from the size of the output buffer";
+    case 96: return "the output buffer is too small";
   }
   return "unknown error code";
 }
@@ -6066,14 +8474,16 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 State& state,
                 const unsigned char* in, size_t insize)
 {
-  unsigned char* buffer = NULL;
-  unsigned error = lodepng_decode(&buffer, &w, &h, &state, in, insize);
-  if(buffer && !error)
+  /*decodes straight into out, which allocates nothing if it has the capacity*/
+  size_t oldsize = out.size(), outsize = 0;
+  unsigned error = lodepng_inspect(&w, &h, &state, in, insize);
+  if(!error)
   {
-    size_t buffersize = lodepng_get_raw_size(w, h, &state.info_raw);
-    out.insert(out.end(), &buffer[0], &buffer[buffersize]);
+    outsize = lodepng_get_raw_size(w, h, state.decoder.color_convert ? &state.info_raw : &state.info_png.color);
+    out.resize(oldsize + outsize);
+    error = lodepng_decode_to(outsize ? &out[oldsize] : 0, outsize, &outsize, &w, &h, &state, in, insize);
   }
-  lodepng_free(buffer);
+  out.resize(error ? oldsize : oldsize + outsize);
   return error;
 }
 
@@ -6123,15 +8533,14 @@ unsigned encode(std::vector<unsigned char>& out,
                 const unsigned char* in, unsigned w, unsigned h,
                 State& state)
 {
-  unsigned char* buffer;
-  size_t buffersize;
-  unsigned error = lodepng_encode(&buffer, &buffersize, in, w, h, &state);
-  if(buffer)
-  {
-    out.insert(out.end(), &buffer[0], &buffer[buffersize]);
-    lodepng_free(buffer);
-  }
-  return error;
+  /*encodes into the buffers of the state, so out allocates nothing if it has the capacity*/
+  LodePNGBuffers temp;
+  LodePNGBuffers* buffers = getBuffers(&state, &temp);
+  buffers->png.size = 0;
+  encodeGeneric(&buffers->png, in, w, h, &state, buffers);
+  if(!state.error) out.insert(out.end(), buffers->png.data, buffers->png.data + buffers->png.size);
+  releaseBuffers(buffers, &temp);
+  return state.error;
 }
 
 unsigned encode(std::vector<unsigned char>& out,
@@ -290,6 +290,9 @@ struct LodePNGCompressSettings /*deflate = compress*/
   unsigned minmatch; /*mininum lz77 length. 3 is normally best, 6 can be better for some PNGs. Default: 0*/
   unsigned nicematch; /*stop searching if >= this length found. Set to 258 for best compression. Default: 128*/
   unsigned lazymatching; /*use lazy matching: better compression but a bit slower. Default: true*/
+  /*1, 2 or 3 select a fast LZ77 encoder (a single candidate per position, no lazy matching) instead of the
+  settings above, 1 being the fastest. Any other value uses the settings above. Default: 0*/
+  unsigned level;
 
   /*use custom zlib encoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -524,6 +527,10 @@ typedef struct LodePNGDecoderSettings
 
   unsigned color_convert; /*whether to convert the PNG to the color type you want. Default: yes*/
 
+  /*number of threads decoding the segments of PNGs with an lpIX chunk (see segment_size of the encoder
+  settings), 0 uses one per hardware thread. Parallel decoding is opt-in. Default: 1*/
+  unsigned num_threads;
+
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   unsigned read_text_chunks; /*if false but remember_unknown_chunks is true, they're stored in the unknown chunks*/
   /*store all bytes from unknown chunks in the LodePNGInfo (off by default, useful for a png editor)*/
@@ -575,8 +582,16 @@ void lodepng_color_profile_init(LodePNGColorProfile* profile);
 unsigned lodepng_get_color_profile(LodePNGColorProfile* profile,
                                    const unsigned char* image, unsigned w, unsigned h,
                                    const LodePNGColorMode* mode_in);
+/*Same as lodepng_get_color_profile for opaque 8-bit grey, RGB or RGBA images without color key, but faster. Returns 0
+and leaves the profile unchanged for other images. This function is in the public interface only for tests, it's
+used internally by lodepng_auto_choose_color.*/
+unsigned lodepng_get_opaque_color_profile(LodePNGColorProfile* profile,
+                                          const unsigned char* image, unsigned w, unsigned h,
+                                          const LodePNGColorMode* mode_in);
 /*The function LodePNG uses internally to decide the PNG color with auto_convert.
-Chooses an optimal color model, e.g. grey if only grey pixels, palette if < 256 colors, ...*/
+Chooses an optimal color model, e.g. grey if only grey pixels, palette if < 256 colors, ...
+Opaque 8-bit images are profiled by a faster scan (SSE2 where available). The chosen mode, and thus the
+encoded PNG, is the same as with the full color profile.*/
 unsigned lodepng_auto_choose_color(LodePNGColorMode* mode_out,
                                    const unsigned char* image, unsigned w, unsigned h,
                                    const LodePNGColorMode* mode_in);
@@ -601,6 +616,17 @@ typedef struct LodePNGEncoderSettings
   have to cleanup this buffer, LodePNG will never free it. Don't forget that filter_palette_zero
   must be set to 0 to ensure this is also used on palette or low bitdepth images.*/
   const unsigned char* predefined_filters;
+  /*number of threads filtering the scanlines of large images, 0 uses one per hardware thread. The result
+  does not depend on it. Parallel encoding is opt-in, since the caller may already run several encoders
+  or solvers on its own threads. Default: 1*/
+  unsigned num_threads;
+  /*if nonzero, the scanlines of non-interlaced images are deflated in independent segments of about this
+  many bytes, on num_threads threads, and a private lpIX chunk lists the segments so that the decoder can
+  inflate them on several threads too. Other decoders read the PNG as usual. The first scanline of each
+  segment uses filter None or Sub, also with LFS_PREDEFINED, whose filter types are overridden on those
+  scanlines. Each segment starts without dictionary, which costs a little compression. Not used with
+  btype 0, custom_zlib or custom_deflate. Default: 0*/
+  size_t segment_size;
 
   /*force creating a PLTE chunk if colortype is 2 or 6 (= a suggested palette).
   If colortype is 3, PLTE is _always_ created.*/
@@ -618,6 +644,9 @@ void lodepng_encoder_settings_init(LodePNGEncoderSettings* settings);
 
 
 #if defined(LODEPNG_COMPILE_DECODER) || defined(LODEPNG_COMPILE_ENCODER)
+/*Working memory of the encoder and decoder that a state can keep between calls, see lodepng_state_keep_buffers.*/
+typedef struct LodePNGBuffers LodePNGBuffers;
+
 /*The settings, state and information for extended encoding and decoding.*/
 typedef struct LodePNGState
 {
@@ -630,6 +659,7 @@ typedef struct LodePNGState
   LodePNGColorMode info_raw; /*specifies the format in which you would like to get the raw pixel buffer*/
   LodePNGInfo info_png; /*info of the PNG image obtained after decoding*/
   unsigned error;
+  LodePNGBuffers* buffers; /*NULL unless lodepng_state_keep_buffers was called*/
 #ifdef LODEPNG_COMPILE_CPP
   /* For the lodepng::State subclass. */
   virtual ~LodePNGState(){}
@@ -640,6 +670,17 @@ typedef struct LodePNGState
 void lodepng_state_init(LodePNGState* state);
 void lodepng_state_cleanup(LodePNGState* state);
 void lodepng_state_copy(LodePNGState* dest, const LodePNGState* source);
+
+/*
+Makes the encoder and decoder keep their working memory in the state instead of allocating and freeing it
+in every call: the image data of the IDAT chunks, the inflated and the filtered scanlines, the image before
+color conversion, the hash tables of the deflater and the Huffman trees of the deflater and the inflater.
+Encoding or decoding many images of a similar size with one state then no longer allocates these once they
+have grown, and with lodepng_encode_to and lodepng_decode_to not the output either, so that it does not
+allocate at all unless a palette has to be converted or is decoded. The memory is freed by
+lodepng_state_cleanup, lodepng_state_copy does not copy it. Returns error 83 if it cannot be allocated.
+*/
+unsigned lodepng_state_keep_buffers(LodePNGState* state);
 #endif /* defined(LODEPNG_COMPILE_DECODER) || defined(LODEPNG_COMPILE_ENCODER) */
 
 #ifdef LODEPNG_COMPILE_DECODER
@@ -659,6 +700,51 @@ information is placed in the info_png field of the LodePNGState.
 unsigned lodepng_inspect(unsigned* w, unsigned* h,
                          LodePNGState* state,
                          const unsigned char* in, size_t insize);
+
+/*
+Receives row y of the image while decoding with lodepng_decode_rows: linebytes bytes in the color type of
+the PNG (state->info_png.color), without filter type byte and valid only during the call. Rows of pixels
+smaller than a byte are padded to a full byte. Returning nonzero stops decoding, lodepng_decode_rows then
+returns that value as error.
+*/
+typedef unsigned (*LodePNGRowCallback)(void* user, unsigned y, const unsigned char* row, size_t linebytes);
+
+/*
+Decodes the PNG row by row: the image data is inflated with a window of 32 KB and each scanline is handed
+to the callback as soon as it is complete, so the image is never in memory as a whole, only the compressed
+data of the IDAT chunks is. Adam7 interlaced images, and custom_zlib or custom_inflate in the decoder
+settings, still need the whole image in memory first. The Adler-32 checksum and the amount of image data
+are only checked at the end, after the rows were handed out. The settings of state->decoder are used,
+info_raw is not.
+*/
+unsigned lodepng_decode_rows(LodePNGRowCallback callback, void* user, unsigned* w, unsigned* h,
+                             LodePNGState* state, const unsigned char* in, size_t insize);
+
+/*The sample formats of lodepng_decode_into. The values are those of the color converted to RGBA8.*/
+typedef enum LodePNGSampleFormat
+{
+  LSF_FLOAT_GREY = 0, /*one float per pixel, the luminance (see LSF_GREY8) divided by 255*/
+  LSF_FLOAT_RGB = 1, /*three floats per pixel, red, green and blue divided by 255*/
+  LSF_GREY8 = 2 /*one byte per pixel, the luminance 0.299 R + 0.587 G + 0.114 B, equal to the value for grey*/
+} LodePNGSampleFormat;
+
+/*
+Decodes the PNG straight into a buffer of the given sample format, the alpha channel is ignored. Each scanline
+is converted as soon as lodepng_decode_rows has it, so the RAW image of lodepng_decode is never created. The settings
+of state->decoder are used, info_raw is not. The size of the image must be w * h (see lodepng_inspect),
+otherwise error 95 is returned. Row y of the image starts at byte y * stride of out, for the float formats
+out and stride must be aligned to floats.
+*/
+unsigned lodepng_decode_into(void* out, size_t stride, LodePNGSampleFormat format,
+                             unsigned w, unsigned h, LodePNGState* state,
+                             const unsigned char* in, size_t insize);
+
+/*
+Same as lodepng_decode, but decodes into out, memory of capacity bytes owned by the caller. *outsize is set
+to the size of the image. If it is larger than capacity, error 96 is returned and nothing is decoded.
+*/
+unsigned lodepng_decode_to(unsigned char* out, size_t capacity, size_t* outsize, unsigned* w, unsigned* h,
+                           LodePNGState* state, const unsigned char* in, size_t insize);
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 
@@ -667,6 +753,14 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h,
 unsigned lodepng_encode(unsigned char** out, size_t* outsize,
                         const unsigned char* image, unsigned w, unsigned h,
                         LodePNGState* state);
+
+/*
+Same as lodepng_encode, but writes the PNG to out, memory of capacity bytes owned by the caller. *outsize is
+set to the size of the PNG. If it is larger than capacity, error 96 is returned and out is left unchanged.
+*/
+unsigned lodepng_encode_to(unsigned char* out, size_t capacity, size_t* outsize,
+                           const unsigned char* image, unsigned w, unsigned h,
+                           LodePNGState* state);
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 /*
@@ -827,7 +921,10 @@ class State : public LodePNGState
 };
 
 #ifdef LODEPNG_COMPILE_DECODER
-/* Same as other lodepng::decode, but using a State for more settings and information. */
+/*
+Same as other lodepng::decode, but using a State for more settings and information. If the state keeps its
+buffers (lodepng_state_keep_buffers) and out has the capacity, the image data is not allocated anew.
+*/
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 State& state,
                 const unsigned char* in, size_t insize);
@@ -837,7 +934,10 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
-/* Same as other lodepng::encode, but using a State for more settings and information. */
+/*
+Same as other lodepng::encode, but using a State for more settings and information. If the state keeps its
+buffers (lodepng_state_keep_buffers) and out has the capacity, the image data is not allocated anew.
+*/
 unsigned encode(std::vector<unsigned char>& out,
                 const unsigned char* in, unsigned w, unsigned h,
                 State& state);
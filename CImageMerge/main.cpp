@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <string>
 #include <algorithm>
+#include <chrono>
 
 #include "lodepng.h"
 #include "CutGrid.h"
@@ -21,7 +22,8 @@ enum ProgramMode
 {
 	SimpleStitch,
 	ComputeGradient,
-	GradientStitch
+	GradientStitch,
+	BenchmarkDynTree
 };
 
 // 2-component vector
@@ -238,6 +240,52 @@ void performGradientStitching(const vector<vector<vec2<float> > >& field1, const
 	}
 }
 
+// Time the min-cut of performStitching with the dynamic tree backend of Grid
+template <typename Grid>
+double timeStitchingCut(int gridHeight, int gridWidth, double* flow)
+{
+	auto start = chrono::steady_clock::now();
+
+	Grid grid(gridHeight, gridWidth);
+	grid.setEdgeCostFunction(&EdgeCostSingleton::EdgeCost);
+	grid.setSource(0, 0);
+	grid.setSink(0, gridWidth - 1);
+	*flow = grid.getMaxFlow();
+
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Compare the dynamic tree backends of the planar cut on the stitching grid
+void benchmarkDynTrees(const vector<vector<float> >& image1,
+	const vector<vector<float> >& image2, const int margin)
+{
+	const int repetitions = 5;
+
+	int gridWidth = margin;
+	int gridHeight = static_cast<int>(image1.size());
+
+	// Prepare the singleton edge weight class
+	EdgeCostSingleton::Data.Image1 = &image1;
+	EdgeCostSingleton::Data.Image2 = &image2;
+	EdgeCostSingleton::Data.Margin = margin;
+	EdgeCostSingleton::Data.LargeNumber = 1000000.0 * gridWidth * gridHeight;
+
+	// Report the best of several runs for each backend
+	double flowPath = 0.0, flowSplay = 0.0;
+	double timePath = 0.0, timeSplay = 0.0;
+	for (int i = 0; i < repetitions; ++i)
+	{
+		double t = timeStitchingCut<CutGridT<DynPathTree> >(gridHeight, gridWidth, &flowPath);
+		timePath = (i == 0) ? t : std::min(timePath, t);
+		t = timeStitchingCut<CutGridT<SplayPathTree> >(gridHeight, gridWidth, &flowSplay);
+		timeSplay = (i == 0) ? t : std::min(timeSplay, t);
+	}
+
+	cout << "Grid " << gridHeight << " x " << gridWidth << endl;
+	cout << "DynPathTree:   " << timePath << " s (flow " << flowPath << ")" << endl;
+	cout << "SplayPathTree: " << timeSplay << " s (flow " << flowSplay << ")" << endl;
+}
+
 // Compute a gradient from a scalar field
 void computeGradient(const vector<vector<float> >& scalarField, vector<vector<vec2<float> > >* output)
 {
@@ -276,20 +324,6 @@ void convertGradientToImageData(vector<vector<vec2<float> > >& grad, vector<unsi
 	}
 }
 
-// Convert an 8-bit image array to a matrix of floats
-void convertImageDataToFloatMatrix(const vector<unsigned char>& image,
-	const int width, const int height, vector<vector<float> >* output)
-{
-	for (int y = 0; y < height; ++y)
-	{
-		output->push_back(vector<float>(width));
-		vector<float>& row = (*output)[output->size() - 1];
-
-		for (int x = 0; x < width; ++x)
-			row[x] = (float)image[4 * (x + y * width)] / 255.0f;
-	}
-}
-
 // Convert a matrix of float to an 8-bit image array
 void convertFloatMatrixToImageData(const vector<vector<float> >& matrix,
 	vector<unsigned char>* output)
@@ -308,17 +342,30 @@ void convertFloatMatrixToImageData(const vector<vector<float> >& matrix,
 
 unsigned int floatMatrixFromPNG(const string& filename, vector<vector<float> >* output)
 {
-	// Open the raw PNG data
-	vector<unsigned char> imageData;
+	// Open the PNG file and read its size
+	vector<unsigned char> png;
 	unsigned int imageWidth;
 	unsigned int imageHeight;
-	unsigned int error = lodepng::decode(imageData, imageWidth, imageHeight, filename);
+	lodepng::State state;
+	unsigned int error = lodepng::load_file(png, filename);
+	if (!error)
+		error = lodepng_inspect(&imageWidth, &imageHeight, &state, png.data(), png.size());
 
 	if (error)
 		return error;
 
-	// Convert data to a float matrix
-	convertImageDataToFloatMatrix(imageData, imageWidth, imageHeight, output);
+	// Decode straight to one float per pixel, without the intermediate RGBA image
+	vector<float> pixels((size_t)imageWidth * imageHeight);
+	error = lodepng_decode_into(pixels.data(), imageWidth * sizeof(float), LSF_FLOAT_GREY,
+		imageWidth, imageHeight, &state, png.data(), png.size());
+
+	if (error)
+		return error;
+
+	// Split into the rows of the float matrix
+	for (unsigned int y = 0; y < imageHeight; ++y)
+		output->push_back(vector<float>(pixels.begin() + (size_t)y * imageWidth,
+			pixels.begin() + (size_t)(y + 1) * imageWidth));
 	return 0;
 }
 
@@ -414,6 +461,13 @@ int main(int argc, char** argv)
 			static_cast<unsigned int>(gradientOutput.size()));
 		break;
 	}
+	case BenchmarkDynTree:
+	{
+		// Time the stitching cut with both dynamic tree backends
+		benchmarkDynTrees(imageArray1, imageArray2, stitchMargin);
+		error = 0;
+		break;
+	}
 	}
 
 	if (error)
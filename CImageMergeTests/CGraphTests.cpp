@@ -0,0 +1,327 @@
+/*****************************************************************************
+*    PlanarCut - software to compute MinCut / MaxFlow in a planar graph      *
+*                              Version 1.0.2                                 *
+*                                                                            *
+*    Copyright 2011 - 2013 Eno Töppe <toeppe@in.tum.de>                      *
+*                          Frank R. Schmidt <info@frank-r-schmidt.de>        *
+******************************************************************************
+
+  If you use this software for research purposes, YOU MUST CITE the following 
+  paper in any resulting publication:
+
+    [1] Efficient Planar Graph Cuts with Applications in Computer Vision.
+        F. R. Schmidt, E. Töppe, D. Cremers, 
+	    IEEE CVPR, Miami, Florida, June 2009		
+
+******************************************************************************
+
+  This software is released under the LGPL license. Details are explained
+  in the files 'COPYING' and 'COPYING.LESSER'.
+	
+*****************************************************************************/
+
+#include "CGraph.h"
+#include "IndexHeap.h"
+#include "ThreadPool.h"
+#include "Tests.h"
+#include <thread>
+#include <vector>
+
+
+//random directed graph given by its arcs, a fifth of the weights is zero
+struct TestArcs {
+  int numNodes;
+  std::vector<int> from, to;
+  std::vector<CapType> weight;
+
+  TestArcs(TestRandom &rnd, int numNodes, int numArcs) : numNodes(numNodes) {
+    for (int i=0; i<numArcs; i++) {
+      from.push_back(rnd.range(numNodes));
+      to.push_back(rnd.range(numNodes));
+      weight.push_back(rnd.range(5) ? 1 + rnd.range(20) : 0);
+    }
+  }
+
+  //distances from the given start nodes by Bellman-Ford as reference
+  std::vector<CapType> referenceDist(const std::vector<int> &start) const {
+    std::vector<CapType> dist(numNodes, CAP_INF);
+    bool changed = true;
+
+    for (size_t i=0; i<start.size(); i++)
+      dist[start[i]] = 0;
+
+    while (changed) {
+      changed = false;
+      for (size_t i=0; i<from.size(); i++)
+	if (dist[from[i]] != CAP_INF && dist[from[i]] + weight[i] < dist[to[i]]) {
+	  dist[to[i]] = dist[from[i]] + weight[i];
+	  changed = true;
+	}
+    }
+
+    return dist;
+  }
+
+  //weight of the cheapest arc u -> v or CAP_INF
+  CapType arcWeight(int u, int v) const {
+    CapType w = CAP_INF;
+    for (size_t i=0; i<from.size(); i++)
+      if (from[i] == u && to[i] == v && weight[i] < w)
+	w = weight[i];
+    return w;
+  }
+};
+
+
+//runDijkstraMulti() has to find a shortest path from any start node to
+//any end node, also in repeated queries on the same graph
+TEST(CGraphDijkstraMulti) {
+
+  TestRandom rnd(35);
+
+  for (int trial=0; trial<40; trial++) {
+    int numNodes = 2 + rnd.range(150);
+    TestArcs arcs(rnd, numNodes, numNodes * (1 + rnd.range(4)));
+    CGraph graph(numNodes);
+    std::vector<CGNode*> nodes;
+    int i;
+
+    for (i=0; i<numNodes; i++)
+      nodes.push_back(graph.addNode(i));
+    for (i=0; i<(int)arcs.from.size(); i++)
+      graph.addEdge(nodes[arcs.from[i]], nodes[arcs.to[i]], arcs.weight[i]);
+
+    for (int query=0; query<5; query++) {
+      std::vector<int> start, end;
+      std::vector<CGNode*> startNodes, endNodes;
+      std::vector<bool> isStart(numNodes, false), isEnd(numNodes, false);
+
+      for (i=1+rnd.range(3); i>0; i--) {
+	start.push_back(rnd.range(numNodes));
+	startNodes.push_back(nodes[start.back()]);
+	isStart[start.back()] = true;
+      }
+      for (i=1+rnd.range(3); i>0; i--) {
+	end.push_back(rnd.range(numNodes));
+	endNodes.push_back(nodes[end.back()]);
+	isEnd[end.back()] = true;
+      }
+
+      std::vector<CapType> dist = arcs.referenceDist(start);
+      CapType best = CAP_INF;
+      for (i=0; i<(int)end.size(); i++)
+	if (dist[end[i]] < best)
+	  best = dist[end[i]];
+
+      CGNode *dest = graph.runDijkstraMulti(&startNodes[0], (int)start.size(),
+					    &endNodes[0], (int)end.size());
+      CHECK((dest == NULL) == (best == CAP_INF));
+      if (!dest)
+	continue;
+      CHECK(isEnd[dest->tag]);
+
+      //follow the path backwards - it must not run in circles
+      CGNode *n = dest;
+      CapType cost = 0;
+      int length = 1;
+      while (n->dijkPrev && length <= numNodes) {
+	cost += arcs.arcWeight(n->dijkPrev->tag, n->tag);
+	n = n->dijkPrev;
+	length++;
+      }
+      CHECK(length <= numNodes);
+      CHECK(isStart[n->tag]);
+      CHECK(cost == best);
+
+      int pathLength;
+      CGNode **path = graph.getShortestPath(dest, &pathLength);
+      CHECK(pathLength == length && path[0] == n && path[length-1] == dest);
+      delete [] path;
+    }
+  }
+
+}
+
+
+
+//runDijkstraCSR() on the graph of buildCSR() has to agree with the 
+//reference distances, with and without threads building the graph
+TEST(CGraphCSR) {
+
+  TestRandom rnd(36);
+  ThreadPool pool(3);
+
+  for (int trial=0; trial<40; trial++) {
+    int numNodes = 1 + rnd.range(300);
+    TestArcs arcs(rnd, numNodes, rnd.range(numNodes * 4));
+    CGraph graph(numNodes);
+    std::vector<CapType> dist(numNodes);
+    std::vector<int> prev(numNodes);
+    int start = rnd.range(numNodes);
+    int numArcs = (int)arcs.from.size();
+
+    graph.buildCSR(numNodes, numArcs,
+		   numArcs ? &arcs.from[0] : NULL, numArcs ? &arcs.to[0] : NULL,
+		   numArcs ? &arcs.weight[0] : NULL, (trial & 1) ? &pool : NULL);
+    graph.runDijkstraCSR(start, &dist[0], &prev[0]);
+
+    std::vector<CapType> ref = arcs.referenceDist(std::vector<int>(1, start));
+    for (int v=0; v<numNodes; v++) {
+      CHECK(dist[v] == ref[v]);
+      if (v == start || ref[v] == CAP_INF)
+	CHECK(prev[v] == -1);
+      else
+	CHECK(prev[v] >= 0 && dist[prev[v]] + arcs.arcWeight(prev[v], v) == dist[v]);
+    }
+  }
+
+}
+
+
+
+//Dijkstra's algorithm with the priority queue Heap (cf. IndexHeap.h) 
+//on the given arcs, their weights multiplied by scale
+template<class Heap>
+static std::vector<CapType> heapDijkstra(const TestArcs &arcs, int start, CapType scale) {
+
+  int numNodes = arcs.numNodes, numArcs = (int)arcs.from.size();
+  std::vector<int> first(numNodes+1, 0), order(numArcs);
+  std::vector<CapType> dist(numNodes, CAP_INF);
+  Heap heap(numNodes);
+  int i, u;
+
+  //the arcs sorted by their tail
+  for (i=0; i<numArcs; i++)
+    first[arcs.from[i]+1]++;
+  for (u=0; u<numNodes; u++)
+    first[u+1] += first[u];
+  std::vector<int> fill(first.begin(), first.end()-1);
+  for (i=0; i<numArcs; i++)
+    order[fill[arcs.from[i]]++] = i;
+
+  dist[start] = 0;
+  heap.insert(start, 0);
+
+  while (heap.deleteMin(u)) {
+    for (int a=first[u]; a<first[u+1]; a++) {
+      int v = arcs.to[order[a]];
+      CapType w = dist[u] + scale * arcs.weight[order[a]];
+
+      if (heap.contains(v)) {
+	if (w < dist[v]) {
+	  dist[v] = w;
+	  heap.decrease(v, w);
+	}
+      } else if (dist[v] == CAP_INF) {
+	dist[v] = w;
+	heap.insert(v, w);
+      }
+    }
+  }
+
+  return dist;
+
+}
+
+
+
+//the heaps of IndexHeap.h have to give the distances of the DijkHeap 
+//of runDijkstra() and of the reference - RadixHeap also with keys 
+//beyond 32 bits, the d-ary heaps also with fractional keys
+TEST(IndexHeapDijkstra) {
+
+  TestRandom rnd(28);
+
+  for (int trial=0; trial<40; trial++) {
+    int numNodes = 1 + rnd.range(300);
+    TestArcs arcs(rnd, numNodes, rnd.range(numNodes * 4));
+    CGraph graph(numNodes);
+    std::vector<CGNode*> nodes;
+    int i, start = rnd.range(numNodes);
+
+    for (i=0; i<numNodes; i++)
+      nodes.push_back(graph.addNode(i));
+    for (i=0; i<(int)arcs.from.size(); i++)
+      graph.addEdge(nodes[arcs.from[i]], nodes[arcs.to[i]], arcs.weight[i]);
+    graph.runDijkstra(nodes[start]);
+
+    std::vector<CapType> ref = arcs.referenceDist(std::vector<int>(1, start));
+    for (i=0; i<numNodes; i++)
+      CHECK(nodes[i]->dijkWeight == ref[i]);
+
+    CHECK(heapDijkstra< DAryHeap<2> >(arcs, start, 1) == ref);
+    CHECK(heapDijkstra< DAryHeap<4> >(arcs, start, 1) == ref);
+    CHECK(heapDijkstra< DAryHeap<8> >(arcs, start, 1) == ref);
+    CHECK(heapDijkstra<RadixHeap>(arcs, start, 1) == ref);
+
+    //multiples of 2^30 and of 1/4 keep the sums exact
+    CapType large = 1073741824., quarter = 0.25;
+    std::vector<CapType> refLarge(ref), refQuarter(ref);
+    for (i=0; i<numNodes; i++)
+      if (ref[i] != CAP_INF) {
+	refLarge[i]   *= large;
+	refQuarter[i] *= quarter;
+      }
+    CHECK(heapDijkstra<RadixHeap>(arcs, start, large) == refLarge);
+    CHECK(heapDijkstra< DAryHeap<4> >(arcs, start, quarter) == refQuarter);
+    CHECK(heapDijkstra< DAryHeap<8> >(arcs, start, quarter) == refQuarter);
+  }
+
+  CHECK(RadixHeap::isValidKey(1073741824. * 8000));
+  CHECK(!RadixHeap::isValidKey(0.25) && !RadixHeap::isValidKey(-1) && !RadixHeap::isValidKey(CAP_INF));
+
+}
+
+
+
+//builds, searches and clears graphs of several blocks in a loop and 
+//counts the distances that differ from the reference
+static void churnGraphs(int seed, int *numWrong) {
+
+  TestRandom rnd(seed);
+  CGraph graph(3 * NODE_BLOCK_SIZE);
+
+  for (int trial=0; trial<30; trial++) {
+    int numNodes = 1 + rnd.range(3 * NODE_BLOCK_SIZE);
+    TestArcs arcs(rnd, numNodes, rnd.range(numNodes * 3));
+    std::vector<CGNode*> nodes;
+    int i, start = rnd.range(numNodes);
+
+    for (i=0; i<numNodes; i++)
+      nodes.push_back(graph.addNode(i));
+    for (i=0; i<(int)arcs.from.size(); i++)
+      graph.addEdge(nodes[arcs.from[i]], nodes[arcs.to[i]], arcs.weight[i]);
+
+    graph.runDijkstra(nodes[start]);
+
+    std::vector<CapType> ref = arcs.referenceDist(std::vector<int>(1, start));
+    for (i=0; i<numNodes; i++)
+      if (nodes[i]->dijkWeight != ref[i])
+	(*numWrong)++;
+
+    //hands the blocks to the other threads
+    graph.clear();
+  }
+
+}
+
+
+
+//graphs built and cleared on several threads at once share the blocks 
+//of the global BlockPool - no thread may see the nodes of another one
+TEST(CGraphBlockPool) {
+
+  const int numThreads = 4;
+  std::vector<std::thread> threads;
+  int numWrong[numThreads] = {0};
+  int t;
+
+  for (t=0; t<numThreads; t++)
+    threads.push_back(std::thread(churnGraphs, 37 + t, &numWrong[t]));
+  for (t=0; t<numThreads; t++)
+    threads[t].join();
+
+  for (t=0; t<numThreads; t++)
+    CHECK(numWrong[t] == 0);
+
+}
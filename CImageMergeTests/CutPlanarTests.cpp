@@ -0,0 +1,801 @@
+/*****************************************************************************
+*    PlanarCut - software to compute MinCut / MaxFlow in a planar graph      *
+*                              Version 1.0.2                                 *
+*                                                                            *
+*    Copyright 2011 - 2013 Eno Töppe <toeppe@in.tum.de>                      *
+*                          Frank R. Schmidt <info@frank-r-schmidt.de>        *
+******************************************************************************
+
+  If you use this software for research purposes, YOU MUST CITE the following 
+  paper in any resulting publication:
+
+    [1] Efficient Planar Graph Cuts with Applications in Computer Vision.
+        F. R. Schmidt, E. Töppe, D. Cremers, 
+	    IEEE CVPR, Miami, Florida, June 2009		
+
+******************************************************************************
+
+  This software is released under the LGPL license. Details are explained
+  in the files 'COPYING' and 'COPYING.LESSER'.
+	
+*****************************************************************************/
+
+#include "CutGrid.h"
+#include "CGraph.h"
+#include "Tests.h"
+#include <vector>
+#include <thread>
+#include <math.h>
+
+
+//grid with the edge costs held in arrays: cost[dir][row*nCols+col] is 
+//the capacity of the arc leaving (row,col) in direction dir
+template<class DynTree>
+class TestGridT : public CutGridT<DynTree>
+{
+ public:
+  int nRows, nCols;
+  std::vector<CapType> cost[4];
+
+  TestGridT(int nRows, int nCols) : CutGridT<DynTree>(nRows, nCols), 
+				    nRows(nRows), nCols(nCols) {
+    for (int d=0; d<4; d++)
+      cost[d].assign(nRows*nCols, 0);
+    this->setSource(0, 0);
+    this->setSink(nRows-1, nCols-1);
+  }
+
+  virtual CapType edgeCost(int row, int col, CutGridBase::EDir dir) {
+    return cost[dir][row*nCols + col];
+  }
+
+  //draws integral costs from [0,maxCost), a cost is zero with 
+  //probability 1/zeroRatio (never if zeroRatio is 0)
+  void randomize(TestRandom &rnd, int maxCost, int zeroRatio) {
+    for (int d=0; d<4; d++)
+      for (int i=0; i<nRows*nCols; i++)
+	cost[d][i] = (zeroRatio && !rnd.range(zeroRatio)) ? 0 : 1 + rnd.range(maxCost-1);
+  }
+
+  //changes the costs of the pixels in a small random region to new 
+  //random values and returns the region
+  void randomizeRegion(TestRandom &rnd, int maxCost, int zeroRatio,
+		       int &rowMin, int &colMin, int &rowMax, int &colMax) {
+    rowMin = rnd.range(nRows); rowMax = rowMin + rnd.range(3);
+    colMin = rnd.range(nCols); colMax = colMin + rnd.range(3);
+    if (rowMax >= nRows) rowMax = nRows-1;
+    if (colMax >= nCols) colMax = nCols-1;
+    for (int r=rowMin; r<=rowMax; r++)
+      for (int c=colMin; c<=colMax; c++)
+	for (int d=0; d<4; d++)
+	  cost[d][r*nCols + c] = (zeroRatio && !rnd.range(zeroRatio)) ? 0 : 1 + rnd.range(maxCost-1);
+  }
+
+  //maximum flow computed by Dinic's algorithm as reference
+  double referenceFlow();
+
+  //capacity of the cut given by the labels of getLabels()
+  double cutCapacity();
+};
+
+
+template<class DynTree>
+double TestGridT<DynTree>::referenceFlow() {
+
+  struct Arc { int to; double cap; };
+  int n = nRows*nCols, s, t, u, v, d;
+  std::vector<Arc> arcs;
+  std::vector< std::vector<int> > out(n);
+  std::vector<int> level(n), next(n), queue(n), path;
+  double flow = 0;
+
+  //arcs come in pairs, the arc i is the reverse of i^1
+  for (u=0; u<n; u++) {
+    int r = u / nCols, c = u % nCols;
+    if (c < nCols-1) {
+      v = u+1;
+      out[u].push_back((int)arcs.size()); arcs.push_back(Arc{v, cost[CutGridBase::DIR_EAST][u]});
+      out[v].push_back((int)arcs.size()); arcs.push_back(Arc{u, cost[CutGridBase::DIR_WEST][v]});
+    }
+    if (r < nRows-1) {
+      v = u+nCols;
+      out[u].push_back((int)arcs.size()); arcs.push_back(Arc{v, cost[CutGridBase::DIR_SOUTH][u]});
+      out[v].push_back((int)arcs.size()); arcs.push_back(Arc{u, cost[CutGridBase::DIR_NORTH][v]});
+    }
+  }
+
+  int rs, cs, rt, ct;
+  this->getSource(rs, cs);
+  this->getSink(rt, ct);
+  s = rs*nCols + cs;
+  t = rt*nCols + ct;
+
+  while (true) {
+
+    //breadth first search for the level graph
+    int head = 0, tail = 0;
+    level.assign(n, -1);
+    level[s] = 0;
+    queue[tail++] = s;
+    while (head < tail) {
+      u = queue[head++];
+      for (size_t k=0; k<out[u].size(); k++) {
+	Arc &a = arcs[out[u][k]];
+	if (a.cap > 0 && level[a.to] < 0) {
+	  level[a.to] = level[u] + 1;
+	  queue[tail++] = a.to;
+	}
+      }
+    }
+    if (level[t] < 0)
+      break;
+
+    //blocking flow by depth first search along the level graph
+    next.assign(n, 0);
+    path.clear();
+    u = s;
+    while (true) {
+      if (u == t) {
+	double aug = HUGE_VAL;
+	for (size_t k=0; k<path.size(); k++)
+	  if (arcs[path[k]].cap < aug) aug = arcs[path[k]].cap;
+	for (size_t k=0; k<path.size(); k++) {
+	  arcs[path[k]].cap   -= aug;
+	  arcs[path[k]^1].cap += aug;
+	}
+	flow += aug;
+	path.clear();
+	u = s;
+	continue;
+      }
+      for (d=next[u]; d<(int)out[u].size(); d++) {
+	Arc &a = arcs[out[u][d]];
+	if (a.cap > 0 && level[a.to] == level[u] + 1)
+	  break;
+      }
+      next[u] = d;
+      if (d < (int)out[u].size()) {
+	path.push_back(out[u][d]);
+	u = arcs[out[u][d]].to;
+      } else {
+	//dead end - retreat
+	if (u == s)
+	  break;
+	level[u] = -1;
+	u = arcs[path.back()^1].to;
+	path.pop_back();
+      }
+    }
+  }
+
+  return flow;
+
+}
+
+
+template<class DynTree>
+double TestGridT<DynTree>::cutCapacity() {
+
+  std::vector<CutPlanarBase::ELabel> labels(nRows*nCols);
+  double cap = 0;
+  int u, v;
+
+  this->getLabels(&labels[0]);
+
+  for (u=0; u<nRows*nCols; u++) {
+    if (labels[u] != CutPlanarBase::LABEL_SOURCE)
+      continue;
+    v = u+1;
+    if (u % nCols < nCols-1 && labels[v] == CutPlanarBase::LABEL_SINK)
+      cap += cost[CutGridBase::DIR_EAST][u];
+    v = u-1;
+    if (u % nCols > 0 && labels[v] == CutPlanarBase::LABEL_SINK)
+      cap += cost[CutGridBase::DIR_WEST][u];
+    v = u+nCols;
+    if (u / nCols < nRows-1 && labels[v] == CutPlanarBase::LABEL_SINK)
+      cap += cost[CutGridBase::DIR_SOUTH][u];
+    v = u-nCols;
+    if (u / nCols > 0 && labels[v] == CutPlanarBase::LABEL_SINK)
+      cap += cost[CutGridBase::DIR_NORTH][u];
+  }
+
+  return cap;
+
+}
+
+
+static bool sameFlow(double a, double b) {
+  return fabs(a - b) <= 1e-6 * (1 + fabs(b));
+}
+
+
+//two instances used alternately on one thread must not share their 
+//dynamic tree nodes, neither must destroying one of them affect the other
+template<class DynTree>
+static void checkTwoInstances() {
+
+  TestRandom rnd(31);
+  TestGridT<DynTree> a(30, 30);
+  int r0, c0, r1, c1;
+
+  a.randomize(rnd, 20, 0);
+  CHECK(sameFlow(a.getMaxFlow(), a.referenceFlow()));
+
+  {
+    TestGridT<DynTree> b(40, 40);
+    b.randomize(rnd, 20, 0);
+    CHECK(sameFlow(b.getMaxFlow(), b.referenceFlow()));
+
+    a.randomizeRegion(rnd, 20, 0, r0, c0, r1, c1);
+    CHECK(sameFlow(a.updateMaxFlow(r0, c0, r1, c1), a.referenceFlow()));
+    CHECK(sameFlow(b.cutCapacity(), b.referenceFlow()));
+  }
+
+  a.randomizeRegion(rnd, 20, 0, r0, c0, r1, c1);
+  CHECK(sameFlow(a.updateMaxFlow(r0, c0, r1, c1), a.referenceFlow()));
+  CHECK(sameFlow(a.cutCapacity(), a.referenceFlow()));
+
+}
+
+TEST(CutPlanarTwoInstances) {
+  checkTwoInstances<DynPathTree>();
+  checkTwoInstances<SplayPathTree>();
+}
+
+
+//an instance may be created, solved and destroyed by different threads
+template<class DynTree>
+static void checkThreads() {
+
+  TestRandom rnd(37);
+  TestGridT<DynTree> *grid = new TestGridT<DynTree>(25, 35);
+  double flow = 0, flowUpdated = 0;
+  int r0, c0, r1, c1;
+
+  grid->randomize(rnd, 50, 0);
+  std::thread([&] { flow = grid->getMaxFlow(); }).join();
+  CHECK(sameFlow(flow, grid->referenceFlow()));
+
+  grid->randomizeRegion(rnd, 50, 0, r0, c0, r1, c1);
+  std::thread([&] { flowUpdated = grid->updateMaxFlow(r0, c0, r1, c1); }).join();
+  CHECK(sameFlow(flowUpdated, grid->referenceFlow()));
+  CHECK(sameFlow(grid->cutCapacity(), flowUpdated));
+
+  std::thread([&] { delete grid; }).join();
+
+}
+
+TEST(CutPlanarThreads) {
+  checkThreads<DynPathTree>();
+  checkThreads<SplayPathTree>();
+}
+
+
+
+//capacities far below EPSILON vanish during preFlow(), so that the 
+//source is blocked and there is no cut loop in T*
+template<class DynTree>
+static void checkBlockedSource() {
+
+  TestRandom rnd(39);
+  int r0, c0, r1, c1;
+
+  for (int trial=0; trial<20; trial++) {
+    int nRows = 2 + rnd.range(10), nCols = 2 + rnd.range(10);
+    TestGridT<DynTree> grid(nRows, nCols);
+    std::vector<CutPlanarBase::ELabel> labels(nRows*nCols);
+
+    grid.randomize(rnd, 50, 3);
+    for (int d=0; d<4; d++)
+      for (int i=0; i<nRows*nCols; i++)
+	grid.cost[d][i] *= 1e-9;
+    CHECK(sameFlow(grid.getMaxFlow(), grid.referenceFlow()));
+
+    grid.getLabels(&labels[0]);
+    CHECK(labels[0] == CutPlanarBase::LABEL_SOURCE);
+    CHECK(labels[nRows*nCols-1] == CutPlanarBase::LABEL_SINK);
+
+    grid.randomizeRegion(rnd, 50, 3, r0, c0, r1, c1);
+    for (int r=r0; r<=r1; r++)
+      for (int c=c0; c<=c1; c++)
+	for (int d=0; d<4; d++)
+	  grid.cost[d][r*nCols + c] *= 1e-9;
+    CHECK(sameFlow(grid.updateMaxFlow(r0, c0, r1, c1), grid.referenceFlow()));
+  }
+
+}
+
+TEST(CutPlanarBlockedSource) {
+  checkBlockedSource<DynPathTree>();
+  checkBlockedSource<SplayPathTree>();
+}
+
+
+
+//updateMaxFlow() on random grids with zero capacity edges has to yield
+//the flow of a fresh solve of the same grid
+template<class DynTree>
+static void checkIncremental(int maxCost, double scale) {
+
+  TestRandom rnd(26);
+  int r0, c0, r1, c1;
+
+  for (int trial=0; trial<60; trial++) {
+    int nRows = 2 + rnd.range(30), nCols = 2 + rnd.range(30);
+    TestGridT<DynTree> grid(nRows, nCols);
+
+    grid.randomize(rnd, maxCost, 4);
+    for (int d=0; d<4; d++)
+      for (int i=0; i<nRows*nCols; i++)
+	grid.cost[d][i] *= scale;
+    CHECK(sameFlow(grid.getMaxFlow(), grid.referenceFlow()));
+
+    for (int step=0; step<4; step++) {
+      grid.randomizeRegion(rnd, maxCost, 4, r0, c0, r1, c1);
+      for (int r=r0; r<=r1; r++)
+	for (int c=c0; c<=c1; c++)
+	  for (int d=0; d<4; d++)
+	    grid.cost[d][r*nCols + c] *= scale;
+
+      double flow = grid.updateMaxFlow(r0, c0, r1, c1);
+      TestGridT<DynTree> fresh(nRows, nCols);
+      for (int d=0; d<4; d++)
+	fresh.cost[d] = grid.cost[d];
+
+      double ref = grid.referenceFlow();
+      CHECK(sameFlow(flow, ref));
+      CHECK(sameFlow(fresh.getMaxFlow(), ref));
+      CHECK(sameFlow(grid.cutCapacity(), ref));
+      CHECK(sameFlow(grid.getMaxFlow(), flow));
+    }
+  }
+
+}
+
+TEST(CutPlanarIncremental) {
+  checkIncremental<DynPathTree>(50, 1);
+  checkIncremental<SplayPathTree>(50, 1);
+  checkIncremental<DynPathTree>(8, 1./7);
+  checkIncremental<SplayPathTree>(8, 1./7);
+}
+
+
+//raising costs and pinning pixels keeps the previous flow feasible, so 
+//the spanning trees are repaired instead of being rebuilt - this also 
+//raises the replacement of infinite capacities now and then
+template<class DynTree>
+static void checkIncrementalRaise() {
+
+  TestRandom rnd(50);
+  int r0, c0, r1, c1;
+
+  for (int trial=0; trial<60; trial++) {
+    int nRows = 2 + rnd.range(30), nCols = 2 + rnd.range(30);
+    TestGridT<DynTree> grid(nRows, nCols);
+
+    grid.randomize(rnd, 50, 0);
+    CHECK(sameFlow(grid.getMaxFlow(), grid.referenceFlow()));
+
+    for (int step=0; step<8; step++) {
+      r0 = rnd.range(nRows);
+      c0 = rnd.range(nCols);
+      r1 = r0 + rnd.range(3);
+      c1 = c0 + rnd.range(3);
+      if (r1 >= nRows) r1 = nRows-1;
+      if (c1 >= nCols) c1 = nCols-1;
+
+      bool pin = !rnd.range(4);
+      for (int r=r0; r<=r1; r++)
+	for (int c=c0; c<=c1; c++)
+	  for (int d=0; d<4; d++) {
+	    double &cost = grid.cost[d][r*nCols + c];
+	    cost = pin ? CAP_INF : cost + rnd.range(20);
+	  }
+
+      double flow = grid.updateMaxFlow(r0, c0, r1, c1);
+      double ref  = grid.referenceFlow();
+
+      //pinned pixels may connect source and sink
+      if (ref >= CAP_INF)
+	break;
+
+      CHECK(sameFlow(flow, ref));
+      CHECK(sameFlow(grid.cutCapacity(), ref));
+    }
+  }
+
+}
+
+TEST(CutPlanarIncrementalRaise) {
+  checkIncrementalRaise<DynPathTree>();
+  checkIncrementalRaise<SplayPathTree>();
+}
+
+
+//both dynamic tree backends have to agree on the same graphs, in 
+//particular on graphs with many zero capacity (eps) edges
+TEST(CutPlanarBackends) {
+
+  TestRandom rnd(34);
+
+  for (int trial=0; trial<80; trial++) {
+    int nRows = 2 + rnd.range(40), nCols = 2 + rnd.range(40);
+    int zeroRatio = 2 + rnd.range(4);
+    double scale = (trial & 1) ? 1./3 : 1;
+    TestGridT<DynPathTree>   dyn(nRows, nCols);
+    TestGridT<SplayPathTree> splay(nRows, nCols);
+
+    dyn.randomize(rnd, 30, zeroRatio);
+    for (int d=0; d<4; d++) {
+      for (int i=0; i<nRows*nCols; i++)
+	dyn.cost[d][i] *= scale;
+      splay.cost[d] = dyn.cost[d];
+    }
+
+    double ref = dyn.referenceFlow();
+    double flowDyn = dyn.getMaxFlow(), flowSplay = splay.getMaxFlow();
+    CHECK(sameFlow(flowDyn, ref));
+    CHECK(sameFlow(flowSplay, ref));
+    CHECK(sameFlow(flowDyn, flowSplay));
+    CHECK(sameFlow(dyn.cutCapacity(), ref));
+    CHECK(sameFlow(splay.cutCapacity(), ref));
+  }
+
+}
+
+
+//with several threads the potentials of preFlow() are computed by 
+//delta-stepping - the flow and the cut have to be the same
+TEST(CutPlanarDeltaStepping) {
+
+  TestRandom rnd(29);
+  int r0, c0, r1, c1;
+
+  for (int trial=0; trial<30; trial++) {
+    int nRows = 2 + rnd.range(60), nCols = 2 + rnd.range(60);
+    TestGridT<DynPathTree> grid(nRows, nCols);
+    double scale = (trial & 1) ? 1./7 : 1;
+
+    grid.setNumThreads(1 + trial % 4);
+    grid.randomize(rnd, 40, 5);
+    for (int d=0; d<4; d++)
+      for (int i=0; i<nRows*nCols; i++)
+	grid.cost[d][i] *= scale;
+
+    double ref = grid.referenceFlow();
+    CHECK(sameFlow(grid.getMaxFlow(), ref));
+    CHECK(sameFlow(grid.cutCapacity(), ref));
+
+    grid.randomizeRegion(rnd, 40, 5, r0, c0, r1, c1);
+    double flow = grid.updateMaxFlow(r0, c0, r1, c1);
+    ref = grid.referenceFlow();
+    CHECK(sameFlow(flow, ref));
+    CHECK(sameFlow(grid.cutCapacity(), ref));
+  }
+
+}
+
+
+
+//planar grid of nRows x nCols vertices embedded the same way as by 
+//CutGrid, whose dual shortest path distances can be queried
+class TestDualGrid : public CutPlanarT<DynPathTree>
+{
+ public:
+  int nRows, nCols, numEdges, numFaces;
+  PlanarVertex *vertList;
+  PlanarEdge   *edgeList;
+  PlanarFace   *faceList;
+
+  TestDualGrid(TestRandom &rnd, int nRows, int nCols, double scale) : nRows(nRows), nCols(nCols) {
+    int nHorz = (nCols-1) * nRows, i, j, e;
+    PlanarEdge *ccw[4];
+
+    numEdges = nHorz + nCols * (nRows-1);
+    numFaces = (nRows-1) * (nCols-1) + 1; //the outer face comes last
+    vertList = new PlanarVertex[nRows*nCols];
+    edgeList = new PlanarEdge[numEdges];
+    faceList = new PlanarFace[numFaces];
+
+    for (j=0; j<nRows; j++)
+      for (i=0; i<nCols; i++) {
+	e = 0;
+	if (i < nCols-1) ccw[e++] = &edgeList[j*(nCols-1) + i];
+	if (j > 0)       ccw[e++] = &edgeList[nHorz + (j-1)*nCols + i];
+	if (i > 0)       ccw[e++] = &edgeList[j*(nCols-1) + i-1];
+	if (j < nRows-1) ccw[e++] = &edgeList[nHorz + j*nCols + i];
+	vertList[j*nCols + i].setEdgesCCW(ccw, e);
+      }
+
+    for (j=0, e=0; j<nRows; j++)
+      for (i=0; i<nCols-1; i++, e++)
+	edgeList[e].setEdge(&vertList[j*nCols + i], &vertList[j*nCols + i+1],
+			    &faceList[j > 0       ? (j-1)*(nCols-1) + i : numFaces-1],
+			    &faceList[j < nRows-1 ? j*(nCols-1) + i     : numFaces-1],
+			    scale * (1 + rnd.range(30)), scale * (1 + rnd.range(30)));
+    for (j=0; j<nRows-1; j++)
+      for (i=0; i<nCols; i++, e++)
+	edgeList[e].setEdge(&vertList[j*nCols + i], &vertList[(j+1)*nCols + i],
+			    &faceList[i < nCols-1 ? j*(nCols-1) + i   : numFaces-1],
+			    &faceList[i > 0       ? j*(nCols-1) + i-1 : numFaces-1],
+			    scale * (1 + rnd.range(30)), scale * (1 + rnd.range(30)));
+
+    initialize(nRows*nCols, vertList, numEdges, edgeList, numFaces, faceList);
+  }
+
+  ~TestDualGrid() {
+    delete [] vertList;
+    delete [] edgeList;
+    delete [] faceList;
+  }
+
+  std::vector<CapType> dualDistances(int startFace) {
+    std::vector<CapType> dist(numFaces);
+    runDualDijkstra(startFace, &dist[0]);
+    return dist;
+  }
+
+  //the distances as preFlow() computed them before the dual adjacency 
+  //arrays, by runDijkstra() on a CGraph of the faces
+  std::vector<CapType> cgraphDistances(int startFace) {
+    CGraph graph(numFaces);
+    std::vector<CGNode*> nodes;
+    std::vector<CapType> dist;
+    int i;
+
+    for (i=0; i<numFaces; i++)
+      nodes.push_back(graph.addNode(i));
+    for (i=0; i<numEdges; i++) {
+      CGNode *src = nodes[edgeList[i].getTailDual() - faceList];
+      CGNode *dst = nodes[edgeList[i].getHeadDual() - faceList];
+      graph.addEdge(src, dst, edgeList[i].getCapacity());
+      graph.addEdge(dst, src, edgeList[i].getRevCapacity());
+    }
+
+    graph.runDijkstra(nodes[startFace]);
+    for (i=0; i<numFaces; i++)
+      dist.push_back(nodes[i]->dijkWeight);
+    return dist;
+  }
+};
+
+
+//the potentials of preFlow() on the dual adjacency arrays - by the radix
+//heap, the d-ary heap and delta-stepping - have to be the distances 
+//of the former Dijkstra on a CGraph of the faces
+TEST(CutPlanarDualDijkstra) {
+
+  TestRandom rnd(27);
+
+  for (int trial=0; trial<40; trial++) {
+    int nRows = 2 + rnd.range(40), nCols = 2 + rnd.range(40);
+    bool integral = (trial & 1) == 0;
+    TestDualGrid grid(rnd, nRows, nCols, integral ? 1 : 1./3);
+    int startFace = rnd.range(grid.numFaces);
+
+    if (trial & 2)
+      grid.setNumThreads(1 + rnd.range(4));
+
+    std::vector<CapType> dist = grid.dualDistances(startFace);
+    std::vector<CapType> ref  = grid.cgraphDistances(startFace);
+    for (int f=0; f<grid.numFaces; f++) {
+      if (integral)
+	CHECK(dist[f] == ref[f]);
+      else
+	CHECK(sameFlow(dist[f], ref[f]));
+    }
+  }
+
+}
+
+
+
+//weakly linked chain of leaves as built by constructSpanningTrees(): 
+//leaves[k] hangs at leaves[k-1] by the edge of the k-th costs
+template<class DynTree>
+class TestChainT
+{
+ public:
+  typedef typename DynTree::Leaf Leaf;
+  typedef typename DynTree::Root Root;
+
+  typename DynTree::Arena arena;
+  std::vector<Leaf*> leaves;
+
+  TestChainT(int numLeaves) {
+    Leaf *pl = DynTree::allocLeaves(arena, numLeaves);
+    for (int k=0; k<numLeaves; k++)
+      leaves.push_back(pl + k);
+  }
+
+  ~TestChainT() {
+    DynTree::releaseArena(arena);
+  }
+
+  Root *build(const std::vector<CapType> &cost, const std::vector<CapType> &costR,
+	      const std::vector<bool> &mapping) {
+    for (size_t k=1; k<leaves.size(); k++)
+      leaves[k]->setWeakLink(arena, leaves[k-1], cost[k], costR[k], mapping[k], DynData(k));
+    return DynTree::rootFromLeafChain(arena, &leaves[0], PlanarIdx(leaves.size()));
+  }
+
+  int index(Leaf *pl) {
+    for (size_t k=0; k<leaves.size(); k++)
+      if (leaves[k] == pl)
+	return int(k);
+    return -1;
+  }
+
+  //head, tail and minimum cost leaf of the path, followed by the 
+  //successor and the edge cost of every leaf
+  std::vector<CapType> observe() {
+    std::vector<CapType> obs;
+    Root *root = leaves[0]->getPath(arena);
+
+    obs.push_back(index(root->getHead(arena)));
+    obs.push_back(index(root->getTail(arena)));
+    if (leaves.size() > 1)
+      obs.push_back(index(leaves[0]->getPath(arena)->getMinCostLeaf(arena)));
+    for (size_t k=0; k<leaves.size(); k++) {
+      obs.push_back(index(leaves[k]->getNext(arena)));
+      if (k > 0)
+	obs.push_back(leaves[k]->getEdgeCost(arena));
+    }
+    return obs;
+  }
+
+  void addCost(CapType cost) {
+    leaves[0]->getPath(arena)->addCost(cost);
+  }
+
+  void reverse() {
+    leaves[0]->getPath(arena)->reverse();
+  }
+
+  //costs, mapping and data of the edge removed by dividing at leaves[k]
+  std::vector<CapType> divide(int k) {
+    typename DynTree::Split split;
+    std::vector<CapType> obs;
+
+    leaves[k]->divide(arena, &split);
+    obs.push_back(split.costBefore);
+    obs.push_back(split.costBeforeR);
+    obs.push_back(split.mappingBefore);
+    obs.push_back(split.dataBefore);
+    return obs;
+  }
+};
+
+
+//destroys all inner nodes of the path, appending the head and tail 
+//indices of the left and the right subpath of each of them in preorder
+static void dismantle(TestChainT<DynPathTree> &chain, DynRoot *root, std::vector<int> &shape) {
+  ResultDestroy dr = {0, 0, 0, 0};
+  DynArena &a = chain.arena;
+
+  root->destroy(a, &dr); //nothing is done for a leaf
+  if (!dr.leftPath)
+    return;
+
+  shape.push_back(chain.index(dr.leftPath->getHead(a)));
+  shape.push_back(chain.index(dr.leftPath->getTail(a)));
+  shape.push_back(chain.index(dr.rightPath->getHead(a)));
+  shape.push_back(chain.index(dr.rightPath->getTail(a)));
+  dismantle(chain, dr.leftPath, shape);
+  dismantle(chain, dr.rightPath, shape);
+}
+
+
+struct TestChainNode {
+  int head, tail;
+  int left, right; //-1 for a leaf
+};
+
+static void chainShape(const std::vector<TestChainNode> &tree, int node, std::vector<int> &shape) {
+  const TestChainNode &n = tree[node];
+
+  if (n.left < 0)
+    return;
+  shape.push_back(tree[n.left].head);
+  shape.push_back(tree[n.left].tail);
+  shape.push_back(tree[n.right].head);
+  shape.push_back(tree[n.right].tail);
+  chainShape(tree, n.left, shape);
+  chainShape(tree, n.right, shape);
+}
+
+//the shape of the former DynRootFromLeafChain(): the leaves are paired 
+//from the head until the remaining row is a power of two, which is then
+//merged pairwise row by row
+static std::vector<int> referenceShape(int numLeaves) {
+  std::vector<TestChainNode> tree;
+  std::vector<int> row, next, shape;
+  int full = 1, i;
+
+  for (i=numLeaves-1; i>=0; i--) {
+    TestChainNode leaf = {i, i, -1, -1};
+    row.push_back(int(tree.size()));
+    tree.push_back(leaf);
+  }
+  while (2*full <= numLeaves)
+    full *= 2;
+
+  for (int pairs = numLeaves - full; row.size() > 1; pairs = int(row.size()) / 2) {
+    next.clear();
+    for (i=0; i<int(row.size()); i++)
+      if (i < 2*pairs && (i & 1) == 0) {
+	TestChainNode n = {tree[row[i]].head, tree[row[i+1]].tail, row[i], row[i+1]};
+	next.push_back(int(tree.size()));
+	tree.push_back(n);
+      } else if (i >= 2*pairs)
+	next.push_back(row[i]);
+    row.swap(next);
+  }
+
+  chainShape(tree, row[0], shape);
+  return shape;
+}
+
+
+//the balanced path built in one pass by DynRootFromLeafChain() has to 
+//have the shape of the former row-wise construction and behave like the
+//path of the splay tree backend, also when its inner nodes come from the
+//free list instead of a fresh slab
+TEST(DynPathFromLeafChain) {
+
+  TestRandom rnd(33);
+
+  for (int trial=0; trial<60; trial++) {
+    int n = (trial < 8) ? 1 + trial : 1 + rnd.range(trial < 40 ? 300 : 3000);
+    std::vector<CapType> cost(n), costR(n);
+    std::vector<bool> mapping(n);
+    std::vector<int> shape;
+    bool reversed = false;
+
+    for (int k=1; k<n; k++) {
+      cost[k]    = rnd.range(20);
+      costR[k]   = rnd.range(20);
+      mapping[k] = rnd.range(2) != 0;
+    }
+
+    TestChainT<DynPathTree>   dyn(n);
+    TestChainT<SplayPathTree> splay(n);
+    DynRoot *root = dyn.build(cost, costR, mapping);
+    splay.build(cost, costR, mapping);
+
+    std::vector<CapType> fresh = dyn.observe();
+    CHECK(fresh == splay.observe());
+    CHECK(fresh[0] == n-1 && fresh[1] == 0);
+    for (int k=1; k<n; k++) {
+      CHECK(dyn.leaves[k]->getNext(dyn.arena) == dyn.leaves[k-1]);
+      CHECK(dyn.leaves[k]->getEdgeCost(dyn.arena) == cost[k]);
+    }
+
+    //the slots of the first build are exhausted, so the second one takes 
+    //its inner nodes one by one from the free list
+    dismantle(dyn, root, shape);
+    CHECK(shape == referenceShape(n));
+    root = dyn.build(cost, costR, mapping);
+    CHECK(dyn.observe() == fresh);
+
+    for (int step=0; step<4; step++) {
+      CapType delta = rnd.range(10) - 5;
+      dyn.addCost(delta);
+      splay.addCost(delta);
+      if (rnd.range(2)) {
+	dyn.reverse();
+	splay.reverse();
+	reversed = !reversed;
+      }
+      CHECK(dyn.observe() == splay.observe());
+    }
+
+    if (n > 1) {
+      int k = reversed ? 1 + rnd.range(n-1) : rnd.range(n-1);
+      std::vector<CapType> edge = dyn.divide(k);
+      CHECK(edge == splay.divide(k));
+      CHECK(edge[3] == (reversed ? k : k+1));
+    }
+  }
+
+}
@@ -0,0 +1,1034 @@
+#include <atomic>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lodepng.h"
+#include "Tests.h"
+
+// The test project compiles lodepng with LODEPNG_NO_COMPILE_ALLOCATORS, so
+// that its allocations are counted here
+static std::atomic<long> lodepngAllocations(0);
+
+void* lodepng_malloc(size_t size)
+{
+	lodepngAllocations++;
+	return malloc(size);
+}
+
+void* lodepng_realloc(void* ptr, size_t newSize)
+{
+	lodepngAllocations++;
+	return realloc(ptr, newSize);
+}
+
+void lodepng_free(void* ptr)
+{
+	free(ptr);
+}
+
+// Random RGBA8 image with smooth areas, so that all filter types and
+// Huffman codes of the encoder are used
+static std::vector<unsigned char> makeImage(TestRandom& rnd, unsigned w, unsigned h)
+{
+	std::vector<unsigned char> image(static_cast<size_t>(w) * h * 4);
+
+	for (size_t i = 0; i < image.size(); ++i)
+	{
+		size_t pixel = i / 4;
+		unsigned x = static_cast<unsigned>(pixel % w), y = static_cast<unsigned>(pixel / w);
+		image[i] = rnd.range(4) ? static_cast<unsigned char>((x * 7 + y * 3 + (i & 3) * 50) & 255)
+			: static_cast<unsigned char>(rnd.range(256));
+	}
+
+	return image;
+}
+
+// Encodes an RGBA8 image to a PNG of the given color type, with an lpIX
+// chunk if segmentSize is not 0
+static std::vector<unsigned char> encodeImage(const std::vector<unsigned char>& image, unsigned w, unsigned h,
+	LodePNGColorType colorType, unsigned bitDepth, unsigned interlace, size_t segmentSize = 0)
+{
+	lodepng::State state;
+	std::vector<unsigned char> png;
+
+	state.encoder.auto_convert = 0;
+	state.encoder.segment_size = segmentSize;
+	state.info_png.color.colortype = colorType;
+	state.info_png.color.bitdepth = bitDepth;
+	state.info_png.interlace_method = interlace;
+
+	// a palette needs at most 2^bitDepth entries
+	std::vector<unsigned char> reduced(image);
+	if (colorType == LCT_PALETTE)
+	{
+		unsigned numColors = 1u << bitDepth;
+		for (unsigned i = 0; i < numColors; ++i)
+			lodepng_palette_add(&state.info_png.color, static_cast<unsigned char>(i * 255 / (numColors - 1)), 0, 0, 255);
+		for (size_t i = 0; i < reduced.size(); i += 4)
+		{
+			unsigned index = reduced[i] * numColors / 256;
+			reduced[i] = static_cast<unsigned char>(index * 255 / (numColors - 1));
+			reduced[i + 1] = reduced[i + 2] = 0;
+			reduced[i + 3] = 255;
+		}
+	}
+
+	unsigned error = lodepng::encode(png, reduced, w, h, state);
+	CHECK(error == 0);
+	return png;
+}
+
+struct CollectedRows
+{
+	std::vector<unsigned char> data;
+	unsigned numRows;
+	unsigned stopAtRow;
+};
+
+static unsigned collectRow(void* user, unsigned y, const unsigned char* row, size_t linebytes)
+{
+	CollectedRows* rows = static_cast<CollectedRows*>(user);
+
+	if (y != rows->numRows)
+		return 1000;
+	if (y == rows->stopAtRow)
+		return 1001;
+
+	rows->data.insert(rows->data.end(), row, row + linebytes);
+	rows->numRows++;
+	return 0;
+}
+
+// lodepng_decode_rows has to hand out the scanlines lodepng_decode returns
+// in the color type of the PNG, padded to full bytes
+TEST(LodePNGDecodeRows)
+{
+	TestRandom rnd(46);
+	struct { LodePNGColorType colorType; unsigned bitDepth; } modes[] =
+	{
+		{ LCT_RGBA, 8 }, { LCT_RGB, 8 }, { LCT_GREY, 8 }, { LCT_GREY_ALPHA, 8 },
+		{ LCT_RGBA, 16 }, { LCT_GREY, 1 }, { LCT_GREY, 4 }, { LCT_PALETTE, 2 }, { LCT_PALETTE, 8 }
+	};
+
+	for (int trial = 0; trial < 36; ++trial)
+	{
+		unsigned w = 1 + rnd.range(90), h = 1 + rnd.range(90);
+		unsigned mode = trial % (sizeof(modes) / sizeof(modes[0]));
+		unsigned interlace = (trial / 9) & 1;
+		std::vector<unsigned char> image = makeImage(rnd, w, h);
+		std::vector<unsigned char> png = encodeImage(image, w, h, modes[mode].colorType, modes[mode].bitDepth, interlace);
+
+		// the whole image in the color type of the PNG
+		lodepng::State state;
+		std::vector<unsigned char> raw;
+		unsigned w2, h2;
+		state.decoder.color_convert = 0;
+		CHECK(lodepng::decode(raw, w2, h2, state, png) == 0);
+
+		CollectedRows rows;
+		rows.numRows = 0;
+		rows.stopAtRow = ~0u;
+		lodepng::State rowState;
+		CHECK(lodepng_decode_rows(&collectRow, &rows, &w2, &h2, &rowState, png.data(), png.size()) == 0);
+		CHECK(w2 == w && h2 == h && rows.numRows == h);
+
+		// the rows of the packed image, each padded to full bytes
+		size_t bpp = lodepng_get_bpp(&state.info_png.color);
+		size_t lineBytes = (w * bpp + 7) / 8;
+		std::vector<unsigned char> padded(lineBytes * h, 0);
+		for (size_t bit = 0; bit < static_cast<size_t>(w) * h * bpp; ++bit)
+		{
+			size_t y = bit / (w * bpp), x = bit % (w * bpp);
+			if (raw[bit / 8] & (128 >> (bit % 8)))
+				padded[y * lineBytes + x / 8] |= static_cast<unsigned char>(128 >> (x % 8));
+		}
+		CHECK(rows.data == padded);
+
+		// a nonzero return value of the callback stops decoding
+		rows.data.clear();
+		rows.numRows = 0;
+		rows.stopAtRow = h / 2;
+		CHECK(lodepng_decode_rows(&collectRow, &rows, &w2, &h2, &rowState, png.data(), png.size()) == 1001);
+		CHECK(rows.numRows == h / 2);
+
+		// truncated PNGs are rejected
+		rows.data.clear();
+		rows.numRows = 0;
+		rows.stopAtRow = ~0u;
+		CHECK(lodepng_decode_rows(&collectRow, &rows, &w2, &h2, &rowState, png.data(), png.size() / 2) != 0);
+	}
+}
+
+// Returns the offset of the first chunk of the given type or 0
+static size_t findChunk(const std::vector<unsigned char>& png, const char* type)
+{
+	for (size_t i = 8; i + 12 <= png.size(); i += 12 + lodepng_chunk_length(&png[i]))
+	{
+		if (!memcmp(&png[i + 4], type, 4))
+			return i;
+	}
+	return 0;
+}
+
+// PNGs written with segment_size carry an lpIX chunk and have to decode to
+// the same image on one or several threads, also if the index is corrupt
+TEST(LodePNGSegments)
+{
+	TestRandom rnd(47);
+	int numIndexed = 0;
+
+	for (int trial = 0; trial < 24; ++trial)
+	{
+		unsigned w = 1 + rnd.range(300), h = 1 + rnd.range(200);
+		std::vector<unsigned char> image = makeImage(rnd, w, h);
+		std::vector<unsigned char> png, pngThreads;
+
+		lodepng::State state;
+		state.encoder.auto_convert = 0;
+		state.encoder.segment_size = 64 + rnd.range(5000);
+		state.encoder.zlibsettings.btype = trial % 4 ? 2 : 1;
+		CHECK(lodepng::encode(png, image, w, h, state) == 0);
+
+		// the PNG does not depend on the number of threads
+		state.encoder.num_threads = 4;
+		CHECK(lodepng::encode(pngThreads, image, w, h, state) == 0);
+		CHECK(png == pngThreads);
+
+		size_t index = findChunk(png, "lpIX");
+		numIndexed += index != 0;
+
+		for (unsigned numThreads = 1; numThreads <= 4; numThreads += 3)
+		{
+			lodepng::State decodeState;
+			std::vector<unsigned char> decoded;
+			unsigned w2, h2;
+			decodeState.decoder.num_threads = numThreads;
+			CHECK(lodepng::decode(decoded, w2, h2, decodeState, png) == 0);
+			CHECK(decoded == image);
+		}
+
+		// a wrong segment offset makes the decoder fall back to the usual decoding
+		if (index && lodepng_chunk_length(&png[index]) >= 20)
+		{
+			std::vector<unsigned char> corrupt(png);
+			corrupt[index + 8 + 4 + 8 + 3] ^= 1;
+
+			lodepng::State decodeState;
+			std::vector<unsigned char> decoded;
+			unsigned w2, h2;
+			decodeState.decoder.num_threads = 4;
+			decodeState.decoder.ignore_crc = 1;
+			CHECK(lodepng::decode(decoded, w2, h2, decodeState, corrupt) == 0);
+			CHECK(decoded == image);
+		}
+	}
+
+	CHECK(numIndexed > 0);
+}
+
+// lodepng_encode_to and lodepng_decode_to have to give the results of
+// lodepng_encode and lodepng_decode in caller memory, or error 96 if it is
+// too small, also with a state that keeps its buffers
+TEST(LodePNGEncodeDecodeTo)
+{
+	TestRandom rnd(48);
+	LodePNGState state;
+
+	lodepng_state_init(&state);
+	CHECK(lodepng_state_keep_buffers(&state) == 0);
+
+	for (int trial = 0; trial < 20; ++trial)
+	{
+		unsigned w = 1 + rnd.range(200), h = 1 + rnd.range(200);
+		std::vector<unsigned char> image = makeImage(rnd, w, h);
+
+		unsigned char* png = 0;
+		size_t pngSize = 0, outSize = 0;
+		CHECK(lodepng_encode(&png, &pngSize, image.data(), w, h, &state) == 0);
+
+		// exactly the capacity needed
+		std::vector<unsigned char> out(pngSize + 16, 0xAB);
+		CHECK(lodepng_encode_to(out.data(), pngSize, &outSize, image.data(), w, h, &state) == 0);
+		CHECK(outSize == pngSize && !memcmp(out.data(), png, pngSize) && out[pngSize] == 0xAB);
+
+		// one byte less - out is left unchanged
+		std::vector<unsigned char> small(pngSize, 0xCD);
+		outSize = 0;
+		CHECK(lodepng_encode_to(small.data(), pngSize - 1, &outSize, image.data(), w, h, &state) == 96);
+		CHECK(outSize == pngSize && small == std::vector<unsigned char>(pngSize, 0xCD));
+
+		// decoding into caller memory
+		unsigned char* decoded = 0;
+		unsigned w2, h2;
+		CHECK(lodepng_decode(&decoded, &w2, &h2, &state, png, pngSize) == 0);
+		size_t imageSize = static_cast<size_t>(w) * h * 4;
+
+		std::vector<unsigned char> pixels(imageSize + 16, 0xAB);
+		outSize = 0;
+		CHECK(lodepng_decode_to(pixels.data(), imageSize, &outSize, &w2, &h2, &state, png, pngSize) == 0);
+		CHECK(outSize == imageSize && w2 == w && h2 == h);
+		CHECK(!memcmp(pixels.data(), decoded, imageSize) && !memcmp(pixels.data(), image.data(), imageSize));
+		CHECK(pixels[imageSize] == 0xAB);
+
+		std::vector<unsigned char> smallPixels(imageSize, 0xCD);
+		outSize = 0;
+		CHECK(lodepng_decode_to(smallPixels.data(), imageSize - 1, &outSize, &w2, &h2, &state, png, pngSize) == 96);
+		CHECK(outSize == imageSize && smallPixels == std::vector<unsigned char>(imageSize, 0xCD));
+
+		free(decoded);
+		free(png);
+	}
+
+	lodepng_state_cleanup(&state);
+}
+
+// Once its buffers have grown to the image size, a state that keeps them
+// encodes and decodes without allocating
+TEST(LodePNGKeepBuffersAllocations)
+{
+	TestRandom rnd(50);
+	LodePNGState state;
+
+	lodepng_state_init(&state);
+	CHECK(lodepng_state_keep_buffers(&state) == 0);
+	state.encoder.auto_convert = 0;
+
+	for (int trial = 0; trial < 12; ++trial)
+	{
+		unsigned w = 1 + rnd.range(300), h = 1 + rnd.range(200);
+		std::vector<unsigned char> image = makeImage(rnd, w, h);
+		std::vector<unsigned char> png(static_cast<size_t>(w) * h * 5 + h + 1024), pixels(image.size());
+		state.encoder.zlibsettings.btype = trial % 3;
+		state.info_png.interlace_method = (trial / 3) & 1;
+
+		// the first two runs let the buffers grow
+		for (int run = 0; run < 3; ++run)
+		{
+			size_t pngSize = 0, outSize = 0;
+			unsigned w2, h2;
+			long before = lodepngAllocations;
+			CHECK(lodepng_encode_to(png.data(), png.size(), &pngSize, image.data(), w, h, &state) == 0);
+			CHECK(lodepng_decode_to(pixels.data(), pixels.size(), &outSize, &w2, &h2, &state, png.data(), pngSize) == 0);
+			if (run == 2)
+				CHECK(lodepngAllocations == before);
+		}
+		CHECK(pixels == image);
+	}
+
+	lodepng_state_cleanup(&state);
+
+	// the counting allocators are the ones lodepng uses
+	std::vector<unsigned char> image(4 * 16 * 16, 128), png;
+	long before = lodepngAllocations;
+	CHECK(lodepng::encode(png, image, 16, 16) == 0);
+	CHECK(lodepngAllocations > before);
+}
+
+// Bytes whose frequencies halve from one value to the next, so that the
+// Huffman codes get up to 15 bits, with repeated runs for the distance codes
+static std::vector<unsigned char> makeSkewedData(TestRandom& rnd, size_t size)
+{
+	std::vector<unsigned char> data;
+
+	while (data.size() < size)
+	{
+		if (data.size() > 300 && rnd.range(8) == 0)
+		{
+			size_t distance = 1 + rnd.range(static_cast<int>(data.size() < 32768 ? data.size() : 32768));
+			size_t length = 3 + rnd.range(rnd.range(2) ? 8 : 300);
+			for (size_t i = 0; i < length; ++i)
+				data.push_back(data[data.size() - distance]);
+			continue;
+		}
+		unsigned value = 0;
+		while (value < 40 && rnd.range(2))
+			++value;
+		data.push_back(static_cast<unsigned char>(value * 5));
+	}
+
+	data.resize(size);
+	return data;
+}
+
+// The two-level decoding tables have to inflate deflate streams with codes
+// of all lengths to their input, and reject truncated streams and
+// oversubscribed code lengths
+TEST(LodePNGInflateTables)
+{
+	TestRandom rnd(40);
+
+	for (int trial = 0; trial < 30; ++trial)
+	{
+		std::vector<unsigned char> data = makeSkewedData(rnd, 1 + rnd.range(trial < 10 ? 1000 : 200000));
+		LodePNGCompressSettings settings;
+		lodepng_compress_settings_init(&settings);
+		settings.btype = 1 + (trial & 1);
+		settings.use_lz77 = (trial & 2) == 0;
+
+		unsigned char* deflated = 0;
+		size_t deflatedSize = 0;
+		CHECK(lodepng_deflate(&deflated, &deflatedSize, data.data(), data.size(), &settings) == 0);
+
+		unsigned char* out = 0;
+		size_t outSize = 0;
+		CHECK(lodepng_inflate(&out, &outSize, deflated, deflatedSize, &lodepng_default_decompress_settings) == 0);
+		CHECK(outSize == data.size() && !memcmp(out, data.data(), outSize));
+		free(out);
+
+		// the last byte holds at least the final bit of the end code
+		for (int cut = 0; cut < 4; ++cut)
+		{
+			size_t size = rnd.range(static_cast<int>(deflatedSize));
+			out = 0;
+			outSize = 0;
+			CHECK(lodepng_inflate(&out, &outSize, deflated, size, &lodepng_default_decompress_settings) != 0);
+			free(out);
+		}
+
+		// corrupt streams must not be read out of bounds
+		for (int flip = 0; flip < 4; ++flip)
+		{
+			std::vector<unsigned char> corrupt(deflated, deflated + deflatedSize);
+			corrupt[rnd.range(static_cast<int>(deflatedSize))] ^= static_cast<unsigned char>(1 << rnd.range(8));
+			out = 0;
+			outSize = 0;
+			lodepng_inflate(&out, &outSize, corrupt.data(), corrupt.size(), &lodepng_default_decompress_settings);
+			free(out);
+		}
+
+		free(deflated);
+	}
+
+	// dynamic block whose four code length codes all have length 1
+	const unsigned char oversubscribed[] = {0x05, 0x00, 0x92, 0x04, 0, 0, 0, 0};
+	unsigned char* out = 0;
+	size_t outSize = 0;
+	CHECK(lodepng_inflate(&out, &outSize, oversubscribed, sizeof(oversubscribed), &lodepng_default_decompress_settings) == 55);
+	free(out);
+}
+
+// The predictor of PNG filter type 4, as written in the PNG specification
+static int paethReference(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+	if (pa <= pb && pa <= pc)
+		return a;
+	if (pb <= pc)
+		return b;
+	return c;
+}
+
+// Filters one scanline byte by byte, prev is 0 for the first scanline
+static void filterReference(unsigned char* out, const unsigned char* line, const unsigned char* prev,
+	size_t lineBytes, size_t bytesPerPixel, int type)
+{
+	for (size_t i = 0; i < lineBytes; ++i)
+	{
+		int a = i >= bytesPerPixel ? line[i - bytesPerPixel] : 0;
+		int b = prev ? prev[i] : 0;
+		int c = prev && i >= bytesPerPixel ? prev[i - bytesPerPixel] : 0;
+		int predictor = 0;
+
+		switch (type)
+		{
+			case 1: predictor = a; break;
+			case 2: predictor = b; break;
+			case 3: predictor = (a + b) / 2; break;
+			case 4: predictor = paethReference(a, b, c); break;
+		}
+		out[i] = static_cast<unsigned char>(line[i] - predictor);
+	}
+}
+
+// Writes a non-interlaced PNG from scanlines that are already filtered
+static std::vector<unsigned char> makeFilteredPng(const std::vector<unsigned char>& filtered, unsigned w, unsigned h,
+	LodePNGColorType colorType, unsigned bitDepth)
+{
+	static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+	unsigned char header[13] = {
+		static_cast<unsigned char>(w >> 24), static_cast<unsigned char>(w >> 16),
+		static_cast<unsigned char>(w >> 8), static_cast<unsigned char>(w),
+		static_cast<unsigned char>(h >> 24), static_cast<unsigned char>(h >> 16),
+		static_cast<unsigned char>(h >> 8), static_cast<unsigned char>(h),
+		static_cast<unsigned char>(bitDepth), static_cast<unsigned char>(colorType), 0, 0, 0};
+
+	unsigned char* zlib = 0;
+	size_t zlibSize = 0;
+	CHECK(lodepng_zlib_compress(&zlib, &zlibSize, filtered.data(), filtered.size(), &lodepng_default_compress_settings) == 0);
+
+	unsigned char* png = static_cast<unsigned char*>(malloc(sizeof(signature)));
+	size_t pngSize = sizeof(signature);
+	memcpy(png, signature, sizeof(signature));
+	CHECK(lodepng_chunk_create(&png, &pngSize, sizeof(header), "IHDR", header) == 0);
+	CHECK(lodepng_chunk_create(&png, &pngSize, static_cast<unsigned>(zlibSize), "IDAT", zlib) == 0);
+	CHECK(lodepng_chunk_create(&png, &pngSize, 0, "IEND", 0) == 0);
+
+	std::vector<unsigned char> result(png, png + pngSize);
+	free(png);
+	free(zlib);
+	return result;
+}
+
+// Pixel widths of 1 to 8 bytes, the SSE2 unfiltering handles 4 of them
+static const struct { LodePNGColorType colorType; unsigned bitDepth; unsigned bytesPerPixel; } filterModes[] = {
+	{LCT_RGBA, 8, 4}, {LCT_GREY_ALPHA, 16, 4}, {LCT_GREY, 8, 1}, {LCT_GREY_ALPHA, 8, 2},
+	{LCT_RGB, 8, 3}, {LCT_RGB, 16, 6}, {LCT_RGBA, 16, 8}};
+
+// Pixels of random bytes and of nearly equal ones, the latter make the
+// distances of the Paeth predictor tie
+static std::vector<unsigned char> makeFilterImage(TestRandom& rnd, size_t size)
+{
+	std::vector<unsigned char> raw(size);
+	unsigned char base = static_cast<unsigned char>(rnd.range(256));
+
+	for (size_t i = 0; i < size; ++i)
+		raw[i] = rnd.range(3) ? static_cast<unsigned char>(base + rnd.range(3)) : static_cast<unsigned char>(rnd.range(256));
+	return raw;
+}
+
+// Scanlines filtered by the reference filter with a random type each have
+// to unfilter to the image, for every pixel width and also interlaced
+TEST(LodePNGUnfilter)
+{
+	TestRandom rnd(41);
+
+	for (int trial = 0; trial < 140; ++trial)
+	{
+		int mode = trial % (sizeof(filterModes) / sizeof(filterModes[0]));
+		LodePNGColorType colorType = filterModes[mode].colorType;
+		unsigned bitDepth = filterModes[mode].bitDepth;
+		size_t bytesPerPixel = filterModes[mode].bytesPerPixel;
+		unsigned w = 1 + rnd.range(trial < 70 ? 20 : 90), h = 1 + rnd.range(12);
+		size_t lineBytes = w * bytesPerPixel;
+		std::vector<unsigned char> raw = makeFilterImage(rnd, lineBytes * h);
+
+		std::vector<unsigned char> filtered(h * (lineBytes + 1));
+		for (unsigned y = 0; y < h; ++y)
+		{
+			int type = rnd.range(5);
+			filtered[y * (lineBytes + 1)] = static_cast<unsigned char>(type);
+			filterReference(&filtered[y * (lineBytes + 1) + 1], &raw[y * lineBytes], y ? &raw[(y - 1) * lineBytes] : 0,
+				lineBytes, bytesPerPixel, type);
+		}
+		std::vector<unsigned char> png = makeFilteredPng(filtered, w, h, colorType, bitDepth);
+
+		lodepng::State state;
+		std::vector<unsigned char> decoded;
+		unsigned w2, h2;
+		state.info_raw.colortype = colorType;
+		state.info_raw.bitdepth = bitDepth;
+		CHECK(lodepng::decode(decoded, w2, h2, state, png) == 0);
+		CHECK(w2 == w && h2 == h && decoded == raw);
+
+		// Adam7 unfilters the passes in place, a few bytes behind each other
+		std::vector<unsigned char> interlaced;
+		state.encoder.auto_convert = 0;
+		state.info_png.color.colortype = colorType;
+		state.info_png.color.bitdepth = bitDepth;
+		state.info_png.interlace_method = 1;
+		CHECK(lodepng::encode(interlaced, raw, w, h, state) == 0);
+		decoded.clear();
+		CHECK(lodepng::decode(decoded, w2, h2, state, interlaced) == 0);
+		CHECK(decoded == raw);
+	}
+}
+
+// Inflates the concatenated IDAT chunks of a PNG, giving its filtered scanlines
+static std::vector<unsigned char> inflateIdat(const std::vector<unsigned char>& png)
+{
+	std::vector<unsigned char> zlib;
+	const unsigned char* chunk = png.data() + 8;
+
+	while (!lodepng_chunk_type_equals(chunk, "IEND"))
+	{
+		if (lodepng_chunk_type_equals(chunk, "IDAT"))
+			zlib.insert(zlib.end(), lodepng_chunk_data_const(chunk), lodepng_chunk_data_const(chunk) + lodepng_chunk_length(chunk));
+		chunk = lodepng_chunk_next_const(chunk);
+	}
+
+	unsigned char* filtered = 0;
+	size_t filteredSize = 0;
+	CHECK(lodepng_zlib_decompress(&filtered, &filteredSize, zlib.data(), zlib.size(), &lodepng_default_decompress_settings) == 0);
+	std::vector<unsigned char> result(filtered, filtered + filteredSize);
+	free(filtered);
+	return result;
+}
+
+// The filter type of the LFS_MINSUM heuristic: the smallest sum of the
+// filtered bytes, taken as signed except for type 0, the lowest type on ties
+static int minsumReference(const unsigned char* line, const unsigned char* prev, size_t lineBytes, size_t bytesPerPixel)
+{
+	std::vector<unsigned char> filtered(lineBytes);
+	size_t smallest = 0;
+	int best = 0;
+
+	for (int type = 0; type < 5; ++type)
+	{
+		size_t sum = 0;
+		filterReference(filtered.data(), line, prev, lineBytes, bytesPerPixel, type);
+		for (size_t i = 0; i < lineBytes; ++i)
+			sum += type == 0 || filtered[i] < 128 ? filtered[i] : 255 - filtered[i];
+		if (type == 0 || sum < smallest)
+		{
+			best = type;
+			smallest = sum;
+		}
+	}
+	return best;
+}
+
+// The filter types chosen by the encoder have to be the ones of the
+// reference heuristic, and the PNG must not depend on the number of threads
+// filtering the scanlines
+TEST(LodePNGFilterSelection)
+{
+	TestRandom rnd(42);
+	static const LodePNGFilterStrategy strategies[] = {LFS_MINSUM, LFS_ENTROPY, LFS_BRUTE_FORCE};
+
+	for (int trial = 0; trial < 40; ++trial)
+	{
+		int mode = trial % (sizeof(filterModes) / sizeof(filterModes[0]));
+		LodePNGColorType colorType = filterModes[mode].colorType;
+		unsigned bitDepth = filterModes[mode].bitDepth;
+		size_t bytesPerPixel = filterModes[mode].bytesPerPixel;
+		LodePNGFilterStrategy strategy = strategies[trial % 3];
+
+		// images of more than FILTER_MIN_BYTES per thread are filtered in parallel
+		bool large = strategy != LFS_BRUTE_FORCE && trial % 4 == 0;
+		unsigned w = large ? 1000000 / (400 * static_cast<unsigned>(bytesPerPixel)) : 1 + rnd.range(90);
+		unsigned h = large ? 400 + rnd.range(100) : 1 + rnd.range(30);
+		size_t lineBytes = w * bytesPerPixel;
+		std::vector<unsigned char> raw = makeFilterImage(rnd, lineBytes * h);
+
+		lodepng::State state;
+		std::vector<unsigned char> png, parallelPng;
+		state.encoder.auto_convert = 0;
+		state.encoder.filter_strategy = strategy;
+		state.info_raw.colortype = state.info_png.color.colortype = colorType;
+		state.info_raw.bitdepth = state.info_png.color.bitdepth = bitDepth;
+		CHECK(lodepng::encode(png, raw, w, h, state) == 0);
+
+		state.encoder.num_threads = 2 + rnd.range(3);
+		CHECK(lodepng::encode(parallelPng, raw, w, h, state) == 0);
+		CHECK(parallelPng == png);
+
+		std::vector<unsigned char> filtered = inflateIdat(png);
+		CHECK(filtered.size() == h * (lineBytes + 1));
+		if (filtered.size() != h * (lineBytes + 1))
+			continue;
+
+		std::vector<unsigned char> line(lineBytes);
+		for (unsigned y = 0; y < h; ++y)
+		{
+			const unsigned char* row = &raw[y * lineBytes];
+			const unsigned char* prev = y ? &raw[(y - 1) * lineBytes] : 0;
+			int type = filtered[y * (lineBytes + 1)];
+
+			if (strategy == LFS_MINSUM)
+				CHECK(type == minsumReference(row, prev, lineBytes, bytesPerPixel));
+			filterReference(line.data(), row, prev, lineBytes, bytesPerPixel, type);
+			CHECK(!memcmp(line.data(), &filtered[y * (lineBytes + 1) + 1], lineBytes));
+		}
+	}
+}
+
+// The fast compression levels have to give valid zlib streams of their
+// input, also for runs longer than a match and for repeats beyond the
+// window, and any other level the output of level 0
+TEST(LodePNGFastLevels)
+{
+	TestRandom rnd(43);
+
+	for (int trial = 0; trial < 24; ++trial)
+	{
+		std::vector<unsigned char> data;
+		switch (trial % 3)
+		{
+			case 0:
+				data = makeSkewedData(rnd, 1 + rnd.range(trial < 12 ? 2000 : 300000));
+				break;
+			case 1:
+			{
+				// a random block repeated at a distance just inside or beyond the window
+				size_t distance = 32760 + rnd.range(16) + (rnd.range(2) ? 8000 : 0);
+				for (size_t i = 0; i < distance; ++i)
+					data.push_back(static_cast<unsigned char>(rnd.range(256)));
+				data.insert(data.end(), data.begin(), data.begin() + 5000);
+				break;
+			}
+			default:
+				data = makeImage(rnd, 1 + rnd.range(300), 1 + rnd.range(100));
+				break;
+		}
+
+		unsigned char* zlib = 0;
+		size_t zlibSize = 0;
+		LodePNGCompressSettings settings;
+		lodepng_compress_settings_init(&settings);
+		CHECK(lodepng_zlib_compress(&zlib, &zlibSize, data.data(), data.size(), &settings) == 0);
+		std::vector<unsigned char> level0(zlib, zlib + zlibSize);
+		free(zlib);
+
+		for (unsigned level = 1; level <= 4; ++level)
+		{
+			settings.level = level;
+			settings.btype = 1 + rnd.range(2);
+			zlib = 0;
+			zlibSize = 0;
+			CHECK(lodepng_zlib_compress(&zlib, &zlibSize, data.data(), data.size(), &settings) == 0);
+
+			unsigned char* out = 0;
+			size_t outSize = 0;
+			CHECK(lodepng_zlib_decompress(&out, &outSize, zlib, zlibSize, &lodepng_default_decompress_settings) == 0);
+			CHECK(outSize == data.size() && !memcmp(out, data.data(), outSize));
+			if (level == 4 && settings.btype == 2)
+				CHECK(std::vector<unsigned char>(zlib, zlib + zlibSize) == level0);
+			free(out);
+			free(zlib);
+		}
+	}
+
+	// the hash table of a state that keeps its buffers holds positions of
+	// the previous image
+	LodePNGState state;
+	lodepng_state_init(&state);
+	CHECK(lodepng_state_keep_buffers(&state) == 0);
+	for (int trial = 0; trial < 12; ++trial)
+	{
+		unsigned w = 1 + rnd.range(200), h = 1 + rnd.range(200);
+		std::vector<unsigned char> image = makeImage(rnd, w, h);
+		unsigned char* png = 0;
+		unsigned char* decoded = 0;
+		size_t pngSize = 0;
+		unsigned w2, h2;
+
+		state.encoder.zlibsettings.level = 1 + trial % 3;
+		CHECK(lodepng_encode(&png, &pngSize, image.data(), w, h, &state) == 0);
+		CHECK(lodepng_decode(&decoded, &w2, &h2, &state, png, pngSize) == 0);
+		CHECK(w2 == w && h2 == h && !memcmp(decoded, image.data(), image.size()));
+		free(decoded);
+		free(png);
+	}
+	lodepng_state_cleanup(&state);
+}
+
+// CRC-32 of the PNG chunks, bit by bit
+static unsigned crc32Reference(const unsigned char* data, size_t size)
+{
+	unsigned crc = 0xffffffffu;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; ++bit)
+			crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+	}
+	return crc ^ 0xffffffffu;
+}
+
+// Adler-32 of the zlib streams, one modulo per byte
+static unsigned adler32Reference(const unsigned char* data, size_t size)
+{
+	unsigned s1 = 1, s2 = 0;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		s1 = (s1 + data[i]) % 65521;
+		s2 = (s2 + s1) % 65521;
+	}
+	return (s2 << 16) | s1;
+}
+
+// lodepng_crc32 and the Adler-32 at the end of a zlib stream have to be
+// the checksums of the references for any length and alignment, also for
+// bytes of 255, which let the sums grow fastest
+TEST(LodePNGChecksums)
+{
+	TestRandom rnd(44);
+
+	for (int trial = 0; trial < 60; ++trial)
+	{
+		size_t size = trial < 20 ? trial * 7 : rnd.range(trial < 50 ? 2000 : 70000);
+		size_t offset = rnd.range(32);
+		std::vector<unsigned char> buffer(offset + size);
+		for (size_t i = 0; i < buffer.size(); ++i)
+			buffer[i] = trial % 5 == 0 ? 255 : static_cast<unsigned char>(rnd.range(256));
+		const unsigned char* data = buffer.data() + offset;
+
+		CHECK(lodepng_crc32(data, size) == crc32Reference(data, size));
+
+		unsigned char* zlib = 0;
+		size_t zlibSize = 0;
+		LodePNGCompressSettings settings;
+		lodepng_compress_settings_init(&settings);
+		settings.btype = 0;
+		CHECK(lodepng_zlib_compress(&zlib, &zlibSize, data, size, &settings) == 0);
+		unsigned adler = (unsigned)zlib[zlibSize - 4] << 24 | (unsigned)zlib[zlibSize - 3] << 16 |
+			(unsigned)zlib[zlibSize - 2] << 8 | zlib[zlibSize - 1];
+		CHECK(adler == adler32Reference(data, size));
+
+		// a wrong checksum is rejected
+		unsigned char* out = 0;
+		size_t outSize = 0;
+		zlib[zlibSize - 1 - rnd.range(4)] ^= static_cast<unsigned char>(1 << rnd.range(8));
+		CHECK(lodepng_zlib_decompress(&out, &outSize, zlib, zlibSize, &lodepng_default_decompress_settings) == 58);
+		free(out);
+		free(zlib);
+	}
+}
+
+// lodepng_decode_into has to give the RGBA8 colors of lodepng_decode in
+// its sample format, for all color types, also interlaced or decoded in
+// segments on several threads, and leave the padding of the rows alone
+TEST(LodePNGDecodeInto)
+{
+	TestRandom rnd(45);
+	static const struct { LodePNGColorType colorType; unsigned bitDepth; } modes[] = {
+		{LCT_GREY, 1}, {LCT_GREY, 2}, {LCT_GREY, 4}, {LCT_GREY, 8}, {LCT_GREY, 16}, {LCT_GREY_ALPHA, 8},
+		{LCT_GREY_ALPHA, 16}, {LCT_RGB, 8}, {LCT_RGB, 16}, {LCT_RGBA, 8}, {LCT_RGBA, 16},
+		{LCT_PALETTE, 1}, {LCT_PALETTE, 2}, {LCT_PALETTE, 4}, {LCT_PALETTE, 8}};
+	static const LodePNGSampleFormat formats[] = {LSF_FLOAT_GREY, LSF_FLOAT_RGB, LSF_GREY8};
+	static const unsigned samplesPerPixel[] = {1, 3, 1}, sampleSize[] = {4, 4, 1};
+
+	for (int trial = 0; trial < 90; ++trial)
+	{
+		int mode = trial % (sizeof(modes) / sizeof(modes[0]));
+		unsigned w = 1 + rnd.range(70), h = 1 + rnd.range(40);
+		size_t segmentSize = trial % 3 == 2 ? 64 + rnd.range(2000) : 0;
+		std::vector<unsigned char> png = encodeImage(makeImage(rnd, w, h), w, h, modes[mode].colorType,
+			modes[mode].bitDepth, segmentSize ? 0 : rnd.range(2), segmentSize);
+
+		std::vector<unsigned char> rgba;
+		unsigned w2, h2;
+		CHECK(lodepng::decode(rgba, w2, h2, png) == 0);
+
+		for (int f = 0; f < 3; ++f)
+		{
+			size_t rowSize = w * samplesPerPixel[f] * sampleSize[f];
+			size_t stride = rowSize + 4 * rnd.range(3);
+			std::vector<float> buffer((stride * h + 3) / 4 + 1);
+			unsigned char* out = reinterpret_cast<unsigned char*>(buffer.data());
+			memset(out, 0xAB, buffer.size() * 4);
+			lodepng::State state;
+			state.decoder.num_threads = 3;
+
+			CHECK(lodepng_decode_into(out, stride, formats[f], w, h, &state, png.data(), png.size()) == 0);
+			for (unsigned y = 0; y < h; ++y)
+				for (unsigned x = 0; x < w; ++x)
+				{
+					const unsigned char* c = &rgba[4 * (y * w + x)];
+					unsigned char grey = static_cast<unsigned char>((77u * c[0] + 150u * c[1] + 29u * c[2] + 128u) >> 8);
+					const unsigned char* sample = out + y * stride + x * samplesPerPixel[f] * sampleSize[f];
+					float value[3];
+					memcpy(value, sample, samplesPerPixel[f] * sampleSize[f]);
+
+					if (formats[f] == LSF_GREY8)
+						CHECK(*sample == grey);
+					else if (formats[f] == LSF_FLOAT_GREY)
+						CHECK(value[0] == grey / 255.0f);
+					else
+						CHECK(value[0] == c[0] / 255.0f && value[1] == c[1] / 255.0f && value[2] == c[2] / 255.0f);
+				}
+
+			// the padding between the rows and behind the image is untouched
+			for (unsigned y = 0; y < h; ++y)
+				for (size_t i = rowSize; i < stride; ++i)
+					CHECK(out[y * stride + i] == 0xAB);
+			for (size_t i = stride * (h - 1) + rowSize; i < buffer.size() * 4; ++i)
+				CHECK(out[i] == 0xAB);
+
+			// the size has to be the one of the PNG
+			CHECK(lodepng_decode_into(out, stride, formats[f], w + 1, h, &state, png.data(), png.size()) == 95);
+		}
+	}
+}
+
+// The RGBA8 color of pixel i of a raw image, following the PNG
+// specification: 16-bit samples give their high byte, smaller grey values
+// are scaled to 255 and a matching color key makes the pixel transparent
+static void colorReference(unsigned char rgba[4], const unsigned char* in, size_t i, const LodePNGColorMode& mode)
+{
+	unsigned bits = mode.bitdepth, channels = lodepng_get_channels(&mode);
+	unsigned value[4] = {0, 0, 0, 0}, key;
+
+	for (unsigned c = 0; c < channels; ++c)
+		for (unsigned b = 0; b < bits; ++b)
+		{
+			size_t bit = (i * channels + c) * bits + b;
+			value[c] = (value[c] << 1) | ((in[bit / 8] >> (7 - bit % 8)) & 1);
+		}
+
+	unsigned char high[4];
+	for (unsigned c = 0; c < 4; ++c)
+		high[c] = static_cast<unsigned char>(bits == 16 ? value[c] >> 8 : value[c]);
+
+	switch (mode.colortype)
+	{
+		case LCT_GREY:
+			rgba[0] = rgba[1] = rgba[2] = static_cast<unsigned char>(bits < 8 ? value[0] * 255 / ((1u << bits) - 1) : high[0]);
+			rgba[3] = mode.key_defined && value[0] == mode.key_r ? 0 : 255;
+			break;
+		case LCT_RGB:
+			key = mode.key_defined && value[0] == mode.key_r && value[1] == mode.key_g && value[2] == mode.key_b;
+			rgba[0] = high[0]; rgba[1] = high[1]; rgba[2] = high[2];
+			rgba[3] = key ? 0 : 255;
+			break;
+		case LCT_PALETTE:
+			memcpy(rgba, &mode.palette[4 * value[0]], 4);
+			break;
+		case LCT_GREY_ALPHA:
+			rgba[0] = rgba[1] = rgba[2] = high[0];
+			rgba[3] = high[1];
+			break;
+		default:
+			memcpy(rgba, high, 4);
+			break;
+	}
+}
+
+// lodepng_convert has to give the colors of the reference from every
+// input mode to the 8-bit modes of the vector kernels, for any number of
+// pixels
+TEST(LodePNGConvert)
+{
+	TestRandom rnd(49);
+	static const struct { LodePNGColorType colorType; unsigned bitDepth; } inModes[] = {
+		{LCT_GREY, 1}, {LCT_GREY, 4}, {LCT_GREY, 8}, {LCT_GREY, 16}, {LCT_GREY_ALPHA, 8}, {LCT_GREY_ALPHA, 16},
+		{LCT_RGB, 8}, {LCT_RGB, 16}, {LCT_RGBA, 8}, {LCT_RGBA, 16}, {LCT_PALETTE, 2}, {LCT_PALETTE, 8}};
+	static const LodePNGColorType outTypes[] = {LCT_RGBA, LCT_RGB, LCT_GREY, LCT_GREY_ALPHA};
+
+	for (int trial = 0; trial < 400; ++trial)
+	{
+		int mode = trial % (sizeof(inModes) / sizeof(inModes[0]));
+		unsigned w = 1 + rnd.range(trial < 200 ? 40 : 300), h = 1 + rnd.range(3);
+		LodePNGColorMode in, out;
+		lodepng_color_mode_init(&in);
+		lodepng_color_mode_init(&out);
+		in.colortype = inModes[mode].colorType;
+		in.bitdepth = inModes[mode].bitDepth;
+		out.colortype = outTypes[rnd.range(4)];
+		out.bitdepth = 8;
+
+		// few distinct values, so that color keys match
+		std::vector<unsigned char> raw((lodepng_get_raw_size(w, h, &in)));
+		for (size_t i = 0; i < raw.size(); ++i)
+			raw[i] = static_cast<unsigned char>(rnd.range(2) ? rnd.range(256) : rnd.range(2) * 255);
+		if (in.colortype == LCT_PALETTE)
+			for (unsigned i = 0; i < (1u << in.bitdepth); ++i)
+				lodepng_palette_add(&in, static_cast<unsigned char>(rnd.range(256)), static_cast<unsigned char>(rnd.range(256)),
+					static_cast<unsigned char>(rnd.range(256)), static_cast<unsigned char>(rnd.range(256)));
+		if ((in.colortype == LCT_GREY || in.colortype == LCT_RGB) && rnd.range(2))
+		{
+			unsigned maxValue = (1u << in.bitdepth) - 1;
+			in.key_defined = 1;
+			in.key_r = rnd.range(2) ? maxValue : 0;
+			in.key_g = rnd.range(2) ? maxValue : 0;
+			in.key_b = rnd.range(2) ? maxValue : 0;
+		}
+
+		std::vector<unsigned char> converted(lodepng_get_raw_size(w, h, &out) + 1, 0xAB);
+		CHECK(lodepng_convert(converted.data(), raw.data(), &out, &in, w, h) == 0);
+		CHECK(converted.back() == 0xAB);
+
+		unsigned channels = lodepng_get_channels(&out);
+		for (size_t i = 0; i < static_cast<size_t>(w) * h; ++i)
+		{
+			unsigned char rgba[4];
+			colorReference(rgba, raw.data(), i, in);
+			const unsigned char* pixel = &converted[i * channels];
+
+			// the grey of a color is its red channel
+			switch (out.colortype)
+			{
+				case LCT_RGBA: CHECK(!memcmp(pixel, rgba, 4)); break;
+				case LCT_RGB: CHECK(!memcmp(pixel, rgba, 3)); break;
+				case LCT_GREY: CHECK(pixel[0] == rgba[0]); break;
+				default: CHECK(pixel[0] == rgba[0] && pixel[1] == rgba[3]); break;
+			}
+		}
+
+		lodepng_color_mode_cleanup(&in);
+		lodepng_color_mode_cleanup(&out);
+	}
+}
+
+// the faster profile of opaque 8-bit images has to equal the full one of
+// lodepng_get_color_profile, with few or more than 256 colors, grey or
+// colored anywhere, and the other images have to be left to the full one
+TEST(LodePNGOpaqueColorProfile)
+{
+	TestRandom rnd(50);
+	static const LodePNGColorType colorTypes[] = {LCT_GREY, LCT_RGB, LCT_RGBA};
+	static const int colorCounts[] = {1, 2, 3, 4, 5, 16, 17, 200, 255, 256, 257, 258, 1000};
+
+	for (int trial = 0; trial < 600; ++trial)
+	{
+		LodePNGColorMode mode;
+		lodepng_color_mode_init(&mode);
+		mode.colortype = colorTypes[trial % 3];
+		mode.bitdepth = 8;
+		unsigned w = 1 + rnd.range(trial < 300 ? 20 : 70), h = 1 + rnd.range(trial < 300 ? 20 : 70);
+		size_t numPixels = static_cast<size_t>(w) * h;
+		bool grey = mode.colortype == LCT_GREY || rnd.range(3) == 0;
+
+		// pixels from a set of colors, in runs, with at most one colored
+		// or translucent pixel somewhere in grey or opaque images
+		int numColors = colorCounts[rnd.range(sizeof(colorCounts) / sizeof(colorCounts[0]))];
+		std::vector<unsigned char> colors(numColors * 4);
+		for (int i = 0; i < numColors; ++i)
+		{
+			unsigned char* c = &colors[i * 4];
+			c[0] = static_cast<unsigned char>(grey && numColors <= 256 ? i * 251 + trial : rnd.range(256));
+			c[1] = grey ? c[0] : static_cast<unsigned char>(rnd.range(4) ? rnd.range(256) : c[0]);
+			c[2] = grey ? c[0] : static_cast<unsigned char>(rnd.range(4) ? rnd.range(256) : c[0]);
+			c[3] = 255;
+		}
+		unsigned channels = lodepng_get_channels(&mode);
+		std::vector<unsigned char> image(numPixels * channels);
+		for (size_t i = 0; i < numPixels; ++i)
+		{
+			if (i > 0 && rnd.range(3) == 0)
+				memcpy(&image[i * channels], &image[(i - 1) * channels], channels);
+			else
+				memcpy(&image[i * channels], &colors[rnd.range(numColors) * 4], channels);
+		}
+		size_t odd = rnd.range(2) ? numPixels - 1 - rnd.range(static_cast<int>(numPixels < 5 ? numPixels : 5))
+			: rnd.range(static_cast<int>(numPixels));
+		if (grey && mode.colortype != LCT_GREY && rnd.range(4) == 0)
+			image[odd * channels + 1] ^= 1;
+		bool opaque = mode.colortype != LCT_RGBA || rnd.range(3);
+		if (!opaque)
+			image[odd * 4 + 3] = static_cast<unsigned char>(rnd.range(2) ? 0 : 254);
+		if (rnd.range(10) == 0)
+		{
+			mode.key_defined = 1;
+			mode.key_r = mode.key_g = mode.key_b = image[0];
+		}
+
+		LodePNGColorProfile fast, full;
+		lodepng_color_profile_init(&fast);
+		lodepng_color_profile_init(&full);
+		CHECK(lodepng_get_color_profile(&full, image.data(), w, h, &mode) == 0);
+		if (!opaque || mode.key_defined)
+		{
+			LodePNGColorProfile unchanged = fast;
+			CHECK(lodepng_get_opaque_color_profile(&fast, image.data(), w, h, &mode) == 0);
+			CHECK(!memcmp(&fast, &unchanged, sizeof(fast)));
+		}
+		else
+		{
+			CHECK(lodepng_get_opaque_color_profile(&fast, image.data(), w, h, &mode) == 1);
+			CHECK(fast.colored == full.colored);
+			CHECK(fast.key == full.key && fast.alpha == full.alpha);
+			CHECK(fast.key_r == full.key_r && fast.key_g == full.key_g && fast.key_b == full.key_b);
+			CHECK(fast.numcolors == full.numcolors);
+			CHECK(fast.bits == full.bits);
+			CHECK(!memcmp(fast.palette, full.palette, 4 * (full.numcolors < 256 ? full.numcolors : 256)));
+		}
+
+		lodepng_color_mode_cleanup(&mode);
+	}
+}
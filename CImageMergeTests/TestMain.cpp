@@ -0,0 +1,46 @@
+#include <vector>
+#include <string.h>
+
+#include "Tests.h"
+
+int testFailures = 0;
+
+struct RegisteredTest
+{
+	const char* name;
+	TestFunc func;
+};
+
+static std::vector<RegisteredTest>& registeredTests()
+{
+	static std::vector<RegisteredTest> tests;
+	return tests;
+}
+
+TestCase::TestCase(const char* name, TestFunc func)
+{
+	RegisteredTest test = { name, func };
+	registeredTests().push_back(test);
+}
+
+// Runs all tests, or the ones whose name contains argv[1]
+int main(int argc, char** argv)
+{
+	std::vector<RegisteredTest>& tests = registeredTests();
+	int failedTests = 0;
+
+	for (size_t i = 0; i < tests.size(); ++i)
+	{
+		if (argc >= 2 && !strstr(tests[i].name, argv[1]))
+			continue;
+
+		int failuresBefore = testFailures;
+		tests[i].func();
+		bool failed = testFailures != failuresBefore;
+		failedTests += failed;
+		printf("%-40s %s\n", tests[i].name, failed ? "FAILED" : "ok");
+	}
+
+	printf("%d test(s) failed\n", failedTests);
+	return failedTests ? 1 : 0;
+}
@@ -0,0 +1,49 @@
+#ifndef __TESTS_H__
+#define __TESTS_H__
+
+#include <stdio.h>
+
+// Minimal test registry: TEST(name) defines a test that is run by
+// TestMain.cpp, CHECK(cond) reports a failed condition and goes on.
+
+typedef void (*TestFunc)();
+
+struct TestCase
+{
+	TestCase(const char* name, TestFunc func);
+};
+
+extern int testFailures;
+
+#define TEST(name) \
+	static void name(); \
+	static TestCase name##Case(#name, &name); \
+	static void name()
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			testFailures++; \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		} \
+	} while (0)
+
+// Deterministic pseudo random numbers, so that failures reproduce on
+// every platform
+struct TestRandom
+{
+	unsigned long long state;
+
+	TestRandom(unsigned long long seed) : state(seed * 2862933555777941757ULL + 3037000493ULL) {}
+
+	unsigned next()
+	{
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return static_cast<unsigned>(state >> 33);
+	}
+
+	// uniform in [0, n)
+	int range(int n) { return static_cast<int>(next() % static_cast<unsigned>(n)); }
+};
+
+#endif